@@ -0,0 +1,693 @@
+/*
+    File: lwlte_sys_host.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System layer of the host tests, on libc and pthreads
+    Platform: Host
+*/
+#include "lwlte_sys_host.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_queue.h"
+#include "lwlte_sys_timer.h"
+#include "lwlte_sys_hash.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* A mutex with a condition, the state of a semaphore or of a flags object */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t bits;
+} lwlte_sys_host_signal_t;
+
+static lwlte_sys_host_signal_t* lwlte_sys_host_signal_create(void)
+{
+    lwlte_sys_host_signal_t* s = malloc(sizeof(lwlte_sys_host_signal_t));
+    if (s == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->bits = 0;
+    return s;
+}
+
+static void lwlte_sys_host_signal_delete(lwlte_sys_host_signal_t* s)
+{
+    if (s == NULL) {
+        return;
+    }
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+/* Wait on the condition, the lock held, false once the deadline passed */
+static bool lwlte_sys_host_signal_wait(lwlte_sys_host_signal_t* s, const struct timespec* deadline)
+{
+    if (deadline == NULL) {
+        pthread_cond_wait(&s->cond, &s->lock);
+        return true;
+    }
+    return pthread_cond_timedwait(&s->cond, &s->lock, deadline) != ETIMEDOUT;
+}
+
+/* Deadline of a wait, NULL for UINT32_MAX (forever) */
+static const struct timespec* lwlte_sys_host_deadline(uint32_t timeout_ms, struct timespec* ts)
+{
+    if (timeout_ms == LWLTE_SYS_WAIT_FOREVER) {
+        return NULL;
+    }
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+/* Allocations left before lwlte_sys_mem_malloc fails, -1: never fails */
+static int s_lwlte_sys_host_mem_left = -1;
+
+void lwlte_sys_host_mem_fail_after(int count)
+{
+    __atomic_store_n(&s_lwlte_sys_host_mem_left, count, __ATOMIC_SEQ_CST);
+}
+
+void* lwlte_sys_mem_malloc(lwlte_base_type_t size)
+{
+    int left = __atomic_load_n(&s_lwlte_sys_host_mem_left, __ATOMIC_SEQ_CST);
+    while (left > 0 && !__atomic_compare_exchange_n(&s_lwlte_sys_host_mem_left, &left, left - 1, false, 
+        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+    }
+    if (left == 0) {
+        return NULL;
+    }
+    return malloc(size);
+}
+
+void lwlte_sys_mem_free(void* ptr)
+{
+    free(ptr);
+}
+
+lwlte_sys_mutex_t lwlte_sys_mutex_create(void)
+{
+    pthread_mutex_t* m = malloc(sizeof(pthread_mutex_t));
+    if (m == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(m, NULL);
+    return (lwlte_sys_mutex_t)m;
+}
+
+void lwlte_sys_mutex_lock(lwlte_sys_mutex_t m)
+{
+    if (m == NULL) {
+        return;
+    }
+    pthread_mutex_lock((pthread_mutex_t*)m);
+}
+
+void lwlte_sys_mutex_unlock(lwlte_sys_mutex_t m)
+{
+    if (m == NULL) {
+        return;
+    }
+    pthread_mutex_unlock((pthread_mutex_t*)m);
+}
+
+void lwlte_sys_mutex_delete(lwlte_sys_mutex_t m)
+{
+    if (m == NULL) {
+        return;
+    }
+    pthread_mutex_destroy((pthread_mutex_t*)m);
+    free(m);
+}
+
+static pthread_mutex_t s_lwlte_sys_host_global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void lwlte_sys_global_lock(void)
+{
+    pthread_mutex_lock(&s_lwlte_sys_host_global_lock);
+}
+
+void lwlte_sys_global_unlock(void)
+{
+    pthread_mutex_unlock(&s_lwlte_sys_host_global_lock);
+}
+
+lwlte_sys_semaphore_t lwlte_sys_semaphore_create(void)
+{
+    return (lwlte_sys_semaphore_t)lwlte_sys_host_signal_create();
+}
+
+void lwlte_sys_semaphore_signal(lwlte_sys_semaphore_t s)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)s;
+    if (sig == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sig->lock);
+    sig->bits = 1;
+    pthread_cond_broadcast(&sig->cond);
+    pthread_mutex_unlock(&sig->lock);
+}
+
+bool lwlte_sys_semaphore_wait(lwlte_sys_semaphore_t s, BaseType_t timeout_ms)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)s;
+    if (sig == NULL) {
+        return false;
+    }
+    struct timespec ts;
+    const struct timespec* deadline = lwlte_sys_host_deadline((uint32_t)timeout_ms, &ts);
+    pthread_mutex_lock(&sig->lock);
+    while (sig->bits == 0 && lwlte_sys_host_signal_wait(sig, deadline)) {
+    }
+    bool taken = sig->bits != 0;
+    sig->bits = 0;
+    pthread_mutex_unlock(&sig->lock);
+    return taken;
+}
+
+void lwlte_sys_semaphore_delete(lwlte_sys_semaphore_t s)
+{
+    lwlte_sys_host_signal_delete((lwlte_sys_host_signal_t*)s);
+}
+
+lwlte_sys_flags_t lwlte_sys_flags_create(void)
+{
+    return (lwlte_sys_flags_t)lwlte_sys_host_signal_create();
+}
+
+void lwlte_sys_flags_delete(lwlte_sys_flags_t f)
+{
+    lwlte_sys_host_signal_delete((lwlte_sys_host_signal_t*)f);
+}
+
+void lwlte_sys_flags_set(lwlte_sys_flags_t f, lwlte_sys_flagbits_t bits)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)f;
+    if (sig == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sig->lock);
+    sig->bits |= bits;
+    pthread_cond_broadcast(&sig->cond);
+    pthread_mutex_unlock(&sig->lock);
+}
+
+void lwlte_sys_flags_clear(lwlte_sys_flags_t f, lwlte_sys_flagbits_t bits)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)f;
+    if (sig == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&sig->lock);
+    sig->bits &= ~bits;
+    pthread_mutex_unlock(&sig->lock);
+}
+
+lwlte_sys_flagbits_t lwlte_sys_flags_get(lwlte_sys_flags_t f)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)f;
+    if (sig == NULL) {
+        return 0;
+    }
+    pthread_mutex_lock(&sig->lock);
+    lwlte_sys_flagbits_t bits = sig->bits;
+    pthread_mutex_unlock(&sig->lock);
+    return bits;
+}
+
+bool lwlte_sys_flags_get_bit(lwlte_sys_flags_t f, lwlte_sys_flagbits_t bit)
+{
+    return (lwlte_sys_flags_get(f) & bit) != 0;
+}
+
+static bool lwlte_sys_host_flags_met(uint32_t bits, lwlte_sys_flagbits_t wait_bits, bool wait_all)
+{
+    return wait_all ? (bits & wait_bits) == wait_bits : (bits & wait_bits) != 0;
+}
+
+lwlte_sys_flagbits_t lwlte_sys_flags_wait(lwlte_sys_flags_t f, lwlte_sys_flagbits_t wait_bits, bool wait_all,
+    bool clear_on_exit, uint32_t timeout_ms)
+{
+    lwlte_sys_host_signal_t* sig = (lwlte_sys_host_signal_t*)f;
+    if (sig == NULL) {
+        return 0;
+    }
+    struct timespec ts;
+    const struct timespec* deadline = lwlte_sys_host_deadline(timeout_ms, &ts);
+    pthread_mutex_lock(&sig->lock);
+    while (!lwlte_sys_host_flags_met(sig->bits, wait_bits, wait_all) && timeout_ms != 0 
+        && lwlte_sys_host_signal_wait(sig, deadline)) {
+    }
+    bool met = lwlte_sys_host_flags_met(sig->bits, wait_bits, wait_all);
+    lwlte_sys_flagbits_t bits = met ? sig->bits : 0;
+    if (met && clear_on_exit) {
+        sig->bits &= ~wait_bits;
+    }
+    pthread_mutex_unlock(&sig->lock);
+    return bits;
+}
+
+/* A ring of depth items, the signal lock guards it and its condition wakes both the senders and the receivers */
+typedef struct {
+    lwlte_sys_host_signal_t* sig;
+    size_t item_size;
+    size_t depth;
+    size_t head;
+    size_t count;
+    uint8_t items[];
+} lwlte_sys_host_queue_t;
+
+lwlte_sys_queue_t lwlte_sys_queue_create(BaseType_t item_size, BaseType_t depth)
+{
+    if (item_size <= 0 || depth <= 0) {
+        return NULL;
+    }
+    lwlte_sys_host_queue_t* q = malloc(sizeof(lwlte_sys_host_queue_t) + (size_t)item_size * (size_t)depth);
+    if (q == NULL) {
+        return NULL;
+    }
+    q->sig = lwlte_sys_host_signal_create();
+    if (q->sig == NULL) {
+        free(q);
+        return NULL;
+    }
+    q->item_size = item_size;
+    q->depth = depth;
+    q->head = 0;
+    q->count = 0;
+    return (lwlte_sys_queue_t)q;
+}
+
+void lwlte_sys_queue_delete(lwlte_sys_queue_t q)
+{
+    lwlte_sys_host_queue_t* hq = (lwlte_sys_host_queue_t*)q;
+    if (hq == NULL) {
+        return;
+    }
+    lwlte_sys_host_signal_delete(hq->sig);
+    free(hq);
+}
+
+bool lwlte_sys_queue_send(lwlte_sys_queue_t q, const void* item, uint32_t timeout_ms)
+{
+    lwlte_sys_host_queue_t* hq = (lwlte_sys_host_queue_t*)q;
+    if (hq == NULL || item == NULL) {
+        return false;
+    }
+    struct timespec ts;
+    const struct timespec* deadline = lwlte_sys_host_deadline(timeout_ms, &ts);
+    pthread_mutex_lock(&hq->sig->lock);
+    while (hq->count == hq->depth && timeout_ms != 0 && lwlte_sys_host_signal_wait(hq->sig, deadline)) {
+    }
+    bool sent = hq->count < hq->depth;
+    if (sent) {
+        memcpy(hq->items + ((hq->head + hq->count) % hq->depth) * hq->item_size, item, hq->item_size);
+        hq->count++;
+        pthread_cond_broadcast(&hq->sig->cond);
+    }
+    pthread_mutex_unlock(&hq->sig->lock);
+    return sent;
+}
+
+bool lwlte_sys_queue_recv(lwlte_sys_queue_t q, void* item, uint32_t timeout_ms)
+{
+    lwlte_sys_host_queue_t* hq = (lwlte_sys_host_queue_t*)q;
+    if (hq == NULL || item == NULL) {
+        return false;
+    }
+    struct timespec ts;
+    const struct timespec* deadline = lwlte_sys_host_deadline(timeout_ms, &ts);
+    pthread_mutex_lock(&hq->sig->lock);
+    while (hq->count == 0 && timeout_ms != 0 && lwlte_sys_host_signal_wait(hq->sig, deadline)) {
+    }
+    bool received = hq->count > 0;
+    if (received) {
+        memcpy(item, hq->items + hq->head * hq->item_size, hq->item_size);
+        hq->head = (hq->head + 1) % hq->depth;
+        hq->count--;
+        pthread_cond_broadcast(&hq->sig->cond);
+    }
+    pthread_mutex_unlock(&hq->sig->lock);
+    return received;
+}
+
+/* No interrupts on the host, the caller is a thread like any other */
+bool lwlte_sys_queue_send_from_isr(lwlte_sys_queue_t q, const void* item, bool* need_yield)
+{
+    if (need_yield != NULL) {
+        *need_yield = false;
+    }
+    return lwlte_sys_queue_send(q, item, 0);
+}
+
+/* As in the ESP-IDF port, whose lwlte_sys_thread.c does not build on the host */
+void lwlte_sys_thread_cfg_apply(lwlte_sys_thread_cfg_t* cfg, const lwlte_task_config_t* task_config, const char* name, 
+    uint32_t default_stack_size, uint32_t default_priority, void* arg)
+{
+    cfg->name = name;
+    cfg->stack_size = task_config->stack_size > 0 ? task_config->stack_size : default_stack_size;
+    cfg->priority = task_config->priority > 0 ? task_config->priority : default_priority;
+    cfg->core_id = task_config->pin_to_core ? task_config->core_id : LWLTE_SYS_THREAD_NO_AFFINITY;
+    cfg->arg = arg;
+}
+
+typedef struct {
+    lwlte_sys_thread_fn_t fn;
+    void* arg;
+} lwlte_sys_host_thread_wrap_t;
+
+static void* lwlte_sys_host_thread_trampoline(void* p)
+{
+    lwlte_sys_host_thread_wrap_t w = *(lwlte_sys_host_thread_wrap_t*)p;
+    free(p);
+    w.fn(w.arg);
+    return NULL;
+}
+
+/* The threads are detached, like the FreeRTOS tasks they end by returning from their function.
+   The stack size, the priority and the core are left to the host scheduler */
+lwlte_sys_thread_t lwlte_sys_thread_create(lwlte_sys_thread_fn_t fn, const lwlte_sys_thread_cfg_t* cfg)
+{
+    if (fn == NULL || cfg == NULL) {
+        return NULL;
+    }
+    lwlte_sys_host_thread_wrap_t* w = malloc(sizeof(lwlte_sys_host_thread_wrap_t));
+    if (w == NULL) {
+        return NULL;
+    }
+    w->fn = fn;
+    w->arg = cfg->arg;
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&th, &attr, lwlte_sys_host_thread_trampoline, w);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        free(w);
+        return NULL;
+    }
+    return (lwlte_sys_thread_t)th;
+}
+
+/* A thread can not be killed from outside on the host, the tasks of lwlte return by themselves */
+void lwlte_sys_thread_delete(lwlte_sys_thread_t t)
+{
+}
+
+void lwlte_sys_thread_sleep(uint32_t ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+lwlte_tick_t lwlte_sys_time_get_ticks(void)
+{
+    return lwlte_sys_time_get_ms();
+}
+
+lwlte_tick_t lwlte_sys_time_get_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (lwlte_tick_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+uint32_t lwlte_sys_random(void)
+{
+    return (uint32_t)random();
+}
+
+/* A timer is a thread sleeping until its expiry, the signal lock guards the state */
+typedef struct {
+    lwlte_sys_host_signal_t* sig;
+    pthread_t thread;
+    lwlte_sys_timer_fn_t fn;
+    void* arg;
+    uint32_t period_ms;
+    bool auto_reload;
+    bool armed;
+    bool deleted;
+    struct timespec expiry;
+} lwlte_sys_host_timer_t;
+
+static void* lwlte_sys_host_timer_thread(void* p)
+{
+    lwlte_sys_host_timer_t* t = (lwlte_sys_host_timer_t*)p;
+    pthread_mutex_lock(&t->sig->lock);
+    while (!t->deleted) {
+        if (!t->armed) {
+            lwlte_sys_host_signal_wait(t->sig, NULL);
+            continue;
+        }
+        if (lwlte_sys_host_signal_wait(t->sig, &t->expiry) || !t->armed || t->deleted) {
+            /* Woken by a start, a stop or a delete, the state is checked again */
+            continue;
+        }
+        if (t->auto_reload) {
+            lwlte_sys_host_deadline(t->period_ms, &t->expiry);
+        }
+        else {
+            t->armed = false;
+        }
+        pthread_mutex_unlock(&t->sig->lock);
+        t->fn(t->arg);
+        pthread_mutex_lock(&t->sig->lock);
+    }
+    pthread_mutex_unlock(&t->sig->lock);
+    return NULL;
+}
+
+lwlte_sys_timer_t lwlte_sys_timer_create(const char* name, uint32_t period_ms, bool auto_reload,
+    lwlte_sys_timer_fn_t fn, void* arg)
+{
+    if (fn == NULL || period_ms == 0) {
+        return NULL;
+    }
+    lwlte_sys_host_timer_t* t = calloc(1, sizeof(lwlte_sys_host_timer_t));
+    if (t == NULL) {
+        return NULL;
+    }
+    t->sig = lwlte_sys_host_signal_create();
+    t->fn = fn;
+    t->arg = arg;
+    t->period_ms = period_ms;
+    t->auto_reload = auto_reload;
+    if (t->sig == NULL || pthread_create(&t->thread, NULL, lwlte_sys_host_timer_thread, t) != 0) {
+        lwlte_sys_host_signal_delete(t->sig);
+        free(t);
+        return NULL;
+    }
+    return (lwlte_sys_timer_t)t;
+}
+
+/* Joins the timer thread, so the callback has returned too. A timer can not delete itself from its callback */
+void lwlte_sys_timer_delete(lwlte_sys_timer_t t)
+{
+    lwlte_sys_host_timer_t* ht = (lwlte_sys_host_timer_t*)t;
+    if (ht == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&ht->sig->lock);
+    ht->deleted = true;
+    pthread_cond_broadcast(&ht->sig->cond);
+    pthread_mutex_unlock(&ht->sig->lock);
+    pthread_join(ht->thread, NULL);
+    lwlte_sys_host_signal_delete(ht->sig);
+    free(ht);
+}
+
+bool lwlte_sys_timer_start(lwlte_sys_timer_t t, uint32_t period_ms)
+{
+    lwlte_sys_host_timer_t* ht = (lwlte_sys_host_timer_t*)t;
+    if (ht == NULL || period_ms == 0) {
+        return false;
+    }
+    pthread_mutex_lock(&ht->sig->lock);
+    ht->period_ms = period_ms;
+    ht->armed = true;
+    lwlte_sys_host_deadline(period_ms, &ht->expiry);
+    pthread_cond_broadcast(&ht->sig->cond);
+    pthread_mutex_unlock(&ht->sig->lock);
+    return true;
+}
+
+bool lwlte_sys_timer_stop(lwlte_sys_timer_t t)
+{
+    lwlte_sys_host_timer_t* ht = (lwlte_sys_host_timer_t*)t;
+    if (ht == NULL) {
+        return false;
+    }
+    pthread_mutex_lock(&ht->sig->lock);
+    ht->armed = false;
+    pthread_cond_broadcast(&ht->sig->cond);
+    pthread_mutex_unlock(&ht->sig->lock);
+    return true;
+}
+
+/* SHA-256 of FIPS 180-4, mbedTLS is not available on the host */
+typedef struct {
+    uint32_t state[8];
+    uint64_t length; // bytes hashed
+    uint8_t block[64];
+    size_t fill;
+} lwlte_sys_host_sha256_t;
+
+static const uint32_t s_lwlte_sys_host_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define LWLTE_SYS_HOST_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void lwlte_sys_host_sha256_start(lwlte_sys_host_sha256_t* c)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(c->state, init, sizeof(init));
+    c->length = 0;
+    c->fill = 0;
+}
+
+static void lwlte_sys_host_sha256_block(lwlte_sys_host_sha256_t* c, const uint8_t* p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = LWLTE_SYS_HOST_ROTR(w[i - 15], 7) ^ LWLTE_SYS_HOST_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = LWLTE_SYS_HOST_ROTR(w[i - 2], 17) ^ LWLTE_SYS_HOST_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t v[8];
+    memcpy(v, c->state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = LWLTE_SYS_HOST_ROTR(v[4], 6) ^ LWLTE_SYS_HOST_ROTR(v[4], 11) ^ LWLTE_SYS_HOST_ROTR(v[4], 25);
+        uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1 = v[7] + s1 + ch + s_lwlte_sys_host_sha256_k[i] + w[i];
+        uint32_t s0 = LWLTE_SYS_HOST_ROTR(v[0], 2) ^ LWLTE_SYS_HOST_ROTR(v[0], 13) ^ LWLTE_SYS_HOST_ROTR(v[0], 22);
+        uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        memmove(v + 1, v, 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + s0 + maj;
+    }
+    for (int i = 0; i < 8; i++) {
+        c->state[i] += v[i];
+    }
+}
+
+lwlte_sys_sha256_t lwlte_sys_sha256_create(void)
+{
+    lwlte_sys_host_sha256_t* c = malloc(sizeof(lwlte_sys_host_sha256_t));
+    if (c == NULL) {
+        return NULL;
+    }
+    lwlte_sys_host_sha256_start(c);
+    return (lwlte_sys_sha256_t)c;
+}
+
+void lwlte_sys_sha256_delete(lwlte_sys_sha256_t h)
+{
+    free(h);
+}
+
+void lwlte_sys_sha256_update(lwlte_sys_sha256_t h, const void* data, size_t len)
+{
+    lwlte_sys_host_sha256_t* c = (lwlte_sys_host_sha256_t*)h;
+    if (c == NULL) {
+        return;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    c->length += len;
+    while (len > 0) {
+        size_t n = sizeof(c->block) - c->fill < len ? sizeof(c->block) - c->fill : len;
+        memcpy(c->block + c->fill, p, n);
+        c->fill += n;
+        p += n;
+        len -= n;
+        if (c->fill == sizeof(c->block)) {
+            lwlte_sys_host_sha256_block(c, c->block);
+            c->fill = 0;
+        }
+    }
+}
+
+void lwlte_sys_sha256_finish(lwlte_sys_sha256_t h, uint8_t digest[LWLTE_SYS_SHA256_SIZE])
+{
+    lwlte_sys_host_sha256_t* c = (lwlte_sys_host_sha256_t*)h;
+    if (c == NULL) {
+        return;
+    }
+    /* The padding: 0x80, zeros, then the length in bits on the last 8 bytes of a block */
+    uint64_t bits = c->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t pad_len = (c->fill < 56 ? 56 : 120) - c->fill;
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    lwlte_sys_sha256_update(h, pad, pad_len + 8);
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(c->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(c->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(c->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)c->state[i];
+    }
+    lwlte_sys_host_sha256_start(c);
+}
+
+/* No partition table on the host, the tests use the file storage */
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label)
+{
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from)
+{
+    return NULL;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,13 @@
+/*
+    File: lwlte_sys_host.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: Test hooks of the host system layer
+    Platform: Host
+*/
+#pragma once
+
+/**
+ * Let count more lwlte_sys_mem_malloc calls succeed and fail the ones after, -1 lets them all succeed again.
+ */
+void lwlte_sys_host_mem_fail_after(int count);
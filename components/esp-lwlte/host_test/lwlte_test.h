@@ -0,0 +1,76 @@
+/*
+    File: lwlte_test.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host test assertions, named after the Unity ones
+    - A failed assertion reports its line and returns from the test case, RUN_TEST goes on with the next one.
+    - The test program exits with the number of failed test cases.
+*/
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+static int s_lwlte_test_failures;
+static int s_lwlte_test_failed;
+
+#define TEST_FAIL_MESSAGE(msg) \
+    do { \
+        printf("%s:%d: %s\n", __FILE__, __LINE__, msg); \
+        s_lwlte_test_failed = 1; \
+        return; \
+    } while (0)
+
+#define TEST_ASSERT(cond) \
+    do { \
+        if (!(cond)) { \
+            TEST_FAIL_MESSAGE("expected " #cond); \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_TRUE(cond) TEST_ASSERT(cond)
+#define TEST_ASSERT_FALSE(cond) TEST_ASSERT(!(cond))
+#define TEST_ASSERT_NULL(ptr) TEST_ASSERT((ptr) == NULL)
+#define TEST_ASSERT_NOT_NULL(ptr) TEST_ASSERT((ptr) != NULL)
+
+#define TEST_ASSERT_EQUAL_INT(expected, actual) \
+    do { \
+        long long e_ = (long long)(expected); \
+        long long a_ = (long long)(actual); \
+        if (e_ != a_) { \
+            printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+            s_lwlte_test_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual) \
+    do { \
+        const char* e_ = (expected); \
+        const char* a_ = (actual); \
+        if (strcmp(e_, a_) != 0) { \
+            printf("%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, a_, e_); \
+            s_lwlte_test_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING_LEN(expected, actual, len) \
+    do { \
+        size_t l_ = (len); \
+        if (strlen(expected) != l_ || memcmp((expected), (actual), l_) != 0) { \
+            printf("%s:%d: %s is \"%.*s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, (int)l_, (actual), (expected)); \
+            s_lwlte_test_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define RUN_TEST(fn) \
+    do { \
+        s_lwlte_test_failed = 0; \
+        fn(); \
+        printf("%s %s\n", s_lwlte_test_failed ? "FAIL" : "PASS", #fn); \
+        s_lwlte_test_failures += s_lwlte_test_failed; \
+    } while (0)
+
+#define TEST_RESULT() (s_lwlte_test_failures)
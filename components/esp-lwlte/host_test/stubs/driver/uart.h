@@ -0,0 +1,29 @@
+/*
+    File: uart.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: ESP-IDF UART types for the host tests
+    Platform: Host
+*/
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+
+typedef int uart_port_t;
+
+#define UART_DATA_8_BITS 3
+#define UART_PARITY_DISABLE 0
+#define UART_STOP_BITS_1 1
+#define UART_HW_FLOWCTRL_DISABLE 0
+#define UART_SCLK_DEFAULT 0
+
+typedef struct {
+    int baud_rate;
+    int data_bits;
+    int parity;
+    int stop_bits;
+    int flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+    int source_clk;
+} uart_config_t;
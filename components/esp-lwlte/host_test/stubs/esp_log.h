@@ -0,0 +1,17 @@
+/*
+    File: esp_log.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: ESP-IDF log macros for the host tests, printed to stdout
+    Platform: Host
+*/
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOG_HOST(level, tag, fmt, ...) printf(level " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) ESP_LOG_HOST("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) ESP_LOG_HOST("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) ESP_LOG_HOST("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) ESP_LOG_HOST("D", tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,15 @@
+/*
+    File: esp_ota_ops.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: ESP-IDF OTA API for the host tests
+    Platform: Host
+*/
+#pragma once
+
+#include "esp_partition.h"
+#include "esp_err.h"
+
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from);
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition);
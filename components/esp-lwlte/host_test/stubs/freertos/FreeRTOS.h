@@ -0,0 +1,53 @@
+/*
+    File: FreeRTOS.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: FreeRTOS types for the host tests, no scheduler
+    Platform: Host
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+typedef void* EventGroupHandle_t;
+typedef void* TimerHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef void* TaskHandle_t;
+
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define pdTRUE 1
+#define pdFALSE 0
+
+#define BIT0 (1u << 0)
+#define BIT1 (1u << 1)
+#define BIT2 (1u << 2)
+#define BIT3 (1u << 3)
+#define BIT4 (1u << 4)
+#define BIT5 (1u << 5)
+#define BIT6 (1u << 6)
+#define BIT7 (1u << 7)
+#define BIT8 (1u << 8)
+#define BIT9 (1u << 9)
+#define BIT10 (1u << 10)
+#define BIT11 (1u << 11)
+#define BIT12 (1u << 12)
+#define BIT13 (1u << 13)
+#define BIT14 (1u << 14)
+#define BIT15 (1u << 15)
+#define BIT16 (1u << 16)
+#define BIT17 (1u << 17)
+#define BIT18 (1u << 18)
+#define BIT19 (1u << 19)
+#define BIT20 (1u << 20)
+#define BIT21 (1u << 21)
+#define BIT22 (1u << 22)
+#define BIT23 (1u << 23)
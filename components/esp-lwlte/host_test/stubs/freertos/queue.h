@@ -0,0 +1,10 @@
+/*
+    File: queue.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: FreeRTOS queue for the host tests, the types only
+    Platform: Host
+*/
+#pragma once
+
+#include "freertos/FreeRTOS.h"
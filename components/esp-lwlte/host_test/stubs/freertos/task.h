@@ -0,0 +1,12 @@
+/*
+    File: task.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: FreeRTOS task for the host tests, the types and the priorities
+    Platform: Host
+*/
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#define tskIDLE_PRIORITY 0
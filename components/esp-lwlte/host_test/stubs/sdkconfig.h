@@ -0,0 +1,10 @@
+/*
+    File: sdkconfig.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: ESP-IDF project config for the host tests, there is no lwIP on the host
+    Platform: Host
+*/
+#pragma once
+
+#define CONFIG_LWIP_PPP_SUPPORT 0
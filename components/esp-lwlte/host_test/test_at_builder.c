@@ -0,0 +1,92 @@
+/*
+    File: test_at_builder.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the AT command builder
+*/
+#include "lwlte_at_builder.h"
+#include "lwlte_test.h"
+
+static void test_command(void)
+{
+    char buf[64];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, sizeof(buf));
+    lwlte_at_builder_str(&b, "AT+MPUB=");
+    lwlte_at_builder_quoted(&b, "a/b", 3);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, 1);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, INT32_MIN);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_builder_end(&b));
+    TEST_ASSERT_EQUAL_STRING("AT+MPUB=\"a/b\",1,-2147483648\r\n", buf);
+    TEST_ASSERT_EQUAL_INT(strlen(buf), b.len);
+}
+
+static void test_rewind(void)
+{
+    char buf[64];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, sizeof(buf));
+    lwlte_at_builder_str(&b, "AT+MSUB=");
+    size_t head = b.len;
+    lwlte_at_builder_quoted(&b, "x", 1);
+    lwlte_at_builder_end(&b);
+    /* The head is kept, the arguments are written again */
+    lwlte_at_builder_rewind(&b, head);
+    lwlte_at_builder_quoted(&b, "y/z", 3);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_builder_end(&b));
+    TEST_ASSERT_EQUAL_STRING("AT+MSUB=\"y/z\"\r\n", buf);
+}
+
+static void test_unquotable(void)
+{
+    char buf[64];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, sizeof(buf));
+    lwlte_at_builder_str(&b, "AT+MSUB=");
+    size_t head = b.len;
+    lwlte_at_builder_quoted(&b, "x\"y", 3);
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_at_builder_end(&b));
+    /* The rewind clears the overflow */
+    lwlte_at_builder_rewind(&b, head);
+    lwlte_at_builder_quoted(&b, "x\r\ny", 4);
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_at_builder_end(&b));
+}
+
+static void test_size(void)
+{
+    /* lwlte_at_builder_size leaves room for the longest values */
+    const char* topic = "0123456789012345678901234567";
+    size_t size = lwlte_at_builder_size("AT+MPUB=", strlen(topic), 2, 1);
+    char buf[128];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, size);
+    lwlte_at_builder_str(&b, "AT+MPUB=");
+    lwlte_at_builder_quoted(&b, topic, strlen(topic));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, INT32_MIN);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, INT32_MIN);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_builder_end(&b));
+    /* A buffer too small overflows, and what fitted stays null-terminated */
+    lwlte_at_builder_init(&b, buf, b.len);
+    lwlte_at_builder_str(&b, "AT+MPUB=");
+    lwlte_at_builder_quoted(&b, topic, strlen(topic));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, INT32_MIN);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, INT32_MIN);
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_at_builder_end(&b));
+    TEST_ASSERT_EQUAL_INT(strlen(buf), b.len);
+    TEST_ASSERT_TRUE(b.len < b.size);
+}
+
+int main(void)
+{
+    RUN_TEST(test_command);
+    RUN_TEST(test_rewind);
+    RUN_TEST(test_unquotable);
+    RUN_TEST(test_size);
+    return TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+/*
+    File: test_at_parser.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the AT response tokenizer and schemas
+*/
+#include "lwlte_at_parser.h"
+#include "lwlte_test.h"
+
+static lwlte_err_t parse(lwlte_at_schema_id_t id, const char* response, lwlte_at_field_t* fields)
+{
+    return lwlte_at_parse_response(id, response, strlen(response), fields, LWLTE_AT_SCHEMA_MAX_FIELDS);
+}
+
+static void test_csq_after_echo(void)
+{
+    lwlte_at_field_t f[LWLTE_AT_SCHEMA_MAX_FIELDS];
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CSQ, "AT+CSQ\r\r\n+CSQ: 5,99\r\n\r\nOK\r\n", f));
+    TEST_ASSERT_EQUAL_INT(5, f[0].v.i);
+    TEST_ASSERT_EQUAL_INT(99, f[1].v.i);
+    /* Two digits and spaces around the separator */
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CSQ, "+CSQ:25 , 0\r\n", f));
+    TEST_ASSERT_EQUAL_INT(25, f[0].v.i);
+    TEST_ASSERT_EQUAL_INT(0, f[1].v.i);
+}
+
+static void test_csq_malformed(void)
+{
+    lwlte_at_field_t f[LWLTE_AT_SCHEMA_MAX_FIELDS];
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CSQ, "ERROR\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CSQ, "+CSQ: 5\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CSQ, "+CSQ: x,99\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CSQ, "+CSQ: 5;99\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CSQ, "+CSQ: 99999999999,99\r\n", f));
+}
+
+static void test_field_count(void)
+{
+    lwlte_at_field_t f[1];
+    const char* line = "+CSQ: 5,99\r\n";
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_at_parse_line(LWLTE_AT_SCHEMA_CSQ, line, strlen(line), f, 1));
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_at_parse_line(LWLTE_AT_SCHEMA_MAX, line, strlen(line), f, 1));
+}
+
+static void test_raw_and_str(void)
+{
+    lwlte_at_field_t f[LWLTE_AT_SCHEMA_MAX_FIELDS];
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CPIN, "+CPIN: READY \r\n", f));
+    TEST_ASSERT_TRUE(lwlte_at_slice_eq(&f[0].s, "READY"));
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CDNSGIP, "+CDNSGIP: 1,\"example.com\",\"93.184.216.34\"\r\n", f));
+    TEST_ASSERT_EQUAL_INT(1, f[0].v.i);
+    TEST_ASSERT_EQUAL_STRING_LEN("example.com", f[1].s.ptr, f[1].s.len);
+    TEST_ASSERT_EQUAL_INT(93, f[2].v.ip[0]);
+    TEST_ASSERT_EQUAL_INT(34, f[2].v.ip[3]);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CDNSGIP, "+CDNSGIP: 1,\"example.com\r\n", f));
+}
+
+static void test_ip(void)
+{
+    lwlte_at_field_t f[LWLTE_AT_SCHEMA_MAX_FIELDS];
+    /* The schema without a prefix skips the echo line */
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CIFSR, "AT+CIFSR\r\r\n10.12.3.45\r\n", f));
+    TEST_ASSERT_EQUAL_INT(10, f[0].v.ip[0]);
+    TEST_ASSERT_EQUAL_INT(12, f[0].v.ip[1]);
+    TEST_ASSERT_EQUAL_INT(3, f[0].v.ip[2]);
+    TEST_ASSERT_EQUAL_INT(45, f[0].v.ip[3]);
+    TEST_ASSERT_EQUAL_STRING_LEN("10.12.3.45", f[0].s.ptr, f[0].s.len);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CIFSR, "256.1.1.1\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CIFSR, "1234.1.1.1\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CIFSR, "10.0.1\r\n", f));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, parse(LWLTE_AT_SCHEMA_CIFSR, "10.0.0.1x\r\n", f));
+}
+
+static void test_cipping(void)
+{
+    lwlte_at_field_t f[LWLTE_AT_SCHEMA_MAX_FIELDS];
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, parse(LWLTE_AT_SCHEMA_CIPPING, "+CIPPING: 1,\"8.8.8.8\",120,255\r\n", f));
+    TEST_ASSERT_EQUAL_INT(1, f[0].v.i);
+    TEST_ASSERT_EQUAL_INT(8, f[1].v.ip[0]);
+    TEST_ASSERT_EQUAL_INT(120, f[2].v.i);
+    TEST_ASSERT_EQUAL_INT(255, f[3].v.i);
+}
+
+static void test_tokenizer(void)
+{
+    const char* line = "+MSUB: \"a/b\",-3,  7\r\n";
+    lwlte_at_tokenizer_t tok;
+    TEST_ASSERT_FALSE(lwlte_at_tokenizer_init(&tok, line, strlen(line), "+MPUB:"));
+    TEST_ASSERT_TRUE(lwlte_at_tokenizer_init(&tok, line, strlen(line), "+MSUB:"));
+    lwlte_at_slice_t topic;
+    int32_t a = 0;
+    int32_t b = 0;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_next_str(&tok, &topic));
+    TEST_ASSERT_TRUE(lwlte_at_slice_eq(&topic, "a/b"));
+    /* The slice points into the line, nothing was copied */
+    TEST_ASSERT_TRUE(topic.ptr == line + 8);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_next_int(&tok, &a));
+    TEST_ASSERT_FALSE(lwlte_at_tokenizer_done(&tok));
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_at_next_int(&tok, &b));
+    TEST_ASSERT_EQUAL_INT(-3, a);
+    TEST_ASSERT_EQUAL_INT(7, b);
+    TEST_ASSERT_TRUE(lwlte_at_tokenizer_done(&tok));
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, lwlte_at_next_int(&tok, &a));
+}
+
+int main(void)
+{
+    RUN_TEST(test_csq_after_echo);
+    RUN_TEST(test_csq_malformed);
+    RUN_TEST(test_field_count);
+    RUN_TEST(test_raw_and_str);
+    RUN_TEST(test_ip);
+    RUN_TEST(test_cipping);
+    RUN_TEST(test_tokenizer);
+    return TEST_RESULT();
+}
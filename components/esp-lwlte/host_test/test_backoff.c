@@ -0,0 +1,52 @@
+/*
+    File: test_backoff.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the retry backoff
+*/
+#include "lwlte_backoff.h"
+#include "lwlte_test.h"
+#include <stdbool.h>
+
+/* The delay doubles per attempt and stays in the upper half of it */
+static void test_doubles_with_jitter(void)
+{
+    for (uint32_t attempt = 1; attempt <= 4; attempt++) {
+        uint32_t delay = 100u << (attempt - 1);
+        for (int i = 0; i < 100; i++) {
+            uint32_t ms = lwlte_backoff_ms(100, 10000, attempt);
+            TEST_ASSERT(ms >= delay / 2);
+            TEST_ASSERT(ms <= delay);
+        }
+    }
+}
+
+static void test_capped(void)
+{
+    for (int i = 0; i < 100; i++) {
+        uint32_t ms = lwlte_backoff_ms(100, 1000, 30);
+        TEST_ASSERT(ms >= 500);
+        TEST_ASSERT(ms <= 1000);
+    }
+    uint32_t ms = lwlte_backoff_ms(1000, UINT32_MAX, 64);
+    TEST_ASSERT(ms >= UINT32_MAX / 4);
+}
+
+/* The peers failing together get spread delays */
+static void test_jitter_spreads(void)
+{
+    uint32_t first = lwlte_backoff_ms(1000, 60000, 3);
+    bool spread = false;
+    for (int i = 0; i < 100 && !spread; i++) {
+        spread = lwlte_backoff_ms(1000, 60000, 3) != first;
+    }
+    TEST_ASSERT_TRUE(spread);
+}
+
+int main(void)
+{
+    RUN_TEST(test_doubles_with_jitter);
+    RUN_TEST(test_capped);
+    RUN_TEST(test_jitter_spreads);
+    return TEST_RESULT();
+}
@@ -0,0 +1,312 @@
+/*
+    File: test_core.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the core, its init and its streamed AT commands
+    - The UART of lwlte_ll_hal is replaced by a scripted modem: every command written to it starts a thread
+      that plays the script chunk by chunk to the RX callback, as the UART RX task would.
+    - The core runs in the split task mode, the lines reach the sink through the shared worker.
+*/
+#include "lwlte_core.h"
+#include "lwlte_ll_hal.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_host.h"
+#include "lwlte_test.h"
+#include <pthread.h>
+
+#define TEST_STREAM_UART_BUF_SIZE 128
+#define TEST_STREAM_SCRIPT_MAX 64
+
+typedef struct {
+    uint32_t delay_ms; // before the chunk is received
+    const char* text;
+} test_stream_chunk_t;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool running;
+    bool stop;
+    bool command; // a command was written, the script is to be played
+    bool playing;
+    lwlte_ll_uart_config_t config;
+    test_stream_chunk_t script[TEST_STREAM_SCRIPT_MAX];
+    int script_len;
+    char written[256];
+} s_modem = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+static lwlte_core_t* s_core;
+
+/* Lines received by the sink */
+static char s_lines[4096];
+static int s_line_count;
+static int s_abort_at; // the sink aborts on this line, 0: never
+
+/* Wait for the modem to play out its script, with the lock held */
+static void modem_wait_idle_locked(void)
+{
+    while (s_modem.playing) {
+        pthread_cond_wait(&s_modem.cond, &s_modem.lock);
+    }
+}
+
+static void modem_wait_idle(void)
+{
+    pthread_mutex_lock(&s_modem.lock);
+    modem_wait_idle_locked();
+    pthread_mutex_unlock(&s_modem.lock);
+}
+
+static void modem_script(const test_stream_chunk_t* script, int len)
+{
+    pthread_mutex_lock(&s_modem.lock);
+    modem_wait_idle_locked();
+    memcpy(s_modem.script, script, sizeof(test_stream_chunk_t) * len);
+    s_modem.script_len = len;
+    s_modem.written[0] = '\0';
+    pthread_mutex_unlock(&s_modem.lock);
+    s_lines[0] = '\0';
+    s_line_count = 0;
+    s_abort_at = 0;
+}
+
+static void* modem_thread(void* arg)
+{
+    char chunk[TEST_STREAM_UART_BUF_SIZE];
+    pthread_mutex_lock(&s_modem.lock);
+    while (!s_modem.stop) {
+        if (!s_modem.command) {
+            pthread_cond_wait(&s_modem.cond, &s_modem.lock);
+            continue;
+        }
+        s_modem.command = false;
+        s_modem.playing = true;
+        for (int i = 0; i < s_modem.script_len && !s_modem.stop; i++) {
+            /* The RX task hands over null-terminated chunks below uart_buf_size */
+            test_stream_chunk_t step = s_modem.script[i];
+            size_t len = strlen(step.text);
+            memcpy(chunk, step.text, len + 1);
+            pthread_mutex_unlock(&s_modem.lock);
+            lwlte_sys_thread_sleep(step.delay_ms);
+            s_modem.config.rx_fn(s_modem.config.rx_ctx, chunk, len);
+            pthread_mutex_lock(&s_modem.lock);
+        }
+        s_modem.playing = false;
+        pthread_cond_broadcast(&s_modem.cond);
+    }
+    pthread_mutex_unlock(&s_modem.lock);
+    return NULL;
+}
+
+lwlte_err_t lwlte_ll_uart_init(const lwlte_ll_uart_config_t* config, lwlte_ll_uart_t* uart)
+{
+    s_modem.config = *config;
+    s_modem.stop = false;
+    s_modem.command = false;
+    if (pthread_create(&s_modem.thread, NULL, modem_thread, NULL) != 0) {
+        return LWLTE_ERROR;
+    }
+    s_modem.running = true;
+    *uart = &s_modem;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_uart_deinit(lwlte_ll_uart_t uart)
+{
+    if (uart == NULL || !s_modem.running) {
+        return LWLTE_OK;
+    }
+    pthread_mutex_lock(&s_modem.lock);
+    s_modem.stop = true;
+    pthread_cond_broadcast(&s_modem.cond);
+    pthread_mutex_unlock(&s_modem.lock);
+    pthread_join(s_modem.thread, NULL);
+    s_modem.running = false;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_uart_write(lwlte_ll_uart_t uart, const char* data, size_t size)
+{
+    pthread_mutex_lock(&s_modem.lock);
+    strncat(s_modem.written, data, size);
+    s_modem.command = true;
+    pthread_cond_broadcast(&s_modem.cond);
+    pthread_mutex_unlock(&s_modem.lock);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_gpio_init(lwlte_base_type_t gpio_num, lwlte_base_type_t level)
+{
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_gpio_set_level(lwlte_base_type_t gpio_num, lwlte_base_type_t level)
+{
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_gpio_deinit(lwlte_base_type_t gpio_num)
+{
+    return LWLTE_OK;
+}
+
+static bool collect_line(const char* line, lwlte_base_type_t line_length, void* ctx)
+{
+    s_line_count++;
+    strncat(s_lines, line, line_length);
+    return s_line_count != s_abort_at;
+}
+
+/* A response several times the size of the AT buffer, with an empty line and a line split over two chunks */
+static void test_stream_lines(void)
+{
+    static test_stream_chunk_t script[TEST_STREAM_SCRIPT_MAX];
+    static char lines[20][32];
+    int n = 0;
+    for (int i = 0; i < 20; i++) {
+        snprintf(lines[i], sizeof(lines[i]), "+FSREAD: line %02d of the file\r\n", i);
+        script[n++] = (test_stream_chunk_t){ 1, lines[i] };
+    }
+    script[n++] = (test_stream_chunk_t){ 1, "\r\nO" };
+    script[n++] = (test_stream_chunk_t){ 1, "K\r\n" };
+    modem_script(script, n);
+    lwlte_err_t err = lwlte_core_send_at_cmd_stream_internal(s_core, "AT+FSREAD\r\n", "OK", "ERROR", 2000,
+        collect_line, NULL);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, err);
+    TEST_ASSERT_EQUAL_STRING("AT+FSREAD\r\n", s_modem.written);
+    TEST_ASSERT_EQUAL_INT(22, s_line_count);
+    TEST_ASSERT(strlen(s_lines) > TEST_STREAM_UART_BUF_SIZE * 4);
+    TEST_ASSERT_NOT_NULL(strstr(s_lines, "+FSREAD: line 00 of the file\r\n+FSREAD: line 01"));
+    TEST_ASSERT_NOT_NULL(strstr(s_lines, "+FSREAD: line 19 of the file\r\n\r\nOK\r\n"));
+}
+
+static void test_stream_error(void)
+{
+    static const test_stream_chunk_t script[] = {
+        { 1, "+CME ERROR: 3\r\n" },
+    };
+    modem_script(script, 1);
+    lwlte_err_t err = lwlte_core_send_at_cmd_stream_internal(s_core, "AT+FSREAD\r\n", "OK", "ERROR", 2000,
+        collect_line, NULL);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, err);
+    TEST_ASSERT_EQUAL_INT(1, s_line_count);
+}
+
+/* The sink stops the command, the lines after it are not delivered to it */
+static void test_stream_sink_abort(void)
+{
+    static const test_stream_chunk_t script[] = {
+        { 1, "+FSREAD: 1\r\n" },
+        { 1, "+FSREAD: 2\r\n" },
+        { 1, "+FSREAD: 3\r\n" },
+        { 1, "+FSREAD: 4\r\n" },
+        { 1, "OK\r\n" },
+    };
+    modem_script(script, 5);
+    s_abort_at = 2;
+    lwlte_err_t err = lwlte_core_send_at_cmd_stream_internal(s_core, "AT+FSREAD\r\n", "OK", "ERROR", 2000,
+        collect_line, NULL);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, err);
+    /* Let the rest of the script arrive */
+    modem_wait_idle();
+    TEST_ASSERT_EQUAL_INT(2, s_line_count);
+    TEST_ASSERT_EQUAL_STRING("+FSREAD: 1\r\n+FSREAD: 2\r\n", s_lines);
+}
+
+/* Lines keep arriving, the wait time still bounds the whole command */
+static void test_stream_deadline(void)
+{
+    static test_stream_chunk_t script[TEST_STREAM_SCRIPT_MAX];
+    for (int i = 0; i < 30; i++) {
+        script[i] = (test_stream_chunk_t){ 40, "+FSREAD: more\r\n" };
+    }
+    modem_script(script, 30);
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_err_t err = lwlte_core_send_at_cmd_stream_internal(s_core, "AT+FSREAD\r\n", "OK", "ERROR", 300,
+        collect_line, NULL);
+    lwlte_tick_t elapsed_ms = lwlte_sys_time_get_ms() - start_ms;
+    TEST_ASSERT_EQUAL_INT(LWLTE_TIMEOUT, err);
+    TEST_ASSERT(elapsed_ms >= 300);
+    TEST_ASSERT(elapsed_ms < 450);
+    TEST_ASSERT(s_line_count > 0);
+}
+
+/* No "RDY" comes, the bring-up gives up at once and leaves the AT channel to the tests */
+static lwlte_config_t test_config(void)
+{
+    return (lwlte_config_t){
+        .uart_buf_size = TEST_STREAM_UART_BUF_SIZE,
+        .uart_baudrate = 115200,
+        .at_wait_ticks = 1000,
+        .init_max_time_ms = 10,
+        .rx_mode = LWLTE_RX_MODE_SPLIT_TASK,
+    };
+}
+
+/* Every allocation of the create fails in turn, each failure unwinds and reports LWLTE_NO_MEM */
+static void test_create_no_mem(void)
+{
+    lwlte_config_t config = test_config();
+    config.cmux_enable = true;
+    lwlte_core_t* core = NULL;
+    lwlte_err_t err = LWLTE_NO_MEM;
+    int fail_after = 0;
+    while (err == LWLTE_NO_MEM && fail_after < 32) {
+        lwlte_sys_host_mem_fail_after(fail_after++);
+        err = lwlte_core_create_internal(&config, &core);
+    }
+    lwlte_sys_host_mem_fail_after(-1);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, err);
+    TEST_ASSERT(fail_after > 8);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_core_destroy_internal(core));
+}
+
+/* The re-init of the watchdog runs out of memory, the core is left deinitialized and a later init works */
+static void test_reinit_no_mem(void)
+{
+    lwlte_config_t config = test_config();
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_core_deinit_internal(s_core));
+    lwlte_sys_host_mem_fail_after(3);
+    lwlte_err_t err = lwlte_core_init_internal(s_core, &config);
+    lwlte_sys_host_mem_fail_after(-1);
+    TEST_ASSERT_EQUAL_INT(LWLTE_NO_MEM, err);
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_INITIALIZED, lwlte_core_send_at_cmd_stream_internal(s_core, "AT\r\n", "OK", 
+        "ERROR", 1000, collect_line, NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_core_init_internal(s_core, &config));
+    static const test_stream_chunk_t script[] = {
+        { 1, "OK\r\n" },
+    };
+    modem_script(script, 1);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_core_send_at_cmd_stream_internal(s_core, "AT\r\n", "OK", "ERROR", 1000,
+        collect_line, NULL));
+}
+
+static void test_stream_invalid_args(void)
+{
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_core_send_at_cmd_stream_internal(s_core, "AT\r\n", "OK", "ERROR",
+        1000, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_INITIALIZED, lwlte_core_send_at_cmd_stream_internal(NULL, "AT\r\n", "OK", "ERROR",
+        1000, collect_line, NULL));
+}
+
+int main(void)
+{
+    RUN_TEST(test_create_no_mem);
+    lwlte_config_t config = test_config();
+    if (lwlte_core_create_internal(&config, &s_core) != LWLTE_OK) {
+        printf("FAIL lwlte_core_create_internal\n");
+        return 1;
+    }
+    RUN_TEST(test_stream_lines);
+    RUN_TEST(test_stream_error);
+    RUN_TEST(test_stream_sink_abort);
+    RUN_TEST(test_stream_invalid_args);
+    RUN_TEST(test_reinit_no_mem);
+    RUN_TEST(test_stream_deadline);
+    if (lwlte_core_destroy_internal(s_core) != LWLTE_OK) {
+        printf("FAIL lwlte_core_destroy_internal\n");
+        return 1;
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,390 @@
+/*
+    File: test_http.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the HTTP client, the body framings and the Range resume
+    - The sockets of lwlte_tcp are replaced by scripted connections: each one plays what the server sends
+      on it, then the server closes it. The requests the client sends are recorded.
+*/
+#include "lwlte_http_client.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_test.h"
+#include <stdlib.h>
+
+#define TEST_HTTP_CONNECTIONS 4
+/* Bytes per socket read, small to split the lines and the chunks */
+#define TEST_HTTP_READ_SIZE 37
+#define TEST_HTTP_BODY_MAX 4096
+
+typedef struct {
+    char data[8192];
+    size_t len;
+    size_t pos;
+} test_http_conn_t;
+
+static test_http_conn_t s_conns[TEST_HTTP_CONNECTIONS];
+static int s_conn_count; // connections opened
+static int s_conn = -1; // the open one
+static char s_sent[2048]; // requests sent on all the connections
+static lwlte_sys_flags_t s_events;
+static int s_tcp; // stands for the lwlte_tcp_t, only its address is used
+
+/* Body bytes received per request */
+static uint8_t s_body[4][TEST_HTTP_BODY_MAX];
+static size_t s_body_len[4];
+static int s_calls;
+
+/* Byte at an offset of the test resource */
+static uint8_t pattern(size_t offset)
+{
+    return (uint8_t)('a' + offset % 26);
+}
+
+static void server_text(int conn, const char* text)
+{
+    test_http_conn_t* c = &s_conns[conn];
+    size_t len = strlen(text);
+    memcpy(c->data + c->len, text, len);
+    c->len += len;
+}
+
+static void server_body(int conn, size_t offset, size_t len)
+{
+    test_http_conn_t* c = &s_conns[conn];
+    for (size_t i = 0; i < len; i++) {
+        c->data[c->len++] = (char)pattern(offset + i);
+    }
+}
+
+/* Whether the body of a request is the resource from offset on */
+static bool body_matches(size_t index, size_t offset, size_t len)
+{
+    if (s_body_len[index] != len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (s_body[index][i] != pattern(offset + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void reset(void)
+{
+    memset(s_conns, 0, sizeof(s_conns));
+    memset(s_body_len, 0, sizeof(s_body_len));
+    s_conn_count = 0;
+    s_conn = -1;
+    s_sent[0] = '\0';
+    s_calls = 0;
+    lwlte_sys_flags_clear(s_events, UINT32_MAX);
+}
+
+lwlte_sys_flags_t lwlte_tcp_get_events_internal(lwlte_tcp_t* tcp)
+{
+    return s_events;
+}
+
+lwlte_err_t lwlte_tcp_open_internal(lwlte_tcp_t* tcp, lwlte_socket_type_t type, const char* host, uint16_t port,
+    lwlte_base_type_t timeout_ms, int* id)
+{
+    if (s_conn_count == TEST_HTTP_CONNECTIONS) {
+        return LWLTE_ERROR;
+    }
+    s_conn = s_conn_count++;
+    *id = 0;
+    /* Data to read or a close, and room to send */
+    lwlte_sys_flags_set(s_events, LWLTE_TCP_EVENT_RX(0) | LWLTE_TCP_EVENT_TX(0));
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_tcp_close_internal(lwlte_tcp_t* tcp, int id)
+{
+    s_conn = -1;
+    lwlte_sys_flags_clear(s_events, LWLTE_TCP_EVENT_RX(0) | LWLTE_TCP_EVENT_TX(0));
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_tcp_send_internal(lwlte_tcp_t* tcp, int id, const void* data, size_t len, size_t* sent)
+{
+    size_t used = strlen(s_sent);
+    size_t n = len < sizeof(s_sent) - used - 1 ? len : sizeof(s_sent) - used - 1;
+    memcpy(s_sent + used, data, n);
+    s_sent[used + n] = '\0';
+    *sent = len;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_tcp_recv_internal(lwlte_tcp_t* tcp, int id, void* buf, size_t size, lwlte_base_type_t wait_ms,
+    size_t* received)
+{
+    test_http_conn_t* c = &s_conns[s_conn];
+    size_t n = c->len - c->pos;
+    n = n < size ? n : size;
+    n = n < TEST_HTTP_READ_SIZE ? n : TEST_HTTP_READ_SIZE;
+    memcpy(buf, c->data + c->pos, n);
+    c->pos += n;
+    /* 0 bytes once the script is played: the server closed the connection */
+    *received = n;
+    return LWLTE_OK;
+}
+
+static bool on_body(size_t index, const void* data, size_t len, void* ctx)
+{
+    if (index >= 4 || s_body_len[index] + len > TEST_HTTP_BODY_MAX) {
+        return false;
+    }
+    memcpy(s_body[index] + s_body_len[index], data, len);
+    s_body_len[index] += len;
+    s_calls++;
+    return true;
+}
+
+static lwlte_http_client_t* client_create(lwlte_base_type_t chunk_size)
+{
+    lwlte_http_config_t config = {
+        .host = "example.com",
+        .chunk_size = chunk_size,
+    };
+    lwlte_http_client_t* client = NULL;
+    lwlte_http_client_create_internal((lwlte_tcp_t*)&s_tcp, &config, &client);
+    return client;
+}
+
+static void test_content_length_pipelined(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n");
+    server_body(0, 0, 10);
+    server_text(0, "HTTP/1.1 404 Not Found\r\nContent-Length: 5\r\n\r\nnope!");
+    server_text(0, "HTTP/1.1 200 OK\r\ncontent-length: 3\r\nConnection: close\r\n\r\n");
+    server_body(0, 0, 3);
+    lwlte_http_client_t* client = client_create(0);
+    TEST_ASSERT_NOT_NULL(client);
+    lwlte_http_request_t requests[3] = { { .path = "/a" }, { .path = "/b" }, { .path = "/c" } };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, requests, 3, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(200, requests[0].status);
+    TEST_ASSERT_EQUAL_INT(10, requests[0].total_length);
+    TEST_ASSERT_TRUE(body_matches(0, 0, 10));
+    /* The body of an error status is read and not passed on */
+    TEST_ASSERT_EQUAL_INT(404, requests[1].status);
+    TEST_ASSERT_EQUAL_INT(0, s_body_len[1]);
+    TEST_ASSERT_TRUE(body_matches(2, 0, 3));
+    /* All three sent on one connection before the first response */
+    TEST_ASSERT_EQUAL_INT(1, s_conn_count);
+    TEST_ASSERT_NOT_NULL(strstr(s_sent, "GET /a HTTP/1.1\r\nHost: example.com\r\n"));
+    TEST_ASSERT_NOT_NULL(strstr(s_sent, "GET /c HTTP/1.1\r\n"));
+    TEST_ASSERT_NULL(strstr(s_sent, "Range:"));
+    lwlte_http_stats_t stats;
+    lwlte_http_client_get_stats_internal(client, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.requests);
+    TEST_ASSERT_EQUAL_INT(1, stats.connections);
+    TEST_ASSERT_EQUAL_INT(13, stats.body_bytes);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_chunked(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 100 Continue\r\n\r\n");
+    server_text(0, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+    server_text(0, "5;name=value\r\n");
+    server_body(0, 0, 5);
+    server_text(0, "\r\n1A\r\n");
+    server_body(0, 5, 26);
+    server_text(0, "\r\n0\r\nX-Trailer: yes\r\n\r\n");
+    /* The next response on the same connection starts right after the trailer */
+    server_text(0, "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n");
+    lwlte_http_client_t* client = client_create(8);
+    lwlte_http_request_t requests[2] = { { .path = "/chunked" }, { .path = "/empty" } };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, requests, 2, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(200, requests[0].status);
+    TEST_ASSERT_EQUAL_INT(0, requests[0].total_length);
+    TEST_ASSERT_EQUAL_INT(31, requests[0].received);
+    TEST_ASSERT_TRUE(body_matches(0, 0, 31));
+    /* Chunks of chunk_size, whatever the framing of the body */
+    TEST_ASSERT_EQUAL_INT(4, s_calls);
+    TEST_ASSERT_EQUAL_INT(204, requests[1].status);
+    TEST_ASSERT_EQUAL_INT(1, s_conn_count);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_chunked_malformed(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n");
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/bad" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_SUPPORTED, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_until_close(void)
+{
+    reset();
+    server_text(0, "HTTP/1.0 200 OK\r\n\r\n");
+    server_body(0, 0, 100);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/old" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_TRUE(body_matches(0, 0, 100));
+    TEST_ASSERT_EQUAL_INT(0, request.resumes);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_resume_with_range(void)
+{
+    reset();
+    /* The connection is lost halfway */
+    server_text(0, "HTTP/1.1 200 OK\r\nContent-Length: 3000\r\nETag: \"v1\"\r\n\r\n");
+    server_body(0, 0, 1500);
+    server_text(1, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 1500-2999/3000\r\n"
+        "Content-Length: 1500\r\nETag: \"v1\"\r\n\r\n");
+    server_body(1, 1500, 1500);
+    lwlte_http_client_t* client = client_create(1000);
+    lwlte_http_request_t request = { .path = "/fw.bin" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(206, request.status);
+    TEST_ASSERT_EQUAL_INT(3000, request.total_length);
+    TEST_ASSERT_EQUAL_INT(3000, request.received);
+    TEST_ASSERT_EQUAL_INT(1, request.resumes);
+    TEST_ASSERT_TRUE(body_matches(0, 0, 3000));
+    TEST_ASSERT_EQUAL_INT(2, s_conn_count);
+    TEST_ASSERT_NOT_NULL(strstr(s_sent, "Range: bytes=1500-\r\nIf-Range: \"v1\"\r\n"));
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_resume_long_etag(void)
+{
+    reset();
+    /* The longest ETag the client keeps, 63 characters with its quotes */
+    char etag[64];
+    memset(etag, 'e', sizeof(etag) - 1);
+    etag[0] = '"';
+    etag[sizeof(etag) - 2] = '"';
+    etag[sizeof(etag) - 1] = '\0';
+    char text[256];
+    snprintf(text, sizeof(text), "HTTP/1.1 200 OK\r\nContent-Length: 3000\r\nETag: %s\r\n\r\n", etag);
+    server_text(0, text);
+    server_body(0, 0, 1500);
+    snprintf(text, sizeof(text), "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 1500-2999/3000\r\n"
+        "Content-Length: 1500\r\nETag: %s\r\n\r\n", etag);
+    server_text(1, text);
+    server_body(1, 1500, 1500);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/fw.bin" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_TRUE(body_matches(0, 0, 3000));
+    /* The whole If-Range line was sent */
+    snprintf(text, sizeof(text), "Range: bytes=1500-\r\nIf-Range: %s\r\n", etag);
+    TEST_ASSERT_NOT_NULL(strstr(s_sent, text));
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_resume_range_ignored(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 200 OK\r\nContent-Length: 2000\r\nETag: \"v1\"\r\n\r\n");
+    server_body(0, 0, 700);
+    /* The server sends the whole resource again, the bytes delivered before are skipped */
+    server_text(1, "HTTP/1.1 200 OK\r\nContent-Length: 2000\r\nETag: \"v1\"\r\n\r\n");
+    server_body(1, 0, 2000);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/fw.bin" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(2000, request.received);
+    TEST_ASSERT_TRUE(body_matches(0, 0, 2000));
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_resume_changed(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 200 OK\r\nContent-Length: 2000\r\nETag: \"v1\"\r\n\r\n");
+    server_body(0, 0, 700);
+    server_text(1, "HTTP/1.1 200 OK\r\nContent-Length: 2000\r\nETag: \"v2\"\r\n\r\n");
+    server_body(1, 0, 2000);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/fw.bin" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_SUPPORTED, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(700, request.received);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_offset_request(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 100-199/200\r\nContent-Length: 100\r\n\r\n");
+    server_body(0, 100, 100);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/fw.bin", .offset = 100 };
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_NOT_NULL(strstr(s_sent, "Range: bytes=100-\r\n"));
+    /* No ETag known yet, no If-Range */
+    TEST_ASSERT_NULL(strstr(s_sent, "If-Range"));
+    TEST_ASSERT_EQUAL_INT(200, request.total_length);
+    TEST_ASSERT_TRUE(body_matches(0, 100, 100));
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_wrong_range(void)
+{
+    reset();
+    server_text(0, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 0-99/200\r\nContent-Length: 100\r\n\r\n");
+    server_body(0, 0, 100);
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/fw.bin", .offset = 100 };
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_SUPPORTED, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(0, s_body_len[0]);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_max_resumes(void)
+{
+    reset();
+    /* Every connection is lost before the end of the body */
+    for (int i = 0; i < TEST_HTTP_CONNECTIONS; i++) {
+        server_text(i, "HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n");
+    }
+    lwlte_http_config_t config = {
+        .host = "example.com",
+        .max_resumes = 2,
+    };
+    lwlte_http_client_t* client = NULL;
+    lwlte_http_client_create_internal((lwlte_tcp_t*)&s_tcp, &config, &client);
+    lwlte_http_request_t request = { .path = "/fw.bin" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    TEST_ASSERT_EQUAL_INT(2, request.resumes);
+    TEST_ASSERT_EQUAL_INT(3, s_conn_count);
+    lwlte_http_client_destroy_internal(client);
+}
+
+static void test_invalid_path(void)
+{
+    lwlte_http_client_t* client = client_create(0);
+    lwlte_http_request_t request = { .path = "/a b" };
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    request.path = "relative";
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_http_client_get_internal(client, &request, 1, on_body, NULL));
+    lwlte_http_client_destroy_internal(client);
+}
+
+int main(void)
+{
+    s_events = lwlte_sys_flags_create();
+    RUN_TEST(test_content_length_pipelined);
+    RUN_TEST(test_chunked);
+    RUN_TEST(test_chunked_malformed);
+    RUN_TEST(test_until_close);
+    RUN_TEST(test_resume_with_range);
+    RUN_TEST(test_resume_long_etag);
+    RUN_TEST(test_resume_range_ignored);
+    RUN_TEST(test_resume_changed);
+    RUN_TEST(test_offset_request);
+    RUN_TEST(test_wrong_range);
+    RUN_TEST(test_max_resumes);
+    RUN_TEST(test_invalid_path);
+    lwlte_sys_flags_delete(s_events);
+    return TEST_RESULT();
+}
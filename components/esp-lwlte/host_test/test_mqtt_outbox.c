@@ -0,0 +1,269 @@
+/*
+    File: test_mqtt_outbox.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the MQTT outbox, the recovery after a reboot or a power cut
+    - The log lives in a file storage, a reboot closes it and creates the outbox again on the same file.
+    - The pipeline is replaced by a recorder of the submitted payloads.
+*/
+#include "lwlte_mqtt_outbox.h"
+#include "lwlte_sys_storage.h"
+#include "lwlte_test.h"
+#include <stdio.h>
+
+#define TEST_OUTBOX_PATH "test_mqtt_outbox.bin"
+#define TEST_OUTBOX_SECTOR 256
+#define TEST_OUTBOX_SECTORS 3
+#define TEST_OUTBOX_CAPACITY 4
+
+static lwlte_sys_storage_t s_file;
+/* The file storage with a power cut: the writes fail once s_writes_left reaches 0 */
+static lwlte_sys_storage_t s_storage;
+static int s_writes_left = -1;
+static lwlte_mqtt_outbox_overflow_t s_overflow = LWLTE_MQTT_OUTBOX_DROP_OLDEST;
+static lwlte_mqtt_client_config_t s_config;
+static lwlte_mqtt_outbox_t s_outbox;
+
+/* Payloads submitted to the pipeline and reported dropped, space separated */
+static char s_submitted[1024];
+static char s_dropped[256];
+
+lwlte_err_t lwlte_mqtt_pipeline_submit(lwlte_mqtt_pipeline_t pipeline, const char* topic, const char* payload,
+    size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    strncat(s_submitted, payload, sizeof(s_submitted) - strlen(s_submitted) - 1);
+    strncat(s_submitted, " ", sizeof(s_submitted) - strlen(s_submitted) - 1);
+    return LWLTE_OK;
+}
+
+static void on_publish(lwlte_base_type_t msg_id, lwlte_mqtt_msg_status_t status, void* ctx)
+{
+    if (status == LWLTE_MQTT_MSG_DROPPED) {
+        char id[16];
+        snprintf(id, sizeof(id), "%d ", (int)msg_id);
+        strncat(s_dropped, id, sizeof(s_dropped) - strlen(s_dropped) - 1);
+    }
+}
+
+static lwlte_err_t cut_read(void* ctx, uint32_t offset, void* data, size_t size)
+{
+    return s_file.read(s_file.ctx, offset, data, size);
+}
+
+static lwlte_err_t cut_write(void* ctx, uint32_t offset, const void* data, size_t size)
+{
+    if (s_writes_left == 0) {
+        return LWLTE_ERROR;
+    }
+    if (s_writes_left > 0) {
+        s_writes_left--;
+    }
+    return s_file.write(s_file.ctx, offset, data, size);
+}
+
+static lwlte_err_t cut_erase(void* ctx, uint32_t offset, size_t size)
+{
+    if (s_writes_left == 0) {
+        return LWLTE_ERROR;
+    }
+    return s_file.erase(s_file.ctx, offset, size);
+}
+
+static void boot(void)
+{
+    lwlte_sys_storage_file_open(TEST_OUTBOX_PATH, TEST_OUTBOX_SECTOR * TEST_OUTBOX_SECTORS, TEST_OUTBOX_SECTOR, &s_file);
+    s_storage = s_file;
+    s_storage.read = cut_read;
+    s_storage.write = cut_write;
+    s_storage.erase = cut_erase;
+    s_writes_left = -1;
+    s_config = (lwlte_mqtt_client_config_t)LWLTE_MQTT_CLIENT_CONFIG_DEFAULT();
+    s_config.outbox_t.storage = &s_storage;
+    s_config.outbox_t.overflow = s_overflow;
+    s_config.pipeline_t.on_publish = on_publish;
+    s_outbox = lwlte_mqtt_outbox_create(&s_config, TEST_OUTBOX_CAPACITY);
+    s_submitted[0] = '\0';
+    s_dropped[0] = '\0';
+}
+
+static void shutdown(void)
+{
+    lwlte_mqtt_outbox_delete(s_outbox);
+    s_outbox = NULL;
+    lwlte_sys_storage_file_close(&s_file);
+}
+
+static void reboot(void)
+{
+    shutdown();
+    boot();
+}
+
+static void fresh_boot(void)
+{
+    remove(TEST_OUTBOX_PATH);
+    boot();
+}
+
+static lwlte_err_t append(const char* payload, lwlte_base_type_t* msg_id)
+{
+    return lwlte_mqtt_outbox_append(s_outbox, "a/b", payload, strlen(payload), 1, false, 0, msg_id);
+}
+
+/* Feed and deliver up to count records, -1 for all of them */
+static void deliver(int count)
+{
+    while (count != 0 && lwlte_mqtt_outbox_feed(s_outbox, NULL)) {
+        lwlte_mqtt_outbox_complete(s_outbox, LWLTE_MQTT_MSG_DELIVERED);
+        if (count > 0) {
+            count--;
+        }
+    }
+}
+
+static void test_empty(void)
+{
+    fresh_boot();
+    TEST_ASSERT_NOT_NULL(s_outbox);
+    TEST_ASSERT_FALSE(lwlte_mqtt_outbox_feed(s_outbox, NULL));
+    shutdown();
+}
+
+static void test_pending_after_reboot(void)
+{
+    fresh_boot();
+    lwlte_base_type_t id = 0;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, append("m1", &id));
+    TEST_ASSERT_EQUAL_INT(1, id);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, append("m2", NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, append("m3", NULL));
+    deliver(1);
+    TEST_ASSERT_EQUAL_STRING("m1 ", s_submitted);
+
+    reboot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m2 m3 ", s_submitted);
+    /* The sequence numbers go on after the highest one in the log */
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, append("m4", &id));
+    TEST_ASSERT_EQUAL_INT(4, id);
+
+    reboot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m4 ", s_submitted);
+    shutdown();
+}
+
+static void test_inflight_sent_again(void)
+{
+    /* Fed to the pipeline but not completed before the reboot: sent again, a duplicate rather than a loss */
+    fresh_boot();
+    append("m1", NULL);
+    append("m2", NULL);
+    TEST_ASSERT_TRUE(lwlte_mqtt_outbox_feed(s_outbox, NULL));
+    TEST_ASSERT_TRUE(lwlte_mqtt_outbox_feed(s_outbox, NULL));
+    lwlte_mqtt_outbox_complete(s_outbox, LWLTE_MQTT_MSG_DELIVERED);
+
+    reboot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m2 ", s_submitted);
+    shutdown();
+}
+
+static void test_torn_record(void)
+{
+    fresh_boot();
+    append("m1", NULL);
+    /* Header, topic and payload are written, the power goes before the commit byte */
+    s_writes_left = 3;
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, append("torn", NULL));
+
+    reboot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m1 ", s_submitted);
+    /* The torn record closes its sector, the next records go on in the next one */
+    lwlte_base_type_t id = 0;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, append("m2", &id));
+    TEST_ASSERT_EQUAL_INT(2, id);
+
+    reboot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m2 ", s_submitted);
+    shutdown();
+}
+
+static void test_corrupt_record(void)
+{
+    fresh_boot();
+    append("m1", NULL);
+    append("m2", NULL);
+    shutdown();
+    /* Clear a bit of the first payload, as a flash cell going bad would */
+    FILE* f = fopen(TEST_OUTBOX_PATH, "r+b");
+    TEST_ASSERT_NOT_NULL(f);
+    char record[64];
+    TEST_ASSERT_EQUAL_INT(sizeof(record), fread(record, 1, sizeof(record), f));
+    long payload = 0;
+    while (payload + 5 <= (long)sizeof(record) && memcmp(record + payload, "a/bm1", 5) != 0) {
+        payload++;
+    }
+    TEST_ASSERT_TRUE(payload + 5 <= (long)sizeof(record));
+    fseek(f, payload + 3, SEEK_SET);
+    fputc('m' & 0xFE, f);
+    fclose(f);
+
+    boot();
+    deliver(-1);
+    TEST_ASSERT_EQUAL_STRING("m2 ", s_submitted);
+    shutdown();
+}
+
+static void test_drop_oldest(void)
+{
+    fresh_boot();
+    char payload[16];
+    for (int i = 0; i < 40; i++) {
+        snprintf(payload, sizeof(payload), "p%02d", i);
+        TEST_ASSERT_EQUAL_INT(LWLTE_OK, append(payload, NULL));
+    }
+    /* The oldest sectors were erased for the newest records, their publishes reported dropped */
+    TEST_ASSERT_TRUE(strlen(s_dropped) > 0);
+    TEST_ASSERT_EQUAL_INT(0, strncmp(s_dropped, "1 2 3 ", 6));
+
+    reboot();
+    deliver(-1);
+    /* What is left is delivered in order and ends with the newest */
+    size_t len = strlen(s_submitted);
+    TEST_ASSERT_TRUE(len >= 4);
+    TEST_ASSERT_EQUAL_STRING("p39 ", s_submitted + len - 4);
+    TEST_ASSERT_TRUE(strstr(s_submitted, "p00 ") == NULL);
+    shutdown();
+}
+
+static void test_drop_newest(void)
+{
+    s_overflow = LWLTE_MQTT_OUTBOX_DROP_NEWEST;
+    fresh_boot();
+    int rejected = 0;
+    for (int i = 0; i < 40; i++) {
+        if (append("x", NULL) == LWLTE_ERROR) {
+            rejected++;
+        }
+    }
+    TEST_ASSERT_TRUE(rejected > 0);
+    TEST_ASSERT_EQUAL_STRING("", s_dropped);
+    shutdown();
+    s_overflow = LWLTE_MQTT_OUTBOX_DROP_OLDEST;
+}
+
+int main(void)
+{
+    RUN_TEST(test_empty);
+    RUN_TEST(test_pending_after_reboot);
+    RUN_TEST(test_inflight_sent_again);
+    RUN_TEST(test_torn_record);
+    RUN_TEST(test_corrupt_record);
+    RUN_TEST(test_drop_oldest);
+    RUN_TEST(test_drop_newest);
+    remove(TEST_OUTBOX_PATH);
+    return TEST_RESULT();
+}
@@ -0,0 +1,152 @@
+/*
+    File: test_mqtt_router.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the MQTT topic router, the '+', '#' and '$' matching rules
+*/
+#include "lwlte_mqtt_router.h"
+#include "lwlte_test.h"
+
+/* Handlers called by the last dispatch, by their context */
+static char s_called[512];
+
+static void record(const char* topic, size_t topic_len, const char* payload, size_t payload_len, void* ctx)
+{
+    strncat(s_called, (const char*)ctx, sizeof(s_called) - strlen(s_called) - 1);
+    strncat(s_called, " ", sizeof(s_called) - strlen(s_called) - 1);
+}
+
+static lwlte_base_type_t dispatch(lwlte_mqtt_router_t router, const char* topic)
+{
+    s_called[0] = '\0';
+    return lwlte_mqtt_router_dispatch(router, topic, strlen(topic), "pl", 2);
+}
+
+/* Whether a router holding only this filter calls its handler for the topic */
+static bool matches(const char* filter, const char* topic)
+{
+    lwlte_mqtt_router_t router = lwlte_mqtt_router_create();
+    lwlte_mqtt_router_add(router, filter, record, (void*)filter);
+    bool hit = dispatch(router, topic) == 1;
+    lwlte_mqtt_router_delete(router);
+    return hit;
+}
+
+static void test_exact(void)
+{
+    TEST_ASSERT_TRUE(matches("a/b", "a/b"));
+    TEST_ASSERT_FALSE(matches("a/b", "a/bc"));
+    TEST_ASSERT_FALSE(matches("a/b", "a"));
+    TEST_ASSERT_FALSE(matches("a/b", "a/b/c"));
+    /* Empty levels are levels */
+    TEST_ASSERT_TRUE(matches("a//b", "a//b"));
+    TEST_ASSERT_FALSE(matches("a//b", "a/b"));
+}
+
+static void test_plus(void)
+{
+    TEST_ASSERT_TRUE(matches("a/+", "a/b"));
+    TEST_ASSERT_TRUE(matches("a/+", "a/"));
+    TEST_ASSERT_FALSE(matches("a/+", "a"));
+    TEST_ASSERT_FALSE(matches("a/+", "a/b/c"));
+    TEST_ASSERT_TRUE(matches("+/+", "/b"));
+    TEST_ASSERT_TRUE(matches("dev/+/cmd", "dev/7/cmd"));
+    TEST_ASSERT_FALSE(matches("dev/+/cmd", "dev/7/8/cmd"));
+}
+
+static void test_hash(void)
+{
+    TEST_ASSERT_TRUE(matches("a/#", "a/b/c"));
+    /* '#' also matches the parent level */
+    TEST_ASSERT_TRUE(matches("a/#", "a"));
+    TEST_ASSERT_FALSE(matches("a/#", "b"));
+    TEST_ASSERT_TRUE(matches("#", "a/b"));
+    TEST_ASSERT_TRUE(matches("+/#", "a/b/c"));
+}
+
+static void test_dollar(void)
+{
+    /* A leading wildcard does not match the '$' topics, an explicit level does */
+    TEST_ASSERT_FALSE(matches("#", "$SYS/x"));
+    TEST_ASSERT_FALSE(matches("+/x", "$SYS/x"));
+    TEST_ASSERT_TRUE(matches("$SYS/#", "$SYS/x"));
+    TEST_ASSERT_TRUE(matches("$SYS/+", "$SYS/x"));
+}
+
+static void test_invalid_filters(void)
+{
+    lwlte_mqtt_router_t router = lwlte_mqtt_router_create();
+    TEST_ASSERT_NOT_NULL(router);
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_mqtt_router_add(router, "a#", record, NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_mqtt_router_add(router, "a/#/b", record, NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_mqtt_router_add(router, "a/b+", record, NULL));
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_mqtt_router_add(router, "a/b", NULL, NULL));
+    lwlte_mqtt_router_delete(router);
+}
+
+static void test_overlapping(void)
+{
+    lwlte_mqtt_router_t router = lwlte_mqtt_router_create();
+    const char* filters[] = { "a/b", "a/+", "a/#", "#", "+/b", "a/b/c" };
+    for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_mqtt_router_add(router, filters[i], record, (void*)filters[i]));
+    }
+    /* The same handler and context again has no effect */
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_mqtt_router_add(router, "a/b", record, (void*)filters[0]));
+    TEST_ASSERT_EQUAL_INT(5, dispatch(router, "a/b"));
+    TEST_ASSERT_EQUAL_INT(3, dispatch(router, "a/b/c"));
+    TEST_ASSERT_EQUAL_INT(2, dispatch(router, "a"));
+    TEST_ASSERT_EQUAL_INT(0, dispatch(router, "$SYS/b"));
+
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_mqtt_router_remove(router, "a/#", record, (void*)filters[2]));
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_FOUND, lwlte_mqtt_router_remove(router, "a/#", record, (void*)filters[2]));
+    TEST_ASSERT_EQUAL_INT(1, dispatch(router, "a"));
+    TEST_ASSERT_EQUAL_STRING("# ", s_called);
+    lwlte_mqtt_router_delete(router);
+}
+
+static void test_many_levels(void)
+{
+    lwlte_mqtt_router_t router = lwlte_mqtt_router_create();
+    char filter[32];
+    for (int i = 0; i < 300; i++) {
+        snprintf(filter, sizeof(filter), "dev/x%d/cmd", i);
+        TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_mqtt_router_add(router, filter, record, "dev"));
+    }
+    TEST_ASSERT_EQUAL_INT(1, dispatch(router, "dev/x17/cmd"));
+    TEST_ASSERT_EQUAL_INT(1, dispatch(router, "dev/x299/cmd"));
+    TEST_ASSERT_EQUAL_INT(0, dispatch(router, "dev/x300/cmd"));
+    lwlte_mqtt_router_delete(router);
+}
+
+static lwlte_mqtt_router_t s_router;
+
+static void remove_self(const char* topic, size_t topic_len, const char* payload, size_t payload_len, void* ctx)
+{
+    lwlte_mqtt_router_remove(s_router, "x/+", remove_self, ctx);
+}
+
+static void test_handler_removes_itself(void)
+{
+    /* More handlers than the dispatch keeps on the stack */
+    s_router = lwlte_mqtt_router_create();
+    for (intptr_t i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_mqtt_router_add(s_router, "x/+", remove_self, (void*)i));
+    }
+    TEST_ASSERT_EQUAL_INT(20, dispatch(s_router, "x/y"));
+    TEST_ASSERT_EQUAL_INT(0, dispatch(s_router, "x/y"));
+    lwlte_mqtt_router_delete(s_router);
+}
+
+int main(void)
+{
+    RUN_TEST(test_exact);
+    RUN_TEST(test_plus);
+    RUN_TEST(test_hash);
+    RUN_TEST(test_dollar);
+    RUN_TEST(test_invalid_filters);
+    RUN_TEST(test_overlapping);
+    RUN_TEST(test_many_levels);
+    RUN_TEST(test_handler_removes_itself);
+    return TEST_RESULT();
+}
@@ -0,0 +1,268 @@
+/*
+    File: test_ota.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the OTA writer on a file standing in for the update partition
+    - The HTTP client is replaced by a server of one image: it answers from the offset asked for and can cut
+      the transfer at a given byte. The offsets asked for are recorded.
+    - The file storage is wrapped to fail one write, the failed write programs zeros over a part of its range
+      like an interrupted flash write.
+*/
+#include "lwlte_ota_update.h"
+#include "lwlte_http_client.h"
+#include "lwlte_sys_storage.h"
+#include "lwlte_sys_hash.h"
+#include "lwlte_test.h"
+#include <stdlib.h>
+
+#define TEST_OTA_FILE "test_ota.bin"
+#define TEST_OTA_SECTOR_SIZE 4096
+#define TEST_OTA_STORAGE_SIZE (16 * TEST_OTA_SECTOR_SIZE)
+#define TEST_OTA_IMAGE_SIZE (5 * TEST_OTA_SECTOR_SIZE + 1234)
+/* Bytes per body callback, not a divisor of the sector size */
+#define TEST_OTA_CHUNK_SIZE 1000
+#define TEST_OTA_BUFFER_SIZE 1500
+
+static uint8_t s_image[TEST_OTA_IMAGE_SIZE];
+static uint8_t s_image_sha[LWLTE_SYS_SHA256_SIZE];
+
+static struct {
+    uint32_t cut_at; // the transfer stops before this byte, 0: never
+    uint32_t offsets[8]; // offset of each request
+    int calls;
+} s_server;
+
+static struct {
+    lwlte_sys_storage_t file;
+    uint32_t fail_at; // the write covering this offset fails once, UINT32_MAX: never
+} s_flash;
+
+static int s_http; // stands for the lwlte_http_client_t, only its address is used
+
+lwlte_err_t lwlte_http_client_get_internal(lwlte_http_client_t* client, lwlte_http_request_t* requests, size_t count,
+    lwlte_http_body_cb_t cb, void* ctx)
+{
+    lwlte_http_request_t* req = &requests[0];
+    s_server.offsets[s_server.calls++] = req->offset;
+    req->status = req->offset > 0 ? 206 : 200;
+    req->total_length = TEST_OTA_IMAGE_SIZE;
+    req->received = 0;
+    req->resumes = 0;
+    uint32_t pos = req->offset;
+    while (pos < TEST_OTA_IMAGE_SIZE) {
+        if (s_server.cut_at > 0 && pos >= s_server.cut_at) {
+            s_server.cut_at = 0;
+            return LWLTE_ERROR;
+        }
+        uint32_t n = TEST_OTA_IMAGE_SIZE - pos < TEST_OTA_CHUNK_SIZE ? TEST_OTA_IMAGE_SIZE - pos : TEST_OTA_CHUNK_SIZE;
+        if (s_server.cut_at > pos && s_server.cut_at - pos < n) {
+            n = s_server.cut_at - pos;
+        }
+        req->received += n;
+        if (!cb(0, s_image + pos, n, ctx)) {
+            return LWLTE_ERROR;
+        }
+        pos += n;
+    }
+    return LWLTE_OK;
+}
+
+static lwlte_err_t flash_read(void* ctx, uint32_t offset, void* data, size_t size)
+{
+    return s_flash.file.read(s_flash.file.ctx, offset, data, size);
+}
+
+static lwlte_err_t flash_write(void* ctx, uint32_t offset, const void* data, size_t size)
+{
+    if (s_flash.fail_at >= offset && s_flash.fail_at < offset + size) {
+        s_flash.fail_at = UINT32_MAX;
+        uint8_t zeros[TEST_OTA_SECTOR_SIZE] = { 0 };
+        s_flash.file.write(s_flash.file.ctx, offset, zeros, size / 2);
+        return LWLTE_ERROR;
+    }
+    return s_flash.file.write(s_flash.file.ctx, offset, data, size);
+}
+
+static lwlte_err_t flash_erase(void* ctx, uint32_t offset, size_t size)
+{
+    return s_flash.file.erase(s_flash.file.ctx, offset, size);
+}
+
+static lwlte_sys_storage_t s_storage = {
+    .read = flash_read,
+    .write = flash_write,
+    .erase = flash_erase,
+    .size = TEST_OTA_STORAGE_SIZE,
+    .sector_size = TEST_OTA_SECTOR_SIZE,
+};
+
+/* A new erased file for each test */
+static bool flash_open(void)
+{
+    remove(TEST_OTA_FILE);
+    s_flash.fail_at = UINT32_MAX;
+    memset(&s_server, 0, sizeof(s_server));
+    return lwlte_sys_storage_file_open(TEST_OTA_FILE, TEST_OTA_STORAGE_SIZE, TEST_OTA_SECTOR_SIZE,
+        &s_flash.file) == LWLTE_OK;
+}
+
+static void flash_close(void)
+{
+    lwlte_sys_storage_file_close(&s_flash.file);
+    remove(TEST_OTA_FILE);
+}
+
+/* Whether the storage holds the image */
+static bool flash_holds_image(void)
+{
+    static uint8_t data[TEST_OTA_IMAGE_SIZE];
+    return s_flash.file.read(s_flash.file.ctx, 0, data, sizeof(data)) == LWLTE_OK &&
+        memcmp(data, s_image, sizeof(data)) == 0;
+}
+
+static lwlte_ota_config_t ota_config(const uint8_t* sha256)
+{
+    return (lwlte_ota_config_t){
+        .http = (lwlte_http_handle_t)&s_http,
+        .path = "/fw/app.bin",
+        .storage = &s_storage,
+        .sha256 = sha256,
+    };
+}
+
+/* The host SHA-256 against the FIPS 180-2 example */
+static void test_sha256_vector(void)
+{
+    static const uint8_t expected[LWLTE_SYS_SHA256_SIZE] = {
+        0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+        0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+    };
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    lwlte_sys_sha256_t sha = lwlte_sys_sha256_create();
+    TEST_ASSERT_NOT_NULL(sha);
+    lwlte_sys_sha256_update(sha, "abc", 3);
+    lwlte_sys_sha256_finish(sha, digest);
+    lwlte_sys_sha256_delete(sha);
+    TEST_ASSERT(memcmp(digest, expected, sizeof(digest)) == 0);
+}
+
+/* The first bytes are in the storage from a previous boot, they are hashed again and not downloaded */
+static void test_resume_offset(void)
+{
+    TEST_ASSERT_TRUE(flash_open());
+    uint32_t resume_offset = 2 * TEST_OTA_SECTOR_SIZE + 700;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, s_flash.file.erase(s_flash.file.ctx, 0, 3 * TEST_OTA_SECTOR_SIZE));
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, s_flash.file.write(s_flash.file.ctx, 0, s_image, resume_offset));
+    lwlte_ota_config_t config = ota_config(s_image_sha);
+    config.resume_offset = resume_offset;
+    lwlte_ota_t* ota = NULL;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_ota_begin_internal(&config, &ota));
+    lwlte_err_t err = lwlte_ota_run_internal(ota);
+    lwlte_ota_stats_t stats;
+    lwlte_ota_get_stats_internal(ota, &stats);
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    lwlte_err_t sha_err = lwlte_ota_get_sha256_internal(ota, digest);
+    lwlte_ota_end_internal(ota);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, err);
+    TEST_ASSERT_EQUAL_INT(1, s_server.calls);
+    TEST_ASSERT_EQUAL_INT(resume_offset, s_server.offsets[0]);
+    TEST_ASSERT_EQUAL_INT(TEST_OTA_IMAGE_SIZE, stats.written);
+    TEST_ASSERT_EQUAL_INT(1, stats.resumes);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, sha_err);
+    TEST_ASSERT(memcmp(digest, s_image_sha, sizeof(digest)) == 0);
+    TEST_ASSERT_TRUE(flash_holds_image());
+    flash_close();
+}
+
+/* A run cut by the link resumes from the last byte written */
+static void test_resume_after_cut(void)
+{
+    TEST_ASSERT_TRUE(flash_open());
+    s_server.cut_at = 3 * TEST_OTA_SECTOR_SIZE + 100;
+    lwlte_ota_config_t config = ota_config(s_image_sha);
+    lwlte_ota_t* ota = NULL;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_ota_begin_internal(&config, &ota));
+    lwlte_err_t first = lwlte_ota_run_internal(ota);
+    lwlte_err_t second = lwlte_ota_run_internal(ota);
+    lwlte_ota_end_internal(ota);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, first);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, second);
+    TEST_ASSERT_EQUAL_INT(2, s_server.calls);
+    TEST_ASSERT_EQUAL_INT(0, s_server.offsets[0]);
+    TEST_ASSERT_EQUAL_INT(3 * TEST_OTA_SECTOR_SIZE + 100, s_server.offsets[1]);
+    TEST_ASSERT_TRUE(flash_holds_image());
+    flash_close();
+}
+
+/* A wrong digest discards the image, the next run starts over */
+static void test_sha_mismatch(void)
+{
+    TEST_ASSERT_TRUE(flash_open());
+    uint8_t wrong[LWLTE_SYS_SHA256_SIZE];
+    memcpy(wrong, s_image_sha, sizeof(wrong));
+    wrong[0] ^= 0x01;
+    lwlte_ota_config_t config = ota_config(wrong);
+    lwlte_ota_t* ota = NULL;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_ota_begin_internal(&config, &ota));
+    lwlte_err_t first = lwlte_ota_run_internal(ota);
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    lwlte_err_t sha_err = lwlte_ota_get_sha256_internal(ota, digest);
+    lwlte_ota_stats_t stats;
+    lwlte_ota_get_stats_internal(ota, &stats);
+    lwlte_err_t second = lwlte_ota_run_internal(ota);
+    lwlte_ota_end_internal(ota);
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_SUPPORTED, first);
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_INITIALIZED, sha_err);
+    TEST_ASSERT_EQUAL_INT(0, stats.written);
+    TEST_ASSERT_EQUAL_INT(LWLTE_NOT_SUPPORTED, second);
+    TEST_ASSERT_EQUAL_INT(2, s_server.calls);
+    TEST_ASSERT_EQUAL_INT(0, s_server.offsets[1]);
+    flash_close();
+}
+
+/* The failed write left zeros in its sector, the next run erases the sector and writes it from its start.
+   The buffers are not a divisor of the sector size, so the failed write starts within the sector. */
+static void test_write_error_rewrites_sector(void)
+{
+    TEST_ASSERT_TRUE(flash_open());
+    s_flash.fail_at = 3 * TEST_OTA_SECTOR_SIZE + 10;
+    lwlte_ota_config_t config = ota_config(s_image_sha);
+    config.buffer_size = TEST_OTA_BUFFER_SIZE;
+    lwlte_ota_t* ota = NULL;
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_ota_begin_internal(&config, &ota));
+    lwlte_err_t first = lwlte_ota_run_internal(ota);
+    lwlte_ota_stats_t stats;
+    lwlte_ota_get_stats_internal(ota, &stats);
+    lwlte_err_t second = lwlte_ota_run_internal(ota);
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    lwlte_err_t sha_err = lwlte_ota_get_sha256_internal(ota, digest);
+    lwlte_ota_end_internal(ota);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, first);
+    /* The write at 12000 failed, the hash went back to the start of its sector */
+    TEST_ASSERT_EQUAL_INT(2 * TEST_OTA_SECTOR_SIZE, stats.written);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, second);
+    TEST_ASSERT_EQUAL_INT(2, s_server.calls);
+    TEST_ASSERT_EQUAL_INT(2 * TEST_OTA_SECTOR_SIZE, s_server.offsets[1]);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, sha_err);
+    TEST_ASSERT(memcmp(digest, s_image_sha, sizeof(digest)) == 0);
+    TEST_ASSERT_TRUE(flash_holds_image());
+    flash_close();
+}
+
+int main(void)
+{
+    srand(1);
+    for (size_t i = 0; i < sizeof(s_image); i++) {
+        s_image[i] = (uint8_t)rand();
+    }
+    lwlte_sys_sha256_t sha = lwlte_sys_sha256_create();
+    lwlte_sys_sha256_update(sha, s_image, sizeof(s_image));
+    lwlte_sys_sha256_finish(sha, s_image_sha);
+    lwlte_sys_sha256_delete(sha);
+    RUN_TEST(test_sha256_vector);
+    RUN_TEST(test_resume_offset);
+    RUN_TEST(test_resume_after_cut);
+    RUN_TEST(test_sha_mismatch);
+    RUN_TEST(test_write_error_rewrites_sector);
+    return TEST_RESULT();
+}
@@ -0,0 +1,73 @@
+/*
+    File: test_slab.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the fixed-size block pool
+*/
+#include "lwlte_slab.h"
+#include "lwlte_test.h"
+
+static void test_alloc_free(void)
+{
+    lwlte_slab_t slab = lwlte_slab_create(5, 3);
+    TEST_ASSERT_NOT_NULL(slab);
+    lwlte_slab_stats_t stats;
+    lwlte_slab_get_stats(slab, &stats);
+    /* Rounded up to the pointer alignment */
+    TEST_ASSERT_EQUAL_INT(sizeof(void*), stats.block_size);
+    void* blocks[3];
+    for (int i = 0; i < 3; i++) {
+        blocks[i] = lwlte_slab_alloc(slab, 5);
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+        TEST_ASSERT_EQUAL_INT(0, (uintptr_t)blocks[i] % sizeof(void*));
+    }
+    TEST_ASSERT_NULL(lwlte_slab_alloc(slab, 5));
+    TEST_ASSERT_NULL(lwlte_slab_alloc(slab, stats.block_size + 1));
+    lwlte_slab_free(slab, blocks[1]);
+    /* The freed block is the next one served */
+    TEST_ASSERT_TRUE(lwlte_slab_alloc(slab, 1) == blocks[1]);
+    lwlte_slab_get_stats(slab, &stats);
+    TEST_ASSERT_EQUAL_INT(3, stats.in_use);
+    TEST_ASSERT_EQUAL_INT(3, stats.peak);
+    TEST_ASSERT_EQUAL_INT(1, stats.exhausted);
+    TEST_ASSERT_EQUAL_INT(1, stats.oversize);
+    for (int i = 0; i < 3; i++) {
+        lwlte_slab_free(slab, blocks[i]);
+    }
+    lwlte_slab_get_stats(slab, &stats);
+    TEST_ASSERT_EQUAL_INT(0, stats.in_use);
+    lwlte_slab_delete(slab);
+}
+
+static void test_acquire_falls_back(void)
+{
+    lwlte_slab_t slab = lwlte_slab_create(16, 1);
+    void* pooled = lwlte_slab_acquire(slab, 16);
+    /* The pool is empty, and the size does not fit a block: both from the heap */
+    void* empty = lwlte_slab_acquire(slab, 8);
+    void* large = lwlte_slab_acquire(slab, 100);
+    TEST_ASSERT_NOT_NULL(pooled);
+    TEST_ASSERT_NOT_NULL(empty);
+    TEST_ASSERT_NOT_NULL(large);
+    memset(large, 0, 100);
+    lwlte_slab_stats_t stats;
+    lwlte_slab_get_stats(slab, &stats);
+    TEST_ASSERT_EQUAL_INT(1, stats.in_use);
+    lwlte_slab_release(slab, large);
+    lwlte_slab_release(slab, empty);
+    lwlte_slab_release(slab, pooled);
+    lwlte_slab_get_stats(slab, &stats);
+    TEST_ASSERT_EQUAL_INT(0, stats.in_use);
+    lwlte_slab_delete(slab);
+    /* Without a pool everything is on the heap */
+    void* heap = lwlte_slab_acquire(NULL, 10);
+    TEST_ASSERT_NOT_NULL(heap);
+    lwlte_slab_release(NULL, heap);
+}
+
+int main(void)
+{
+    RUN_TEST(test_alloc_free);
+    RUN_TEST(test_acquire_falls_back);
+    return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+/*
+    File: test_sys_storage.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte host tests of the file storage, the flash stand-in of the outbox and the OTA tests
+*/
+#include "lwlte_sys_storage.h"
+#include "lwlte_test.h"
+#include <stdio.h>
+
+#define TEST_STORAGE_PATH "test_sys_storage.bin"
+
+static void test_new_file_is_erased(void)
+{
+    remove(TEST_STORAGE_PATH);
+    lwlte_sys_storage_t storage;
+    /* The size is rounded down to the sectors */
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, lwlte_sys_storage_file_open(TEST_STORAGE_PATH, 1000, 256, &storage));
+    TEST_ASSERT_EQUAL_INT(768, storage.size);
+    TEST_ASSERT_EQUAL_INT(256, storage.sector_size);
+    uint8_t data[16];
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, storage.read(storage.ctx, 752, data, sizeof(data)));
+    for (size_t i = 0; i < sizeof(data); i++) {
+        TEST_ASSERT_EQUAL_INT(0xFF, data[i]);
+    }
+    lwlte_sys_storage_file_close(&storage);
+    TEST_ASSERT_EQUAL_INT(LWLTE_INVALID_ARG, lwlte_sys_storage_file_open(TEST_STORAGE_PATH, 100, 256, &storage));
+}
+
+static void test_write_clears_bits(void)
+{
+    remove(TEST_STORAGE_PATH);
+    lwlte_sys_storage_t storage;
+    lwlte_sys_storage_file_open(TEST_STORAGE_PATH, 512, 256, &storage);
+    uint8_t first = 0xF0;
+    uint8_t second = 0x3C;
+    uint8_t value = 0;
+    storage.write(storage.ctx, 10, &first, 1);
+    storage.write(storage.ctx, 10, &second, 1);
+    /* As on flash, a write only clears bits */
+    storage.read(storage.ctx, 10, &value, 1);
+    TEST_ASSERT_EQUAL_INT(0x30, value);
+    /* The erase brings the whole sector back to 0xFF, the other one is kept */
+    storage.write(storage.ctx, 300, &first, 1);
+    TEST_ASSERT_EQUAL_INT(LWLTE_OK, storage.erase(storage.ctx, 0, 256));
+    storage.read(storage.ctx, 10, &value, 1);
+    TEST_ASSERT_EQUAL_INT(0xFF, value);
+    storage.read(storage.ctx, 300, &value, 1);
+    TEST_ASSERT_EQUAL_INT(0xF0, value);
+    lwlte_sys_storage_file_close(&storage);
+}
+
+static void test_reopen_keeps_content(void)
+{
+    remove(TEST_STORAGE_PATH);
+    lwlte_sys_storage_t storage;
+    lwlte_sys_storage_file_open(TEST_STORAGE_PATH, 256, 256, &storage);
+    const char text[] = "kept";
+    storage.write(storage.ctx, 0, text, sizeof(text));
+    lwlte_sys_storage_file_close(&storage);
+    /* A larger size extends the file with erased bytes */
+    lwlte_sys_storage_file_open(TEST_STORAGE_PATH, 512, 256, &storage);
+    char data[sizeof(text)];
+    uint8_t tail = 0;
+    storage.read(storage.ctx, 0, data, sizeof(data));
+    storage.read(storage.ctx, 511, &tail, 1);
+    TEST_ASSERT_EQUAL_STRING(text, data);
+    TEST_ASSERT_EQUAL_INT(0xFF, tail);
+    TEST_ASSERT_EQUAL_INT(LWLTE_ERROR, storage.read(storage.ctx, 510, data, sizeof(data)));
+    lwlte_sys_storage_file_close(&storage);
+}
+
+int main(void)
+{
+    RUN_TEST(test_new_file_is_erased);
+    RUN_TEST(test_write_clears_bits);
+    RUN_TEST(test_reopen_keeps_content);
+    remove(TEST_STORAGE_PATH);
+    return TEST_RESULT();
+}
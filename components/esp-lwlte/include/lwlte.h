@@ -9,11 +9,91 @@
 
 #include "lwlte_sys_types.h"
 #include "freertos/FreeRTOS.h"
+#include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef enum {
+    LWLTE_RX_MODE_SPLIT_TASK = 0, // the UART RX task queues the data to the core worker task (default)
+    LWLTE_RX_MODE_SINGLE_TASK, // the UART RX task frames and dispatches the lines itself, saves a task and a context switch per chunk
+} lwlte_rx_mode_t;
+
+/* Placement of an lwlte task, a zero-initialized config selects the built-in defaults */
+typedef struct
+{
+    lwlte_base_type_t stack_size; // Stack size in bytes, 0: default
+    lwlte_base_type_t priority; // Task priority, 0: default
+    lwlte_base_type_t core_id; // Core to pin the task to, only used if pin_to_core is set
+    bool pin_to_core; // false: the task may run on any core
+} lwlte_task_config_t;
+
+/* Modem health watchdog, a zero-initialized config leaves it disabled and selects the defaults */
+typedef struct
+{
+    bool enable; // Supervise the module and recover it automatically
+    lwlte_base_type_t check_interval_ms; // Health check period, 0: default
+    lwlte_base_type_t rx_silence_ms; // Probe the module with "AT" after this long without RX, 0: default
+    lwlte_base_type_t max_consecutive_timeouts; // AT timeouts in a row that declare the module stuck, 0: default
+    lwlte_base_type_t backoff_base_ms; // Wait before the first escalation, doubled at each step, 0: default
+    lwlte_base_type_t backoff_max_ms; // Upper bound of the wait between recovery actions, 0: default
+} lwlte_watchdog_config_t;
+
+typedef enum {
+    LWLTE_WATCHDOG_STAGE_NONE = 0, // healthy
+    LWLTE_WATCHDOG_STAGE_SOFT, // AT probe, then AT+CIPSHUT and network bring-up again
+    LWLTE_WATCHDOG_STAGE_POWER_CYCLE, // power-cycle through the EN pin
+    LWLTE_WATCHDOG_STAGE_FULL_REINIT, // deinit and init the whole core
+} lwlte_watchdog_stage_t;
+
+typedef struct
+{
+    lwlte_watchdog_stage_t stage; // Last recovery stage run, NONE once healthy
+    uint32_t timeout_events; // Times the consecutive AT timeouts limit was hit
+    uint32_t rx_silence_events; // Times the module did not answer the probe after a silence
+    uint32_t unexpected_rdy_events; // Times the module rebooted by itself
+    uint32_t activation_failures; // Times the network bring-up gave up
+    uint32_t soft_recoveries; // Recovery actions run per stage
+    uint32_t power_cycles;
+    uint32_t full_reinits;
+    uint32_t recoveries; // Times the module got healthy again after a failure
+    uint32_t last_recovery_ms; // Time from failure detection to healthy
+    uint32_t max_recovery_ms;
+    uint64_t total_recovery_ms; // total_recovery_ms / recoveries is the mean time to recover
+} lwlte_watchdog_stats_t;
+
+/**
+ * A certificate or key for the module, uploaded to its file system. The data is read from memory or from
+ * a storage (e.g. a flash partition) in chunks, it is never copied to RAM as a whole.
+ */
+typedef struct
+{
+    const char* name; // File name on the module, the file is uploaded again only if its size changed
+    const void* data; // PEM or DER in memory (e.g. an embedded file), NULL to read it from storage
+    const lwlte_sys_storage_t* storage; // Used if data is NULL
+    uint32_t offset; // Of the file in storage
+    uint32_t size; // Bytes
+} lwlte_tls_file_t;
+
+typedef enum {
+    LWLTE_TLS_VERIFY_NONE = 0, // encryption only
+    LWLTE_TLS_VERIFY_SERVER, // the server certificate is checked against ca_cert
+    LWLTE_TLS_VERIFY_MUTUAL, // and the module authenticates with client_cert and client_key
+} lwlte_tls_verify_t;
+
+/* TLS run by the module, a zero-initialized config leaves it disabled */
+typedef struct
+{
+    bool enable;
+    lwlte_tls_verify_t verify;
+    lwlte_tls_file_t ca_cert; // Required from LWLTE_TLS_VERIFY_SERVER
+    lwlte_tls_file_t client_cert; // Required with LWLTE_TLS_VERIFY_MUTUAL
+    lwlte_tls_file_t client_key; // Required with LWLTE_TLS_VERIFY_MUTUAL
+    bool session_resume; // Resume the previous TLS session (ticket or ID) instead of a full handshake on reconnect
+} lwlte_tls_config_t;
+
 typedef struct
 {
     lwlte_base_type_t gpio_en_num; // GPIO number of the EN pin
@@ -24,10 +104,152 @@ typedef struct
     lwlte_base_type_t uart_baudrate; // UART baudrate
     lwlte_tick_t at_wait_ticks; // AT command wait time
     lwlte_base_type_t init_max_time_ms; // Initialization maximum time
+    bool cmux_enable; // Run the AT, data and URC channels over a 3GPP 27.010 multiplexer, Optional
+    lwlte_base_type_t cmux_frame_size; // Maximum frame size (N1), 0: default, at most uart_buf_size - 1, Optional
+    bool ppp_enable; // Run the IP link in lwIP over PPP (on the CMUX data channel if enabled) instead of the module's stack, Optional
+    bool socket_mux; // Bring the module's IP stack up with several connections (AT+CIPMUX=1), required by lwlte_socket, Optional
+    bool probe_before_power_on; // Probe the module with "AT" first and skip the EN power cycle if it answers, Optional
+    lwlte_rx_mode_t rx_mode; // How the received data reaches the line framer, Optional
+    lwlte_task_config_t rx_task; // UART RX task, Optional
+    lwlte_task_config_t worker_task; // Core worker task (split task mode only), Optional
+    lwlte_task_config_t activate_task; // Network bring-up task, Optional
+    lwlte_watchdog_config_t watchdog; // Modem health watchdog, Optional
+    lwlte_task_config_t watchdog_task; // Watchdog task, Optional
 } lwlte_config_t;
 
+/* One modem instance, see lwlte_core_create */
+typedef struct lwlte_core_s* lwlte_handle_t;
+
+/**
+ * Start the default lwlte core. It does not block on the module: the EN power cycle is timer driven
+ * and the network bring-up runs in its own task.
+ */
 esp_err_t lwlte_core_init(const lwlte_config_t* config);
 
+/**
+ * Stop the lwlte tasks, remove the UART driver, power the module off and free all resources.
+ * lwlte_core_init can be called again afterwards.
+ */
+esp_err_t lwlte_core_deinit(void);
+
+/**
+ * Recover a wedged module without rebooting the MCU: power-cycle it through the EN pin and
+ * run the network bring-up again. The UART, the tasks and all handles stay valid.
+ */
+esp_err_t lwlte_core_restart(void);
+
+/**
+ * Get the counters of the modem health watchdog.
+ */
+esp_err_t lwlte_core_get_watchdog_stats(lwlte_watchdog_stats_t* stats);
+
+/**
+ * Start an additional modem instance on its own UART and EN pin. The instances share one worker task,
+ * every other resource (tasks, buffers, watchdog) belongs to the instance.
+ * Create and destroy the instances from one task, these calls are not reentrant.
+ */
+esp_err_t lwlte_core_create(const lwlte_config_t* config, lwlte_handle_t* handle);
+
+/**
+ * Stop an instance created by lwlte_core_create and free it, the handle is invalid afterwards.
+ */
+esp_err_t lwlte_core_destroy(lwlte_handle_t handle);
+
+esp_err_t lwlte_core_restart_instance(lwlte_handle_t handle);
+
+esp_err_t lwlte_core_get_watchdog_stats_instance(lwlte_handle_t handle, lwlte_watchdog_stats_t* stats);
+
+/**
+ * Get the instance started by lwlte_core_init, NULL if it is not started.
+ */
+lwlte_handle_t lwlte_core_get_default(void);
+
+/**
+ * Receives the response of a streamed AT command line by line. It runs on the core worker task that all
+ * instances share (on the instance's RX task in LWLTE_RX_MODE_SINGLE_TASK), so it must not block:
+ * copy the line or hand it to another task and return, a slow sink stalls the other instances too.
+ * @param line The line including its "\r\n", only valid during the call
+ * @return true to continue, false aborts the command with ESP_FAIL
+ */
+typedef bool (*lwlte_core_line_sink_t)(const char* line, lwlte_base_type_t line_length, void* ctx);
+
+/**
+ * Send an AT command and pass its response lines to a sink as they arrive, for responses larger than
+ * uart_buf_size (e.g. AT+CIPRXGET or a file read). The command ends on wait_str, error_str or the sink aborting.
+ * @param wait_time_ms Deadline of the whole command, however many lines arrive
+ * @return ESP_ERR_TIMEOUT past the deadline
+ */
+esp_err_t lwlte_core_send_at_cmd_stream(const char* cmd, const char* wait_str, const char* error_str, 
+    lwlte_base_type_t wait_time_ms, lwlte_core_line_sink_t sink, void* ctx);
+
+esp_err_t lwlte_core_send_at_cmd_stream_instance(lwlte_handle_t handle, const char* cmd, const char* wait_str, 
+    const char* error_str, lwlte_base_type_t wait_time_ms, lwlte_core_line_sink_t sink, void* ctx);
+
+/* Links (modem instances) one scheduler can spread the traffic over */
+#define LWLTE_SCHED_MAX_LINKS 4
+
+/**
+ * Told when a link becomes usable or unusable (network lost, watchdog recovering it),
+ * called from the scheduler task. Sessions pinned to a link that went down should pick a new one.
+ * The callback must not add or remove links.
+ */
+typedef void (*lwlte_sched_link_event_cb_t)(lwlte_handle_t link, bool usable, void* ctx);
+
+/* Link scheduler, a zero-initialized config selects the defaults */
+typedef struct
+{
+    lwlte_base_type_t refresh_interval_ms; // Period of the link checks and of the CSQ readings, 0: default
+    lwlte_sched_link_event_cb_t on_link_event; // Link up/down notification, Optional
+    void* ctx; // Passed to on_link_event
+    lwlte_task_config_t task; // Scheduler task, Optional
+} lwlte_sched_config_t;
+
+typedef struct
+{
+    bool usable; // Network connected and not being recovered by the watchdog
+    lwlte_base_type_t latency_ms; // Moving average of the AT round-trip time
+    lwlte_base_type_t pending_cmds; // AT commands in flight or queued on the link
+    lwlte_base_type_t csq; // Last CSQ reading, 99: unknown
+    uint32_t weight; // Current share of the traffic, relative to the other links
+    uint32_t picks; // Times the link was picked
+    uint32_t failovers; // Times the link went from usable to unusable
+} lwlte_sched_link_stats_t;
+
+/* opaque handle */
+typedef struct lwlte_sched_s* lwlte_sched_handle_t;
+
+/**
+ * Create a scheduler spreading the traffic over several modem instances by latency, queue depth and signal quality.
+ */
+esp_err_t lwlte_sched_create(const lwlte_sched_config_t* config, lwlte_sched_handle_t* handle);
+
+/**
+ * Stop the scheduler task and free it, the links are not touched.
+ */
+esp_err_t lwlte_sched_destroy(lwlte_sched_handle_t handle);
+
+esp_err_t lwlte_sched_add_link(lwlte_sched_handle_t handle, lwlte_handle_t link);
+
+/**
+ * Remove a link, to be done before the instance is destroyed. Waits for a link check in progress.
+ */
+esp_err_t lwlte_sched_remove_link(lwlte_sched_handle_t handle, lwlte_handle_t link);
+
+/**
+ * Pick the link for the next message or session. Successive picks are spread over the usable links
+ * in proportion to their weights (smooth weighted round-robin), so a better link carries more traffic
+ * without starving the others.
+ * @return ESP_ERR_NOT_FOUND if no link is usable
+ */
+esp_err_t lwlte_sched_pick(lwlte_sched_handle_t handle, lwlte_handle_t* link);
+
+/**
+ * Check a link picked earlier, a long-lived session calls it before using its link again.
+ */
+bool lwlte_sched_link_usable(lwlte_sched_handle_t handle, lwlte_handle_t link);
+
+esp_err_t lwlte_sched_get_link_stats(lwlte_sched_handle_t handle, lwlte_handle_t link, lwlte_sched_link_stats_t* stats);
+
 
 #ifdef __cplusplus
 }
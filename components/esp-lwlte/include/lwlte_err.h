@@ -20,6 +20,8 @@ typedef enum {
     LWLTE_NOT_SUPPORTED,
     LWLTE_NOT_INITIALIZED,
     LWLTE_ALREADY_INITIALIZED,
+    LWLTE_NOT_FOUND,
+    LWLTE_NO_MEM,
 } lwlte_err_t;
 
 esp_err_t lwlte_err_2_esp_err(lwlte_err_t err);
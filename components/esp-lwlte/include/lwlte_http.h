@@ -0,0 +1,90 @@
+/*
+    File: lwlte_http.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte http client api header file
+    - HTTP/1.1 GET over a socket of lwlte_socket, the body is streamed to a callback in fixed-size chunks.
+    - The connection is kept open between the requests, several requests are pipelined on it.
+    - A download cut by a connection loss resumes with a Range request from the last byte delivered.
+*/
+#pragma once
+
+#include "lwlte_socket.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Requests sent before the first response is read */
+#define LWLTE_HTTP_PIPELINE_MAX 4
+
+/**
+ * Receives the body of a successful (2xx) response, called from the task of lwlte_http_client_get.
+ * @param index The request in the array given to lwlte_http_client_get
+ * @return false to stop the transfer
+ */
+typedef bool (*lwlte_http_body_cb_t)(size_t index, const void* data, size_t len, void* ctx);
+
+typedef struct
+{
+    const char* host;
+    uint16_t port; // 0: 80
+    const char* headers; // Extra request header lines, each ending with "\r\n", Optional
+    lwlte_base_type_t chunk_size; // Bytes per callback, the last one of a body may be shorter, 0: default
+    lwlte_base_type_t timeout_ms; // Connect and inactivity timeout, 0: default
+    lwlte_base_type_t max_resumes; // Reconnects per request after a connection loss, 0: default
+} lwlte_http_config_t;
+
+typedef struct
+{
+    const char* path; // Absolute path with the query, e.g. "/fw/app.bin"
+    uint32_t offset; // First byte to fetch, not 0 sends a Range request
+    /* Filled in by lwlte_http_client_get */
+    int status; // 0 if no response came
+    uint32_t total_length; // Size of the whole resource, 0 if unknown (chunked)
+    uint32_t received; // Body bytes passed to the callback, the resource is complete at offset + received
+    uint32_t resumes; // Reconnects during this request
+} lwlte_http_request_t;
+
+typedef struct
+{
+    uint32_t requests; // Requests sent, resent ones included
+    uint32_t connections; // Connections opened
+    uint32_t reused; // Requests sent on a kept-alive connection
+    uint32_t resumes; // Requests resent after a connection loss
+    uint32_t body_bytes; // Body bytes passed to the callbacks
+} lwlte_http_stats_t;
+
+/* opaque handle */
+typedef struct lwlte_http_client_s* lwlte_http_handle_t;
+
+/**
+ * Create a client for one server on a socket layer, nothing is sent yet.
+ */
+esp_err_t lwlte_http_client_create(lwlte_socket_handle_t sockets, const lwlte_http_config_t* config, 
+    lwlte_http_handle_t* handle);
+
+/**
+ * Close the connection and free the client.
+ */
+esp_err_t lwlte_http_client_destroy(lwlte_http_handle_t handle);
+
+/**
+ * GET the requests in order, LWLTE_HTTP_PIPELINE_MAX at a time on one connection.
+ * A request answered with a status other than 2xx is complete, its body is not passed to the callback.
+ * @return ESP_FAIL if the callback stopped the transfer or a request failed after max_resumes reconnects,
+ *         the requests before it are complete
+ */
+esp_err_t lwlte_http_client_get(lwlte_http_handle_t handle, lwlte_http_request_t* requests, size_t count, 
+    lwlte_http_body_cb_t cb, void* ctx);
+
+esp_err_t lwlte_http_client_get_stats(lwlte_http_handle_t handle, lwlte_http_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
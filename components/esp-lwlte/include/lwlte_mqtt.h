@@ -6,7 +6,7 @@
 */
 #pragma once
 
-#include "lwlte_mqtt.h"
+#include "lwlte.h"
 #include "lwlte_sys_types.h"
 #include "lwlte_err.h"
 
@@ -28,6 +28,41 @@
         .port = LWLTE_MQTT_CFG_UNSET_INT, \
         .clean_session = LWLTE_MQTT_CFG_UNSET_INT, \
         .keepalive = LWLTE_MQTT_CFG_UNSET_INT \
+    }, \
+    .tls_t = { \
+        .enable = false, \
+    }, \
+    .pipeline_t = { \
+        .max_inflight = LWLTE_MQTT_CFG_UNSET_INT, \
+        .ack_timeout_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+        .max_retries = LWLTE_MQTT_CFG_UNSET_INT, \
+        .default_qos = LWLTE_MQTT_CFG_UNSET_INT, \
+        .on_publish = NULL, \
+        .ctx = NULL, \
+    }, \
+    .reconnect_t = { \
+        .enable = false, \
+        .check_interval_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+        .backoff_base_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+        .backoff_max_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+        .dns_ttl_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+        .session_expiry_ms = LWLTE_MQTT_CFG_UNSET_INT, \
+    }, \
+    .pool_t = { \
+        .topic_size = LWLTE_MQTT_CFG_UNSET_INT, \
+        .payload_size = LWLTE_MQTT_CFG_UNSET_INT, \
+        .block_count = LWLTE_MQTT_CFG_UNSET_INT, \
+    }, \
+    .outbox_t = { \
+        .storage = NULL, \
+        .overflow = LWLTE_MQTT_OUTBOX_DROP_OLDEST, \
+    }, \
+    .batch_t = { \
+        .window_ms = 0, \
+        .max_bytes = LWLTE_MQTT_CFG_UNSET_INT, \
+        .max_count = LWLTE_MQTT_CFG_UNSET_INT, \
+        .flush_qos = LWLTE_MQTT_CFG_UNSET_INT, \
+        .format = LWLTE_MQTT_BATCH_NETSTRING, \
     } \
 }
 
@@ -35,6 +70,62 @@
 extern "C" {
 #endif
 
+typedef enum {
+    LWLTE_MQTT_MSG_DELIVERED = 0, // the module accepted the publish, it runs the QoS 1/2 handshake with the broker
+    LWLTE_MQTT_MSG_FAILED, // the publish was rejected or timed out after all the retries
+    LWLTE_MQTT_MSG_DROPPED, // the client was deinitialized before the publish was sent, or the outbox overflowed
+    LWLTE_MQTT_MSG_UNKNOWN, // a QoS 2 publish the module did not answer, it may have reached the broker and is not sent again
+} lwlte_mqtt_msg_status_t;
+
+/* Framing of the publishes coalesced into one batch message */
+typedef enum {
+    LWLTE_MQTT_BATCH_NETSTRING = 0, // <len>:<payload>, repeated, e.g. 5:hello,2:hi,
+    LWLTE_MQTT_BATCH_JSON_ARRAY, // [<payload>,<payload>], the payloads must be JSON values
+} lwlte_mqtt_batch_format_t;
+
+/**
+ * Receives a message of a subscription, called from the core worker.
+ * @param topic, payload Slices of the receive buffer, only valid during the call and not null-terminated.
+ * The payload may hold line breaks and binary data
+ */
+typedef void (*lwlte_mqtt_message_cb_t)(const char* topic, size_t topic_len, const char* payload, size_t payload_len, void* ctx);
+
+/* What a publish does when the outbox is full */
+typedef enum {
+    LWLTE_MQTT_OUTBOX_DROP_OLDEST = 0, // erase the oldest sector, its publishes are reported dropped
+    LWLTE_MQTT_OUTBOX_DROP_NEWEST, // reject the new publish
+    LWLTE_MQTT_OUTBOX_BLOCK, // wait up to wait_ms for the oldest sector to be delivered
+} lwlte_mqtt_outbox_overflow_t;
+
+/* Usage of a block pool of the client, see lwlte_mqtt_client_get_pool_stats */
+typedef struct {
+    lwlte_base_type_t block_size;
+    lwlte_base_type_t block_count;
+    lwlte_base_type_t in_use;
+    lwlte_base_type_t peak; // highest in_use since init
+    lwlte_base_type_t exhausted; // allocations that found the pool empty and went to the heap
+    lwlte_base_type_t oversize; // allocations larger than a block, they went to the heap
+} lwlte_mqtt_pool_stats_t;
+
+/* Reconnect and time-to-resume counters, see lwlte_mqtt_client_get_reconnect_stats */
+typedef struct {
+    uint32_t sessions_lost; // Times the session was found down while it should be up
+    uint32_t reconnects; // Times the session was opened again
+    uint32_t failed_attempts; // Reconnect attempts that failed, each followed by a backoff
+    uint32_t last_reconnect_ms; // Time from the loss detection to the session being up again
+    uint32_t max_reconnect_ms;
+    uint64_t total_reconnect_ms; // total_reconnect_ms / reconnects is the mean time to resume
+    uint32_t dns_lookups; // AT+CDNSGIP sent for the broker
+    uint32_t dns_cache_hits; // Connects that used the cached broker address
+    uint32_t resubscribes; // Sessions on which all the subscriptions were sent again
+} lwlte_mqtt_reconnect_stats_t;
+
+/**
+ * Completion of a queued publish, called from the pipeline task.
+ * @param msg_id The ID returned when the publish was queued
+ */
+typedef void (*lwlte_mqtt_publish_cb_t)(lwlte_base_type_t msg_id, lwlte_mqtt_msg_status_t status, void* ctx);
+
 typedef struct
 {
     struct {
@@ -54,22 +145,179 @@ typedef struct
         lwlte_base_type_t clean_session; // MQTT clean session, Optional
         lwlte_base_type_t keepalive; // MQTT keepalive, Optional
     } broker_t;
+    /* TLS to the broker, run by the module. The certificates are uploaded by lwlte_mqtt_client_init
+    and only read during the call */
+    lwlte_tls_config_t tls_t; // Optional
+    struct {
+        lwlte_base_type_t max_inflight; // Publishes queued or in flight before a new one waits, Optional
+        lwlte_base_type_t ack_timeout_ms; // Wait for the module to confirm a publish before retrying it, Optional
+        lwlte_base_type_t max_retries; // Retransmissions of a QoS 1/2 publish before it fails, QoS 0 is never retried, Optional
+        lwlte_base_type_t default_qos; // QoS of lwlte_mqtt_client_publish, Optional
+        lwlte_mqtt_publish_cb_t on_publish; // Per-message completion, Optional
+        void* ctx; // Passed to on_publish
+        lwlte_task_config_t task; // Pipeline task, Optional
+    } pipeline_t;
+    struct {
+        /* Reopen the session by itself once it is lost, with a persistent session (clean_session defaults to 0) */
+        bool enable; // Optional
+        lwlte_base_type_t check_interval_ms; // Probe of the session with AT+MQTTSTATU while it is up, Optional
+        lwlte_base_type_t backoff_base_ms; // Wait after the first failed attempt, doubled at each one, Optional
+        lwlte_base_type_t backoff_max_ms; // Upper bound of the wait between attempts, Optional
+        lwlte_base_type_t dns_ttl_ms; // Time the resolved broker address is used before it is resolved again, Optional
+        /* Time the broker keeps a persistent session, the subscriptions are only sent again after a longer outage.
+        Unset: the module cannot tell whether the broker kept the session, the subscriptions are sent again
+        after every reconnect */
+        lwlte_base_type_t session_expiry_ms; // Optional
+        lwlte_task_config_t task; // Reconnect task, Optional
+    } reconnect_t;
+    struct {
+        /* The queued topics and payloads are copied into fixed-size blocks allocated once, larger ones go to the heap */
+        lwlte_base_type_t topic_size; // Block of the topic pool, Optional
+        lwlte_base_type_t payload_size; // Block of the payload pool, Optional
+        lwlte_base_type_t block_count; // Blocks per pool, defaults to max_inflight, Optional
+    } pool_t;
+    struct {
+        /* Publishes are logged here first and survive coverage gaps and reboots, NULL: RAM queue only.
+        The storage must stay valid until the client is deinitialized */
+        const lwlte_sys_storage_t* storage; // Optional
+        lwlte_mqtt_outbox_overflow_t overflow; // Optional
+    } outbox_t;
+    struct {
+        /* The publishes to one topic within the window are sent as one framed message, 0: no batching */
+        lwlte_base_type_t window_ms; // Optional
+        lwlte_base_type_t max_bytes; // Flush a batch before its framed payload gets larger, Optional
+        lwlte_base_type_t max_count; // Flush a batch once it holds this many publishes, Optional
+        lwlte_base_type_t flush_qos; // Publishes with this QoS or higher, and retained ones, are sent at once
+                                     // after the batch of their topic, Optional
+        lwlte_mqtt_batch_format_t format; // Optional
+        lwlte_task_config_t task; // Task flushing the batches at the end of their window, Optional
+    } batch_t;
 } lwlte_mqtt_client_config_t;
 
 esp_err_t lwlte_mqtt_client_init(const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms);
 
 esp_err_t lwlte_mqtt_client_deinit(void);
 
+/**
+ * Open the session. With reconnect_t.enable the client keeps it open from now on until
+ * lwlte_mqtt_client_disconnect, a failed connect is retried with backoff.
+ */
 esp_err_t lwlte_mqtt_client_connect(void);
 
 esp_err_t lwlte_mqtt_client_disconnect(void);
 
+/**
+ * Subscribe, the subscription is kept by the client. Without a session it is sent at the next connect,
+ * and it is sent again on a reconnect whose broker session did not survive.
+ */
 esp_err_t lwlte_mqtt_client_subscribe(const char* topic);
 
+/**
+ * Unsubscribe, without a session the subscription is only forgotten.
+ */
 esp_err_t lwlte_mqtt_client_unsubscribe(const char* topic);
 
+/**
+ * Queue a publish with the default QoS and return at once, the pipeline task sends it.
+ * Waits for a free slot while max_inflight publishes are pending.
+ */
 esp_err_t lwlte_mqtt_client_publish(const char* topic, const char* payload);
 
+/**
+ * Queue a publish and return at once.
+ * With batching, a publish below flush_qos joins the batch of its topic and msg_id is set to 0,
+ * the batch gets its own ID when it is flushed.
+ * With an outbox the publish is logged to the storage and the ID is its sequence number in the log,
+ * the publishes left at a reboot are sent again with the IDs they had.
+ * @param msg_id Optional, set to the ID reported to on_publish
+ * @return ESP_ERR_TIMEOUT if no slot got free within wait_ms, ESP_FAIL if the outbox is full with DROP_NEWEST
+ */
+esp_err_t lwlte_mqtt_client_publish_qos(const char* topic, const char* payload, lwlte_base_type_t qos, 
+    bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+/**
+ * Queue a publish of a binary payload, see lwlte_mqtt_client_publish_qos. The payload may hold quotes,
+ * line breaks and NULs, it is sent as it is after the '>' prompt of AT+MPUBEX.
+ */
+esp_err_t lwlte_mqtt_client_publish_binary(const char* topic, const void* payload, size_t payload_len, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+/**
+ * Send the open batches now, e.g. before a priority publish on another topic or before sleeping.
+ */
+esp_err_t lwlte_mqtt_client_flush(void);
+
+/**
+ * Counters of the reconnect engine and of the broker address cache.
+ */
+esp_err_t lwlte_mqtt_client_get_reconnect_stats(lwlte_mqtt_reconnect_stats_t* stats);
+
+/**
+ * Usage of the topic and payload pools, to size pool_t for the traffic.
+ */
+esp_err_t lwlte_mqtt_client_get_pool_stats(lwlte_mqtt_pool_stats_t* topic_stats, lwlte_mqtt_pool_stats_t* payload_stats);
+
+/**
+ * Route the incoming messages whose topic matches a filter to a handler. The filter may use the '+' and '#'
+ * wildcards, it does not subscribe by itself. A handler may add or remove handlers, including itself.
+ */
+esp_err_t lwlte_mqtt_client_add_handler(const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx);
+
+esp_err_t lwlte_mqtt_client_remove_handler(const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx);
+
+/* One MQTT client on one modem instance, see lwlte_mqtt_client_create */
+typedef struct lwlte_mqtt_client_s* lwlte_mqtt_handle_t;
+
+/**
+ * Create and configure a client on a modem instance, the functions above drive the client of the default instance.
+ */
+esp_err_t lwlte_mqtt_client_create(lwlte_handle_t core, const lwlte_mqtt_client_config_t *config, 
+    lwlte_base_type_t timeout_ms, lwlte_mqtt_handle_t* handle);
+
+esp_err_t lwlte_mqtt_client_destroy(lwlte_mqtt_handle_t handle);
+
+esp_err_t lwlte_mqtt_client_connect_instance(lwlte_mqtt_handle_t handle);
+
+esp_err_t lwlte_mqtt_client_disconnect_instance(lwlte_mqtt_handle_t handle);
+
+esp_err_t lwlte_mqtt_client_subscribe_instance(lwlte_mqtt_handle_t handle, const char* topic);
+
+esp_err_t lwlte_mqtt_client_unsubscribe_instance(lwlte_mqtt_handle_t handle, const char* topic);
+
+esp_err_t lwlte_mqtt_client_publish_instance(lwlte_mqtt_handle_t handle, const char* topic, const char* payload);
+
+esp_err_t lwlte_mqtt_client_publish_qos_instance(lwlte_mqtt_handle_t handle, const char* topic, const char* payload, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+esp_err_t lwlte_mqtt_client_publish_binary_instance(lwlte_mqtt_handle_t handle, const char* topic, 
+    const void* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, 
+    lwlte_base_type_t* msg_id);
+
+esp_err_t lwlte_mqtt_client_flush_instance(lwlte_mqtt_handle_t handle);
+
+esp_err_t lwlte_mqtt_client_get_reconnect_stats_instance(lwlte_mqtt_handle_t handle, lwlte_mqtt_reconnect_stats_t* stats);
+
+esp_err_t lwlte_mqtt_client_get_pool_stats_instance(lwlte_mqtt_handle_t handle, lwlte_mqtt_pool_stats_t* topic_stats, 
+    lwlte_mqtt_pool_stats_t* payload_stats);
+
+esp_err_t lwlte_mqtt_client_add_handler_instance(lwlte_mqtt_handle_t handle, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx);
+
+esp_err_t lwlte_mqtt_client_remove_handler_instance(lwlte_mqtt_handle_t handle, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx);
+
+/**
+ * Outbox storage on a data partition, found by its label.
+ */
+esp_err_t lwlte_mqtt_outbox_storage_partition(const char* label, lwlte_sys_storage_t* storage);
+
+/**
+ * Outbox storage in a file (e.g. on a host build or an SD card), created if it does not exist.
+ */
+esp_err_t lwlte_mqtt_outbox_storage_file(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage);
+
+void lwlte_mqtt_outbox_storage_file_close(lwlte_sys_storage_t* storage);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,95 @@
+/*
+    File: lwlte_ota.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte ota api header file
+    - Download a firmware image with lwlte_http straight into the update partition.
+    - Two buffers: the download fills one while a writer task hashes (SHA-256) and writes the other.
+    - A run cut by a link drop is resumed from the last byte written, within the run and by the next one.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_http.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LWLTE_OTA_SHA256_SIZE 32
+
+typedef struct
+{
+    lwlte_http_handle_t http; // Client of the server holding the image
+    const char* path; // Path of the image on the server
+    lwlte_sys_storage_t* storage; // Where the image goes, see lwlte_ota_storage_update_partition, kept until lwlte_ota_end
+    const uint8_t* sha256; // Expected digest of the image, LWLTE_OTA_SHA256_SIZE bytes, Optional
+    uint32_t resume_offset; // Image bytes already in the storage (e.g. before a restart), they are hashed again, Optional
+    lwlte_base_type_t buffer_size; // Each of the two buffers in bytes, 0: the sector size of the storage
+    lwlte_task_config_t task; // Writer task, Optional
+} lwlte_ota_config_t;
+
+typedef struct
+{
+    uint32_t image_size; // 0 until the server sent it
+    uint32_t written; // Bytes hashed and written to the storage
+    uint32_t elapsed_ms; // Time spent in lwlte_ota_run
+    uint32_t bytes_per_second; // Download throughput over elapsed_ms
+    uint32_t stall_ms; // Time the download waited for a free buffer, i.e. for the flash
+    uint32_t write_ms; // Time the writer spent hashing, erasing and writing
+    uint32_t resumes; // Reconnects within the runs and runs that resumed a download
+} lwlte_ota_stats_t;
+
+/* opaque handle */
+typedef struct lwlte_ota_s* lwlte_ota_handle_t;
+
+/**
+ * Prepare an update and start the writer task, nothing is downloaded yet.
+ */
+esp_err_t lwlte_ota_begin(const lwlte_ota_config_t* config, lwlte_ota_handle_t* handle);
+
+/**
+ * Download the rest of the image and check it.
+ * @return ESP_OK once the whole image is written and its digest matches,
+ *         ESP_ERR_INVALID_CRC on a digest mismatch: the next run starts over,
+ *         ESP_ERR_INVALID_ARG if the image is larger than the storage,
+ *         another error if the download or a write stopped: call it again to resume, after a write error
+ *         from the start of the sector it failed in
+ */
+esp_err_t lwlte_ota_run(lwlte_ota_handle_t handle);
+
+esp_err_t lwlte_ota_get_stats(lwlte_ota_handle_t handle, lwlte_ota_stats_t* stats);
+
+/**
+ * The digest of the image, once lwlte_ota_run returned ESP_OK.
+ */
+esp_err_t lwlte_ota_get_sha256(lwlte_ota_handle_t handle, uint8_t digest[LWLTE_OTA_SHA256_SIZE]);
+
+/**
+ * Stop the writer task and free the update, the storage is left as it is.
+ */
+esp_err_t lwlte_ota_end(lwlte_ota_handle_t handle);
+
+/**
+ * Storage on the app partition the next update goes to.
+ */
+esp_err_t lwlte_ota_storage_update_partition(lwlte_sys_storage_t* storage);
+
+/**
+ * Boot the image of the update partition on the next restart.
+ */
+esp_err_t lwlte_ota_storage_activate(const lwlte_sys_storage_t* storage);
+
+/**
+ * Storage in a file standing in for the update partition (e.g. on a host build).
+ */
+esp_err_t lwlte_ota_storage_file(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage);
+
+void lwlte_ota_storage_file_close(lwlte_sys_storage_t* storage);
+
+#ifdef __cplusplus
+}
+#endif
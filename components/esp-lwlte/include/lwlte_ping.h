@@ -0,0 +1,81 @@
+/*
+    File: lwlte_ping.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte link probe api header file
+    - A background task pings a host through the module (AT+CIPPING) in rounds of one or more probes.
+    - The last LWLTE_PING_WINDOW probes are kept, the summary gives their loss, RTT histogram and jitter.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Probes kept for the summary */
+#define LWLTE_PING_WINDOW 64
+
+/* RTT histogram, the buckets end at 50, 100, 200, 400, 800, 1600 and 3200 ms, the last one has no bound */
+#define LWLTE_PING_BUCKETS 8
+#define LWLTE_PING_BUCKET_FIRST_MS 50
+
+/* Link probe of a modem instance, a zero-initialized config (with a host) selects the defaults */
+typedef struct
+{
+    const char* host; // Host or IP to ping, copied
+    lwlte_base_type_t size; // Payload bytes of a probe, 0: default
+    lwlte_base_type_t timeout_ms; // A probe without an answer by then is lost, 0: default
+    lwlte_base_type_t burst; // Probes of a round, sent back to back, 0: 1
+    lwlte_base_type_t interval_ms; // From a round to the next, 0: the rounds only run on lwlte_ping_trigger
+    lwlte_task_config_t task; // Probe task, Optional
+} lwlte_ping_config_t;
+
+typedef struct
+{
+    uint32_t sent; // Probes in the window
+    uint32_t lost; // Probes of the window without an answer
+    uint32_t loss_permille; // lost / sent, 0 while nothing was sent
+    uint32_t rtt_min_ms; // Over the answered probes of the window, 0 if none
+    uint32_t rtt_avg_ms;
+    uint32_t rtt_max_ms;
+    uint32_t rtt_last_ms; // The last answered probe, 0 if none
+    uint32_t jitter_ms; // Smoothed RTT variation of the answered probes (RFC 3550)
+    uint32_t histogram[LWLTE_PING_BUCKETS]; // Answered probes of the window by RTT
+    uint32_t total_sent; // Probes since the creation
+    uint32_t total_lost;
+    uint32_t age_ms; // Since the last probe, UINT32_MAX if none
+} lwlte_ping_summary_t;
+
+/* opaque handle */
+typedef struct lwlte_ping_s* lwlte_ping_handle_t;
+
+/**
+ * Start probing the link of a modem instance. The rounds are skipped while the network is not connected.
+ */
+esp_err_t lwlte_ping_create(lwlte_handle_t core, const lwlte_ping_config_t* config, lwlte_ping_handle_t* handle);
+
+/**
+ * Stop the probe task and free it.
+ */
+esp_err_t lwlte_ping_destroy(lwlte_ping_handle_t handle);
+
+/**
+ * Run a round now, e.g. right after a reconnect, the periodic rounds go on from it.
+ */
+esp_err_t lwlte_ping_trigger(lwlte_ping_handle_t handle);
+
+/**
+ * Forget the window and the jitter, e.g. after a switch to another cell or APN. The totals are kept.
+ */
+esp_err_t lwlte_ping_reset(lwlte_ping_handle_t handle);
+
+esp_err_t lwlte_ping_get_summary(lwlte_ping_handle_t handle, lwlte_ping_summary_t* summary);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+/*
+    File: lwlte_poll.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte poll api header file
+    - One task waits on the sockets, the MQTT clients, the link state of the modems and its timers at once.
+    - The sources wake the poll set when their state changes, nothing is polled in the meantime.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_mqtt.h"
+#include "lwlte_socket.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    LWLTE_POLL_SOCKET = 0, // a socket of a socket layer
+    LWLTE_POLL_MQTT, // the incoming messages of an MQTT client
+    LWLTE_POLL_LINK, // the network connection of a modem instance
+    LWLTE_POLL_TIMER, // a periodic timer, started by the first wait on it
+} lwlte_poll_type_t;
+
+/* Events, level triggered except LWLTE_POLL_IN of an MQTT client and LWLTE_POLL_EXPIRED */
+#define LWLTE_POLL_IN (1u << 0) // socket: data to read or the end of the stream, MQTT: messages delivered since the last report
+#define LWLTE_POLL_OUT (1u << 1) // socket: room in the send ring
+#define LWLTE_POLL_UP (1u << 2) // link: connected to the network
+#define LWLTE_POLL_DOWN (1u << 3) // link: not connected
+#define LWLTE_POLL_EXPIRED (1u << 4) // timer: a period elapsed
+#define LWLTE_POLL_ERR (1u << 5) // the item is invalid, always reported
+
+typedef struct
+{
+    lwlte_poll_type_t type;
+    union {
+        struct {
+            lwlte_socket_handle_t handle;
+            int sock;
+        } socket;
+        lwlte_mqtt_handle_t mqtt;
+        lwlte_handle_t link;
+        uint32_t period_ms; // timer
+    } source;
+    uint32_t events; // LWLTE_POLL_* bits to wait for
+    uint32_t revents; // the ready bits, set by lwlte_poll_wait
+    /* State kept by lwlte_poll_wait between the calls, zero before the first one */
+    uint32_t mark; // MQTT: messages reported, timer: next expiry
+    bool started;
+} lwlte_poll_item_t;
+
+/* opaque handle */
+typedef struct lwlte_poll_s* lwlte_poll_handle_t;
+
+esp_err_t lwlte_poll_create(lwlte_poll_handle_t* handle);
+
+esp_err_t lwlte_poll_destroy(lwlte_poll_handle_t handle);
+
+/**
+ * Wait until an item is ready. A source (socket layer, MQTT client, modem) wakes one poll set at a time:
+ * the sources of the items must not be polled by another task meanwhile.
+ * @param timeout_ms LWLTE_SYS_WAIT_FOREVER to wait without a timeout, 0 to check only
+ * @param ready Items with revents set, 0 if woken by lwlte_poll_wakeup
+ * @return ESP_ERR_TIMEOUT if nothing was ready within timeout_ms
+ */
+esp_err_t lwlte_poll_wait(lwlte_poll_handle_t handle, lwlte_poll_item_t* items, size_t count, uint32_t timeout_ms, 
+    size_t* ready);
+
+/**
+ * Make the current or the next lwlte_poll_wait return, e.g. after queueing work for the polling task.
+ */
+esp_err_t lwlte_poll_wakeup(lwlte_poll_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+/*
+    File: lwlte_socket.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte socket api header file
+    - TCP and UDP connections run by the module's IP stack, several at the same time (AT+CIPMUX=1).
+    - Every socket has its own receive and send rings, a send returns once the data is in the ring.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Connections the module runs at the same time, the socket IDs go from 0 to LWLTE_SOCKET_MAX - 1 */
+#define LWLTE_SOCKET_MAX 6
+
+typedef enum {
+    LWLTE_SOCKET_TCP = 0,
+    LWLTE_SOCKET_UDP, // a send is one datagram, a receive returns one datagram in push mode
+} lwlte_socket_type_t;
+
+typedef enum {
+    LWLTE_SOCKET_RX_PUSH = 0, // the module pushes the data as it arrives (+RECEIVE), it is dropped if the ring is full,
+                              // needs a uart_buf_size above 1504 to hold a segment, the buffered mode is used otherwise
+    LWLTE_SOCKET_RX_BUFFERED, // the module keeps the data until it is read (AT+CIPRXGET), TCP holds the peer back meanwhile
+} lwlte_socket_rx_mode_t;
+
+/* Socket layer of a modem instance, a zero-initialized config selects the defaults */
+typedef struct
+{
+    lwlte_socket_rx_mode_t rx_mode; // Same for all the sockets of the module
+    lwlte_base_type_t rx_ring_size; // Receive ring of each socket in bytes, 0: default
+    lwlte_base_type_t tx_ring_size; // Send ring of each socket in bytes, 0: default
+    lwlte_task_config_t task; // Send task, Optional
+} lwlte_socket_config_t;
+
+typedef struct
+{
+    uint32_t tx_bytes; // Bytes accepted by the module
+    uint32_t rx_bytes; // Bytes put in the receive ring
+    uint32_t rx_dropped; // Bytes lost on a full receive ring, push mode only
+    uint32_t send_failures; // AT+CIPSEND that failed, the data stays queued
+} lwlte_socket_stats_t;
+
+/* The socket layer of one modem instance, see lwlte_socket_create */
+typedef struct lwlte_tcp_s* lwlte_socket_handle_t;
+
+/**
+ * Start the socket layer on a modem instance, created with lwlte_config_t.socket_mux set.
+ * A module has one socket layer.
+ */
+esp_err_t lwlte_socket_create(lwlte_handle_t core, const lwlte_socket_config_t* config, lwlte_socket_handle_t* handle);
+
+/**
+ * Close the open sockets and stop the socket layer.
+ */
+esp_err_t lwlte_socket_destroy(lwlte_socket_handle_t handle);
+
+/**
+ * Open a connection. The AT channel is only held while the module takes the command,
+ * the other sockets keep sending and receiving while this one connects.
+ * @param timeout_ms Wait for the connection, 0 returns at once, the socket is then writable once connected
+ * @param sock The socket ID
+ * @return ESP_ERR_NOT_FOUND if all the sockets are in use
+ */
+esp_err_t lwlte_socket_open(lwlte_socket_handle_t handle, lwlte_socket_type_t type, const char* host, uint16_t port,
+    lwlte_base_type_t timeout_ms, int* sock);
+
+/**
+ * Queue data, without waiting for the module.
+ * @param sent Bytes queued, less than len if the ring is full, 0 for a datagram that does not fit
+ */
+esp_err_t lwlte_socket_send(lwlte_socket_handle_t handle, int sock, const void* data, size_t len, size_t* sent);
+
+/**
+ * Read the received data, waiting for some if there is none.
+ * @param received 0 once the connection is closed and all its data was read
+ * @return ESP_ERR_TIMEOUT if nothing came within wait_ms
+ */
+esp_err_t lwlte_socket_recv(lwlte_socket_handle_t handle, int sock, void* buf, size_t size,
+    lwlte_base_type_t wait_ms, size_t* received);
+
+/**
+ * Close the connection once the queued data is sent, and free the socket.
+ */
+esp_err_t lwlte_socket_close(lwlte_socket_handle_t handle, int sock);
+
+esp_err_t lwlte_socket_get_stats(lwlte_socket_handle_t handle, int sock, lwlte_socket_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
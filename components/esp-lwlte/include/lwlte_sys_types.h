@@ -9,6 +9,9 @@
 
 #include "freertos/FreeRTOS.h"
 #include "driver/uart.h"
+#include "lwlte_err.h"
+#include <stdint.h>
+#include <stddef.h>
 
 #define LWLTE_TICK_FOREVER portMAX_DELAY
 #define LWLTE_SYS_WAIT_FOREVER  (UINT32_MAX)
@@ -22,6 +25,20 @@ typedef TickType_t lwlte_tick_t;
 typedef uart_config_t lwlte_uart_config_t;
 typedef uart_port_t lwlte_uart_num_t;
 
+/**
+ * Flash-like storage: erased bytes read 0xFF and a write may only clear bits until the sector is erased again.
+ * See lwlte_sys_storage.h for the flash partition and the file backends.
+ */
+typedef struct
+{
+    lwlte_err_t (*read)(void* ctx, uint32_t offset, void* data, size_t size);
+    lwlte_err_t (*write)(void* ctx, uint32_t offset, const void* data, size_t size);
+    lwlte_err_t (*erase)(void* ctx, uint32_t offset, size_t size); // offset and size are multiples of sector_size
+    uint32_t size; // bytes, a multiple of sector_size
+    uint32_t sector_size; // erase unit
+    void* ctx;
+} lwlte_sys_storage_t;
+
 
 #ifdef __cplusplus
 }
@@ -7,34 +7,156 @@
 */
 #include "lwlte.h"
 #include "lwlte_core.h"
+#include "lwlte_watchdog.h"
+#include "lwlte_sched.h"
 #include "freertos/FreeRTOS.h"
 #include "esp_err.h"
 
-static esp_err_t lwlte_err_2_esp_err(lwlte_err_t err)
-{
-    switch (err)
-    {
-        case LWLTE_OK:
-            return ESP_OK;
-        case LWLTE_ERROR:
-            return ESP_FAIL;
-        case LWLTE_TIMEOUT:
-            return ESP_ERR_TIMEOUT;
-        case LWLTE_INVALID_ARG:
-            return ESP_ERR_INVALID_ARG;
-        case LWLTE_NOT_SUPPORTED:
-            return ESP_ERR_NOT_SUPPORTED;
-        case LWLTE_NOT_INITIALIZED:
-            return ESP_ERR_NOT_ALLOWED;
-        case LWLTE_ALREADY_INITIALIZED:
-            return ESP_ERR_NOT_ALLOWED;
-        default:
-            return ESP_FAIL;
-    }
-    return ESP_FAIL;
+/* The instance behind the legacy single-modem API */
+static lwlte_core_t* s_lwlte_default_core;
+
+esp_err_t lwlte_core_create(const lwlte_config_t* config, lwlte_handle_t* handle)
+{
+    if (config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lwlte_core_t* core = NULL;
+    lwlte_err_t err = lwlte_core_create_internal(config, &core);
+    if (err != LWLTE_OK) {
+        return lwlte_err_2_esp_err(err);
+    }
+    if (config->watchdog.enable) {
+        lwlte_watchdog_t watchdog = NULL;
+        err = lwlte_watchdog_start(core, config, &watchdog);
+        if (err != LWLTE_OK) {
+            lwlte_core_destroy_internal(core);
+            return lwlte_err_2_esp_err(err);
+        }
+        lwlte_core_set_watchdog_internal(core, watchdog);
+    }
+    *handle = core;
+    return ESP_OK;
+}
+
+esp_err_t lwlte_core_destroy(lwlte_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* The watchdog must not recover a core that is going away */
+    lwlte_watchdog_t watchdog = lwlte_core_get_watchdog_internal(handle);
+    if (watchdog != NULL) {
+        lwlte_err_t err = lwlte_watchdog_stop(watchdog);
+        if (err != LWLTE_OK) {
+            return lwlte_err_2_esp_err(err);
+        }
+        lwlte_core_set_watchdog_internal(handle, NULL);
+    }
+    return lwlte_err_2_esp_err(lwlte_core_destroy_internal(handle));
+}
+
+esp_err_t lwlte_core_restart_instance(lwlte_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_core_restart_internal(handle));
+}
+
+esp_err_t lwlte_core_get_watchdog_stats_instance(lwlte_handle_t handle, lwlte_watchdog_stats_t* stats)
+{
+    return lwlte_err_2_esp_err(lwlte_watchdog_get_stats(lwlte_core_get_watchdog_internal(handle), stats));
+}
+
+lwlte_handle_t lwlte_core_get_default(void)
+{
+    return s_lwlte_default_core;
+}
+
+esp_err_t lwlte_core_send_at_cmd_stream_instance(lwlte_handle_t handle, const char* cmd, const char* wait_str, 
+    const char* error_str, lwlte_base_type_t wait_time_ms, lwlte_core_line_sink_t sink, void* ctx)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_core_send_at_cmd_stream_internal(handle, cmd, wait_str, error_str, 
+        wait_time_ms, sink, ctx));
 }
 
 esp_err_t lwlte_core_init(const lwlte_config_t* config)
 {
-    return lwlte_err_2_esp_err(lwlte_core_init_internal(config));
-}
\ No newline at end of file
+    if (s_lwlte_default_core != NULL) {
+        return lwlte_err_2_esp_err(LWLTE_ALREADY_INITIALIZED);
+    }
+    return lwlte_core_create(config, &s_lwlte_default_core);
+}
+
+esp_err_t lwlte_core_deinit(void)
+{
+    if (s_lwlte_default_core == NULL) {
+        return lwlte_err_2_esp_err(LWLTE_NOT_INITIALIZED);
+    }
+    esp_err_t err = lwlte_core_destroy(s_lwlte_default_core);
+    if (err == ESP_OK) {
+        s_lwlte_default_core = NULL;
+    }
+    return err;
+}
+
+esp_err_t lwlte_core_restart(void)
+{
+    if (s_lwlte_default_core == NULL) {
+        return lwlte_err_2_esp_err(LWLTE_NOT_INITIALIZED);
+    }
+    return lwlte_core_restart_instance(s_lwlte_default_core);
+}
+
+esp_err_t lwlte_core_get_watchdog_stats(lwlte_watchdog_stats_t* stats)
+{
+    return lwlte_core_get_watchdog_stats_instance(s_lwlte_default_core, stats);
+}
+
+esp_err_t lwlte_core_send_at_cmd_stream(const char* cmd, const char* wait_str, const char* error_str, 
+    lwlte_base_type_t wait_time_ms, lwlte_core_line_sink_t sink, void* ctx)
+{
+    if (s_lwlte_default_core == NULL) {
+        return lwlte_err_2_esp_err(LWLTE_NOT_INITIALIZED);
+    }
+    return lwlte_core_send_at_cmd_stream_instance(s_lwlte_default_core, cmd, wait_str, error_str, 
+        wait_time_ms, sink, ctx);
+}
+
+esp_err_t lwlte_sched_create(const lwlte_sched_config_t* config, lwlte_sched_handle_t* handle)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_create_internal(config, handle));
+}
+
+esp_err_t lwlte_sched_destroy(lwlte_sched_handle_t handle)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_destroy_internal(handle));
+}
+
+esp_err_t lwlte_sched_add_link(lwlte_sched_handle_t handle, lwlte_handle_t link)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_add_link_internal(handle, link));
+}
+
+esp_err_t lwlte_sched_remove_link(lwlte_sched_handle_t handle, lwlte_handle_t link)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_remove_link_internal(handle, link));
+}
+
+esp_err_t lwlte_sched_pick(lwlte_sched_handle_t handle, lwlte_handle_t* link)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_pick_internal(handle, link));
+}
+
+bool lwlte_sched_link_usable(lwlte_sched_handle_t handle, lwlte_handle_t link)
+{
+    return lwlte_sched_link_usable_internal(handle, link);
+}
+
+esp_err_t lwlte_sched_get_link_stats(lwlte_sched_handle_t handle, lwlte_handle_t link, lwlte_sched_link_stats_t* stats)
+{
+    return lwlte_err_2_esp_err(lwlte_sched_get_link_stats_internal(handle, link, stats));
+}
@@ -0,0 +1,45 @@
+/*
+    File: lwlte_http.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte http client api source file
+*/
+#include "lwlte_http.h"
+#include "lwlte_http_client.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_http_client_create(lwlte_socket_handle_t sockets, const lwlte_http_config_t* config, 
+    lwlte_http_handle_t* handle)
+{
+    if (sockets == NULL || config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_http_client_create_internal(sockets, config, handle));
+}
+
+esp_err_t lwlte_http_client_destroy(lwlte_http_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_http_client_destroy_internal(handle));
+}
+
+esp_err_t lwlte_http_client_get(lwlte_http_handle_t handle, lwlte_http_request_t* requests, size_t count, 
+    lwlte_http_body_cb_t cb, void* ctx)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_http_client_get_internal(handle, requests, count, cb, ctx));
+}
+
+esp_err_t lwlte_http_client_get_stats(lwlte_http_handle_t handle, lwlte_http_stats_t* stats)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_http_client_get_stats_internal(handle, stats));
+}
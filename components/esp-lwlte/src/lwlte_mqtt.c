@@ -7,36 +7,237 @@
 #include "lwlte.h"
 #include "lwlte_mqtt.h"
 #include "lwlte_mqtt_client.h"
+#include "lwlte_sys_storage.h"
 #include "lwlte_sys_types.h"
 #include "lwlte_err.h"
 #include "esp_err.h"
 
+/* The client behind the legacy API, bound to the default modem instance */
+static lwlte_mqtt_client_t* s_lwlte_mqtt_default_client;
+
+esp_err_t lwlte_mqtt_client_create(lwlte_handle_t core, const lwlte_mqtt_client_config_t *config, 
+    lwlte_base_type_t timeout_ms, lwlte_mqtt_handle_t* handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lwlte_mqtt_client_t* client = NULL;
+    lwlte_err_t err = lwlte_mqtt_client_create_internal(core, &client);
+    if (err != LWLTE_OK) {
+        return lwlte_err_2_esp_err(err);
+    }
+    err = lwlte_mqtt_client_init_internal(client, config, timeout_ms);
+    if (err != LWLTE_OK) {
+        lwlte_mqtt_client_destroy_internal(client);
+        return lwlte_err_2_esp_err(err);
+    }
+    *handle = client;
+    return ESP_OK;
+}
+
+esp_err_t lwlte_mqtt_client_destroy(lwlte_mqtt_handle_t handle)
+{
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_destroy_internal(handle));
+}
+
+esp_err_t lwlte_mqtt_client_connect_instance(lwlte_mqtt_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_connect_internal(handle));
+}
+
+esp_err_t lwlte_mqtt_client_disconnect_instance(lwlte_mqtt_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_disconnect_internal(handle));
+}
+
+esp_err_t lwlte_mqtt_client_subscribe_instance(lwlte_mqtt_handle_t handle, const char* topic)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_subscribe_internal(handle, topic));
+}
+
+esp_err_t lwlte_mqtt_client_unsubscribe_instance(lwlte_mqtt_handle_t handle, const char* topic)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_unsubscribe_internal(handle, topic));
+}
+
+esp_err_t lwlte_mqtt_client_publish_instance(lwlte_mqtt_handle_t handle, const char* topic, const char* payload)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_publish_internal(handle, topic, payload));
+}
+
+esp_err_t lwlte_mqtt_client_publish_qos_instance(lwlte_mqtt_handle_t handle, const char* topic, const char* payload, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_publish_qos_internal(handle, topic, payload, qos, retain, wait_ms, msg_id));
+}
+
+esp_err_t lwlte_mqtt_client_publish_binary_instance(lwlte_mqtt_handle_t handle, const char* topic, 
+    const void* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, 
+    lwlte_base_type_t* msg_id)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_publish_binary_internal(handle, topic, payload, payload_len, 
+        qos, retain, wait_ms, msg_id));
+}
+
+esp_err_t lwlte_mqtt_client_flush_instance(lwlte_mqtt_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_flush_internal(handle));
+}
+
+esp_err_t lwlte_mqtt_client_get_reconnect_stats_instance(lwlte_mqtt_handle_t handle, lwlte_mqtt_reconnect_stats_t* stats)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_get_reconnect_stats_internal(handle, stats));
+}
+
+esp_err_t lwlte_mqtt_client_get_pool_stats_instance(lwlte_mqtt_handle_t handle, lwlte_mqtt_pool_stats_t* topic_stats, 
+    lwlte_mqtt_pool_stats_t* payload_stats)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_get_pool_stats_internal(handle, topic_stats, payload_stats));
+}
+
+esp_err_t lwlte_mqtt_client_add_handler_instance(lwlte_mqtt_handle_t handle, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_add_handler_internal(handle, filter, cb, ctx));
+}
+
+esp_err_t lwlte_mqtt_client_remove_handler_instance(lwlte_mqtt_handle_t handle, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_mqtt_client_remove_handler_internal(handle, filter, cb, ctx));
+}
+
 esp_err_t lwlte_mqtt_client_init(const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms)
 {
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_init_internal(config, timeout_ms));
+    if (s_lwlte_mqtt_default_client != NULL) {
+        return lwlte_err_2_esp_err(LWLTE_ALREADY_INITIALIZED);
+    }
+    if (lwlte_core_get_default() == NULL) {
+        return lwlte_err_2_esp_err(LWLTE_NOT_INITIALIZED);
+    }
+    return lwlte_mqtt_client_create(lwlte_core_get_default(), config, timeout_ms, &s_lwlte_mqtt_default_client);
 }
 
 esp_err_t lwlte_mqtt_client_deinit(void)
 {
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_deinit_internal());
+    if (s_lwlte_mqtt_default_client == NULL) {
+        return lwlte_err_2_esp_err(LWLTE_NOT_INITIALIZED);
+    }
+    esp_err_t err = lwlte_mqtt_client_destroy(s_lwlte_mqtt_default_client);
+    s_lwlte_mqtt_default_client = NULL;
+    return err;
 }
 
 esp_err_t lwlte_mqtt_client_connect(void)
 {
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_connect_internal());
+    return lwlte_mqtt_client_connect_instance(s_lwlte_mqtt_default_client);
 }
 
 esp_err_t lwlte_mqtt_client_disconnect(void)
 {
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_disconnect_internal());
+    return lwlte_mqtt_client_disconnect_instance(s_lwlte_mqtt_default_client);
 }
 
 esp_err_t lwlte_mqtt_client_subscribe(const char* topic)
 {
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_subscribe_internal(topic));
+    return lwlte_mqtt_client_subscribe_instance(s_lwlte_mqtt_default_client, topic);
 }
 
 esp_err_t lwlte_mqtt_client_unsubscribe(const char* topic)
 {   
-    return lwlte_err_2_esp_err(lwlte_mqtt_client_unsubscribe_internal(topic));
-}
\ No newline at end of file
+    return lwlte_mqtt_client_unsubscribe_instance(s_lwlte_mqtt_default_client, topic);
+}
+
+esp_err_t lwlte_mqtt_client_publish(const char* topic, const char* payload)
+{
+    return lwlte_mqtt_client_publish_instance(s_lwlte_mqtt_default_client, topic, payload);
+}
+
+esp_err_t lwlte_mqtt_client_publish_qos(const char* topic, const char* payload, lwlte_base_type_t qos, 
+    bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    return lwlte_mqtt_client_publish_qos_instance(s_lwlte_mqtt_default_client, topic, payload, qos, retain, wait_ms, msg_id);
+}
+
+esp_err_t lwlte_mqtt_client_publish_binary(const char* topic, const void* payload, size_t payload_len, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    return lwlte_mqtt_client_publish_binary_instance(s_lwlte_mqtt_default_client, topic, payload, payload_len, 
+        qos, retain, wait_ms, msg_id);
+}
+
+esp_err_t lwlte_mqtt_client_flush(void)
+{
+    return lwlte_mqtt_client_flush_instance(s_lwlte_mqtt_default_client);
+}
+
+esp_err_t lwlte_mqtt_client_get_reconnect_stats(lwlte_mqtt_reconnect_stats_t* stats)
+{
+    return lwlte_mqtt_client_get_reconnect_stats_instance(s_lwlte_mqtt_default_client, stats);
+}
+
+esp_err_t lwlte_mqtt_client_get_pool_stats(lwlte_mqtt_pool_stats_t* topic_stats, lwlte_mqtt_pool_stats_t* payload_stats)
+{
+    return lwlte_mqtt_client_get_pool_stats_instance(s_lwlte_mqtt_default_client, topic_stats, payload_stats);
+}
+
+esp_err_t lwlte_mqtt_client_add_handler(const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    return lwlte_mqtt_client_add_handler_instance(s_lwlte_mqtt_default_client, filter, cb, ctx);
+}
+
+esp_err_t lwlte_mqtt_client_remove_handler(const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    return lwlte_mqtt_client_remove_handler_instance(s_lwlte_mqtt_default_client, filter, cb, ctx);
+}
+
+esp_err_t lwlte_mqtt_outbox_storage_partition(const char* label, lwlte_sys_storage_t* storage)
+{
+    return lwlte_err_2_esp_err(lwlte_sys_storage_partition_open(label, storage));
+}
+
+esp_err_t lwlte_mqtt_outbox_storage_file(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage)
+{
+    return lwlte_err_2_esp_err(lwlte_sys_storage_file_open(path, size, sector_size, storage));
+}
+
+void lwlte_mqtt_outbox_storage_file_close(lwlte_sys_storage_t* storage)
+{
+    lwlte_sys_storage_file_close(storage);
+}
@@ -0,0 +1,73 @@
+/*
+    File: lwlte_ota.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte ota api source file
+*/
+#include "lwlte_ota.h"
+#include "lwlte_ota_update.h"
+#include "lwlte_sys_storage.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_ota_begin(const lwlte_ota_config_t* config, lwlte_ota_handle_t* handle)
+{
+    if (config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ota_begin_internal(config, handle));
+}
+
+esp_err_t lwlte_ota_run(lwlte_ota_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lwlte_err_t err = lwlte_ota_run_internal(handle);
+    return err == LWLTE_NOT_SUPPORTED ? ESP_ERR_INVALID_CRC : lwlte_err_2_esp_err(err);
+}
+
+esp_err_t lwlte_ota_get_stats(lwlte_ota_handle_t handle, lwlte_ota_stats_t* stats)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ota_get_stats_internal(handle, stats));
+}
+
+esp_err_t lwlte_ota_get_sha256(lwlte_ota_handle_t handle, uint8_t digest[LWLTE_OTA_SHA256_SIZE])
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ota_get_sha256_internal(handle, digest));
+}
+
+esp_err_t lwlte_ota_end(lwlte_ota_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ota_end_internal(handle));
+}
+
+esp_err_t lwlte_ota_storage_update_partition(lwlte_sys_storage_t* storage)
+{
+    return lwlte_err_2_esp_err(lwlte_sys_storage_update_partition_open(storage));
+}
+
+esp_err_t lwlte_ota_storage_activate(const lwlte_sys_storage_t* storage)
+{
+    return lwlte_err_2_esp_err(lwlte_sys_storage_update_partition_activate(storage));
+}
+
+esp_err_t lwlte_ota_storage_file(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage)
+{
+    return lwlte_err_2_esp_err(lwlte_sys_storage_file_open(path, size, sector_size, storage));
+}
+
+void lwlte_ota_storage_file_close(lwlte_sys_storage_t* storage)
+{
+    lwlte_sys_storage_file_close(storage);
+}
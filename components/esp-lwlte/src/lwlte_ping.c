@@ -0,0 +1,51 @@
+/*
+    File: lwlte_ping.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte link probe api source file
+*/
+#include "lwlte_ping.h"
+#include "lwlte_ping_probe.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_ping_create(lwlte_handle_t core, const lwlte_ping_config_t* config, lwlte_ping_handle_t* handle)
+{
+    if (core == NULL || config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ping_create_internal(core, config, handle));
+}
+
+esp_err_t lwlte_ping_destroy(lwlte_ping_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ping_destroy_internal(handle));
+}
+
+esp_err_t lwlte_ping_trigger(lwlte_ping_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ping_trigger_internal(handle));
+}
+
+esp_err_t lwlte_ping_reset(lwlte_ping_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ping_reset_internal(handle));
+}
+
+esp_err_t lwlte_ping_get_summary(lwlte_ping_handle_t handle, lwlte_ping_summary_t* summary)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_ping_get_summary_internal(handle, summary));
+}
@@ -0,0 +1,44 @@
+/*
+    File: lwlte_poll.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte poll api source file
+*/
+#include "lwlte_poll.h"
+#include "lwlte_poll_set.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_poll_create(lwlte_poll_handle_t* handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_poll_set_create_internal(handle));
+}
+
+esp_err_t lwlte_poll_destroy(lwlte_poll_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_poll_set_destroy_internal(handle));
+}
+
+esp_err_t lwlte_poll_wait(lwlte_poll_handle_t handle, lwlte_poll_item_t* items, size_t count, uint32_t timeout_ms, 
+    size_t* ready)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_poll_set_wait_internal(handle, items, count, timeout_ms, ready));
+}
+
+esp_err_t lwlte_poll_wakeup(lwlte_poll_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_poll_set_wakeup_internal(handle));
+}
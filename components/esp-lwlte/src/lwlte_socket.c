@@ -0,0 +1,69 @@
+/*
+    File: lwlte_socket.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte socket api source file
+*/
+#include "lwlte_socket.h"
+#include "lwlte_tcp.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_socket_create(lwlte_handle_t core, const lwlte_socket_config_t* config, lwlte_socket_handle_t* handle)
+{
+    if (core == NULL || config == NULL || handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_create_internal(core, config, handle));
+}
+
+esp_err_t lwlte_socket_destroy(lwlte_socket_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_destroy_internal(handle));
+}
+
+esp_err_t lwlte_socket_open(lwlte_socket_handle_t handle, lwlte_socket_type_t type, const char* host, uint16_t port,
+    lwlte_base_type_t timeout_ms, int* sock)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_open_internal(handle, type, host, port, timeout_ms, sock));
+}
+
+esp_err_t lwlte_socket_send(lwlte_socket_handle_t handle, int sock, const void* data, size_t len, size_t* sent)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_send_internal(handle, sock, data, len, sent));
+}
+
+esp_err_t lwlte_socket_recv(lwlte_socket_handle_t handle, int sock, void* buf, size_t size,
+    lwlte_base_type_t wait_ms, size_t* received)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_recv_internal(handle, sock, buf, size, wait_ms, received));
+}
+
+esp_err_t lwlte_socket_close(lwlte_socket_handle_t handle, int sock)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_close_internal(handle, sock));
+}
+
+esp_err_t lwlte_socket_get_stats(lwlte_socket_handle_t handle, int sock, lwlte_socket_stats_t* stats)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return lwlte_err_2_esp_err(lwlte_tcp_get_stats_internal(handle, sock, stats));
+}
@@ -0,0 +1,66 @@
+/*
+    File: lwlte_at_builder.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: Bounded AT command builder header file
+    - Writes a command into a caller buffer piece by piece, without printf and without allocating.
+    - A piece that does not fit marks the command as overflowed instead of truncating it silently.
+    - The static head of a command can be written once and kept, see lwlte_at_builder_rewind.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "lwlte_err.h"
+
+/* Characters of the longest int32_t, with its sign */
+#define LWLTE_AT_BUILDER_INT_MAX_DIGITS 11
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    char* buf;
+    size_t size;
+    size_t len; // the buffer is kept null-terminated at len
+    bool overflow; // a piece did not fit, the command is incomplete
+} lwlte_at_builder_t;
+
+void lwlte_at_builder_init(lwlte_at_builder_t* b, char* buf, size_t size);
+
+/**
+ * Go back to a length written before, e.g. the end of a precomputed command head, and clear the overflow.
+ */
+void lwlte_at_builder_rewind(lwlte_at_builder_t* b, size_t len);
+
+void lwlte_at_builder_raw(lwlte_at_builder_t* b, const char* data, size_t len);
+
+void lwlte_at_builder_str(lwlte_at_builder_t* b, const char* str);
+
+void lwlte_at_builder_char(lwlte_at_builder_t* b, char c);
+
+void lwlte_at_builder_int(lwlte_at_builder_t* b, int32_t value);
+
+/**
+ * Write a string between quotes. The AT syntax has no escaping, a quote or a line break in it
+ * marks the command as overflowed.
+ */
+void lwlte_at_builder_quoted(lwlte_at_builder_t* b, const char* str, size_t len);
+
+/**
+ * Terminate the command with "\r\n".
+ * @return LWLTE_INVALID_ARG if a piece did not fit or could not be quoted
+ */
+lwlte_err_t lwlte_at_builder_end(lwlte_at_builder_t* b);
+
+/**
+ * Buffer size for a command whose variable pieces total text_len bytes, with int_count integers
+ * and quoted_count quoted strings.
+ */
+size_t lwlte_at_builder_size(const char* head, size_t text_len, size_t int_count, size_t quoted_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,112 @@
+/*
+    File: lwlte_at_parser.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: Zero-copy AT response tokenizer header file
+    - Fields are returned as slices over the caller's buffer, nothing is copied or allocated.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "lwlte_err.h"
+
+#define LWLTE_AT_SCHEMA_MAX_FIELDS 6
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A view into a response buffer, NOT null-terminated */
+typedef struct {
+    const char* ptr;
+    size_t len;
+} lwlte_at_slice_t;
+
+typedef enum {
+    LWLTE_AT_FIELD_INT = 0, // decimal integer, e.g. the 5 in "+CSQ: 5,99"
+    LWLTE_AT_FIELD_STR, // quoted string, the slice excludes the quotes
+    LWLTE_AT_FIELD_IP, // dotted IPv4 address, quoted or not
+    LWLTE_AT_FIELD_RAW, // unquoted token up to the next ',' or the end of line
+} lwlte_at_field_type_t;
+
+typedef struct {
+    lwlte_at_field_type_t type;
+    lwlte_at_slice_t s; // the field as it appears in the buffer
+    union {
+        int32_t i; // LWLTE_AT_FIELD_INT
+        uint8_t ip[4]; // LWLTE_AT_FIELD_IP, network order
+    } v;
+} lwlte_at_field_t;
+
+typedef struct {
+    const char* cur;
+    const char* end;
+} lwlte_at_tokenizer_t;
+
+/* Responses the library knows how to parse, see s_lwlte_at_schemas in lwlte_at_parser.c */
+typedef enum {
+    LWLTE_AT_SCHEMA_CSQ = 0, // +CSQ: <rssi>,<ber>
+    LWLTE_AT_SCHEMA_CPIN, // +CPIN: <code>
+    LWLTE_AT_SCHEMA_CGATT, // +CGATT: <state>
+    LWLTE_AT_SCHEMA_CIFSR, // <ip>
+    LWLTE_AT_SCHEMA_MQTTSTATU, // +MQTTSTATU :<state>
+    LWLTE_AT_SCHEMA_CDNSGIP, // +CDNSGIP: <result>,"<host>","<ip>"
+    LWLTE_AT_SCHEMA_FSFLSIZE, // +FSFLSIZE: <size>
+    LWLTE_AT_SCHEMA_CIPPING, // +CIPPING: <n>,"<ip>",<time>,<ttl>
+    LWLTE_AT_SCHEMA_MAX,
+} lwlte_at_schema_id_t;
+
+typedef struct {
+    const char* prefix; // line prefix, "" for responses without one
+    uint8_t field_count;
+    lwlte_at_field_type_t fields[LWLTE_AT_SCHEMA_MAX_FIELDS];
+} lwlte_at_schema_t;
+
+/**
+ * Start tokenizing one line. Trailing "\r\n" is ignored.
+ * @param prefix If not NULL, the line must start with it, the tokenizer is placed right after it.
+ * @return True if the line matches the prefix
+ */
+bool lwlte_at_tokenizer_init(lwlte_at_tokenizer_t* tok, const char* line, size_t len, const char* prefix);
+
+/**
+ * Read the next field of the given type and step over the following ','.
+ * @return LWLTE_OK, or LWLTE_ERROR if the field is missing or malformed
+ */
+lwlte_err_t lwlte_at_next_field(lwlte_at_tokenizer_t* tok, lwlte_at_field_type_t type, lwlte_at_field_t* field);
+
+lwlte_err_t lwlte_at_next_int(lwlte_at_tokenizer_t* tok, int32_t* value);
+
+lwlte_err_t lwlte_at_next_str(lwlte_at_tokenizer_t* tok, lwlte_at_slice_t* value);
+
+/**
+ * True if there is nothing left on the line.
+ */
+bool lwlte_at_tokenizer_done(const lwlte_at_tokenizer_t* tok);
+
+/**
+ * Compare a slice with a null-terminated string.
+ */
+bool lwlte_at_slice_eq(const lwlte_at_slice_t* s, const char* str);
+
+const lwlte_at_schema_t* lwlte_at_schema_get(lwlte_at_schema_id_t id);
+
+/**
+ * Parse one line against a schema.
+ * @param fields Output, at least the schema's field count entries
+ */
+lwlte_err_t lwlte_at_parse_line(lwlte_at_schema_id_t id, const char* line, size_t len,
+    lwlte_at_field_t* fields, size_t field_count);
+
+/**
+ * Parse the first line of a (multi-line) response that matches the schema.
+ * @return LWLTE_OK, or LWLTE_ERROR if no line matches
+ */
+lwlte_err_t lwlte_at_parse_response(lwlte_at_schema_id_t id, const char* response, size_t len,
+    lwlte_at_field_t* fields, size_t field_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+/*
+    File: lwlte_backoff.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte retry backoff header file
+    - The delay doubles from base_ms at each attempt up to max_ms, then the upper half of it is randomized
+      (equal jitter), so that the peers that failed together do not retry together.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get the delay before a retry.
+ * @param attempt Retries so far, starting at 1
+ * @return Between half the capped delay and the capped delay
+ */
+uint32_t lwlte_backoff_ms(uint32_t base_ms, uint32_t max_ms, uint32_t attempt);
+
+#ifdef __cplusplus
+}
+#endif
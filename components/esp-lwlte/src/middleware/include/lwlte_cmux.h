@@ -0,0 +1,81 @@
+/*
+    File: lwlte_cmux.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: 3GPP TS 27.010 basic mode multiplexer header file
+    - Opens several virtual channels (DLCIs) over the single UART.
+    - Frames are encoded here and written through the given write function, the received bytes
+      are decoded back into per-channel payloads.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "lwlte_err.h"
+
+/* Channels opened by the core, DLCI 0 is the multiplexer control channel */
+#define LWLTE_CMUX_DLCI_CONTROL 0
+#define LWLTE_CMUX_DLCI_AT 1 // AT commands and their responses
+#define LWLTE_CMUX_DLCI_DATA 2 // transparent data (e.g. PPP)
+#define LWLTE_CMUX_DLCI_URC 3 // unsolicited result codes
+#define LWLTE_CMUX_MAX_DLCI 7
+
+/* Default maximum information field size (N1), the module default of AT+CMUX */
+#define LWLTE_CMUX_DEFAULT_FRAME_SIZE 127
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle */
+typedef void* lwlte_cmux_t;
+
+/* Writes an encoded frame to the UART, ctx is the one given to lwlte_cmux_create */
+typedef lwlte_err_t (*lwlte_cmux_write_fn_t)(const char* data, size_t size, void* ctx);
+
+/**
+ * Receives the payload of a UIH frame, called from the context of lwlte_cmux_input.
+ * @param data Only valid during the call, not null-terminated
+ */
+typedef void (*lwlte_cmux_rx_fn_t)(uint8_t dlci, const uint8_t* data, size_t size, void* ctx);
+
+/**
+ * Create a multiplexer, no frame is sent until a channel is opened.
+ * @param frame_size Maximum information field size (N1), must match the AT+CMUX setting
+ */
+lwlte_cmux_t lwlte_cmux_create(size_t frame_size, lwlte_cmux_write_fn_t write, lwlte_cmux_rx_fn_t rx, void* ctx);
+
+void lwlte_cmux_delete(lwlte_cmux_t cmux);
+
+/**
+ * Open a channel (SABM) and wait for the module to accept it (UA).
+ * @return LWLTE_OK, LWLTE_ERROR if the module rejected it (DM), or LWLTE_TIMEOUT
+ */
+lwlte_err_t lwlte_cmux_open_channel(lwlte_cmux_t cmux, uint8_t dlci, uint32_t timeout_ms);
+
+/**
+ * Close the multiplexer (CLD), the module returns to the plain AT mode.
+ */
+lwlte_err_t lwlte_cmux_close(lwlte_cmux_t cmux);
+
+/**
+ * Send data on a channel. Data larger than the frame size is split into several frames and
+ * the TX lock is released between them, so that the other channels are not held off by a bulk transfer.
+ */
+lwlte_err_t lwlte_cmux_write(lwlte_cmux_t cmux, uint8_t dlci, const uint8_t* data, size_t size);
+
+/**
+ * Feed the bytes received from the UART, complete frames are dispatched to the rx function.
+ * Bytes outside of a valid frame are dropped.
+ */
+void lwlte_cmux_input(lwlte_cmux_t cmux, const uint8_t* data, size_t size);
+
+/**
+ * Drop a partially received frame, used when the module leaves the multiplexer mode.
+ */
+void lwlte_cmux_reset(lwlte_cmux_t cmux);
+
+#ifdef __cplusplus
+}
+#endif
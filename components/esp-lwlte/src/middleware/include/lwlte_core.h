@@ -9,11 +9,14 @@
 #include "lwlte.h"
 #include "lwlte_err.h"
 #include "lwlte_sys_types.h"
+#include "lwlte_at_parser.h"
+#include "lwlte_sys_flags.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
 /* AT commands */
+#define AT_PROBE "AT\r\n" //检查模块是否响应
 #define AT_CIMI "AT+CIMI\r\n"
 #define AT_RESET "AT+RESET\r\n" //重启模块
 #define AT_CPIN "AT+CPIN?\r\n" //查询SIM卡是否准备好
@@ -23,6 +26,42 @@
 #define AT_CSTT "AT+CSTT\r\n" //启动任务并设置接入点 APN、用户名、密码
 #define AT_CIICR "AT+CIICR\r\n" //激活移动场景(或发起 GPRS 或 CSD 无线连接)
 #define AT_CIFSR "AT+CIFSR\r\n" //查询本地 IP 地址
+#define AT_DIAL "ATD*99#\r\n" //拨号进入 PPP 数据模式
+#define AT_ESCAPE "+++" //退出数据模式, 前后需保持静默
+#define AT_HANGUP "ATH\r\n" //挂断数据连接
+#define AT_CMUX_FMT "AT+CMUX=0,0,%d,%d\r\n" //进入 CMUX 多路复用模式, 参数为端口速率代码和最大帧长度
+#define AT_CMUX_NO_SPEED_FMT "AT+CMUX=0,0,,%d\r\n" //进入 CMUX 多路复用模式, 波特率没有速率代码时省略该参数
+/* The commands with arguments are built by lwlte_at_builder, the macros are the heads and the comments give the arguments */
+#define AT_CIPMUX_ON "AT+CIPMUX=1\r\n" //开启多链接模式, 需在激活移动场景之前设置
+#define AT_CIPQSEND_ON "AT+CIPQSEND=1\r\n" //快发模式, 数据写入模块即返回 DATA ACCEPT:<n>,<len>
+#define AT_CIPRXGET "AT+CIPRXGET=" //手动接收数据, 1 开启手动接收, 2,<n>,<len> 读取数据
+#define AT_CIPSTART "AT+CIPSTART=" //建立连接, <n>,"<TCP|UDP>","<host>",<port>, 之后上报 <n>, CONNECT OK
+#define AT_CIPSEND "AT+CIPSEND=" //发送数据, <n>,<len>, 出现 '>' 后输入指定长度的数据
+#define AT_CIPCLOSE "AT+CIPCLOSE=" //关闭连接, <n>,1 快速关闭, 返回 <n>, CLOSE OK
+#define AT_CDNSGIP "AT+CDNSGIP=" //域名解析, "<domain>", OK 之后返回 +CDNSGIP: 1,"<domain>","<ip>"
+#define AT_FSCREATE "AT+FSCREATE=" //创建文件, "<filename>"
+#define AT_FSWRITE "AT+FSWRITE=" //写文件, "<filename>",<mode>,<size>,<timeout>, mode 0 从头写 1 追加, 出现 '>' 后输入指定长度的数据
+#define AT_FSFLSIZE "AT+FSFLSIZE=" //查询文件大小, "<filename>"
+#define AT_FSREAD "AT+FSREAD=" //读文件, "<filename>",<mode>,<size>,<position>, mode 0 从头读 1 从 position 读
+#define AT_FSDEL "AT+FSDEL=" //删除文件, "<filename>"
+#define AT_CIPPING "AT+CIPPING=" //PING, "<host>",<count>,<size>,<timeout>, timeout 单位 100ms, 每个回复为 +CIPPING: <n>,"<ip>",<time>,<ttl>, time 单位 ms
+#define AT_SSLCFG "AT+SSLCFG=" //配置 SSL 上下文, "<type>",<ctxindex>,<value>
+#define AT_SSLMIPSTART "AT+SSLMIPSTART=" //建立 MQTT 的 SSL 连接, "<host>",<port>
+#define AT_MCONFIG "AT+MCONFIG=" //设置 MQTT 参数, "<clientid>","<username>","<password>"[,<will_qos>,<will_retain>,"<will_topic>","<will_msg>"]
+#define AT_MIPSTART "AT+MIPSTART=" //建立 MQTT 的 TCP 连接, "<host>",<port>
+#define AT_MCONNECT "AT+MCONNECT=" //向服务器请求 MQTT 会话, <clean_session>,<keepalive>
+#define AT_MPUB "AT+MPUB=" //发布消息, "<topic>",<qos>,<retain>,"<payload>"
+#define AT_MPUBEX "AT+MPUBEX=" //发布消息, "<topic>",<qos>,<retain>,<len>, 出现 '>' 后输入指定长度的 payload
+#define AT_MSUB "AT+MSUB=" //订阅主题, "<topic>",<qos>
+#define AT_MUNSUB "AT+MUNSUB=" //取消订阅主题, "<topic>"
+#define AT_MDISCONNECT "AT+MDISCONNECT\r\n" //关闭 MQTT 会话
+#define AT_MIPCLOSE "AT+MIPCLOSE\r\n" //关闭 MQTT 的 TCP 连接
+#define AT_MQTTSTATU "AT+MQTTSTATU\r\n" //查询 MQTT 连接状态
+#define AT_PROMPT_CANCEL "\x1B" //取消 '>' 之后的数据输入
+#define URC_MSUB "+MSUB:" //订阅消息上报, 格式为 +MSUB: "<topic>",<len> byte,<payload>
+#define URC_MSUB_LEN_SUFFIX " byte," //+MSUB 中长度之后的分隔符, 其后为 payload
+#define URC_RECEIVE "+RECEIVE," //多链接模式收到数据, 格式为 +RECEIVE,<n>,<len>:\r\n<data>
+#define URC_CIPRXGET "+CIPRXGET:" //手动接收模式, 1,<n> 为数据到达, 2,<n>,<len>,<remain>\r\n<data> 为读取的数据
 /* Event Group Bits */
 #define LWLTE_FLAGS_CORE_INITIALIZING BIT0 // module is initializing
 #define LWLTE_FLAGS_CORE_INITIALIZED BIT1 // module is initialized
@@ -36,13 +75,99 @@
 #define LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED BIT9 // IP address is assigned
 #define LWLTE_FLAGS_MODULE_NETWORK_CONNECTED BIT10 // network is connected
 #define LWLTE_FLAGS_AT_CMD_IS_SENDING BIT11 // AT command is sending
+#define LWLTE_FLAGS_CORE_STOPPING BIT12 // deinit in progress, the tasks must exit
+#define LWLTE_FLAGS_ACTIVATE_ABORT BIT13 // the network activate task must exit
+#define LWLTE_FLAGS_CMUX_ACTIVE BIT15 // the module is in the multiplexer mode, the UART carries 27.010 frames
+#define LWLTE_FLAGS_DATA_MODE BIT16 // the data channel (or the UART itself without the multiplexer) carries PPP
+/* Everything learned from the module, cleared when the module is restarted */
+#define LWLTE_FLAGS_MODULE_STATE_BITS (LWLTE_FLAGS_MODULE_READY | LWLTE_FLAGS_MODULE_SIM_CARD_READY | \
+    LWLTE_FLAGS_MODULE_SIGNAL_GOOD | LWLTE_FLAGS_MODULE_PDN_ACTIVATED | LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED | \
+    LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED | LWLTE_FLAGS_MODULE_NETWORK_CONNECTED | LWLTE_FLAGS_CMUX_ACTIVE | \
+    LWLTE_FLAGS_DATA_MODE)
+/* Set in the flags of a watcher, see lwlte_core_set_watcher_internal */
+#define LWLTE_CORE_WATCHER_WAKE BIT0
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* One modem: its UART, its tasks and everything learned from it, see struct lwlte_core_s in lwlte_core.c */
+typedef struct lwlte_core_s lwlte_core_t;
 
-lwlte_err_t lwlte_core_send_at_cmd_internal(const char* cmd, 
+/* URC handlers per instance, see lwlte_core_add_urc_handler_internal. The socket layer takes one per connection */
+#define LWLTE_CORE_MAX_URC_HANDLERS 12
+
+/* Returned by a URC handler that only looked at the line, it then goes on to the AT waiter */
+#define LWLTE_CORE_URC_PASS ((size_t)-1)
+
+/* Wait string of the data prompt, see lwlte_core_send_at_cmd_prompt_internal */
+#define LWLTE_CORE_PROMPT ">"
+
+/* CSQ value of a module that has not been asked yet or does not know, as in 3GPP TS 27.007 */
+#define LWLTE_CORE_CSQ_UNKNOWN 99
+
+/* Liveness and load signals collected by the core for the watchdog and the link scheduler */
+typedef struct {
+    lwlte_base_type_t consecutive_timeouts; // AT commands that timed out in a row
+    lwlte_tick_t last_rx_ms; // time of the last line received from the module
+    lwlte_base_type_t unexpected_rdy_count; // "RDY" received while the module was already ready
+    lwlte_base_type_t at_latency_ms; // moving average of the AT round-trip time, 0 before the first answer
+    lwlte_base_type_t pending_cmds; // AT commands in flight or queued on the module
+    lwlte_base_type_t csq; // last CSQ reading, LWLTE_CORE_CSQ_UNKNOWN if none
+} lwlte_core_health_t;
+
+/* One piece of the data of a prompted command, the pieces are sent back to back */
+typedef struct {
+    const void* base;
+    size_t len;
+} lwlte_core_iovec_t;
+
+
+lwlte_err_t lwlte_core_send_at_cmd_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    char* response_buf, 
+    lwlte_base_type_t response_buf_size
+);
+
+/**
+ * Send an AT command and parse the response against a schema without copying it.
+ * String fields are slices into the core's response buffer and stay valid until the next AT command.
+ * @return LWLTE_OK if a line of the response matched the schema
+ */
+lwlte_err_t lwlte_core_send_at_cmd_parse_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    lwlte_at_schema_id_t schema_id, 
+    lwlte_at_field_t* fields, 
+    size_t field_count
+);
+
+/**
+ * Send an AT command and deliver its response lines to a sink as they arrive instead of buffering them,
+ * so the response size is not bounded by uart_buf_size. See lwlte_core_line_sink_t for the sink rules.
+ * @param wait_time_ms Deadline of the whole command, however many lines arrive
+ * @return LWLTE_ERROR on the error string or if the sink aborted, LWLTE_TIMEOUT past the deadline
+ */
+lwlte_err_t lwlte_core_send_at_cmd_stream_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    lwlte_core_line_sink_t sink, 
+    void* sink_ctx
+);
+
+/**
+ * Send an AT command that asks for data (e.g. AT+MPUBEX with a length), wait for the '>' prompt, send exactly
+ * the bytes of the iovec and wait for the final response. The data is binary, it may hold line breaks and NULs.
+ * If the prompt does not come the data is not sent and the data entry is cancelled.
+ * @param wait_time_ms Timeout of the prompt, then of the response
+ */
+lwlte_err_t lwlte_core_send_at_cmd_prompt_internal(lwlte_core_t* core, const char* cmd, 
+    const lwlte_core_iovec_t* iov, 
+    size_t iov_count, 
     const char* wait_str, 
     const char* error_str, 
     lwlte_base_type_t wait_time_ms, 
@@ -50,29 +175,158 @@ lwlte_err_t lwlte_core_send_at_cmd_internal(const char* cmd,
     lwlte_base_type_t response_buf_size
 );
 
-lwlte_err_t lwlte_core_input(char* input, lwlte_base_type_t input_size);
+/**
+ * Receives the data channel of the multiplexer, called from the UART RX task.
+ * @param data Binary, only valid during the call
+ */
+typedef void (*lwlte_core_data_sink_t)(const uint8_t* data, size_t size, void* ctx);
+
+/**
+ * Receives a URC, called from the core worker (the UART RX task in single task mode).
+ * @param data The URC from its prefix on, a slice of the receive buffer that is only valid during the call.
+ * It may hold binary data and is not null-terminated
+ * @return 0 once the URC is complete, or the number of bytes still missing, e.g. the rest of a payload
+ * that runs over several lines. They are then collected as they are, without line splitting, and the handler
+ * is called again with the whole URC. LWLTE_CORE_URC_PASS if the line is also the response of a command
+ */
+typedef size_t (*lwlte_core_urc_handler_t)(const char* data, size_t size, void* ctx);
+
+lwlte_err_t lwlte_core_input(lwlte_core_t* core, char* input, lwlte_base_type_t input_size);
+
+/**
+ * Route the lines starting with a prefix (e.g. "+MSUB:") to a handler, they no longer reach the AT waiter.
+ * The handlers are kept across an in-place re-init. A URC larger than uart_buf_size is dropped.
+ * @param prefix Must stay valid until the handler is removed
+ * @return LWLTE_ERROR if all the LWLTE_CORE_MAX_URC_HANDLERS entries are used
+ */
+lwlte_err_t lwlte_core_add_urc_handler_internal(lwlte_core_t* core, const char* prefix, 
+    lwlte_core_urc_handler_t handler, void* ctx);
+
+/**
+ * Remove a handler, waiting for it to return if it is running.
+ */
+lwlte_err_t lwlte_core_remove_urc_handler_internal(lwlte_core_t* core, const char* prefix);
+
+/**
+ * Set the receiver of the data channel, NULL drops the data.
+ */
+lwlte_err_t lwlte_core_set_data_sink_internal(lwlte_core_t* core, lwlte_core_data_sink_t sink, void* ctx);
+
+/**
+ * Send on the data channel, concurrently with the AT commands.
+ * @return LWLTE_NOT_SUPPORTED if the multiplexer is not active
+ */
+lwlte_err_t lwlte_core_data_write_internal(lwlte_core_t* core, const uint8_t* data, size_t size);
+
+bool lwlte_core_get_cmux_active_internal(lwlte_core_t* core);
+
+/**
+ * Size of the line buffer of the framers (uart_buf_size), a URC with its payload must be smaller to be delivered.
+ */
+lwlte_base_type_t lwlte_core_get_line_size_internal(lwlte_core_t* core);
+
+/**
+ * Dial and switch the data channel to the data mode, its input then goes to the data sink.
+ * Without the multiplexer the whole UART is switched and AT commands are refused until the data mode is left.
+ * @return LWLTE_OK once the module answered "CONNECT"
+ */
+lwlte_err_t lwlte_core_enter_data_mode_internal(lwlte_core_t* core, const char* dial_cmd, lwlte_base_type_t wait_time_ms);
+
+/**
+ * Leave the data mode, with the "+++" escape and ATH if the multiplexer is not active.
+ */
+lwlte_err_t lwlte_core_exit_data_mode_internal(lwlte_core_t* core);
+
+/**
+ * Report the state of an IP link run outside of the module (PPP), sets or clears the network connected state.
+ */
+void lwlte_core_set_link_up_internal(lwlte_core_t* core, bool up);
+
+/**
+ * Allocate an instance and initialize it, several instances drive several modules on separate UARTs.
+ * The instances in split task mode share one worker task.
+ */
+lwlte_err_t lwlte_core_create_internal(const lwlte_config_t* config, lwlte_core_t** core);
+
+/**
+ * Deinitialize the instance and free it.
+ */
+lwlte_err_t lwlte_core_destroy_internal(lwlte_core_t* core);
+
+/**
+ * Initialize an instance in place, the memory is kept by lwlte_core_deinit_internal so that the
+ * watchdog can re-initialize an instance without invalidating its handle.
+ * The flags, the locks and the semaphores are created once and kept until lwlte_core_destroy_internal.
+ */
+lwlte_err_t lwlte_core_init_internal(lwlte_core_t* core, const lwlte_config_t* config);
+
+/**
+ * Stop all the tasks, remove the UART driver, power the module off and free the buffers.
+ * The sync objects are kept, the AT commands fail with LWLTE_NOT_INITIALIZED until the next init.
+ * LWLTE_TIMEOUT before anything is torn down (the network activate task did not stop) leaves the instance as it was.
+ * LWLTE_TIMEOUT after that (the RX task or the worker did not stop) still completes the teardown, but the buffers
+ * those tasks use are leaked and lwlte_core_destroy_internal never frees the instance.
+ */
+lwlte_err_t lwlte_core_deinit_internal(lwlte_core_t* core);
+
+/**
+ * Power-cycle the module through the EN pin and run the bring-up again.
+ * The UART, the tasks and all the handles stay valid.
+ */
+lwlte_err_t lwlte_core_restart_internal(lwlte_core_t* core);
+
+lwlte_err_t lwlte_core_network_activate_internal(lwlte_core_t* core);
+
+/**
+ * Shut the IP context down (AT+CIPSHUT) and run the network bring-up again, the module is not reset.
+ */
+lwlte_err_t lwlte_core_reactivate_internal(lwlte_core_t* core);
+
+/**
+ * Slot for the watchdog of the instance, owned by the API layer.
+ */
+void lwlte_core_set_watchdog_internal(lwlte_core_t* core, void* watchdog);
+
+void* lwlte_core_get_watchdog_internal(lwlte_core_t* core);
+
+/**
+ * Flags set with LWLTE_CORE_WATCHER_WAKE when the network connected state may have changed, NULL to stop.
+ * An instance has one watcher, kept across an in-place re-init.
+ */
+void lwlte_core_set_watcher_internal(lwlte_core_t* core, lwlte_sys_flags_t watcher);
+
+lwlte_base_type_t lwlte_core_get_signal_strength(lwlte_core_t* core);
+
+/**
+ * Read the CSQ into csq and the health, the module ready check and AT+CSQ run under the same at_waiter lock.
+ * @return LWLTE_NOT_INITIALIZED, without logging, if the module is not ready
+ */
+lwlte_err_t lwlte_core_refresh_signal_internal(lwlte_core_t* core, lwlte_base_type_t* csq);
 
-lwlte_err_t lwlte_core_init_internal(const lwlte_config_t* config);
+lwlte_err_t lwlte_core_get_health_internal(lwlte_core_t* core, lwlte_core_health_t* health);
 
-lwlte_err_t lwlte_core_deinit_internal(void);
+/**
+ * Clear the timeout counter and restart the RX silence timer, used after a recovery action.
+ */
+void lwlte_core_reset_health_internal(lwlte_core_t* core);
 
-lwlte_err_t lwlte_core_network_activate_internal(void);
+bool lwlte_core_get_network_activating_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_module_ready_internal(void);
+bool lwlte_core_get_module_ready_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_module_sim_card_ready_internal(void);
+bool lwlte_core_get_module_sim_card_ready_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_module_signal_good_internal(void);
+bool lwlte_core_get_module_signal_good_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_module_ip_gprs_activated_internal(void);
+bool lwlte_core_get_module_ip_gprs_activated_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_module_pdn_activated_internal(void);
+bool lwlte_core_get_module_pdn_activated_internal(lwlte_core_t* core);
 
-bool lwlte_core_get_network_connected_internal(void);
+bool lwlte_core_get_network_connected_internal(lwlte_core_t* core);
 
-lwlte_err_t lwlte_core_wait_module_ready(lwlte_base_type_t timeout_ms);
+lwlte_err_t lwlte_core_wait_module_ready(lwlte_core_t* core, lwlte_base_type_t timeout_ms);
 
-lwlte_err_t lwlte_core_wait_network_connected(lwlte_base_type_t timeout_ms);   
+lwlte_err_t lwlte_core_wait_network_connected(lwlte_core_t* core, lwlte_base_type_t timeout_ms);   
 
 #ifdef __cplusplus
 }
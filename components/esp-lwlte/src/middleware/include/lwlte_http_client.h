@@ -0,0 +1,36 @@
+/*
+    File: lwlte_http_client.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte http client header file, see lwlte_http.c
+*/
+#pragma once
+
+#include "lwlte_http.h"
+#include "lwlte_tcp.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct lwlte_http_client_s lwlte_http_client_t;
+
+lwlte_err_t lwlte_http_client_create_internal(lwlte_tcp_t* tcp, const lwlte_http_config_t* config, 
+    lwlte_http_client_t** client);
+
+lwlte_err_t lwlte_http_client_destroy_internal(lwlte_http_client_t* client);
+
+/**
+ * See lwlte_http_client_get. One task uses a client at a time.
+ */
+lwlte_err_t lwlte_http_client_get_internal(lwlte_http_client_t* client, lwlte_http_request_t* requests, size_t count, 
+    lwlte_http_body_cb_t cb, void* ctx);
+
+lwlte_err_t lwlte_http_client_get_stats_internal(lwlte_http_client_t* client, lwlte_http_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
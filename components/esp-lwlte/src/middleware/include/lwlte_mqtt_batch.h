@@ -0,0 +1,59 @@
+/*
+    File: lwlte_mqtt_batch.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT publish batching header file
+    - Small publishes to the same topic are framed into one message and flushed at the end of a time window,
+      or earlier when the batch is full, so that many points cost one AT transaction and one MQTT packet.
+*/
+#pragma once
+
+#include "lwlte_mqtt.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Queue a flushed batch (or a publish that bypasses the batching), called without the batch lock, so it may block
+ * or add publishes again.
+ * @param qos -1 for the default QoS
+ */
+typedef lwlte_err_t (*lwlte_mqtt_batch_flush_fn_t)(const char* topic, const char* payload, size_t payload_len,
+    lwlte_base_type_t qos, bool retain, void* ctx);
+
+/* opaque handle */
+typedef void* lwlte_mqtt_batch_t;
+
+/**
+ * Create the batching stage and its task.
+ * @param config The batch_t part of the client config, window_ms must be set
+ */
+lwlte_mqtt_batch_t lwlte_mqtt_batch_create(const lwlte_mqtt_client_config_t* config, lwlte_mqtt_batch_flush_fn_t flush, void* ctx);
+
+/**
+ * Stop the task and flush the open batches.
+ */
+void lwlte_mqtt_batch_delete(lwlte_mqtt_batch_t batch);
+
+/**
+ * Add a publish to the batch of its topic. A publish at or above flush_qos, a retained one, or one too large
+ * for a batch flushes the batch of its topic and is then passed to the flush function as it is.
+ * @param qos -1 for the default QoS, it does not bypass the batching
+ */
+lwlte_err_t lwlte_mqtt_batch_add(lwlte_mqtt_batch_t batch, const char* topic, const char* payload, size_t payload_len,
+    lwlte_base_type_t qos, bool retain);
+
+/**
+ * Flush the open batches now.
+ * @return The error of the first batch that could not be queued, it stays open
+ */
+lwlte_err_t lwlte_mqtt_batch_flush(lwlte_mqtt_batch_t batch);
+
+#ifdef __cplusplus
+}
+#endif
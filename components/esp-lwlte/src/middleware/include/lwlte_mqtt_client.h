@@ -9,27 +9,88 @@
 #include "lwlte_mqtt.h"
 #include "lwlte_sys_types.h"
 #include "lwlte_err.h"
+#include "lwlte_core.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-lwlte_err_t lwlte_mqtt_client_init_internal(const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms);
+/* One MQTT session on one module, see struct lwlte_mqtt_client_s in lwlte_mqtt_client.c */
+typedef struct lwlte_mqtt_client_s lwlte_mqtt_client_t;
 
-lwlte_err_t lwlte_mqtt_client_deinit_internal(void);
+/**
+ * Allocate a client bound to a core instance, it is configured by lwlte_mqtt_client_init_internal.
+ */
+lwlte_err_t lwlte_mqtt_client_create_internal(lwlte_core_t* core, lwlte_mqtt_client_t** client);
 
-lwlte_err_t lwlte_mqtt_client_connect_internal();
+/**
+ * Deinitialize the client and free it.
+ */
+lwlte_err_t lwlte_mqtt_client_destroy_internal(lwlte_mqtt_client_t* client);
 
-lwlte_err_t lwlte_mqtt_client_disconnect_internal();
+lwlte_err_t lwlte_mqtt_client_init_internal(lwlte_mqtt_client_t* client, const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms);
 
-lwlte_err_t lwlte_mqtt_client_subscribe_internal(const char* topic);
+lwlte_err_t lwlte_mqtt_client_deinit_internal(lwlte_mqtt_client_t* client);
 
-lwlte_err_t lwlte_mqtt_client_unsubscribe_internal(const char* topic);
+/**
+ * Open the TCP connection and the MQTT session, the queued publishes start flowing.
+ */
+lwlte_err_t lwlte_mqtt_client_connect_internal(lwlte_mqtt_client_t* client);
 
-lwlte_err_t lwlte_mqtt_client_publish_internal(const char* topic, const char* payload);
+lwlte_err_t lwlte_mqtt_client_disconnect_internal(lwlte_mqtt_client_t* client);
 
+lwlte_err_t lwlte_mqtt_client_subscribe_internal(lwlte_mqtt_client_t* client, const char* topic);
 
+lwlte_err_t lwlte_mqtt_client_unsubscribe_internal(lwlte_mqtt_client_t* client, const char* topic);
 
+/**
+ * Queue a publish with the default QoS, see lwlte_mqtt_client_publish_qos_internal.
+ */
+lwlte_err_t lwlte_mqtt_client_publish_internal(lwlte_mqtt_client_t* client, const char* topic, const char* payload);
+
+/**
+ * Queue a publish on the pipeline and return at once, the completion is reported to on_publish.
+ * @param qos -1 selects the default QoS
+ */
+lwlte_err_t lwlte_mqtt_client_publish_qos_internal(lwlte_mqtt_client_t* client, const char* topic, const char* payload, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+/**
+ * Queue a publish whose payload is binary, it may hold quotes, line breaks and NULs.
+ */
+lwlte_err_t lwlte_mqtt_client_publish_binary_internal(lwlte_mqtt_client_t* client, const char* topic, 
+    const void* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, 
+    lwlte_base_type_t* msg_id);
+
+/**
+ * Send the open batches now.
+ */
+lwlte_err_t lwlte_mqtt_client_flush_internal(lwlte_mqtt_client_t* client);
+
+lwlte_err_t lwlte_mqtt_client_get_reconnect_stats_internal(lwlte_mqtt_client_t* client, 
+    lwlte_mqtt_reconnect_stats_t* stats);
+
+lwlte_err_t lwlte_mqtt_client_get_pool_stats_internal(lwlte_mqtt_client_t* client, 
+    lwlte_mqtt_pool_stats_t* topic_stats, lwlte_mqtt_pool_stats_t* payload_stats);
+
+/**
+ * Route the incoming messages matching a topic filter to a handler, see lwlte_mqtt_router_add.
+ */
+lwlte_err_t lwlte_mqtt_client_add_handler_internal(lwlte_mqtt_client_t* client, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx);
+
+lwlte_err_t lwlte_mqtt_client_remove_handler_internal(lwlte_mqtt_client_t* client, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx);
+
+/**
+ * Messages delivered to the handlers so far, wraps around.
+ */
+uint32_t lwlte_mqtt_client_get_rx_count_internal(lwlte_mqtt_client_t* client);
+
+/**
+ * Flags set with LWLTE_CORE_WATCHER_WAKE after each delivery, NULL to stop. A client has one watcher.
+ */
+void lwlte_mqtt_client_set_watcher_internal(lwlte_mqtt_client_t* client, lwlte_sys_flags_t watcher);
 
 #ifdef __cplusplus
 }
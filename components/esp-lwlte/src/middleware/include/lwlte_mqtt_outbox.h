@@ -0,0 +1,58 @@
+/*
+    File: lwlte_mqtt_outbox.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT store-and-forward outbox header file
+    - Publishes are appended to a log on flash-like storage and fed to the pipeline in order while the session is up.
+    - A delivered publish is only marked done in place, the log is reclaimed a whole sector at a time.
+*/
+#pragma once
+
+#include "lwlte_mqtt.h"
+#include "lwlte_mqtt_pipeline.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle */
+typedef void* lwlte_mqtt_outbox_t;
+
+/**
+ * Open the log on config->outbox_t.storage and recover the publishes left undelivered.
+ * @param capacity Publishes the pipeline can hold, see lwlte_mqtt_pipeline_get_capacity
+ */
+lwlte_mqtt_outbox_t lwlte_mqtt_outbox_create(const lwlte_mqtt_client_config_t* config, lwlte_base_type_t capacity);
+
+/**
+ * Free the outbox, the log is left as it is. The pipeline fed by it must be deleted first.
+ */
+void lwlte_mqtt_outbox_delete(lwlte_mqtt_outbox_t outbox);
+
+/**
+ * Append a publish to the log, the overflow policy applies when the log is full.
+ * @param qos -1 selects the default QoS of the pipeline
+ * @param msg_id Optional, set to the sequence number of the record
+ * @return LWLTE_ERROR if full with DROP_NEWEST, LWLTE_TIMEOUT if still full after wait_ms with BLOCK
+ */
+lwlte_err_t lwlte_mqtt_outbox_append(lwlte_mqtt_outbox_t outbox, const char* topic, const char* payload,
+    size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+/**
+ * Submit the next undelivered record to the pipeline, the lwlte_mqtt_pipeline_source_fn_t of the client.
+ */
+bool lwlte_mqtt_outbox_feed(lwlte_mqtt_outbox_t outbox, lwlte_mqtt_pipeline_t pipeline);
+
+/**
+ * Completion of the oldest record fed to the pipeline, the pipeline completes them in order.
+ * The record is marked done unless it was dropped, then on_publish is called with its sequence number.
+ */
+void lwlte_mqtt_outbox_complete(lwlte_mqtt_outbox_t outbox, lwlte_mqtt_msg_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+/*
+    File: lwlte_mqtt_pipeline.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT outbound pipeline header file
+    - Publishes are queued with an ID and sent in order by the pipeline task, the caller does not wait for them.
+    - A rejected QoS 1/2 publish is sent again until it is confirmed or out of retries, the completion is reported per ID.
+    - A QoS 2 publish without an answer is never sent again, the module may have sent it and a second one would be
+      a new message for the broker.
+*/
+#pragma once
+
+#include "lwlte_mqtt.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_slab.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A queued publish, the strings stay valid until it completes */
+typedef struct {
+    lwlte_base_type_t id;
+    const char* topic;
+    const char* payload;
+    size_t payload_len;
+    lwlte_base_type_t qos;
+    bool retain;
+    lwlte_base_type_t ack_timeout_ms; // how long the sender waits for the confirmation
+} lwlte_mqtt_pipeline_msg_t;
+
+/**
+ * Send one publish and wait for the module to confirm it, called from the pipeline task.
+ * @return LWLTE_OK once confirmed. LWLTE_TIMEOUT if the publish may have left without an answer, a QoS 2 one is
+ * then reported LWLTE_MQTT_MSG_UNKNOWN. Any other failure means nothing was sent, it is retried, unless the sender
+ * took the pipeline offline meanwhile, in which case the publish waits for lwlte_mqtt_pipeline_set_online
+ * without losing a retry
+ */
+typedef lwlte_err_t (*lwlte_mqtt_pipeline_send_fn_t)(const lwlte_mqtt_pipeline_msg_t* msg, void* ctx);
+
+/**
+ * Queue the next publish with lwlte_mqtt_pipeline_submit (wait_ms 0), called from the pipeline task while
+ * online and a slot is free.
+ * @return false if there is nothing to send or the publish could not be queued
+ */
+typedef bool (*lwlte_mqtt_pipeline_source_fn_t)(void* ctx);
+
+/* opaque handle */
+typedef void* lwlte_mqtt_pipeline_t;
+
+/**
+ * Create the pipeline and its task, it starts offline.
+ * @param config The pipeline_t part of the client config, the unset fields select the defaults
+ */
+lwlte_mqtt_pipeline_t lwlte_mqtt_pipeline_create(const lwlte_mqtt_client_config_t* config, 
+    lwlte_mqtt_pipeline_send_fn_t send, void* ctx);
+
+/**
+ * Stop the task and free the pipeline, the pending publishes are reported dropped.
+ */
+void lwlte_mqtt_pipeline_delete(lwlte_mqtt_pipeline_t pipeline);
+
+/**
+ * Queue a publish, the topic and the payload are copied into blocks of the pools, or to the heap if they are too large.
+ * @param qos -1 selects the default QoS
+ * @return LWLTE_TIMEOUT if no slot got free within wait_ms
+ */
+lwlte_err_t lwlte_mqtt_pipeline_submit(lwlte_mqtt_pipeline_t pipeline, const char* topic, 
+    const char* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, 
+    lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id);
+
+/**
+ * Start or hold the sending, e.g. when the broker session is up or lost. Queued publishes are kept while offline.
+ */
+void lwlte_mqtt_pipeline_set_online(lwlte_mqtt_pipeline_t pipeline, bool online);
+
+bool lwlte_mqtt_pipeline_get_online(lwlte_mqtt_pipeline_t pipeline);
+
+/**
+ * Pull the publishes from a source (e.g. the outbox) instead of having them submitted by the callers.
+ * The source is asked again after each lwlte_mqtt_pipeline_wake, each completion and the idle wait.
+ */
+void lwlte_mqtt_pipeline_set_source(lwlte_mqtt_pipeline_t pipeline, lwlte_mqtt_pipeline_source_fn_t source, void* ctx);
+
+/**
+ * Wake the task, e.g. when the source has a new publish.
+ */
+void lwlte_mqtt_pipeline_wake(lwlte_mqtt_pipeline_t pipeline);
+
+/* Number of slots (max_inflight after the defaults) */
+lwlte_base_type_t lwlte_mqtt_pipeline_get_capacity(lwlte_mqtt_pipeline_t pipeline);
+
+void lwlte_mqtt_pipeline_get_pool_stats(lwlte_mqtt_pipeline_t pipeline, lwlte_slab_stats_t* topic_stats, 
+    lwlte_slab_stats_t* payload_stats);
+
+#ifdef __cplusplus
+}
+#endif
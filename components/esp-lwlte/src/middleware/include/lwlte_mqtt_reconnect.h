@@ -0,0 +1,60 @@
+/*
+    File: lwlte_mqtt_reconnect.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT reconnect engine header file
+    - Watches the session while the application wants it up and opens it again once it is lost,
+      with an exponential backoff and jitter between the attempts, and measures the time to resume.
+*/
+#pragma once
+
+#include "lwlte_mqtt.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Open the session again, called from the reconnect task.
+ * @param down_ms Time since the session was found lost
+ */
+typedef lwlte_err_t (*lwlte_mqtt_reconnect_fn_t)(lwlte_tick_t down_ms, void* ctx);
+
+/**
+ * Check the session, called from the reconnect task every check_interval_ms while it is up.
+ */
+typedef bool (*lwlte_mqtt_reconnect_probe_fn_t)(void* ctx);
+
+/* opaque handle */
+typedef void* lwlte_mqtt_reconnect_t;
+
+/**
+ * Create the engine and its task, the session is not wanted until lwlte_mqtt_reconnect_set_wanted.
+ * @param config The reconnect_t part of the client config
+ */
+lwlte_mqtt_reconnect_t lwlte_mqtt_reconnect_create(const lwlte_mqtt_client_config_t* config, 
+    lwlte_mqtt_reconnect_fn_t reconnect, lwlte_mqtt_reconnect_probe_fn_t probe, void* ctx);
+
+void lwlte_mqtt_reconnect_delete(lwlte_mqtt_reconnect_t reconnect);
+
+/**
+ * The application opened (up = true, whether it succeeded or not) or closed the session.
+ */
+void lwlte_mqtt_reconnect_set_wanted(lwlte_mqtt_reconnect_t reconnect, bool wanted, bool up);
+
+/**
+ * The client found the session down, e.g. on a failed publish. The task starts reconnecting at once.
+ */
+void lwlte_mqtt_reconnect_notify_lost(lwlte_mqtt_reconnect_t reconnect);
+
+/**
+ * Fill in the counters of the engine, the DNS and subscription counters belong to the client.
+ */
+void lwlte_mqtt_reconnect_get_stats(lwlte_mqtt_reconnect_t reconnect, lwlte_mqtt_reconnect_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
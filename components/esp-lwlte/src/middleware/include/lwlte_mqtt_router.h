@@ -0,0 +1,50 @@
+/*
+    File: lwlte_mqtt_router.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT subscription router header file
+    - Topic filters are kept in a trie with one node per level, the exact levels of a node are sorted
+      and searched by bisection, '+' and '#' have their own branch.
+    - A message walks the trie once whatever the number of filters.
+*/
+#pragma once
+
+#include "lwlte_mqtt.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle */
+typedef void* lwlte_mqtt_router_t;
+
+lwlte_mqtt_router_t lwlte_mqtt_router_create(void);
+
+void lwlte_mqtt_router_delete(lwlte_mqtt_router_t router);
+
+/**
+ * Register a handler for a topic filter, the filter is copied. Adding the same handler and context again has no effect.
+ * @param filter MQTT topic filter, '+' and '#' must fill a whole level and '#' must be the last one
+ */
+lwlte_err_t lwlte_mqtt_router_add(lwlte_mqtt_router_t router, const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx);
+
+/**
+ * @return LWLTE_NOT_FOUND if the handler is not registered for this filter
+ */
+lwlte_err_t lwlte_mqtt_router_remove(lwlte_mqtt_router_t router, const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx);
+
+/**
+ * Call the handlers of every filter matching the topic. They are called after the lock is released, so a handler may
+ * add or remove handlers, and a handler removed by another task during the dispatch may still get this message.
+ * The topics starting with '$' are not matched by a leading wildcard.
+ * @return The number of handlers called
+ */
+lwlte_base_type_t lwlte_mqtt_router_dispatch(lwlte_mqtt_router_t router, const char* topic, size_t topic_len,
+    const char* payload, size_t payload_len);
+
+#ifdef __cplusplus
+}
+#endif
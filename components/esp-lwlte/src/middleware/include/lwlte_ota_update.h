@@ -0,0 +1,35 @@
+/*
+    File: lwlte_ota_update.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte ota update header file
+*/
+#pragma once
+
+#include "lwlte_ota.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct lwlte_ota_s lwlte_ota_t;
+
+lwlte_err_t lwlte_ota_begin_internal(const lwlte_ota_config_t* config, lwlte_ota_t** ota);
+
+/**
+ * See lwlte_ota_run.
+ * @return LWLTE_NOT_SUPPORTED on a digest mismatch only, LWLTE_INVALID_ARG for an image larger than the storage
+ */
+lwlte_err_t lwlte_ota_run_internal(lwlte_ota_t* ota);
+
+lwlte_err_t lwlte_ota_get_stats_internal(lwlte_ota_t* ota, lwlte_ota_stats_t* stats);
+
+lwlte_err_t lwlte_ota_get_sha256_internal(lwlte_ota_t* ota, uint8_t* digest);
+
+lwlte_err_t lwlte_ota_end_internal(lwlte_ota_t* ota);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+/*
+    File: lwlte_ping_probe.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte link probe header file
+*/
+#pragma once
+
+#include "lwlte_ping.h"
+#include "lwlte_core.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct lwlte_ping_s lwlte_ping_t;
+
+lwlte_err_t lwlte_ping_create_internal(lwlte_core_t* core, const lwlte_ping_config_t* config, lwlte_ping_t** ping);
+
+lwlte_err_t lwlte_ping_destroy_internal(lwlte_ping_t* ping);
+
+lwlte_err_t lwlte_ping_trigger_internal(lwlte_ping_t* ping);
+
+lwlte_err_t lwlte_ping_reset_internal(lwlte_ping_t* ping);
+
+/**
+ * See lwlte_ping_get_summary, computed from the window on each call.
+ */
+lwlte_err_t lwlte_ping_get_summary_internal(lwlte_ping_t* ping, lwlte_ping_summary_t* summary);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,37 @@
+/*
+    File: lwlte_poll_set.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte poll set header file
+    - A poll set owns event flags. While it waits, its flags are the watcher of the sources of the items,
+      which set LWLTE_CORE_WATCHER_WAKE when their state changes. The items are checked again on each wake-up.
+*/
+#pragma once
+
+#include "lwlte_poll.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct lwlte_poll_s lwlte_poll_set_t;
+
+lwlte_err_t lwlte_poll_set_create_internal(lwlte_poll_set_t** set);
+
+lwlte_err_t lwlte_poll_set_destroy_internal(lwlte_poll_set_t* set);
+
+/**
+ * See lwlte_poll_wait.
+ */
+lwlte_err_t lwlte_poll_set_wait_internal(lwlte_poll_set_t* set, lwlte_poll_item_t* items, size_t count, 
+    uint32_t timeout_ms, size_t* ready);
+
+lwlte_err_t lwlte_poll_set_wakeup_internal(lwlte_poll_set_t* set);
+
+#ifdef __cplusplus
+}
+#endif
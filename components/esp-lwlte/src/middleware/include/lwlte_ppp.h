@@ -0,0 +1,48 @@
+/*
+    File: lwlte_ppp.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte PPP link header file
+    - Bridges the data channel of a core instance into lwIP as a PPP netif, requires CONFIG_LWIP_PPP_SUPPORT.
+*/
+#pragma once
+
+#include "lwlte_err.h"
+#include "lwlte_core.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle, one per core instance */
+typedef void* lwlte_ppp_t;
+
+/**
+ * Create the PPP link of a core instance, nothing is dialed until lwlte_ppp_start_internal.
+ * @return NULL if lwIP is built without PPP or on allocation failure
+ */
+lwlte_ppp_t lwlte_ppp_create(lwlte_core_t* core);
+
+/**
+ * Free the link, it must be stopped first.
+ */
+void lwlte_ppp_delete(lwlte_ppp_t ppp);
+
+/**
+ * Dial, switch the data channel to the data mode and start PPP in lwIP.
+ * The link comes up asynchronously, the core is told through lwlte_core_set_link_up_internal.
+ * @return LWLTE_NOT_SUPPORTED if lwIP is built without PPP
+ */
+lwlte_err_t lwlte_ppp_start_internal(lwlte_ppp_t ppp);
+
+/**
+ * Terminate PPP, remove the netif and leave the data mode. Does nothing if PPP is not started.
+ */
+lwlte_err_t lwlte_ppp_stop_internal(lwlte_ppp_t ppp);
+
+bool lwlte_ppp_get_link_up_internal(lwlte_ppp_t ppp);
+
+#ifdef __cplusplus
+}
+#endif
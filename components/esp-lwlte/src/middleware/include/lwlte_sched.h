@@ -0,0 +1,41 @@
+/*
+    File: lwlte_sched.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte multi-modem link scheduler header file
+    - Spreads the traffic over several core instances and moves it away from a link that goes down.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_err.h"
+#include "lwlte_core.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One scheduler, see struct lwlte_sched_s in lwlte_sched.c */
+typedef struct lwlte_sched_s lwlte_sched_t;
+
+lwlte_err_t lwlte_sched_create_internal(const lwlte_sched_config_t* config, lwlte_sched_t** sched);
+
+lwlte_err_t lwlte_sched_destroy_internal(lwlte_sched_t* sched);
+
+lwlte_err_t lwlte_sched_add_link_internal(lwlte_sched_t* sched, lwlte_core_t* core);
+
+lwlte_err_t lwlte_sched_remove_link_internal(lwlte_sched_t* sched, lwlte_core_t* core);
+
+/**
+ * @return LWLTE_NOT_FOUND if no link is usable
+ */
+lwlte_err_t lwlte_sched_pick_internal(lwlte_sched_t* sched, lwlte_core_t** core);
+
+bool lwlte_sched_link_usable_internal(lwlte_sched_t* sched, lwlte_core_t* core);
+
+lwlte_err_t lwlte_sched_get_link_stats_internal(lwlte_sched_t* sched, lwlte_core_t* core, lwlte_sched_link_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+    File: lwlte_slab.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte fixed-size block pool header file
+    - The blocks of a pool are carved out of one allocation made at creation, the free blocks are chained
+      through their first bytes. Allocating and freeing pop and push that list.
+*/
+#pragma once
+
+#include "lwlte_sys_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle */
+typedef void* lwlte_slab_t;
+
+typedef struct {
+    size_t block_size;
+    size_t block_count;
+    size_t in_use;
+    size_t peak; // highest in_use since the creation
+    uint32_t exhausted; // allocations that found the pool empty
+    uint32_t oversize; // allocations larger than a block
+} lwlte_slab_stats_t;
+
+/**
+ * @param block_size Rounded up to the pointer alignment
+ */
+lwlte_slab_t lwlte_slab_create(size_t block_size, size_t block_count);
+
+/**
+ * Free the pool, the blocks still in use are freed with it.
+ */
+void lwlte_slab_delete(lwlte_slab_t slab);
+
+/**
+ * @return A block, NULL if size does not fit in one or the pool is empty
+ */
+void* lwlte_slab_alloc(lwlte_slab_t slab, size_t size);
+
+void lwlte_slab_free(lwlte_slab_t slab, void* block);
+
+/**
+ * Allocate from the pool, and from the heap if the pool cannot serve the size. Free with lwlte_slab_release.
+ * A NULL pool always uses the heap.
+ */
+void* lwlte_slab_acquire(lwlte_slab_t slab, size_t size);
+
+/**
+ * Give back memory from lwlte_slab_acquire, to the pool or to the heap.
+ */
+void lwlte_slab_release(lwlte_slab_t slab, void* ptr);
+
+void lwlte_slab_get_stats(lwlte_slab_t slab, lwlte_slab_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
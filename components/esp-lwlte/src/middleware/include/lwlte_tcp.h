@@ -0,0 +1,62 @@
+/*
+    File: lwlte_tcp.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte multiplexed socket layer header file
+    - The module's URCs feed the receive ring of their socket directly from the core worker.
+    - A send task drains the send rings round-robin with AT+CIPSEND in quick send mode, so a socket only holds
+      the AT channel for one chunk and never while waiting for the network.
+*/
+#pragma once
+
+#include "lwlte_socket.h"
+#include "lwlte_core.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_sys_flags.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Event bits of the sockets, level triggered, see lwlte_tcp_get_events_internal */
+#define LWLTE_TCP_EVENT_RX(id) (1u << (id)) // data to read, or the connection is closed
+#define LWLTE_TCP_EVENT_TX(id) (1u << (8 + (id))) // room in the send ring of a connected socket
+#define LWLTE_TCP_EVENT_STATE(id) (1u << (16 + (id))) // the connect attempt ended, cleared by the next open
+
+typedef struct lwlte_tcp_s lwlte_tcp_t;
+
+/**
+ * Switch the module to quick send and the configured receive mode, route the socket URCs and start the send task.
+ */
+lwlte_err_t lwlte_tcp_create_internal(lwlte_core_t* core, const lwlte_socket_config_t* config, lwlte_tcp_t** tcp);
+
+lwlte_err_t lwlte_tcp_destroy_internal(lwlte_tcp_t* tcp);
+
+lwlte_err_t lwlte_tcp_open_internal(lwlte_tcp_t* tcp, lwlte_socket_type_t type, const char* host, uint16_t port,
+    lwlte_base_type_t timeout_ms, int* id);
+
+lwlte_err_t lwlte_tcp_send_internal(lwlte_tcp_t* tcp, int id, const void* data, size_t len, size_t* sent);
+
+lwlte_err_t lwlte_tcp_recv_internal(lwlte_tcp_t* tcp, int id, void* buf, size_t size, lwlte_base_type_t wait_ms,
+    size_t* received);
+
+lwlte_err_t lwlte_tcp_close_internal(lwlte_tcp_t* tcp, int id);
+
+lwlte_err_t lwlte_tcp_get_stats_internal(lwlte_tcp_t* tcp, int id, lwlte_socket_stats_t* stats);
+
+/**
+ * The flags holding the LWLTE_TCP_EVENT_* bits, to wait on the sockets.
+ */
+lwlte_sys_flags_t lwlte_tcp_get_events_internal(lwlte_tcp_t* tcp);
+
+/**
+ * Flags set with LWLTE_CORE_WATCHER_WAKE when the events change, NULL to stop. The socket layer has one watcher.
+ */
+void lwlte_tcp_set_watcher_internal(lwlte_tcp_t* tcp, lwlte_sys_flags_t watcher);
+
+#ifdef __cplusplus
+}
+#endif
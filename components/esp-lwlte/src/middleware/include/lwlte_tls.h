@@ -0,0 +1,30 @@
+/*
+    File: lwlte_tls.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte module-side TLS header file
+    - The certificates are uploaded once to the file system of the module and referenced by name
+      from an SSL context, the SSL connection of a client uses the context of its AT command.
+    - A "<name>.sha" file next to each certificate holds the SHA-256 of its content.
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_core.h"
+#include "lwlte_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Upload the certificates missing or different on the module and configure an SSL context with them.
+ * A file already on the module with the same size and digest is not uploaded again.
+ * @param ctx_id The SSL context the client's connection command uses
+ * @return LWLTE_INVALID_ARG if a certificate required by the verify mode is missing
+ */
+lwlte_err_t lwlte_tls_setup_internal(lwlte_core_t* core, const lwlte_tls_config_t* config, lwlte_base_type_t ctx_id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,35 @@
+/*
+    File: lwlte_watchdog.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte modem health watchdog header file
+*/
+#pragma once
+
+#include "lwlte.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_core.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle, one per supervised core instance */
+typedef void* lwlte_watchdog_t;
+
+/**
+ * Start supervising a core instance. The config is kept to re-init the instance at the last recovery stage.
+ */
+lwlte_err_t lwlte_watchdog_start(lwlte_core_t* core, const lwlte_config_t* config, lwlte_watchdog_t* watchdog);
+
+/**
+ * Stop the watchdog task and free it, must be called before the core instance is deinitialized.
+ */
+lwlte_err_t lwlte_watchdog_stop(lwlte_watchdog_t watchdog);
+
+lwlte_err_t lwlte_watchdog_get_stats(lwlte_watchdog_t watchdog, lwlte_watchdog_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
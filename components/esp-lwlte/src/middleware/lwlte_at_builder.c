@@ -0,0 +1,93 @@
+/*
+    File: lwlte_at_builder.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: Bounded AT command builder source file
+*/
+#include "lwlte_at_builder.h"
+#include "lwlte_err.h"
+#include <string.h>
+
+void lwlte_at_builder_init(lwlte_at_builder_t* b, char* buf, size_t size)
+{
+    b->buf = buf;
+    b->size = size;
+    b->len = 0;
+    b->overflow = (buf == NULL || size == 0);
+    if (!b->overflow) {
+        b->buf[0] = '\0';
+    }
+}
+
+void lwlte_at_builder_rewind(lwlte_at_builder_t* b, size_t len)
+{
+    if (b->buf == NULL || len > b->len) {
+        return;
+    }
+    b->len = len;
+    b->buf[len] = '\0';
+    b->overflow = false;
+}
+
+void lwlte_at_builder_raw(lwlte_at_builder_t* b, const char* data, size_t len)
+{
+    /* One byte stays for the terminator */
+    if (b->overflow || len >= b->size - b->len) {
+        b->overflow = true;
+        return;
+    }
+    memcpy(b->buf + b->len, data, len);
+    b->len += len;
+    b->buf[b->len] = '\0';
+}
+
+void lwlte_at_builder_str(lwlte_at_builder_t* b, const char* str)
+{
+    lwlte_at_builder_raw(b, str, strlen(str));
+}
+
+void lwlte_at_builder_char(lwlte_at_builder_t* b, char c)
+{
+    lwlte_at_builder_raw(b, &c, 1);
+}
+
+void lwlte_at_builder_int(lwlte_at_builder_t* b, int32_t value)
+{
+    char digits[LWLTE_AT_BUILDER_INT_MAX_DIGITS];
+    size_t pos = sizeof(digits);
+    /* Work on the magnitude as unsigned so that INT32_MIN does not overflow */
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    do {
+        digits[--pos] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[--pos] = '-';
+    }
+    lwlte_at_builder_raw(b, digits + pos, sizeof(digits) - pos);
+}
+
+void lwlte_at_builder_quoted(lwlte_at_builder_t* b, const char* str, size_t len)
+{
+    if (str == NULL || memchr(str, '"', len) != NULL || memchr(str, '\r', len) != NULL || 
+        memchr(str, '\n', len) != NULL) {
+        b->overflow = true;
+        return;
+    }
+    lwlte_at_builder_char(b, '"');
+    lwlte_at_builder_raw(b, str, len);
+    lwlte_at_builder_char(b, '"');
+}
+
+lwlte_err_t lwlte_at_builder_end(lwlte_at_builder_t* b)
+{
+    lwlte_at_builder_raw(b, "\r\n", 2);
+    return b->overflow ? LWLTE_INVALID_ARG : LWLTE_OK;
+}
+
+size_t lwlte_at_builder_size(const char* head, size_t text_len, size_t int_count, size_t quoted_count)
+{
+    /* The quotes, a ',' before every piece, the "\r\n" and the terminator */
+    return strlen(head) + text_len + int_count * LWLTE_AT_BUILDER_INT_MAX_DIGITS + quoted_count * 2 + 
+        int_count + quoted_count + 3;
+}
@@ -0,0 +1,282 @@
+/*
+    File: lwlte_at_parser.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: Zero-copy AT response tokenizer source file
+*/
+#include "lwlte_at_parser.h"
+#include "lwlte_err.h"
+#include <string.h>
+
+#define IS_SPACE(c) ((c) == ' ' || (c) == '\t')
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+
+/* Declarative table of the responses used by the library, indexed by lwlte_at_schema_id_t */
+static const lwlte_at_schema_t s_lwlte_at_schemas[LWLTE_AT_SCHEMA_MAX] = {
+    [LWLTE_AT_SCHEMA_CSQ] = { "+CSQ:", 2, { LWLTE_AT_FIELD_INT, LWLTE_AT_FIELD_INT } },
+    [LWLTE_AT_SCHEMA_CPIN] = { "+CPIN:", 1, { LWLTE_AT_FIELD_RAW } },
+    [LWLTE_AT_SCHEMA_CGATT] = { "+CGATT:", 1, { LWLTE_AT_FIELD_INT } },
+    [LWLTE_AT_SCHEMA_CIFSR] = { "", 1, { LWLTE_AT_FIELD_IP } },
+    [LWLTE_AT_SCHEMA_MQTTSTATU] = { "+MQTTSTATU :", 1, { LWLTE_AT_FIELD_INT } },
+    [LWLTE_AT_SCHEMA_CDNSGIP] = { "+CDNSGIP:", 3, { LWLTE_AT_FIELD_INT, LWLTE_AT_FIELD_STR, LWLTE_AT_FIELD_IP } },
+    [LWLTE_AT_SCHEMA_FSFLSIZE] = { "+FSFLSIZE:", 1, { LWLTE_AT_FIELD_INT } },
+    [LWLTE_AT_SCHEMA_CIPPING] = { "+CIPPING:", 4, { LWLTE_AT_FIELD_INT, LWLTE_AT_FIELD_IP, LWLTE_AT_FIELD_INT,
+        LWLTE_AT_FIELD_INT } },
+};
+
+static void skip_spaces(lwlte_at_tokenizer_t* tok)
+{
+    while (tok->cur < tok->end && IS_SPACE(*tok->cur)) {
+        tok->cur++;
+    }
+}
+
+/* Step over the separator after a field, fail on anything else */
+static lwlte_err_t finish_field(lwlte_at_tokenizer_t* tok)
+{
+    skip_spaces(tok);
+    if (tok->cur == tok->end) {
+        return LWLTE_OK;
+    }
+    if (*tok->cur == ',') {
+        tok->cur++;
+        skip_spaces(tok);
+        return LWLTE_OK;
+    }
+    return LWLTE_ERROR;
+}
+
+static lwlte_err_t parse_int(lwlte_at_tokenizer_t* tok, lwlte_at_field_t* field)
+{
+    const char* p = tok->cur;
+    bool negative = false;
+    int32_t value = 0;
+    if (p < tok->end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    const char* digits = p;
+    while (p < tok->end && IS_DIGIT(*p)) {
+        if (value > (INT32_MAX - 9) / 10) {
+            return LWLTE_ERROR;
+        }
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (p == digits) {
+        return LWLTE_ERROR;
+    }
+    field->s.ptr = tok->cur;
+    field->s.len = (size_t)(p - tok->cur);
+    field->v.i = negative ? -value : value;
+    tok->cur = p;
+    return LWLTE_OK;
+}
+
+static lwlte_err_t parse_str(lwlte_at_tokenizer_t* tok, lwlte_at_field_t* field)
+{
+    if (tok->cur == tok->end || *tok->cur != '"') {
+        return LWLTE_ERROR;
+    }
+    const char* start = tok->cur + 1;
+    const char* quote = memchr(start, '"', (size_t)(tok->end - start));
+    if (quote == NULL) {
+        return LWLTE_ERROR;
+    }
+    field->s.ptr = start;
+    field->s.len = (size_t)(quote - start);
+    tok->cur = quote + 1;
+    return LWLTE_OK;
+}
+
+static lwlte_err_t parse_ip(lwlte_at_tokenizer_t* tok, lwlte_at_field_t* field)
+{
+    const char* p = tok->cur;
+    bool quoted = (p < tok->end && *p == '"');
+    if (quoted) {
+        p++;
+    }
+    const char* start = p;
+    for (int octet = 0; octet < 4; octet++) {
+        if (octet > 0) {
+            if (p == tok->end || *p != '.') {
+                return LWLTE_ERROR;
+            }
+            p++;
+        }
+        int value = 0;
+        const char* digits = p;
+        while (p < tok->end && IS_DIGIT(*p) && p - digits < 3) {
+            value = value * 10 + (*p - '0');
+            p++;
+        }
+        if (p == digits || value > 255) {
+            return LWLTE_ERROR;
+        }
+        field->v.ip[octet] = (uint8_t)value;
+    }
+    field->s.ptr = start;
+    field->s.len = (size_t)(p - start);
+    if (quoted) {
+        if (p == tok->end || *p != '"') {
+            return LWLTE_ERROR;
+        }
+        p++;
+    }
+    tok->cur = p;
+    return LWLTE_OK;
+}
+
+static lwlte_err_t parse_raw(lwlte_at_tokenizer_t* tok, lwlte_at_field_t* field)
+{
+    const char* p = tok->cur;
+    while (p < tok->end && *p != ',') {
+        p++;
+    }
+    /* Trim the trailing spaces */
+    const char* last = p;
+    while (last > tok->cur && IS_SPACE(*(last - 1))) {
+        last--;
+    }
+    if (last == tok->cur) {
+        return LWLTE_ERROR;
+    }
+    field->s.ptr = tok->cur;
+    field->s.len = (size_t)(last - tok->cur);
+    tok->cur = p;
+    return LWLTE_OK;
+}
+
+bool lwlte_at_tokenizer_init(lwlte_at_tokenizer_t* tok, const char* line, size_t len, const char* prefix)
+{
+    if (tok == NULL || line == NULL) {
+        return false;
+    }
+    tok->cur = line;
+    tok->end = line + len;
+    /* Ignore the line ending */
+    while (tok->end > tok->cur && (*(tok->end - 1) == '\n' || *(tok->end - 1) == '\r')) {
+        tok->end--;
+    }
+    skip_spaces(tok);
+    if (prefix != NULL) {
+        size_t prefix_len = strlen(prefix);
+        if ((size_t)(tok->end - tok->cur) < prefix_len || memcmp(tok->cur, prefix, prefix_len) != 0) {
+            return false;
+        }
+        tok->cur += prefix_len;
+        skip_spaces(tok);
+    }
+    return true;
+}
+
+lwlte_err_t lwlte_at_next_field(lwlte_at_tokenizer_t* tok, lwlte_at_field_type_t type, lwlte_at_field_t* field)
+{
+    if (tok == NULL || field == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_err_t err = LWLTE_ERROR;
+    field->type = type;
+    switch (type)
+    {
+        case LWLTE_AT_FIELD_INT:
+            err = parse_int(tok, field);
+            break;
+        case LWLTE_AT_FIELD_STR:
+            err = parse_str(tok, field);
+            break;
+        case LWLTE_AT_FIELD_IP:
+            err = parse_ip(tok, field);
+            break;
+        case LWLTE_AT_FIELD_RAW:
+            err = parse_raw(tok, field);
+            break;
+        default:
+            return LWLTE_INVALID_ARG;
+    }
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    return finish_field(tok);
+}
+
+lwlte_err_t lwlte_at_next_int(lwlte_at_tokenizer_t* tok, int32_t* value)
+{
+    lwlte_at_field_t field;
+    lwlte_err_t err = lwlte_at_next_field(tok, LWLTE_AT_FIELD_INT, &field);
+    if (err == LWLTE_OK && value != NULL) {
+        *value = field.v.i;
+    }
+    return err;
+}
+
+lwlte_err_t lwlte_at_next_str(lwlte_at_tokenizer_t* tok, lwlte_at_slice_t* value)
+{
+    lwlte_at_field_t field;
+    lwlte_err_t err = lwlte_at_next_field(tok, LWLTE_AT_FIELD_STR, &field);
+    if (err == LWLTE_OK && value != NULL) {
+        *value = field.s;
+    }
+    return err;
+}
+
+bool lwlte_at_tokenizer_done(const lwlte_at_tokenizer_t* tok)
+{
+    return tok == NULL || tok->cur >= tok->end;
+}
+
+bool lwlte_at_slice_eq(const lwlte_at_slice_t* s, const char* str)
+{
+    if (s == NULL || str == NULL) {
+        return false;
+    }
+    size_t len = strlen(str);
+    return s->len == len && memcmp(s->ptr, str, len) == 0;
+}
+
+const lwlte_at_schema_t* lwlte_at_schema_get(lwlte_at_schema_id_t id)
+{
+    if (id < 0 || id >= LWLTE_AT_SCHEMA_MAX) {
+        return NULL;
+    }
+    return &s_lwlte_at_schemas[id];
+}
+
+lwlte_err_t lwlte_at_parse_line(lwlte_at_schema_id_t id, const char* line, size_t len,
+    lwlte_at_field_t* fields, size_t field_count)
+{
+    const lwlte_at_schema_t* schema = lwlte_at_schema_get(id);
+    if (schema == NULL || line == NULL || fields == NULL || field_count < schema->field_count) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_at_tokenizer_t tok;
+    if (!lwlte_at_tokenizer_init(&tok, line, len, schema->prefix)) {
+        return LWLTE_ERROR;
+    }
+    for (uint8_t i = 0; i < schema->field_count; i++) {
+        if (lwlte_at_next_field(&tok, schema->fields[i], &fields[i]) != LWLTE_OK) {
+            return LWLTE_ERROR;
+        }
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_at_parse_response(lwlte_at_schema_id_t id, const char* response, size_t len,
+    lwlte_at_field_t* fields, size_t field_count)
+{
+    if (response == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    const char* p = response;
+    const char* end = response + len;
+    while (p < end) {
+        const char* nl = memchr(p, '\n', (size_t)(end - p));
+        const char* line_end = (nl == NULL) ? end : nl + 1;
+        lwlte_err_t err = lwlte_at_parse_line(id, p, (size_t)(line_end - p), fields, field_count);
+        if (err != LWLTE_ERROR) {
+            return err;
+        }
+        p = line_end;
+    }
+    return LWLTE_ERROR;
+}
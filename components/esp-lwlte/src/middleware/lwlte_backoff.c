@@ -0,0 +1,21 @@
+/*
+    File: lwlte_backoff.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte retry backoff source file
+*/
+#include "lwlte_backoff.h"
+#include "lwlte_sys_thread.h"
+
+uint32_t lwlte_backoff_ms(uint32_t base_ms, uint32_t max_ms, uint32_t attempt)
+{
+    uint32_t delay = base_ms;
+    /* Stop doubling at the cap, before the delay could overflow */
+    for (uint32_t i = 1; i < attempt && delay < max_ms && delay <= UINT32_MAX / 2; i++) {
+        delay *= 2;
+    }
+    if (delay > max_ms) {
+        delay = max_ms;
+    }
+    return delay / 2 + lwlte_sys_random() % (delay / 2 + 1);
+}
@@ -0,0 +1,348 @@
+/*
+    File: lwlte_cmux.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: 3GPP TS 27.010 basic mode multiplexer source file
+*/
+#include "lwlte_cmux.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+#define CMUX_FLAG 0xF9
+#define CMUX_EA 0x01
+#define CMUX_CR 0x02
+#define CMUX_PF 0x10
+
+/* Frame types, P/F bit cleared */
+#define CMUX_SABM 0x2F
+#define CMUX_UA 0x63
+#define CMUX_DM 0x0F
+#define CMUX_DISC 0x43
+#define CMUX_UIH 0xEF
+
+/* Multiplexer control messages on DLCI 0, C/R and EA bits cleared */
+#define CMUX_MSG_CLD 0xC1
+#define CMUX_MSG_MSC 0xE1
+
+/* A received FCS is good if the CRC over the checked bytes and the FCS gives this value */
+#define CMUX_FCS_GOOD 0xCF
+
+/* Flag, address, control, 2 length bytes, FCS and flag around the information field */
+#define CMUX_FRAME_OVERHEAD 7
+
+/* Per-DLCI flags bits */
+#define CMUX_FLAGS_UA(dlci) (1u << (dlci))
+#define CMUX_FLAGS_DM(dlci) (1u << ((dlci) + 8))
+
+typedef enum {
+    CMUX_STATE_FLAG = 0,
+    CMUX_STATE_ADDRESS,
+    CMUX_STATE_CONTROL,
+    CMUX_STATE_LENGTH,
+    CMUX_STATE_LENGTH2,
+    CMUX_STATE_DATA,
+    CMUX_STATE_FCS,
+    CMUX_STATE_END,
+} cmux_state_t;
+
+typedef struct {
+    size_t frame_size;
+    lwlte_cmux_write_fn_t write;
+    lwlte_cmux_rx_fn_t rx;
+    void* ctx;
+    lwlte_sys_mutex_t tx_lock; // one frame on the UART at a time
+    uint8_t* tx_frame; // encode buffer, under tx_lock
+    lwlte_sys_flags_t flags; // UA / DM received per DLCI
+    struct {
+        cmux_state_t state;
+        uint8_t address;
+        uint8_t control;
+        uint8_t crc; // running CRC over address, control and length
+        size_t length;
+        size_t received;
+        uint8_t* info;
+    } rx_frame;
+} lwlte_cmux_ctx_t;
+
+static const char* TAG = "lwlte_cmux";
+
+/* CRC-8 of TS 27.010 (reversed polynomial 0xE0), initial value 0xFF */
+static uint8_t cmux_crc_update(uint8_t crc, uint8_t byte)
+{
+    crc ^= byte;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x01) ? (uint8_t)((crc >> 1) ^ 0xE0) : (uint8_t)(crc >> 1);
+    }
+    return crc;
+}
+
+/* Encode and write one frame, the tx_lock must be held by the caller */
+static lwlte_err_t cmux_send_frame_locked(lwlte_cmux_ctx_t* c, uint8_t dlci, uint8_t control,
+    const uint8_t* info, size_t size)
+{
+    uint8_t* p = c->tx_frame;
+    uint8_t crc = 0xFF;
+    *p++ = CMUX_FLAG;
+    /* We are the initiator, our commands and UIH frames carry C/R = 1 */
+    *p = (uint8_t)((dlci << 2) | CMUX_CR | CMUX_EA);
+    crc = cmux_crc_update(crc, *p++);
+    *p = control;
+    crc = cmux_crc_update(crc, *p++);
+    if (size < 128) {
+        *p = (uint8_t)((size << 1) | CMUX_EA);
+        crc = cmux_crc_update(crc, *p++);
+    }
+    else {
+        *p = (uint8_t)((size & 0x7F) << 1);
+        crc = cmux_crc_update(crc, *p++);
+        *p = (uint8_t)(size >> 7);
+        crc = cmux_crc_update(crc, *p++);
+    }
+    /* The FCS of basic mode covers the header only */
+    if (size > 0) {
+        memcpy(p, info, size);
+        p += size;
+    }
+    *p++ = (uint8_t)(0xFF - crc);
+    *p++ = CMUX_FLAG;
+    return c->write((const char*)c->tx_frame, (size_t)(p - c->tx_frame), c->ctx);
+}
+
+static lwlte_err_t cmux_send_frame(lwlte_cmux_ctx_t* c, uint8_t dlci, uint8_t control,
+    const uint8_t* info, size_t size)
+{
+    lwlte_sys_mutex_lock(c->tx_lock);
+    lwlte_err_t err = cmux_send_frame_locked(c, dlci, control, info, size);
+    lwlte_sys_mutex_unlock(c->tx_lock);
+    return err;
+}
+
+lwlte_cmux_t lwlte_cmux_create(size_t frame_size, lwlte_cmux_write_fn_t write, lwlte_cmux_rx_fn_t rx, void* ctx)
+{
+    if (write == NULL || rx == NULL || frame_size == 0 || frame_size > 32767) {
+        return NULL;
+    }
+    lwlte_cmux_ctx_t* c = lwlte_sys_mem_malloc(sizeof(lwlte_cmux_ctx_t));
+    if (c == NULL) {
+        return NULL;
+    }
+    memset(c, 0, sizeof(lwlte_cmux_ctx_t));
+    c->frame_size = frame_size;
+    c->write = write;
+    c->rx = rx;
+    c->ctx = ctx;
+    c->tx_lock = lwlte_sys_mutex_create();
+    c->flags = lwlte_sys_flags_create();
+    c->tx_frame = lwlte_sys_mem_malloc(frame_size + CMUX_FRAME_OVERHEAD);
+    c->rx_frame.info = lwlte_sys_mem_malloc(frame_size);
+    if (c->tx_lock == NULL || c->flags == NULL || c->tx_frame == NULL || c->rx_frame.info == NULL) {
+        lwlte_cmux_delete(c);
+        return NULL;
+    }
+    return c;
+}
+
+void lwlte_cmux_delete(lwlte_cmux_t cmux)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL) {
+        return;
+    }
+    lwlte_sys_mutex_delete(c->tx_lock);
+    lwlte_sys_flags_delete(c->flags);
+    lwlte_sys_mem_free(c->tx_frame);
+    lwlte_sys_mem_free(c->rx_frame.info);
+    lwlte_sys_mem_free(c);
+}
+
+lwlte_err_t lwlte_cmux_open_channel(lwlte_cmux_t cmux, uint8_t dlci, uint32_t timeout_ms)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL || dlci > LWLTE_CMUX_MAX_DLCI) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_flags_clear(c->flags, CMUX_FLAGS_UA(dlci) | CMUX_FLAGS_DM(dlci));
+    lwlte_err_t err = cmux_send_frame(c, dlci, CMUX_SABM | CMUX_PF, NULL, 0);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    lwlte_sys_flagbits_t bits = lwlte_sys_flags_wait(c->flags,
+        CMUX_FLAGS_UA(dlci) | CMUX_FLAGS_DM(dlci), false,
+        true, timeout_ms);
+    if (bits & CMUX_FLAGS_UA(dlci)) {
+        LWLTE_LOGI(TAG, "DLCI %d opened.", dlci);
+        return LWLTE_OK;
+    }
+    if (bits & CMUX_FLAGS_DM(dlci)) {
+        LWLTE_LOGE(TAG, "DLCI %d rejected by the module.", dlci);
+        return LWLTE_ERROR;
+    }
+    return LWLTE_TIMEOUT;
+}
+
+lwlte_err_t lwlte_cmux_close(lwlte_cmux_t cmux)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    const uint8_t cld[] = { CMUX_MSG_CLD | CMUX_CR | CMUX_EA, CMUX_EA };
+    return cmux_send_frame(c, LWLTE_CMUX_DLCI_CONTROL, CMUX_UIH, cld, sizeof(cld));
+}
+
+lwlte_err_t lwlte_cmux_write(lwlte_cmux_t cmux, uint8_t dlci, const uint8_t* data, size_t size)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL || dlci > LWLTE_CMUX_MAX_DLCI || (data == NULL && size > 0)) {
+        return LWLTE_INVALID_ARG;
+    }
+    while (size > 0) {
+        size_t chunk = size < c->frame_size ? size : c->frame_size;
+        /* Lock per frame, the frames of the other channels go out in between */
+        lwlte_err_t err = cmux_send_frame(c, dlci, CMUX_UIH, data, chunk);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        data += chunk;
+        size -= chunk;
+    }
+    return LWLTE_OK;
+}
+
+/* Answer the control messages of the module that require it */
+static void cmux_handle_control(lwlte_cmux_ctx_t* c, const uint8_t* info, size_t size)
+{
+    if (size < 2) {
+        return;
+    }
+    uint8_t type = info[0] & ~(CMUX_CR | CMUX_EA);
+    bool command = (info[0] & CMUX_CR) != 0;
+    if (type == CMUX_MSG_MSC && command) {
+        /* Acknowledge the modem status command by echoing it as a response */
+        uint8_t response[8];
+        size_t response_size = size < sizeof(response) ? size : sizeof(response);
+        memcpy(response, info, response_size);
+        response[0] &= ~CMUX_CR;
+        cmux_send_frame(c, LWLTE_CMUX_DLCI_CONTROL, CMUX_UIH, response, response_size);
+    }
+    else if (type == CMUX_MSG_CLD) {
+        LWLTE_LOGI(TAG, "Multiplexer closed by the module.");
+    }
+}
+
+static void cmux_dispatch_frame(lwlte_cmux_ctx_t* c)
+{
+    uint8_t dlci = c->rx_frame.address >> 2;
+    uint8_t type = c->rx_frame.control & ~CMUX_PF;
+    if (dlci > LWLTE_CMUX_MAX_DLCI) {
+        return;
+    }
+    switch (type)
+    {
+        case CMUX_UA:
+            lwlte_sys_flags_set(c->flags, CMUX_FLAGS_UA(dlci));
+            break;
+        case CMUX_DM:
+            lwlte_sys_flags_set(c->flags, CMUX_FLAGS_DM(dlci));
+            break;
+        case CMUX_UIH:
+            if (dlci == LWLTE_CMUX_DLCI_CONTROL) {
+                cmux_handle_control(c, c->rx_frame.info, c->rx_frame.length);
+            }
+            else if (c->rx_frame.length > 0) {
+                c->rx(dlci, c->rx_frame.info, c->rx_frame.length, c->ctx);
+            }
+            break;
+        default:
+            LWLTE_LOGW(TAG, "Unhandled frame 0x%02x on DLCI %d.", c->rx_frame.control, dlci);
+            break;
+    }
+}
+
+void lwlte_cmux_input(lwlte_cmux_t cmux, const uint8_t* data, size_t size)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL || data == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        uint8_t b = data[i];
+        switch (c->rx_frame.state)
+        {
+            case CMUX_STATE_FLAG:
+                if (b == CMUX_FLAG) {
+                    c->rx_frame.state = CMUX_STATE_ADDRESS;
+                }
+                break;
+            case CMUX_STATE_ADDRESS:
+                /* Consecutive flags close one frame and open the next */
+                if (b == CMUX_FLAG) {
+                    break;
+                }
+                c->rx_frame.address = b;
+                c->rx_frame.crc = cmux_crc_update(0xFF, b);
+                c->rx_frame.state = CMUX_STATE_CONTROL;
+                break;
+            case CMUX_STATE_CONTROL:
+                c->rx_frame.control = b;
+                c->rx_frame.crc = cmux_crc_update(c->rx_frame.crc, b);
+                c->rx_frame.state = CMUX_STATE_LENGTH;
+                break;
+            case CMUX_STATE_LENGTH:
+                c->rx_frame.crc = cmux_crc_update(c->rx_frame.crc, b);
+                c->rx_frame.length = b >> 1;
+                c->rx_frame.received = 0;
+                if (!(b & CMUX_EA)) {
+                    c->rx_frame.state = CMUX_STATE_LENGTH2;
+                }
+                else {
+                    c->rx_frame.state = c->rx_frame.length > 0 ? CMUX_STATE_DATA : CMUX_STATE_FCS;
+                }
+                break;
+            case CMUX_STATE_LENGTH2:
+                c->rx_frame.crc = cmux_crc_update(c->rx_frame.crc, b);
+                c->rx_frame.length |= (size_t)b << 7;
+                c->rx_frame.state = c->rx_frame.length > 0 ? CMUX_STATE_DATA : CMUX_STATE_FCS;
+                break;
+            case CMUX_STATE_DATA:
+                if (c->rx_frame.length > c->frame_size) {
+                    /* Larger than negotiated, resynchronize on the next flag */
+                    LWLTE_LOGW(TAG, "Frame of %d bytes dropped.", (int)c->rx_frame.length);
+                    c->rx_frame.state = CMUX_STATE_FLAG;
+                    break;
+                }
+                c->rx_frame.info[c->rx_frame.received++] = b;
+                if (c->rx_frame.received == c->rx_frame.length) {
+                    c->rx_frame.state = CMUX_STATE_FCS;
+                }
+                break;
+            case CMUX_STATE_FCS:
+                c->rx_frame.crc = cmux_crc_update(c->rx_frame.crc, b);
+                c->rx_frame.state = CMUX_STATE_END;
+                break;
+            case CMUX_STATE_END:
+                if (b == CMUX_FLAG && c->rx_frame.crc == CMUX_FCS_GOOD) {
+                    cmux_dispatch_frame(c);
+                }
+                else {
+                    LWLTE_LOGW(TAG, "Bad frame on DLCI %d dropped.", c->rx_frame.address >> 2);
+                }
+                /* The closing flag may also open the next frame */
+                c->rx_frame.state = (b == CMUX_FLAG) ? CMUX_STATE_ADDRESS : CMUX_STATE_FLAG;
+                break;
+        }
+    }
+}
+
+void lwlte_cmux_reset(lwlte_cmux_t cmux)
+{
+    lwlte_cmux_ctx_t* c = (lwlte_cmux_ctx_t*)cmux;
+    if (c == NULL) {
+        return;
+    }
+    c->rx_frame.state = CMUX_STATE_FLAG;
+    c->rx_frame.received = 0;
+}
@@ -15,23 +15,92 @@
 #include "lwlte_sys_thread.h"
 #include "lwlte_sys_log.h"
 #include "lwlte_sys_mem.h"
+#include "lwlte_sys_timer.h"
+#include "lwlte_at_parser.h"
+#include "lwlte_cmux.h"
+#include "lwlte_ppp.h"
+#include <stdio.h>
 #include "string.h"
 #include <stdbool.h>
 #include <string.h>
 
 #define ADD_TO_LINE(line, line_length, c) { line[line_length] = c; line_length++; line[line_length] = '\0'; }
 #define RESET_LINE(line, line_length) { line_length = 0; line[0] = '\0'; }
-#define GET_CSQ(response, data_pointer, csq) { data_pointer = strstr(response, "+CSQ: ") + 6; csq = *(data_pointer + 1) == ','?(*data_pointer - '0') : (*data_pointer - '0')*10 + (*(data_pointer+1) - '0'); }
+
+/* Splits the input into lines, a partial line is kept until the rest of it arrives */
+typedef struct {
+    char *line;
+    int line_length;
+    int line_size;
+    int raw_needed; // bytes of a URC still to collect as they are, the line is kept until they arrived
+    int skip_needed; // bytes of a URC too large for the line buffer, discarded without being framed
+    /* Receives each complete line, returns the bytes still missing from a URC that runs over the line end */
+    int (*on_line)(lwlte_core_t* core, const char* line, int line_length);
+} lwlte_core_framer_t;
+
+/* Channel of a queued input item, the first byte of the item */
+typedef enum {
+    LWLTE_CORE_CHANNEL_AT = 0, // AT responses, and everything when the multiplexer is not active
+    LWLTE_CORE_CHANNEL_URC, // URC channel of the multiplexer
+} lwlte_core_channel_t;
+
+/* Task defaults, used for the fields left zero in lwlte_task_config_t */
+#define LWLTE_CORE_RX_TASK_STACK_SIZE 4096
+#define LWLTE_CORE_RX_TASK_PRIORITY (tskIDLE_PRIORITY + 10)
+#define LWLTE_CORE_WORKER_TASK_STACK_SIZE 4096
+#define LWLTE_CORE_WORKER_TASK_PRIORITY (tskIDLE_PRIORITY + 10)
+#define LWLTE_CORE_ACTIVATE_TASK_STACK_SIZE 4096
+#define LWLTE_CORE_ACTIVATE_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+
+/* Deinit and restart wait this long for the tasks to stop */
+#define LWLTE_CORE_STOP_TIMEOUT_MS 5000
+#define LWLTE_CORE_STOP_POLL_MS 10
+
+/* EN is held low this long to power-cycle the module */
+#define LWLTE_CORE_POWER_OFF_MS 1000
+/* An already powered module must answer one of these probes */
+#define LWLTE_CORE_PROBE_RETRIES 3
+#define LWLTE_CORE_PROBE_WAIT_MS 300
+/* Time for the module to accept a multiplexer channel */
+#define LWLTE_CORE_CMUX_OPEN_TIMEOUT_MS 1000
+/* Silence required before and after the "+++" escape */
+#define LWLTE_CORE_ESCAPE_GUARD_MS 1000
+/* The AT round-trip average follows a new sample with this weight (1/n) */
+#define LWLTE_CORE_LATENCY_EWMA_WEIGHT 8
+/* Input queue item: the channel byte, the text length (2 bytes, little-endian), then the text */
+#define LWLTE_CORE_ITEM_HEADER 3
+/* Doorbells the shared worker can hold, the RX tasks block when it is full */
+#define LWLTE_CORE_DOORBELL_QUEUE_DEPTH 32
 
 static const char* TAG = "lwlte_core";
 
-static struct {
+/* The flags, the locks and the semaphores live from lwlte_core_create_internal to lwlte_core_destroy_internal,
+   so that the tasks blocked on them survive an in-place re-init by the watchdog */
+struct lwlte_core_s {
     lwlte_config_t config; // config of lwlte_core
+    bool started; // init_internal ran and deinit_internal has not completed
+    bool leaked; // a task of an earlier run did not stop and may still use the instance, it is never freed
     lwlte_sys_flags_t flags;
+    lwlte_ll_uart_t uart;
     lwlte_sys_queue_t core_input_queue;
     lwlte_sys_thread_t network_activate_thread_handle;
-    lwlte_sys_thread_t core_worker_thread_handle;
-    char* core_input_buf;
+    char* core_input_buf; // split task mode: the item being processed, used by the shared worker only
+    lwlte_sys_semaphore_t worker_fence; // given by the shared worker once it is done with this instance
+    bool worker_acquired; // this instance counts as a user of the shared worker
+    char* core_input_item; // split task mode: the item being queued, used by the UART RX task only
+    lwlte_core_framer_t framer;
+    lwlte_core_framer_t urc_framer; // lines of the multiplexer URC channel
+    lwlte_cmux_t cmux; // created when the module is switched to the multiplexer mode
+    lwlte_core_data_sink_t data_sink;
+    void *data_sink_ctx;
+    struct dial_t {
+        lwlte_core_framer_t framer; // lines of the multiplexer data channel while dialing
+        lwlte_sys_semaphore_t done;
+        volatile bool dialing;
+        volatile bool connected;
+    } dial;
+    lwlte_sys_timer_t power_timer; // releases EN at the end of a power cycle
+    bool probe_pending; // the bring-up probes the module before power-cycling it
     struct at_waiter_t {
         char *at_wait_string;
         char *at_error_string;
@@ -40,216 +109,951 @@ static struct {
         lwlte_sys_mutex_t lock;
         bool response_ok;
         bool response_error;
+        lwlte_core_line_sink_t sink; // streaming mode if not NULL, lines bypass at_response
+        void *sink_ctx;
+        lwlte_sys_mutex_t sink_lock; // held by the worker while the sink runs
+        volatile bool prompt_pending; // a command waits for the '>' prompt, the framer completes the line on it
     } at_waiter;
     lwlte_tick_t init_start_time_ms;
+    lwlte_core_health_t health; // liveness signals for the watchdog and the link scheduler
+    lwlte_sys_mutex_t health_lock; // guards health.pending_cmds, updated by several caller tasks
+    lwlte_ppp_t ppp; // PPP link, ppp_enable only
+    void* watchdog; // owned by the API layer, kept across an in-place re-init
+    volatile lwlte_sys_flags_t watcher; // woken on the link state changes, see lwlte_core_set_watcher_internal
+    struct urc_handler_t {
+        const char* prefix; // NULL: free entry
+        lwlte_core_urc_handler_t handler;
+        void* ctx;
+    } urc_handlers[LWLTE_CORE_MAX_URC_HANDLERS]; // kept across an in-place re-init
+    lwlte_sys_mutex_t urc_lock; // held by the worker while a URC handler runs
+};
 
-} s_lwlte_core_context;
+/* Wake the poller of the instance after a change of the link state */
+static void lwlte_core_notify_watcher(lwlte_core_t* core)
+{
+    lwlte_sys_flags_t watcher = core->watcher;
+    if (watcher != NULL) {
+        lwlte_sys_flags_set(watcher, LWLTE_CORE_WATCHER_WAKE);
+    }
+}
 
-lwlte_err_t lwlte_core_send_at_cmd_internal(const char* cmd, 
+/* Doorbell of the shared worker: an instance queued an input item */
+typedef struct {
+    lwlte_core_t* core; // NULL stops the worker
+    bool fence; // no item, the worker gives the instance's worker_fence semaphore
+} lwlte_core_doorbell_t;
+
+/* One worker task serves the instances in split task mode. Every instance keeps its own input queue
+   and rings the doorbell after queuing an item, so the items of an instance are processed in order */
+static struct {
+    lwlte_sys_queue_t doorbell_queue;
+    lwlte_sys_semaphore_t exited;
+    lwlte_base_type_t users; // instances using the worker, it is created by the first one and stopped with the last one
+    bool stop_queued; // the last release queued the stop but the worker did not exit in time
+} s_lwlte_core_worker; // guarded by lwlte_sys_global_lock
+
+/* Write to the AT channel, which is the UART itself unless the multiplexer is active */
+static lwlte_err_t lwlte_core_at_write(lwlte_core_t* core, const char* data, size_t size)
+{
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        return lwlte_cmux_write(core->cmux, LWLTE_CMUX_DLCI_AT, (const uint8_t*)data, size);
+    }
+    return lwlte_ll_uart_write(core->uart, data, size);
+}
+
+/* Arm the waiter, write the data to the AT channel and wait for the response, the at_waiter lock must be held by the caller */
+static lwlte_err_t lwlte_core_at_exchange_locked(lwlte_core_t* core, const lwlte_core_iovec_t* iov, size_t iov_count, 
     const char* wait_str, 
     const char* error_str, 
-    lwlte_base_type_t wait_time_ms, 
-    char* response_buf, 
-    lwlte_base_type_t response_buf_size)
+    lwlte_base_type_t wait_time_ms)
+{
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_AT_CMD_IS_SENDING);
+    core->at_waiter.response_ok = false;
+    core->at_waiter.response_error = false;
+    /* Drain a stale signal left by a previously timed-out command */
+    lwlte_sys_semaphore_wait(core->at_waiter.done, 0);
+    /* Reset the at_response */
+    core->at_waiter.at_response[0] = '\0';
+    strcpy(core->at_waiter.at_error_string, error_str);
+    strcpy(core->at_waiter.at_wait_string, wait_str);
+    /* Send the data, a write error is left to the timeout like a lost command */
+    for (size_t i = 0; i < iov_count; i++) {
+        if (iov[i].len > 0) {
+            lwlte_core_at_write(core, (const char*)iov[i].base, iov[i].len);
+        }
+    }
+    lwlte_tick_t sent_ms = lwlte_sys_time_get_ms();
+    /* Wait for the response, in streaming mode too the wait time bounds the whole command */
+    lwlte_sys_semaphore_wait(core->at_waiter.done, wait_time_ms);
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_AT_CMD_IS_SENDING);
+    /* Round-trip time of the answered commands, a streamed command lasts as long as its data and is not counted */
+    if ((core->at_waiter.response_ok || core->at_waiter.response_error) && core->at_waiter.sink == NULL) {
+        lwlte_base_type_t sample_ms = lwlte_sys_time_get_ms() - sent_ms;
+        core->health.at_latency_ms = (core->health.at_latency_ms == 0) ? sample_ms : 
+            (core->health.at_latency_ms * (LWLTE_CORE_LATENCY_EWMA_WEIGHT - 1) + sample_ms) / LWLTE_CORE_LATENCY_EWMA_WEIGHT;
+    }
+    if (core->at_waiter.response_ok) {
+        core->health.consecutive_timeouts = 0;
+        return LWLTE_OK;
+    }
+    else if (core->at_waiter.response_error) {
+        core->health.consecutive_timeouts = 0;
+        return LWLTE_ERROR;
+    }
+    core->health.consecutive_timeouts++;
+    return LWLTE_TIMEOUT;
+}
+
+/* Send the AT command and wait for the response, the at_waiter lock must be held by the caller */
+static lwlte_err_t lwlte_core_send_at_cmd_locked(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms)
+{
+    /* Log the command without the line ending */
+    int cmd_length = strcspn(cmd, "\r\n");
+    LWLTE_LOGI(TAG, "TX:|%.*s", cmd_length, cmd);
+    lwlte_core_iovec_t iov = { .base = cmd, .len = strlen(cmd) };
+    return lwlte_core_at_exchange_locked(core, &iov, 1, wait_str, error_str, wait_time_ms);
+}
+
+static void lwlte_core_at_unlock(lwlte_core_t* core)
+{
+    lwlte_sys_mutex_unlock(core->at_waiter.lock);
+    lwlte_sys_mutex_lock(core->health_lock);
+    core->health.pending_cmds--;
+    lwlte_sys_mutex_unlock(core->health_lock);
+}
+
+/**
+ * Take the at_waiter lock on behalf of a caller, counting the callers queued on it.
+ * A deinit or a re-init may have run while the caller was queued, the state is checked again under the lock
+ */
+static lwlte_err_t lwlte_core_at_lock(lwlte_core_t* core)
+{
+    lwlte_sys_mutex_lock(core->health_lock);
+    core->health.pending_cmds++;
+    lwlte_sys_mutex_unlock(core->health_lock);
+    lwlte_sys_mutex_lock(core->at_waiter.lock);
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+        lwlte_core_at_unlock(core);
+        return LWLTE_NOT_INITIALIZED;
+    }
+    return LWLTE_OK;
+}
+
+static lwlte_err_t lwlte_core_check_at_cmd_args(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms)
 {
     /* Check if the module is initialized */
-    if (s_lwlte_core_context.flags == NULL || s_lwlte_core_context.core_input_queue == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return LWLTE_NOT_INITIALIZED;
     }
     /* Check if the core is initialized */
-    if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
         return LWLTE_NOT_INITIALIZED;
     }
+    /* Without the multiplexer the AT channel is busy while the UART carries PPP */
+    if (lwlte_sys_flags_get(core->flags) & LWLTE_FLAGS_DATA_MODE && 
+        !lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        return LWLTE_NOT_SUPPORTED;
+    }
     /* Check if the arguments are valid */
-    if (cmd == NULL || wait_str == NULL || error_str == NULL || (response_buf_size < 0)) {
+    if (cmd == NULL || wait_str == NULL || error_str == NULL) {
         return LWLTE_INVALID_ARG;
     }
     /* Check if the wait_time_ticks is valid */
     if (wait_time_ms <= 0) {
         return LWLTE_INVALID_ARG;
     }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_send_at_cmd_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    char* response_buf, 
+    lwlte_base_type_t response_buf_size)
+{
+    lwlte_err_t err = lwlte_core_check_at_cmd_args(core, cmd, wait_str, error_str, wait_time_ms);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    if (response_buf_size < 0) {
+        return LWLTE_INVALID_ARG;
+    }
     /* Lock the at_waiter */
-    lwlte_sys_mutex_lock(s_lwlte_core_context.at_waiter.lock);
-    lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_AT_CMD_IS_SENDING);
-    s_lwlte_core_context.at_waiter.response_ok = false;
-    s_lwlte_core_context.at_waiter.response_error = false;
-    /* Reset the at_response */
-    s_lwlte_core_context.at_waiter.at_response[0] = '\0';
-    strcpy(s_lwlte_core_context.at_waiter.at_error_string, error_str);
-    strcpy(s_lwlte_core_context.at_waiter.at_wait_string, wait_str);
-    /* Send the AT command */
-    lwlte_ll_uart_write(cmd, strlen(cmd));
-    /* Find \n\r and replace \n with \0 , then log the command*/
-    char *cmd_copy = lwlte_sys_mem_malloc(strlen(cmd) + 1);
-    strcpy(cmd_copy, cmd);
-    char *pos = strchr(cmd_copy, '\n');
-    if (pos != NULL) {
-        *pos = '\0';
-    }
-    LWLTE_LOGI(TAG, "TX:|%s", cmd_copy);
-    free((void*)cmd_copy);
-    /* Wait for the response */
-    lwlte_sys_semaphore_wait(s_lwlte_core_context.at_waiter.done, wait_time_ms);
+    err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    err = lwlte_core_send_at_cmd_locked(core, cmd, wait_str, error_str, wait_time_ms);
     /* If the response_buf is not NULL, copy the response to the response_buf */
-    if (response_buf != NULL) {
-        strncpy(response_buf, s_lwlte_core_context.at_waiter.at_response, 
-            response_buf_size > strlen(s_lwlte_core_context.at_waiter.at_response) ? strlen(s_lwlte_core_context.at_waiter.at_response) : response_buf_size);
+    if (response_buf != NULL && response_buf_size > 0) {
+        strncpy(response_buf, core->at_waiter.at_response, response_buf_size - 1);
+        response_buf[response_buf_size - 1] = '\0';
     }
     /* Unlock the at_waiter */
-    lwlte_sys_flags_clear(s_lwlte_core_context.flags, LWLTE_FLAGS_AT_CMD_IS_SENDING);
-    lwlte_sys_mutex_unlock(s_lwlte_core_context.at_waiter.lock);
-    if (s_lwlte_core_context.at_waiter.response_ok) {
-        return LWLTE_OK;
+    lwlte_core_at_unlock(core);
+    return err;
+}
+
+lwlte_err_t lwlte_core_send_at_cmd_parse_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    lwlte_at_schema_id_t schema_id, 
+    lwlte_at_field_t* fields, 
+    size_t field_count)
+{
+    lwlte_err_t err = lwlte_core_check_at_cmd_args(core, cmd, wait_str, error_str, wait_time_ms);
+    if (err != LWLTE_OK) {
+        return err;
     }
-    else if (s_lwlte_core_context.at_waiter.response_error) {
-        return LWLTE_ERROR;
+    if (fields == NULL) {
+        return LWLTE_INVALID_ARG;
     }
-    return LWLTE_TIMEOUT;
+    /* Lock the at_waiter */
+    err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    err = lwlte_core_send_at_cmd_locked(core, cmd, wait_str, error_str, wait_time_ms);
+    /* Parse the response in place, the worker does not touch it until the next command.
+       Some responses (e.g. AT+CIFSR) carry no final result code, so a timeout is parsed as well */
+    if (err == LWLTE_OK || err == LWLTE_TIMEOUT) {
+        err = lwlte_at_parse_response(schema_id, core->at_waiter.at_response, 
+            strlen(core->at_waiter.at_response), fields, field_count);
+    }
+    /* Unlock the at_waiter */
+    lwlte_core_at_unlock(core);
+    return err;
 }
 
-lwlte_err_t lwlte_core_input(char* input, lwlte_base_type_t input_size)
+lwlte_err_t lwlte_core_send_at_cmd_stream_internal(lwlte_core_t* core, const char* cmd, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    lwlte_core_line_sink_t sink, 
+    void* sink_ctx)
 {
-    /* Check if the module is initialized */
-    if (s_lwlte_core_context.flags == NULL || s_lwlte_core_context.core_input_queue == NULL) {
-        return LWLTE_NOT_INITIALIZED;
+    lwlte_err_t err = lwlte_core_check_at_cmd_args(core, cmd, wait_str, error_str, wait_time_ms);
+    if (err != LWLTE_OK) {
+        return err;
     }
-    /* Check if the core is initialized */
-    if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
-        return LWLTE_NOT_INITIALIZED;
+    if (sink == NULL) {
+        return LWLTE_INVALID_ARG;
     }
-    /* Check if the arguments are valid */
-    if (input == NULL || input_size == 0) {
+    /* Lock the at_waiter */
+    err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    lwlte_sys_mutex_lock(core->at_waiter.sink_lock);
+    core->at_waiter.sink = sink;
+    core->at_waiter.sink_ctx = sink_ctx;
+    lwlte_sys_mutex_unlock(core->at_waiter.sink_lock);
+    err = lwlte_core_send_at_cmd_locked(core, cmd, wait_str, error_str, wait_time_ms);
+    /* Detach the sink, waiting for the worker to leave it if it is still running */
+    lwlte_sys_mutex_lock(core->at_waiter.sink_lock);
+    core->at_waiter.sink = NULL;
+    core->at_waiter.sink_ctx = NULL;
+    lwlte_sys_mutex_unlock(core->at_waiter.sink_lock);
+    /* Unlock the at_waiter */
+    lwlte_core_at_unlock(core);
+    return err;
+}
+
+lwlte_err_t lwlte_core_send_at_cmd_prompt_internal(lwlte_core_t* core, const char* cmd, 
+    const lwlte_core_iovec_t* iov, 
+    size_t iov_count, 
+    const char* wait_str, 
+    const char* error_str, 
+    lwlte_base_type_t wait_time_ms, 
+    char* response_buf, 
+    lwlte_base_type_t response_buf_size)
+{
+    lwlte_err_t err = lwlte_core_check_at_cmd_args(core, cmd, wait_str, error_str, wait_time_ms);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    if ((iov == NULL && iov_count > 0) || response_buf_size < 0) {
         return LWLTE_INVALID_ARG;
     }
-    /* Send the input to the core_input_queue */
-    lwlte_sys_queue_send(s_lwlte_core_context.core_input_queue, input, UINT32_MAX);
-    return LWLTE_OK;
+    size_t data_size = 0;
+    for (size_t i = 0; i < iov_count; i++) {
+        if (iov[i].base == NULL && iov[i].len > 0) {
+            return LWLTE_INVALID_ARG;
+        }
+        data_size += iov[i].len;
+    }
+    /* Lock the at_waiter */
+    err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    /* The prompt is not followed by a line ending, the framer completes it by itself while it is awaited */
+    core->at_waiter.prompt_pending = true;
+    err = lwlte_core_send_at_cmd_locked(core, cmd, LWLTE_CORE_PROMPT, error_str, wait_time_ms);
+    core->at_waiter.prompt_pending = false;
+    if (err == LWLTE_OK) {
+        LWLTE_LOGI(TAG, "TX:|<%u bytes>", (unsigned)data_size);
+        err = lwlte_core_at_exchange_locked(core, iov, iov_count, wait_str, error_str, wait_time_ms);
+    }
+    else if (err == LWLTE_TIMEOUT) {
+        /* The prompt may still come, make sure the module does not take the next command as data */
+        lwlte_core_at_write(core, AT_PROMPT_CANCEL, strlen(AT_PROMPT_CANCEL));
+    }
+    /* If the response_buf is not NULL, copy the response to the response_buf */
+    if (response_buf != NULL && response_buf_size > 0) {
+        strncpy(response_buf, core->at_waiter.at_response, response_buf_size - 1);
+        response_buf[response_buf_size - 1] = '\0';
+    }
+    /* Unlock the at_waiter */
+    lwlte_core_at_unlock(core);
+    return err;
+}
+
+/* Deliver a response line to the sink, the command completes on the wait/error string or when the sink fails */
+static void handle_stream_line(lwlte_core_t* core, const char* line, int line_length)
+{
+    lwlte_sys_mutex_lock(core->at_waiter.sink_lock);
+    if (core->at_waiter.sink == NULL) {
+        lwlte_sys_mutex_unlock(core->at_waiter.sink_lock);
+        return;
+    }
+    /* The worker is shared by all instances, the sink must hand the line off without blocking */
+    bool more = core->at_waiter.sink(line, line_length, core->at_waiter.sink_ctx);
+    lwlte_sys_mutex_unlock(core->at_waiter.sink_lock);
+    if (!more) {
+        core->at_waiter.response_error = true;
+        lwlte_sys_semaphore_signal(core->at_waiter.done);
+    }
+    else if (strstr(line, core->at_waiter.at_wait_string) != NULL) {
+        core->at_waiter.response_ok = true;
+        lwlte_sys_semaphore_signal(core->at_waiter.done);
+    }
+    else if (strstr(line, core->at_waiter.at_error_string) != NULL) {
+        core->at_waiter.response_error = true;
+        lwlte_sys_semaphore_signal(core->at_waiter.done);
+    }
+}
+
+static void handle_response_line(lwlte_core_t* core, const char* line, int line_length)
+{
+    if (core->at_waiter.sink != NULL) {
+        handle_stream_line(core, line, line_length);
+        return;
+    }
+    /* Append the line to the response, truncating it if the response buffer is full */
+    size_t response_length = strlen(core->at_waiter.at_response);
+    size_t response_space = core->config.uart_buf_size - 1 - response_length;
+    strncat(core->at_waiter.at_response, line, response_space);
+    /* If the response contains the wait response or the error response, give the done semaphore */
+    if (strstr(core->at_waiter.at_response, core->at_waiter.at_wait_string) != NULL) {
+        core->at_waiter.response_ok = true;
+        lwlte_sys_semaphore_signal(core->at_waiter.done);
+    }
+    else if (strstr(core->at_waiter.at_response, core->at_waiter.at_error_string) != NULL) {
+        core->at_waiter.response_error = true;
+        lwlte_sys_semaphore_signal(core->at_waiter.done);
+    }
 }
 
-static void handle_one_line(const char* line, int line_length)
+/* Pass a line to the URC handler of its prefix, returns false if no handler takes it */
+static bool handle_urc_line(lwlte_core_t* core, const char* line, int line_length, int* raw_needed)
 {
+    if (core->urc_lock == NULL) {
+        return false;
+    }
+    lwlte_sys_mutex_lock(core->urc_lock);
+    for (int i = 0; i < LWLTE_CORE_MAX_URC_HANDLERS; i++) {
+        struct urc_handler_t* entry = &core->urc_handlers[i];
+        if (entry->prefix != NULL && strncmp(line, entry->prefix, strlen(entry->prefix)) == 0) {
+            size_t result = entry->handler(line, line_length, entry->ctx);
+            lwlte_sys_mutex_unlock(core->urc_lock);
+            if (result == LWLTE_CORE_URC_PASS) {
+                return false;
+            }
+            *raw_needed = (int)result;
+            return true;
+        }
+    }
+    lwlte_sys_mutex_unlock(core->urc_lock);
+    return false;
+}
+
+static int handle_one_line(lwlte_core_t* core, const char* line, int line_length)
+{
+    int raw_needed = 0;
+    /* The registered URCs first, e.g. the +MSUB messages of the MQTT client */
+    if (handle_urc_line(core, line, line_length, &raw_needed)) {
+        return raw_needed;
+    }
     /* If the line contains "RDY" and the module is not ready, set the module ready flag */
     if (strstr(line, "RDY") != NULL) {
-        if ((lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY) == 0))
+        if ((lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY) == 0))
         {
-            lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY);
+            lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_READY);
             LWLTE_LOGI(TAG, "Module reset is done.");
         }
-        else if ((lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY) == 1))
+        else if ((lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY) == 1))
         {
             LWLTE_LOGE(TAG, "Multiple \"RDY\" responses received, you may check if the power supply of LTE module is stable.");
+            /* The module rebooted by itself, nothing learned from it before is valid any more */
+            lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_MODULE_STATE_BITS & ~LWLTE_FLAGS_MODULE_READY);
+            lwlte_core_notify_watcher(core);
+            core->health.unexpected_rdy_count++;
         }
     }
     /* If the line contains "+CGEV: ME PDN ACT", it is a URC from the module that the PDN is activated */
-    else if (strstr(line, "+CGEV: ME PDN ACT") != NULL && (lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED) == 0)) {
-        lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED);
+    else if (strstr(line, "+CGEV: ME PDN ACT") != NULL && (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED) == 0)) {
+        lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED);
         LWLTE_LOGI(TAG, "PDN is activated.");
     }
-    /* If the line contains +MSUB:, it is a message from mqtt subscription */
-    else if (strstr(line, "+MSUB:") != NULL) {
-        LWLTE_LOGI(TAG, "Received MSUB: %s", line);
+    /* A +MSUB: without a subscription router, the MQTT client is not initialized */
+    else if (strncmp(line, URC_MSUB, strlen(URC_MSUB)) == 0) {
+        LWLTE_LOGW(TAG, "Unhandled MSUB: %.*s", line_length, line);
     }
     /* If the LWLTE is sending an AT command, append the line to the response and check if the response contains the wait string or the error string */
-    else if (lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_AT_CMD_IS_SENDING)) {
-        strcat(s_lwlte_core_context.at_waiter.at_response, line);
-        /* If the response contains the wait response or the error response, give the done semaphore */
-        if (strstr(s_lwlte_core_context.at_waiter.at_response, s_lwlte_core_context.at_waiter.at_wait_string) != NULL) {
-            s_lwlte_core_context.at_waiter.response_ok = true;
-            lwlte_sys_semaphore_signal(s_lwlte_core_context.at_waiter.done);
+    else if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_AT_CMD_IS_SENDING)) {
+        handle_response_line(core, line, line_length);
+    }
+    return 0;
+}
+
+/* True if the line is the '>' prompt of a command waiting to send its data, on the AT channel only */
+static bool lwlte_core_framer_at_prompt(lwlte_core_t* core, lwlte_core_framer_t* framer)
+{
+    return framer == &core->framer && core->at_waiter.prompt_pending && 
+        framer->line_length == 1 && framer->line[0] == '>';
+}
+
+static void lwlte_core_framer_feed(lwlte_core_t* core, lwlte_core_framer_t* framer, const char* data, lwlte_base_type_t size)
+{
+    for (int i = 0; i < size; i++) {
+        char c = data[i];
+        /* The payload of a dropped URC is binary, it must not be taken for AT responses */
+        if (framer->skip_needed > 0) {
+            framer->skip_needed--;
+            continue;
+        }
+        ADD_TO_LINE(framer->line, framer->line_length, c);
+        /* The rest of a URC is collected as it is, it may hold line breaks and binary data */
+        if (framer->raw_needed > 0) {
+            if (--framer->raw_needed > 0) {
+                continue;
+            }
+        }
+        /* Dispatch on the line ending, on an awaited data prompt, or when the line is too long to be buffered */
+        else if (c != '\n' && framer->line_length < framer->line_size - 1 && !lwlte_core_framer_at_prompt(core, framer)) {
+            continue;
+        }
+        /* Do not log the '\n' so that the log does not get an extra new line */
+        LWLTE_LOGI(TAG, "RX:|%.*s", c == '\n' ? framer->line_length - 1 : framer->line_length, framer->line);
+        core->health.last_rx_ms = lwlte_sys_time_get_ms();
+        int raw_needed = framer->on_line(core, framer->line, framer->line_length);
+        if (raw_needed > 0) {
+            if (framer->line_length + raw_needed < framer->line_size) {
+                framer->raw_needed = raw_needed;
+                continue;
+            }
+            LWLTE_LOGE(TAG, "URC of %d bytes does not fit in the line buffer, dropped.", framer->line_length + raw_needed);
+            framer->skip_needed = raw_needed;
+        }
+        RESET_LINE(framer->line, framer->line_length);
+    }
+}
+
+/* Hand text received on a channel to its line framer, through the worker in split task mode */
+static void lwlte_core_dispatch(lwlte_core_t* core, lwlte_core_channel_t channel, const char* data, lwlte_base_type_t size)
+{
+    if (core->config.rx_mode == LWLTE_RX_MODE_SINGLE_TASK) {
+        lwlte_core_framer_feed(core, channel == LWLTE_CORE_CHANNEL_URC ? &core->urc_framer : &core->framer, 
+            data, size);
+        return;
+    }
+    /* The size is below uart_buf_size: the RX task reads at most uart_buf_size - 1 bytes and frames are not larger.
+       The length is carried in the item, the text may hold binary data */
+    core->core_input_item[0] = (char)channel;
+    core->core_input_item[1] = (char)(size & 0xFF);
+    core->core_input_item[2] = (char)((size >> 8) & 0xFF);
+    memcpy(core->core_input_item + LWLTE_CORE_ITEM_HEADER, data, size);
+    lwlte_sys_queue_send(core->core_input_queue, core->core_input_item, UINT32_MAX);
+    lwlte_core_doorbell_t doorbell = { .core = core, .fence = false };
+    lwlte_sys_queue_send(s_lwlte_core_worker.doorbell_queue, &doorbell, UINT32_MAX);
+}
+
+/* Payload of a multiplexer frame, called from the UART RX task */
+static void lwlte_core_cmux_rx(uint8_t dlci, const uint8_t* data, size_t size, void* ctx)
+{
+    lwlte_core_t* core = (lwlte_core_t*)ctx;
+    core->health.last_rx_ms = lwlte_sys_time_get_ms();
+    if (dlci == LWLTE_CMUX_DLCI_DATA) {
+        if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_DATA_MODE)) {
+            if (core->data_sink != NULL) {
+                core->data_sink(data, size, core->data_sink_ctx);
+            }
+        }
+        else if (core->dial.dialing) {
+            lwlte_core_framer_feed(core, &core->dial.framer, (const char*)data, size);
+        }
+        return;
+    }
+    lwlte_core_dispatch(core, dlci == LWLTE_CMUX_DLCI_URC ? LWLTE_CORE_CHANNEL_URC : LWLTE_CORE_CHANNEL_AT, 
+        (const char*)data, size);
+}
+
+lwlte_err_t lwlte_core_input(lwlte_core_t* core, char* input, lwlte_base_type_t input_size)
+{
+    /* Check if the module is initialized */
+    if (core == NULL || core->flags == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    /* Check if the core is initialized */
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED | LWLTE_FLAGS_CORE_INITIALIZING)) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    /* Check if the arguments are valid */
+    if (input == NULL || input_size <= 0) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* In the multiplexer mode the input is binary frames, they are decoded here and the payloads dispatched per channel */
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        lwlte_cmux_input(core->cmux, (const uint8_t*)input, input_size);
+        return LWLTE_OK;
+    }
+    /* Without the multiplexer the data mode takes the whole UART */
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_DATA_MODE)) {
+        core->health.last_rx_ms = lwlte_sys_time_get_ms();
+        if (core->data_sink != NULL) {
+            core->data_sink((const uint8_t*)input, input_size, core->data_sink_ctx);
+        }
+        return LWLTE_OK;
+    }
+    /* In single task mode the caller (the UART RX task) frames and dispatches the lines itself */
+    lwlte_core_dispatch(core, LWLTE_CORE_CHANNEL_AT, input, input_size);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_set_data_sink_internal(lwlte_core_t* core, lwlte_core_data_sink_t sink, void* ctx)
+{
+    if (core == NULL || core->flags == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    /* Clear the sink first so that the RX task never sees the new sink with the old context */
+    core->data_sink = NULL;
+    core->data_sink_ctx = ctx;
+    core->data_sink = sink;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_data_write_internal(lwlte_core_t* core, const uint8_t* data, size_t size)
+{
+    if (core == NULL || core->flags == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        return lwlte_cmux_write(core->cmux, LWLTE_CMUX_DLCI_DATA, data, size);
+    }
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_DATA_MODE)) {
+        return lwlte_ll_uart_write(core->uart, (const char*)data, size);
+    }
+    return LWLTE_NOT_SUPPORTED;
+}
+
+bool lwlte_core_get_cmux_active_internal(lwlte_core_t* core)
+{
+    if (core == NULL || core->flags == NULL) {
+        return false;
+    }
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE);
+}
+
+lwlte_base_type_t lwlte_core_get_line_size_internal(lwlte_core_t* core)
+{
+    return core != NULL ? core->config.uart_buf_size : 0;
+}
+
+/* Answer of the dial command on the multiplexer data channel, called from the UART RX task */
+static int handle_dial_line(lwlte_core_t* core, const char* line, int line_length)
+{
+    if (strstr(line, "CONNECT") != NULL) {
+        /* Switch before returning so that the following bytes already go to the data sink */
+        lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_DATA_MODE);
+        core->dial.connected = true;
+    }
+    else if (strstr(line, "NO CARRIER") == NULL && strstr(line, "ERROR") == NULL) {
+        return 0;
+    }
+    core->dial.dialing = false;
+    lwlte_sys_semaphore_signal(core->dial.done);
+    return 0;
+}
+
+lwlte_err_t lwlte_core_enter_data_mode_internal(lwlte_core_t* core, const char* dial_cmd, lwlte_base_type_t wait_time_ms)
+{
+    if (core == NULL || core->flags == NULL || 
+        !lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (dial_cmd == NULL || wait_time_ms <= 0) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_DATA_MODE)) {
+        return LWLTE_ALREADY_INITIALIZED;
+    }
+    /* The AT channel stays available, the module answers the dial on the data channel */
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        lwlte_sys_semaphore_wait(core->dial.done, 0);
+        RESET_LINE(core->dial.framer.line, core->dial.framer.line_length);
+        core->dial.connected = false;
+        core->dial.dialing = true;
+        lwlte_err_t err = lwlte_cmux_write(core->cmux, LWLTE_CMUX_DLCI_DATA, 
+            (const uint8_t*)dial_cmd, strlen(dial_cmd));
+        if (err == LWLTE_OK) {
+            lwlte_sys_semaphore_wait(core->dial.done, wait_time_ms);
         }
-        else if (strstr(s_lwlte_core_context.at_waiter.at_response, s_lwlte_core_context.at_waiter.at_error_string) != NULL) {
-            s_lwlte_core_context.at_waiter.response_error = true;
-            lwlte_sys_semaphore_signal(s_lwlte_core_context.at_waiter.done);
+        core->dial.dialing = false;
+        if (err != LWLTE_OK) {
+            return err;
         }
+        return core->dial.connected ? LWLTE_OK : LWLTE_TIMEOUT;
+    }
+    /* Switch in the same lock as the dial, no AT command may go out once the module is in the data mode */
+    lwlte_err_t err = lwlte_core_check_at_cmd_args(core, dial_cmd, "CONNECT", "ERROR", wait_time_ms);
+    if (err != LWLTE_OK) {
+        return err;
     }
+    err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    err = lwlte_core_send_at_cmd_locked(core, dial_cmd, "CONNECT", "ERROR", wait_time_ms);
+    if (err == LWLTE_OK) {
+        lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_DATA_MODE);
+    }
+    lwlte_core_at_unlock(core);
+    return err;
+}
+
+lwlte_err_t lwlte_core_exit_data_mode_internal(lwlte_core_t* core)
+{
+    if (core == NULL || core->flags == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_DATA_MODE)) {
+        return LWLTE_OK;
+    }
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        /* The module hangs the data channel up by itself once PPP has terminated */
+        lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_DATA_MODE);
+        return LWLTE_OK;
+    }
+    /* Escape to the command mode, the module only accepts "+++" surrounded by silence */
+    lwlte_sys_thread_sleep(LWLTE_CORE_ESCAPE_GUARD_MS);
+    lwlte_ll_uart_write(core->uart, AT_ESCAPE, strlen(AT_ESCAPE));
+    lwlte_sys_thread_sleep(LWLTE_CORE_ESCAPE_GUARD_MS);
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_DATA_MODE);
+    RESET_LINE(core->framer.line, core->framer.line_length);
+    core->framer.raw_needed = 0;
+    core->framer.skip_needed = 0;
+    return lwlte_core_send_at_cmd_internal(core, AT_HANGUP, "OK", "ERROR", core->config.at_wait_ticks, NULL, 0);
+}
+
+void lwlte_core_set_link_up_internal(lwlte_core_t* core, bool up)
+{
+    if (core == NULL || core->flags == NULL) {
+        return;
+    }
+    if (up) {
+        lwlte_sys_flags_set(core->flags, 
+            LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED | LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+    }
+    else {
+        lwlte_sys_flags_clear(core->flags, 
+            LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED | LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+    }
+    lwlte_core_notify_watcher(core);
 }
 
 static void core_worker_task(void *pvParameters)
 {
     LWLTE_LOGI(TAG, "core_worker_task starts.");
-    /* Allocate the core_input_buf */
-    s_lwlte_core_context.core_input_buf = lwlte_sys_mem_malloc(s_lwlte_core_context.config.uart_buf_size);
+    lwlte_core_doorbell_t doorbell;
     while (1) {
-        /* Receive the input from the core_input_queue */
-        lwlte_sys_queue_recv(s_lwlte_core_context.core_input_queue, 
-            s_lwlte_core_context.core_input_buf, LWLTE_SYS_WAIT_FOREVER);
-        /* Process the input line by line*/
-        int line_length = 0;
-        char line[s_lwlte_core_context.config.uart_buf_size];
-        line[0] = '\0';
-        for (int i = 0; i < s_lwlte_core_context.config.uart_buf_size; i++) {
-            /* Append the character to the line */
-            char c = (char)s_lwlte_core_context.core_input_buf[i];
-            if (c == '\n') {
-                /* We do this so that the log does not log an extra new line (not to log the '\n') */
-                LWLTE_LOGI(TAG, "RX:|%s", line);
-                ADD_TO_LINE(line, line_length, c);
-                handle_one_line(line, line_length);
-                /* Reset the line */
-                RESET_LINE(line, line_length);
-            }
-            else if (c == '\0') {
-                ADD_TO_LINE(line, line_length, c);
-                break;
-            }
-            else {
-                ADD_TO_LINE(line, line_length, c);
-            }
+        lwlte_sys_queue_recv(s_lwlte_core_worker.doorbell_queue, &doorbell, LWLTE_SYS_WAIT_FOREVER);
+        lwlte_core_t* core = doorbell.core;
+        if (core == NULL) {
+            break;
         }
+        /* Every doorbell queued before the fence has been processed, the instance may go away */
+        if (doorbell.fence) {
+            lwlte_sys_semaphore_signal(core->worker_fence);
+            continue;
+        }
+        if (!lwlte_sys_queue_recv(core->core_input_queue, core->core_input_buf, 0)) {
+            continue;
+        }
+        /* Process the input line by line, the item is the channel, the length and the text */
+        lwlte_core_framer_t* framer = (core->core_input_buf[0] == LWLTE_CORE_CHANNEL_URC) ? 
+            &core->urc_framer : &core->framer;
+        lwlte_base_type_t size = (uint8_t)core->core_input_buf[1] | ((uint8_t)core->core_input_buf[2] << 8);
+        lwlte_core_framer_feed(core, framer, core->core_input_buf + LWLTE_CORE_ITEM_HEADER, size);
     }
-    free(s_lwlte_core_context.core_input_buf);
+    LWLTE_LOGI(TAG, "core_worker_task exits.");
+    /* Must be the last access to the worker, the last instance deletes it once this is given */
+    lwlte_sys_semaphore_signal(s_lwlte_core_worker.exited);
 }
 
-static lwlte_err_t lwlte_core_create_worker_thread(void)
+/* Runs in the timer service task at the end of the power-off time */
+static void lwlte_core_power_timer_callback(void* arg)
 {
-    /* Create the core_worker_thread */
-    lwlte_sys_thread_cfg_t core_worker_thread_config = {
-        .name = "core_worker_thread",
-        .priority = tskIDLE_PRIORITY + 10,
-        .stack_size = 4096,
-        .arg = NULL
-    };
-    s_lwlte_core_context.core_worker_thread_handle = lwlte_sys_thread_create(core_worker_task, &core_worker_thread_config);
+    lwlte_core_t* core = (lwlte_core_t*)arg;
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_STOPPING)) {
+        return;
+    }
+    lwlte_ll_gpio_set_level(core->config.gpio_en_num, 1);
+    LWLTE_LOGI(TAG, "Module EN released.");
+}
+
+/* Pull EN low and return at once, the power timer releases it, the module then reports "RDY" */
+static lwlte_err_t lwlte_core_power_cycle_async(lwlte_core_t* core)
+{
+    if (lwlte_ll_gpio_set_level(core->config.gpio_en_num, 0) != LWLTE_OK) {
+        return LWLTE_ERROR;
+    }
+    if (!lwlte_sys_timer_start(core->power_timer, LWLTE_CORE_POWER_OFF_MS)) {
+        return LWLTE_ERROR;
+    }
+    return LWLTE_OK;
+}
+
+/* Start the shared worker for the first instance, the task config of that instance is used */
+static lwlte_err_t lwlte_core_worker_acquire(lwlte_core_t* core)
+{
+    lwlte_sys_global_lock();
+    /* A worker whose stop could not be queued still runs and is reused */
+    if (s_lwlte_core_worker.users > 0 || (s_lwlte_core_worker.doorbell_queue != NULL && !s_lwlte_core_worker.stop_queued)) {
+        s_lwlte_core_worker.users++;
+        lwlte_sys_global_unlock();
+        return LWLTE_OK;
+    }
+    /* A worker that was late to stop is replaced once it has exited */
+    if (s_lwlte_core_worker.stop_queued) {
+        if (!lwlte_sys_semaphore_wait(s_lwlte_core_worker.exited, 0)) {
+            LWLTE_LOGE(TAG, "core_worker_task of the previous run has not exited yet.");
+            lwlte_sys_global_unlock();
+            return LWLTE_TIMEOUT;
+        }
+        lwlte_sys_queue_delete(s_lwlte_core_worker.doorbell_queue);
+        lwlte_sys_semaphore_delete(s_lwlte_core_worker.exited);
+        s_lwlte_core_worker.doorbell_queue = NULL;
+        s_lwlte_core_worker.exited = NULL;
+        s_lwlte_core_worker.stop_queued = false;
+    }
+    s_lwlte_core_worker.doorbell_queue = lwlte_sys_queue_create(sizeof(lwlte_core_doorbell_t), LWLTE_CORE_DOORBELL_QUEUE_DEPTH);
+    s_lwlte_core_worker.exited = lwlte_sys_semaphore_create();
+    lwlte_sys_thread_cfg_t core_worker_thread_config;
+    lwlte_sys_thread_cfg_apply(&core_worker_thread_config, &core->config.worker_task, "core_worker_thread", 
+        LWLTE_CORE_WORKER_TASK_STACK_SIZE, LWLTE_CORE_WORKER_TASK_PRIORITY, NULL);
+    if (s_lwlte_core_worker.doorbell_queue == NULL || s_lwlte_core_worker.exited == NULL || 
+        lwlte_sys_thread_create(core_worker_task, &core_worker_thread_config) == NULL) {
+        lwlte_sys_queue_delete(s_lwlte_core_worker.doorbell_queue);
+        lwlte_sys_semaphore_delete(s_lwlte_core_worker.exited);
+        s_lwlte_core_worker.doorbell_queue = NULL;
+        s_lwlte_core_worker.exited = NULL;
+        lwlte_sys_global_unlock();
+        return LWLTE_ERROR;
+    }
+    s_lwlte_core_worker.users = 1;
+    lwlte_sys_global_unlock();
+    return LWLTE_OK;
+}
+
+/* Stop the shared worker with the last instance. On a timeout the queue and the semaphore are kept,
+   the worker may still use them, the next acquire reuses or replaces it */
+static lwlte_err_t lwlte_core_worker_release(void)
+{
+    lwlte_sys_global_lock();
+    if (s_lwlte_core_worker.users == 0 || --s_lwlte_core_worker.users > 0) {
+        lwlte_sys_global_unlock();
+        return LWLTE_OK;
+    }
+    lwlte_core_doorbell_t doorbell = { .core = NULL, .fence = false };
+    if (!lwlte_sys_queue_send(s_lwlte_core_worker.doorbell_queue, &doorbell, LWLTE_CORE_STOP_TIMEOUT_MS)) {
+        LWLTE_LOGE(TAG, "core_worker_task stop could not be queued, the worker keeps running.");
+        lwlte_sys_global_unlock();
+        return LWLTE_TIMEOUT;
+    }
+    if (!lwlte_sys_semaphore_wait(s_lwlte_core_worker.exited, LWLTE_CORE_STOP_TIMEOUT_MS)) {
+        LWLTE_LOGE(TAG, "core_worker_task did not stop in time.");
+        s_lwlte_core_worker.stop_queued = true;
+        lwlte_sys_global_unlock();
+        return LWLTE_TIMEOUT;
+    }
+    lwlte_sys_queue_delete(s_lwlte_core_worker.doorbell_queue);
+    lwlte_sys_semaphore_delete(s_lwlte_core_worker.exited);
+    s_lwlte_core_worker.doorbell_queue = NULL;
+    s_lwlte_core_worker.exited = NULL;
+    lwlte_sys_global_unlock();
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_core_init_internal(const lwlte_config_t* config)
+/* Data read by the UART RX task of this instance */
+static lwlte_err_t lwlte_core_uart_rx(void* ctx, char* data, lwlte_base_type_t size)
+{
+    return lwlte_core_input((lwlte_core_t*)ctx, data, size);
+}
+
+static lwlte_err_t lwlte_core_uart_write(const char* data, size_t size, void* ctx)
+{
+    return lwlte_ll_uart_write(((lwlte_core_t*)ctx)->uart, data, size);
+}
+
+/* Create the flags and the sync objects of an instance, those already there are kept */
+static lwlte_err_t lwlte_core_sync_create(lwlte_core_t* core)
+{
+    if (core->flags == NULL) {
+        core->flags = lwlte_sys_flags_create();
+        if (core->flags != NULL) {
+            lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_ALL_BITS);
+        }
+    }
+    if (core->health_lock == NULL) {
+        core->health_lock = lwlte_sys_mutex_create();
+    }
+    if (core->at_waiter.done == NULL) {
+        core->at_waiter.done = lwlte_sys_semaphore_create();
+    }
+    if (core->at_waiter.lock == NULL) {
+        core->at_waiter.lock = lwlte_sys_mutex_create();
+    }
+    if (core->at_waiter.sink_lock == NULL) {
+        core->at_waiter.sink_lock = lwlte_sys_mutex_create();
+    }
+    if (core->urc_lock == NULL) {
+        core->urc_lock = lwlte_sys_mutex_create();
+    }
+    if (core->dial.done == NULL) {
+        core->dial.done = lwlte_sys_semaphore_create();
+    }
+    if (core->worker_fence == NULL) {
+        core->worker_fence = lwlte_sys_semaphore_create();
+    }
+    if (core->flags == NULL || core->health_lock == NULL || core->at_waiter.done == NULL || 
+        core->at_waiter.lock == NULL || core->at_waiter.sink_lock == NULL || core->urc_lock == NULL || 
+        core->dial.done == NULL || core->worker_fence == NULL) {
+        return LWLTE_ERROR;
+    }
+    return LWLTE_OK;
+}
+
+/* Delete the flags and the sync objects, nothing may use the instance any more */
+static void lwlte_core_sync_delete(lwlte_core_t* core)
+{
+    lwlte_sys_semaphore_delete(core->worker_fence);
+    core->worker_fence = NULL;
+    lwlte_sys_semaphore_delete(core->dial.done);
+    core->dial.done = NULL;
+    lwlte_sys_mutex_delete(core->urc_lock);
+    core->urc_lock = NULL;
+    lwlte_sys_mutex_delete(core->at_waiter.sink_lock);
+    core->at_waiter.sink_lock = NULL;
+    lwlte_sys_mutex_delete(core->at_waiter.lock);
+    core->at_waiter.lock = NULL;
+    lwlte_sys_semaphore_delete(core->at_waiter.done);
+    core->at_waiter.done = NULL;
+    lwlte_sys_mutex_delete(core->health_lock);
+    core->health_lock = NULL;
+    /* Delete the flags last, the getters treat a NULL flags as not initialized */
+    lwlte_sys_flags_t flags = core->flags;
+    core->flags = NULL;
+    lwlte_sys_flags_delete(flags);
+}
+
+lwlte_err_t lwlte_core_init_internal(lwlte_core_t* core, const lwlte_config_t* config)
 {
     LWLTE_LOGI(TAG, "lwlte_core_init_internal starts.");
     /* Record the start time */
-    s_lwlte_core_context.init_start_time_ms = lwlte_sys_time_get_ms();
+    core->init_start_time_ms = lwlte_sys_time_get_ms();
     /* If the config is NULL, return an error */
     if (config == NULL) {
         return LWLTE_INVALID_ARG;
     }
     /* If the module is already initialized, return an error */
-    if (s_lwlte_core_context.flags != NULL || s_lwlte_core_context.core_input_queue != NULL) {
+    if (core->started) {
         return LWLTE_ALREADY_INITIALIZED;
     }
+    /* Kept across an in-place re-init, the tasks blocked on them during the re-init wake up on the new state */
+    if (lwlte_core_sync_create(core) != LWLTE_OK) {
+        return LWLTE_NO_MEM;
+    }
+    core->started = true;
     /* Copy the config */
-    s_lwlte_core_context.config = *config;
-    /* Create the flags and clear all the bits */
-    s_lwlte_core_context.flags = lwlte_sys_flags_create();
-    lwlte_sys_flags_clear(s_lwlte_core_context.flags, LWLTE_FLAGS_ALL_BITS);
-    /* Set the initializing bit */
-    lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_CORE_INITIALIZING);
-    /* Create the core_input_queue */
-    s_lwlte_core_context.core_input_queue = lwlte_sys_queue_create(s_lwlte_core_context.config.uart_buf_size, 10);
-    /* Initialize the at_waiter */
-    s_lwlte_core_context.at_waiter.done = lwlte_sys_semaphore_create();
-    s_lwlte_core_context.at_waiter.lock = lwlte_sys_mutex_create();
-    s_lwlte_core_context.at_waiter.at_response = lwlte_sys_mem_malloc(s_lwlte_core_context.config.uart_buf_size);
-    s_lwlte_core_context.at_waiter.at_response[0] = '\0';
-    s_lwlte_core_context.at_waiter.at_error_string = lwlte_sys_mem_malloc(s_lwlte_core_context.config.uart_buf_size);
-    s_lwlte_core_context.at_waiter.at_error_string[0] = '\0';
-    s_lwlte_core_context.at_waiter.at_wait_string = lwlte_sys_mem_malloc(s_lwlte_core_context.config.uart_buf_size);
-    s_lwlte_core_context.at_waiter.at_wait_string[0] = '\0';
+    core->config = *config;
+    /* The callers queued on the at_waiter during a re-init are still counted */
+    lwlte_sys_mutex_lock(core->health_lock);
+    lwlte_base_type_t pending_cmds = core->health.pending_cmds;
+    core->health = (lwlte_core_health_t){ .last_rx_ms = lwlte_sys_time_get_ms(), .pending_cmds = pending_cmds, 
+        .csq = LWLTE_CORE_CSQ_UNKNOWN };
+    lwlte_sys_mutex_unlock(core->health_lock);
+    /* Clear all the bits and set the initializing bit */
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_ALL_BITS);
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_CORE_INITIALIZING);
+    /* Create the line framers */
+    core->framer.line_size = core->config.uart_buf_size;
+    core->framer.line = lwlte_sys_mem_malloc(core->framer.line_size);
+    core->framer.on_line = handle_one_line;
+    if (core->config.cmux_enable) {
+        core->urc_framer.line_size = core->config.uart_buf_size;
+        core->urc_framer.line = lwlte_sys_mem_malloc(core->urc_framer.line_size);
+        core->urc_framer.on_line = handle_one_line;
+        core->dial.framer.line_size = core->config.uart_buf_size;
+        core->dial.framer.line = lwlte_sys_mem_malloc(core->dial.framer.line_size);
+        core->dial.framer.on_line = handle_dial_line;
+    }
+    /* Create the core_input_queue, the single task mode has no worker to feed. An item is the channel, the length and the text */
+    if (core->config.rx_mode == LWLTE_RX_MODE_SPLIT_TASK) {
+        core->core_input_queue = lwlte_sys_queue_create(core->config.uart_buf_size + LWLTE_CORE_ITEM_HEADER, 10);
+        core->core_input_item = lwlte_sys_mem_malloc(core->config.uart_buf_size + LWLTE_CORE_ITEM_HEADER);
+        core->core_input_buf = lwlte_sys_mem_malloc(core->config.uart_buf_size + LWLTE_CORE_ITEM_HEADER);
+    }
+    core->at_waiter.at_response = lwlte_sys_mem_malloc(core->config.uart_buf_size);
+    core->at_waiter.at_error_string = lwlte_sys_mem_malloc(core->config.uart_buf_size);
+    core->at_waiter.at_wait_string = lwlte_sys_mem_malloc(core->config.uart_buf_size);
+    /* The watchdog re-inits the core at runtime, a failed allocation must fail the init and not crash it */
+    if (core->framer.line == NULL || 
+        (core->config.cmux_enable && (core->urc_framer.line == NULL || core->dial.framer.line == NULL)) || 
+        (core->config.rx_mode == LWLTE_RX_MODE_SPLIT_TASK && 
+            (core->core_input_queue == NULL || core->core_input_item == NULL || core->core_input_buf == NULL)) || 
+        core->at_waiter.at_response == NULL || core->at_waiter.at_error_string == NULL || 
+        core->at_waiter.at_wait_string == NULL) {
+        LWLTE_LOGE(TAG, "Out of memory for the core buffers.");
+        lwlte_core_deinit_internal(core);
+        return LWLTE_NO_MEM;
+    }
+    RESET_LINE(core->framer.line, core->framer.line_length);
+    if (core->config.cmux_enable) {
+        RESET_LINE(core->urc_framer.line, core->urc_framer.line_length);
+        RESET_LINE(core->dial.framer.line, core->dial.framer.line_length);
+    }
+    /* Initialize the at_waiter, a stale signal of the previous run is drained */
+    lwlte_sys_semaphore_wait(core->at_waiter.done, 0);
+    lwlte_sys_semaphore_wait(core->dial.done, 0);
+    lwlte_sys_semaphore_wait(core->worker_fence, 0);
+    core->at_waiter.at_response[0] = '\0';
+    core->at_waiter.at_error_string[0] = '\0';
+    core->at_waiter.at_wait_string[0] = '\0';
     /* Initialize the UART */
     lwlte_ll_uart_config_t uart_config = {
-        .uart_num = s_lwlte_core_context.config.uart_num,
-        .uart_tx_io_num = s_lwlte_core_context.config.uart_tx_io_num,
-        .uart_rx_io_num = s_lwlte_core_context.config.uart_rx_io_num,
-        .uart_buf_size = s_lwlte_core_context.config.uart_buf_size,
+        .uart_num = core->config.uart_num,
+        .uart_tx_io_num = core->config.uart_tx_io_num,
+        .uart_rx_io_num = core->config.uart_rx_io_num,
+        .uart_buf_size = core->config.uart_buf_size,
         .uart_config = {
             .baud_rate = config->uart_baudrate,
             .data_bits = UART_DATA_8_BITS,
@@ -258,63 +1062,542 @@ lwlte_err_t lwlte_core_init_internal(const lwlte_config_t* config)
             .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
             .source_clk = UART_SCLK_DEFAULT,
         },
+        .rx_fn = lwlte_core_uart_rx,
+        .rx_ctx = core,
     };
-    if (lwlte_ll_uart_init(&uart_config) != LWLTE_OK) {
+    lwlte_sys_thread_cfg_apply(&uart_config.rx_task_config, &core->config.rx_task, "lwlte_ll_uart_rx_task", 
+        LWLTE_CORE_RX_TASK_STACK_SIZE, LWLTE_CORE_RX_TASK_PRIORITY, NULL);
+    /* Join the shared worker before the RX task can ring it, unless an earlier run is still counted */
+    if (core->config.rx_mode == LWLTE_RX_MODE_SPLIT_TASK && !core->worker_acquired) {
+        if (lwlte_core_worker_acquire(core) != LWLTE_OK) {
+            lwlte_core_deinit_internal(core);
+            return LWLTE_ERROR;
+        }
+        core->worker_acquired = true;
+    }
+    if (lwlte_ll_uart_init(&uart_config, &core->uart) != LWLTE_OK) {
+        lwlte_core_deinit_internal(core);
         return LWLTE_ERROR;
     }
-    /* Create the core_worker_thread */
-    if (lwlte_core_create_worker_thread() != LWLTE_OK) {
+    if (core->config.ppp_enable) {
+        core->ppp = lwlte_ppp_create(core);
+    }
+    /* Initialize the GPIO, keep EN high if the module may already be powered so that the probe can find it */
+    core->power_timer = lwlte_sys_timer_create("lwlte_power", LWLTE_CORE_POWER_OFF_MS, false, 
+        lwlte_core_power_timer_callback, core);
+    if (core->power_timer == NULL || 
+        lwlte_ll_gpio_init(core->config.gpio_en_num, core->config.probe_before_power_on ? 1 : 0) != LWLTE_OK) {
+        lwlte_core_deinit_internal(core);
         return LWLTE_ERROR;
     }
-    /* Initialize the GPIO */
-    if (lwlte_ll_gpio_init(s_lwlte_core_context.config.gpio_en_num) != LWLTE_OK) {
+    /* Power the module on without blocking the caller, or let the bring-up probe it first */
+    core->probe_pending = core->config.probe_before_power_on;
+    if (!core->probe_pending && lwlte_core_power_cycle_async(core) != LWLTE_OK) {
+        lwlte_core_deinit_internal(core);
         return LWLTE_ERROR;
     }
     /* Initialize the network activate task */
-    if (lwlte_core_network_activate_internal() != LWLTE_OK) {
+    if (lwlte_core_network_activate_internal(core) != LWLTE_OK) {
+        lwlte_core_deinit_internal(core);
         return LWLTE_ERROR;
     }
     /* Set the initialized bit */
-    lwlte_sys_flags_clear(s_lwlte_core_context.flags, LWLTE_FLAGS_CORE_INITIALIZING);
-    lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_CORE_INITIALIZED);
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_CORE_INITIALIZING);
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_CORE_INITIALIZED);
+    return LWLTE_OK;
+}
+
+/* Poll until the bits are cleared by their owner, event groups can only wait for bits to be set */
+static bool lwlte_core_wait_bits_cleared(lwlte_core_t* core, lwlte_sys_flagbits_t bits, lwlte_base_type_t timeout_ms)
+{
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    while (lwlte_sys_flags_get(core->flags) & bits) {
+        if (lwlte_sys_time_get_ms() - start_ms >= timeout_ms) {
+            return false;
+        }
+        lwlte_sys_thread_sleep(LWLTE_CORE_STOP_POLL_MS);
+    }
+    return true;
+}
+
+/* Stop the network activate task if it is running */
+static lwlte_err_t lwlte_core_stop_network_activate(lwlte_core_t* core)
+{
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_ACTIVATE_ABORT);
+    /* Wake a pending AT command of the task so that it notices the abort quickly */
+    lwlte_sys_semaphore_signal(core->at_waiter.done);
+    bool stopped = lwlte_core_wait_bits_cleared(core, LWLTE_FLAGS_INIT_TASK_RUNNING, LWLTE_CORE_STOP_TIMEOUT_MS);
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_ACTIVATE_ABORT);
+    if (!stopped) {
+        LWLTE_LOGE(TAG, "network_activate_task did not stop in time.");
+        return LWLTE_TIMEOUT;
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_deinit_internal(lwlte_core_t* core)
+{
+    if (core == NULL || !core->started) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    LWLTE_LOGI(TAG, "lwlte_core_deinit_internal starts.");
+    /* Refuse new AT commands and tell the tasks to stop */
+    lwlte_sys_flagbits_t init_bits = lwlte_sys_flags_get(core->flags) &
+        (LWLTE_FLAGS_CORE_INITIALIZED | LWLTE_FLAGS_CORE_INITIALIZING);
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_CORE_INITIALIZED | LWLTE_FLAGS_CORE_INITIALIZING);
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_CORE_STOPPING);
+    if (lwlte_core_stop_network_activate(core) != LWLTE_OK) {
+        /* Nothing is torn down yet, the instance is left as it was and the deinit can be tried again */
+        lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_CORE_STOPPING);
+        lwlte_sys_flags_set(core->flags, init_bits);
+        return LWLTE_TIMEOUT;
+    }
+    /* Take the PPP link down while the data channel still works */
+    lwlte_ppp_stop_internal(core->ppp);
+    lwlte_ppp_delete(core->ppp);
+    core->ppp = NULL;
+    /* Let a command in flight complete (it fails at once), then keep the waiter locked */
+    lwlte_sys_semaphore_signal(core->at_waiter.done);
+    lwlte_sys_mutex_lock(core->at_waiter.lock);
+    /* Bring the module back to the plain AT mode */
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        lwlte_cmux_close(core->cmux);
+    }
+    /* From here on the teardown always completes. A task that did not stop may still use the multiplexer,
+       the input queue, the framers and the at_waiter buffers, they are then leaked instead of freed */
+    bool leaked = false;
+    /* Stop the UART RX task and remove the driver, nothing feeds the core after this */
+    if (lwlte_ll_uart_deinit(core->uart) != LWLTE_OK) {
+        leaked = true;
+    }
+    core->uart = NULL;
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_CMUX_ACTIVE);
+    core->data_sink = NULL;
+    core->data_sink_ctx = NULL;
+    /* Queue a fence behind the pending doorbells, once the shared worker reaches it no doorbell refers to this instance */
+    if (core->worker_acquired) {
+        lwlte_core_doorbell_t fence = { .core = core, .fence = true };
+        if (!lwlte_sys_queue_send(s_lwlte_core_worker.doorbell_queue, &fence, LWLTE_CORE_STOP_TIMEOUT_MS)
+            || !lwlte_sys_semaphore_wait(core->worker_fence, LWLTE_CORE_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "core_worker_task did not reach the fence in time.");
+            /* The instance stays a user of the worker, the next init does not join it again */
+            leaked = true;
+        }
+        else {
+            /* No doorbell refers to this instance any more, a worker late to stop only delays the next acquire */
+            core->worker_acquired = false;
+            lwlte_core_worker_release();
+        }
+    }
+    if (!leaked) {
+        lwlte_cmux_delete(core->cmux);
+        lwlte_sys_queue_delete(core->core_input_queue);
+        lwlte_sys_mem_free(core->core_input_item);
+        lwlte_sys_mem_free(core->core_input_buf);
+        lwlte_sys_mem_free(core->framer.line);
+        lwlte_sys_mem_free(core->urc_framer.line);
+        lwlte_sys_mem_free(core->dial.framer.line);
+        lwlte_sys_mem_free(core->at_waiter.at_response);
+        lwlte_sys_mem_free(core->at_waiter.at_error_string);
+        lwlte_sys_mem_free(core->at_waiter.at_wait_string);
+    }
+    else {
+        LWLTE_LOGE(TAG, "A core task did not stop, its buffers are leaked and the instance can not be freed.");
+        core->leaked = true;
+    }
+    core->cmux = NULL;
+    core->core_input_queue = NULL;
+    core->core_input_item = NULL;
+    core->core_input_buf = NULL;
+    /* Cancel a pending power-on, then power the module off */
+    if (core->power_timer != NULL) {
+        lwlte_sys_timer_stop(core->power_timer);
+        lwlte_sys_timer_delete(core->power_timer);
+        core->power_timer = NULL;
+    }
+    core->probe_pending = false;
+    lwlte_ll_gpio_deinit(core->config.gpio_en_num);
+    /* Reset the framers and the at_waiter */
+    core->framer = (lwlte_core_framer_t){ 0 };
+    core->urc_framer = (lwlte_core_framer_t){ 0 };
+    core->dial.framer = (lwlte_core_framer_t){ 0 };
+    core->at_waiter.at_response = NULL;
+    core->at_waiter.at_error_string = NULL;
+    core->at_waiter.at_wait_string = NULL;
+    core->at_waiter.sink = NULL;
+    core->at_waiter.sink_ctx = NULL;
+    /* The sync objects stay, the callers queued on the at_waiter find the core not initialized */
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_ALL_BITS);
+    core->started = false;
+    lwlte_sys_mutex_unlock(core->at_waiter.lock);
+    lwlte_core_notify_watcher(core);
+    LWLTE_LOGI(TAG, "lwlte_core_deinit_internal completed.");
+    return leaked ? LWLTE_TIMEOUT : LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_create_internal(const lwlte_config_t* config, lwlte_core_t** core)
+{
+    if (config == NULL || core == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_core_t* instance = lwlte_sys_mem_malloc(sizeof(lwlte_core_t));
+    if (instance == NULL) {
+        return LWLTE_NO_MEM;
+    }
+    memset(instance, 0, sizeof(lwlte_core_t));
+    lwlte_err_t err = lwlte_core_init_internal(instance, config);
+    if (err != LWLTE_OK) {
+        /* init_internal has already cleaned up after itself */
+        lwlte_core_sync_delete(instance);
+        lwlte_sys_mem_free(instance);
+        return err;
+    }
+    *core = instance;
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_core_deinit_internal(void)
+lwlte_err_t lwlte_core_destroy_internal(lwlte_core_t* core)
+{
+    if (core == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* A failed deinit leaves tasks that may still use the instance, so it is not freed */
+    lwlte_err_t err = lwlte_core_deinit_internal(core);
+    if (err != LWLTE_OK && err != LWLTE_NOT_INITIALIZED) {
+        return err;
+    }
+    if (core->leaked) {
+        return LWLTE_TIMEOUT;
+    }
+    lwlte_core_sync_delete(core);
+    lwlte_sys_mem_free(core);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_core_add_urc_handler_internal(lwlte_core_t* core, const char* prefix, 
+    lwlte_core_urc_handler_t handler, void* ctx)
+{
+    if (core == NULL || core->urc_lock == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (prefix == NULL || prefix[0] == '\0' || handler == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_err_t err = LWLTE_ERROR;
+    lwlte_sys_mutex_lock(core->urc_lock);
+    for (int i = 0; i < LWLTE_CORE_MAX_URC_HANDLERS; i++) {
+        struct urc_handler_t* entry = &core->urc_handlers[i];
+        /* A prefix registered again gets the new handler */
+        if (entry->prefix == NULL || strcmp(entry->prefix, prefix) == 0) {
+            *entry = (struct urc_handler_t){ .prefix = prefix, .handler = handler, .ctx = ctx };
+            err = LWLTE_OK;
+            break;
+        }
+    }
+    lwlte_sys_mutex_unlock(core->urc_lock);
+    return err;
+}
+
+lwlte_err_t lwlte_core_remove_urc_handler_internal(lwlte_core_t* core, const char* prefix)
+{
+    if (core == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (prefix == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* Without the lock the core is deinitialized and no handler can be running */
+    if (core->urc_lock != NULL) {
+        lwlte_sys_mutex_lock(core->urc_lock);
+    }
+    lwlte_err_t err = LWLTE_NOT_FOUND;
+    for (int i = 0; i < LWLTE_CORE_MAX_URC_HANDLERS; i++) {
+        struct urc_handler_t* entry = &core->urc_handlers[i];
+        if (entry->prefix != NULL && strcmp(entry->prefix, prefix) == 0) {
+            *entry = (struct urc_handler_t){ 0 };
+            err = LWLTE_OK;
+        }
+    }
+    if (core->urc_lock != NULL) {
+        lwlte_sys_mutex_unlock(core->urc_lock);
+    }
+    return err;
+}
+
+void lwlte_core_set_watchdog_internal(lwlte_core_t* core, void* watchdog)
+{
+    if (core != NULL) {
+        core->watchdog = watchdog;
+    }
+}
+
+void* lwlte_core_get_watchdog_internal(lwlte_core_t* core)
+{
+    return (core != NULL) ? core->watchdog : NULL;
+}
+
+void lwlte_core_set_watcher_internal(lwlte_core_t* core, lwlte_sys_flags_t watcher)
+{
+    if (core != NULL) {
+        core->watcher = watcher;
+    }
+}
+
+lwlte_err_t lwlte_core_restart_internal(lwlte_core_t* core)
+{
+    if (core->flags == NULL || 
+        !lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    LWLTE_LOGI(TAG, "Restarting the LTE module.");
+    /* Stop the bring-up, the UART, the worker and every handle stay as they are */
+    if (lwlte_core_stop_network_activate(core) != LWLTE_OK) {
+        return LWLTE_TIMEOUT;
+    }
+    /* Take PPP down first, the data mode does not survive the power cycle */
+    lwlte_ppp_stop_internal(core->ppp);
+    /* Forget everything learned from the module, the bring-up runs again from "RDY" */
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_MODULE_STATE_BITS);
+    lwlte_core_notify_watcher(core);
+    /* Fail a pending AT command at once instead of letting it time out */
+    lwlte_sys_semaphore_signal(core->at_waiter.done);
+    /* Power-cycle the module through the EN pin, the bring-up waits for "RDY" meanwhile */
+    core->probe_pending = false;
+    if (lwlte_core_power_cycle_async(core) != LWLTE_OK) {
+        return LWLTE_ERROR;
+    }
+    core->init_start_time_ms = lwlte_sys_time_get_ms();
+    return lwlte_core_network_activate_internal(core);
+}
+
+lwlte_err_t lwlte_core_reactivate_internal(lwlte_core_t* core)
+{
+    if (core->flags == NULL || 
+        !lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    LWLTE_LOGI(TAG, "Reactivating the network.");
+    if (lwlte_core_stop_network_activate(core) != LWLTE_OK) {
+        return LWLTE_TIMEOUT;
+    }
+    /* Hang PPP up, the bring-up dials again */
+    lwlte_ppp_stop_internal(core->ppp);
+    /* Drop the IP context, the PDN stays as reported by the module */
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED | 
+        LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED | LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+    lwlte_core_notify_watcher(core);
+    lwlte_core_send_at_cmd_internal(core, AT_CIPSHUT, "SHUT OK", "ERROR", core->config.at_wait_ticks, NULL, 0);
+    core->init_start_time_ms = lwlte_sys_time_get_ms();
+    return lwlte_core_network_activate_internal(core);
+}
+
+lwlte_err_t lwlte_core_get_health_internal(lwlte_core_t* core, lwlte_core_health_t* health)
 {
+    if (health == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (core == NULL || core->flags == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    *health = core->health;
     return LWLTE_OK;
 }
 
-lwlte_base_type_t lwlte_core_get_signal_strength(void)
+void lwlte_core_reset_health_internal(lwlte_core_t* core)
+{
+    core->health.consecutive_timeouts = 0;
+    core->health.last_rx_ms = lwlte_sys_time_get_ms();
+}
+
+bool lwlte_core_get_network_activating_internal(lwlte_core_t* core)
+{
+    if (core == NULL || core->flags == NULL) {
+        return false;
+    }
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_INIT_TASK_RUNNING);
+}
+
+lwlte_err_t lwlte_core_refresh_signal_internal(lwlte_core_t* core, lwlte_base_type_t* csq)
+{
+    if (core == NULL || core->flags == NULL || csq == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_err_t err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    /* Checked under the lock, a restart or a deinit cannot come between the check and the command */
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY)) {
+        lwlte_core_at_unlock(core);
+        return LWLTE_NOT_INITIALIZED;
+    }
+    err = lwlte_core_send_at_cmd_locked(core, AT_CSQ, "OK", "ERROR", core->config.at_wait_ticks);
+    lwlte_at_field_t fields[2];
+    if (err == LWLTE_OK) {
+        err = lwlte_at_parse_response(LWLTE_AT_SCHEMA_CSQ, core->at_waiter.at_response, 
+            strlen(core->at_waiter.at_response), fields, 2);
+    }
+    /* The health readings of the commands are written under the at_waiter lock */
+    if (err == LWLTE_OK) {
+        *csq = fields[0].v.i;
+        core->health.csq = *csq;
+    }
+    lwlte_core_at_unlock(core);
+    return err;
+}
+
+lwlte_base_type_t lwlte_core_get_signal_strength(lwlte_core_t* core)
 {
-    if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY)) {
+    lwlte_base_type_t csq = -1;
+    lwlte_err_t err = lwlte_core_refresh_signal_internal(core, &csq);
+    if (err == LWLTE_NOT_INITIALIZED || err == LWLTE_INVALID_ARG) {
         LWLTE_LOGE(TAG, "LWLTE module is not ready! Please call lwlte_core_init() first.");
-        return -1;
     }
-    char response[s_lwlte_core_context.config.uart_buf_size];
-    if (lwlte_core_send_at_cmd_internal(AT_CSQ, "OK", "ERROR", s_lwlte_core_context.config.at_wait_ticks, response, sizeof(response)) != LWLTE_OK) {
-        return -1;
+    return err == LWLTE_OK ? csq : -1;
+}
+
+/* Sleep between the bring-up steps, return true if the bring-up is aborted meanwhile */
+static bool network_activate_sleep(lwlte_core_t* core, uint32_t ms)
+{
+    return lwlte_sys_flags_wait(core->flags, 
+        LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING, false, 
+        false, ms) != 0;
+}
+
+/* AT commands are refused until the init has returned, the bring-up task may start before that */
+static void network_activate_wait_initialized(lwlte_core_t* core)
+{
+    lwlte_sys_flags_wait(core->flags, 
+        LWLTE_FLAGS_CORE_INITIALIZED | LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING, false, 
+        false, LWLTE_CORE_STOP_TIMEOUT_MS);
+}
+
+/* Check if the module is already powered and running, it answers "AT" without reporting "RDY" again */
+static bool network_activate_probe(lwlte_core_t* core)
+{
+    network_activate_wait_initialized(core);
+    for (int i = 0; i < LWLTE_CORE_PROBE_RETRIES; i++) {
+        if (lwlte_sys_flags_get(core->flags) & (LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING)) {
+            return false;
+        }
+        if (lwlte_core_send_at_cmd_internal(core, AT_PROBE, "OK", "ERROR", LWLTE_CORE_PROBE_WAIT_MS, NULL, 0) == LWLTE_OK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 27.010 port speed code of a baud rate (1: 9600 to 6: 230400), 0 if the rate has none */
+static int lwlte_core_cmux_speed_code(lwlte_base_type_t baudrate)
+{
+    static const lwlte_base_type_t rates[] = { 9600, 19200, 38400, 57600, 115200, 230400 };
+    for (int i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+        if (rates[i] == baudrate) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/* Switch the module to the multiplexer mode and open the channels, the plain AT mode is kept on failure */
+static lwlte_err_t network_activate_start_cmux(lwlte_core_t* core)
+{
+    network_activate_wait_initialized(core);
+    if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CORE_INITIALIZED)) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    /* The frame size must fit in a queue item and in a line of the framer */
+    lwlte_base_type_t frame_size = core->config.cmux_frame_size > 0 ? 
+        core->config.cmux_frame_size : LWLTE_CMUX_DEFAULT_FRAME_SIZE;
+    if (frame_size > core->config.uart_buf_size - 1) {
+        frame_size = core->config.uart_buf_size - 1;
+    }
+    if (core->cmux == NULL) {
+        core->cmux = lwlte_cmux_create(frame_size, lwlte_core_uart_write, lwlte_core_cmux_rx, core);
+        if (core->cmux == NULL) {
+            return LWLTE_ERROR;
+        }
+    }
+    char cmd[40];
+    int speed_code = lwlte_core_cmux_speed_code(core->config.uart_baudrate);
+    if (speed_code > 0) {
+        snprintf(cmd, sizeof(cmd), AT_CMUX_FMT, speed_code, (int)frame_size);
+    }
+    else {
+        snprintf(cmd, sizeof(cmd), AT_CMUX_NO_SPEED_FMT, (int)frame_size);
+    }
+    /* Hold the at_waiter so that no command goes out between the switch and the channels being open */
+    lwlte_err_t err = lwlte_core_at_lock(core);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    err = lwlte_core_send_at_cmd_locked(core, cmd, "OK", "ERROR", core->config.at_wait_ticks);
+    if (err == LWLTE_OK) {
+        lwlte_cmux_reset(core->cmux);
+        lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_CMUX_ACTIVE);
+        /* The control and AT channels are required, the module sends the URCs on the AT channel without the URC one */
+        err = lwlte_cmux_open_channel(core->cmux, LWLTE_CMUX_DLCI_CONTROL, LWLTE_CORE_CMUX_OPEN_TIMEOUT_MS);
+        if (err == LWLTE_OK) {
+            err = lwlte_cmux_open_channel(core->cmux, LWLTE_CMUX_DLCI_AT, LWLTE_CORE_CMUX_OPEN_TIMEOUT_MS);
+        }
+        if (err == LWLTE_OK) {
+            if (lwlte_cmux_open_channel(core->cmux, LWLTE_CMUX_DLCI_DATA, LWLTE_CORE_CMUX_OPEN_TIMEOUT_MS) != LWLTE_OK) {
+                LWLTE_LOGW(TAG, "CMUX data channel not available.");
+            }
+            if (lwlte_cmux_open_channel(core->cmux, LWLTE_CMUX_DLCI_URC, LWLTE_CORE_CMUX_OPEN_TIMEOUT_MS) != LWLTE_OK) {
+                LWLTE_LOGW(TAG, "CMUX URC channel not available.");
+            }
+        }
+        else {
+            lwlte_cmux_close(core->cmux);
+            lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_CMUX_ACTIVE);
+        }
     }
-    char *data_pointer = NULL;
-    lwlte_base_type_t csq = 0;
-    GET_CSQ(response, data_pointer, csq);
-    return csq;
+    lwlte_core_at_unlock(core);
+    return err;
 }
 
 static void network_activate_task(void *pvParameters)
 {
+    lwlte_core_t* core = (lwlte_core_t*)pvParameters;
     LWLTE_LOGI(TAG, "network_activate_task starts.");
-    lwlte_sys_flags_wait(s_lwlte_core_context.flags, 
-        LWLTE_FLAGS_MODULE_READY, true, 
-        false, LWLTE_SYS_WAIT_FOREVER);
-    while (lwlte_sys_time_get_ms() - s_lwlte_core_context.init_start_time_ms < s_lwlte_core_context.config.init_max_time_ms) {
-        lwlte_sys_thread_sleep(1000);
+    bool connected = false;
+    if (core->probe_pending) {
+        core->probe_pending = false;
+        if (network_activate_probe(core)) {
+            lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_READY);
+            LWLTE_LOGI(TAG, "Module is already powered, power-on skipped.");
+        }
+        else if (!(lwlte_sys_flags_get(core->flags) & (LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING))) {
+            LWLTE_LOGI(TAG, "Module did not answer the probe, powering it on.");
+            lwlte_core_power_cycle_async(core);
+        }
+    }
+    /* Wait for "RDY" within the bring-up time, a module that never reports it is left to the watchdog */
+    lwlte_sys_flags_wait(core->flags, 
+        LWLTE_FLAGS_MODULE_READY | LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING, false, 
+        false, core->config.init_max_time_ms);
+    /* Multiplex the UART before anything else is sent, the module drops out of it when it is reset */
+    if (core->config.cmux_enable && 
+        lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY) && 
+        !lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_CMUX_ACTIVE)) {
+        if (network_activate_start_cmux(core) == LWLTE_OK) {
+            LWLTE_LOGI(TAG, "CMUX is active.");
+        }
+        else {
+            LWLTE_LOGE(TAG, "Failed to start CMUX, staying in the AT mode.");
+        }
+    }
+    while (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY) && lwlte_sys_time_get_ms() - core->init_start_time_ms < core->config.init_max_time_ms) {
+        if (network_activate_sleep(core, 1000)) {
+            break;
+        }
         /* Check if the SIM card is ready */
-        if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY)) {
-            char response[s_lwlte_core_context.config.uart_buf_size];
-            lwlte_core_send_at_cmd_internal(AT_CPIN, "+CPIN: READY", "ERROR", s_lwlte_core_context.config.at_wait_ticks, response, sizeof(response));
-            if (strstr(response, "+CPIN: READY") != NULL) {
-                lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY);
+        if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY)) {
+            lwlte_at_field_t code;
+            if (lwlte_core_send_at_cmd_parse_internal(core, AT_CPIN, "+CPIN:", "ERROR", core->config.at_wait_ticks, 
+                LWLTE_AT_SCHEMA_CPIN, &code, 1) == LWLTE_OK && lwlte_at_slice_eq(&code.s, "READY")) {
+                lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY);
                 LWLTE_LOGI(TAG, "SIM card is ready");
             }
             else {
@@ -322,12 +1605,14 @@ static void network_activate_task(void *pvParameters)
                 continue;
             }
         }
-        lwlte_sys_thread_sleep(1000);
+        if (network_activate_sleep(core, 1000)) {
+            break;
+        }
         /* Check if the signal is good */
-        if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD)) {
-            lwlte_base_type_t csq = lwlte_core_get_signal_strength();
+        if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD)) {
+            lwlte_base_type_t csq = lwlte_core_get_signal_strength(core);
             if (csq == 99 ||csq > 9) {
-                lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD);
+                lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD);
                 LWLTE_LOGI(TAG, "Signal is good");
             }
             else {
@@ -335,22 +1620,47 @@ static void network_activate_task(void *pvParameters)
                 continue;
             }
         }
-        lwlte_sys_thread_sleep(1000);
+        if (network_activate_sleep(core, 1000)) {
+            break;
+        }
         /* Check if the PDN is activated */
-        if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED)) {
+        if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED)) {
             LWLTE_LOGE(TAG, "Waiting for the PDN to be activated...");
-            lwlte_sys_flags_wait(s_lwlte_core_context.flags, 
-            LWLTE_FLAGS_MODULE_PDN_ACTIVATED, true, 
-            false, s_lwlte_core_context.config.init_max_time_ms);
+            lwlte_sys_flags_wait(core->flags, 
+            LWLTE_FLAGS_MODULE_PDN_ACTIVATED | LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING, false, 
+            false, core->config.init_max_time_ms);
+        }
+        if (network_activate_sleep(core, 1000)) {
+            break;
+        }
+        /* In PPP mode the attach is done, the IP link runs in lwIP instead of the module's stack */
+        if (core->config.ppp_enable) {
+            if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED)) {
+                if (lwlte_ppp_start_internal(core->ppp) != LWLTE_OK) {
+                    LWLTE_LOGE(TAG, "Failed to initialize the LWLTE module: PPP not started");
+                    continue;
+                }
+                lwlte_sys_flags_wait(core->flags, 
+                    LWLTE_FLAGS_MODULE_NETWORK_CONNECTED | LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING, false, 
+                    false, core->config.init_max_time_ms);
+                if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED)) {
+                    LWLTE_LOGE(TAG, "Failed to initialize the LWLTE module: PPP link not up");
+                    continue;
+                }
+            }
+            LWLTE_LOGI(TAG, "The LTE Module has connected to the network over PPP.");
+            connected = true;
+            break;
         }
-        lwlte_sys_thread_sleep(1000);
         /* Check if the IP GPRS is activated */
-        if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED)) {
-            char response[s_lwlte_core_context.config.uart_buf_size];
-            lwlte_core_send_at_cmd_internal(AT_CSTT, "OK", "ERROR", s_lwlte_core_context.config.at_wait_ticks, response, sizeof(response));
-            lwlte_core_send_at_cmd_internal(AT_CIICR, "OK", "ERROR", s_lwlte_core_context.config.at_wait_ticks, response, sizeof(response));
-            if (strstr(response, "OK") != NULL) {
-                lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED);
+        if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED)) {
+            /* The connection mode can only be changed before the activation */
+            if (core->config.socket_mux) {
+                lwlte_core_send_at_cmd_internal(core, AT_CIPMUX_ON, "OK", "ERROR", core->config.at_wait_ticks, NULL, 0);
+            }
+            lwlte_core_send_at_cmd_internal(core, AT_CSTT, "OK", "ERROR", core->config.at_wait_ticks, NULL, 0);
+            if (lwlte_core_send_at_cmd_internal(core, AT_CIICR, "OK", "ERROR", core->config.at_wait_ticks, NULL, 0) == LWLTE_OK) {
+                lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED);
                 LWLTE_LOGI(TAG, "IP GPRS is activated.");
             }
             else {
@@ -358,118 +1668,135 @@ static void network_activate_task(void *pvParameters)
                 continue;
             }
         }
-        lwlte_sys_thread_sleep(1000);
+        if (network_activate_sleep(core, 1000)) {
+            break;
+        }
         /* Check if the IP address is assigned */
-        if (!lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED)) {
-            char response[s_lwlte_core_context.config.uart_buf_size];
-            lwlte_core_send_at_cmd_internal(AT_CIFSR, "OK", "ERROR", s_lwlte_core_context.config.at_wait_ticks, response, sizeof(response));
-            if (strstr(response, "ERROR") == NULL) {
-                lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED);
-                LWLTE_LOGI(TAG, "IP address is assigned.");
+        if (!lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED)) {
+            lwlte_at_field_t ip;
+            if (lwlte_core_send_at_cmd_parse_internal(core, AT_CIFSR, "OK", "ERROR", core->config.at_wait_ticks, 
+                LWLTE_AT_SCHEMA_CIFSR, &ip, 1) == LWLTE_OK) {
+                lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_IP_ADDRESS_ASSIGNED);
+                LWLTE_LOGI(TAG, "IP address is assigned: %d.%d.%d.%d", ip.v.ip[0], ip.v.ip[1], ip.v.ip[2], ip.v.ip[3]);
             }
             else {
                 LWLTE_LOGE(TAG, "Failed to initialize the LWLTE module: IP address not assigned");
                 continue;
             }
         }
-        lwlte_sys_flags_set(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+        lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+        lwlte_core_notify_watcher(core);
         LWLTE_LOGI(TAG, "The LTE Module has connected to the network.");
-        s_lwlte_core_context.network_activate_thread_handle = NULL;
-        lwlte_sys_thread_delete(NULL);
+        connected = true;
+        break;
+    }
+    if (lwlte_sys_flags_get(core->flags) & (LWLTE_FLAGS_ACTIVATE_ABORT | LWLTE_FLAGS_CORE_STOPPING)) {
+        LWLTE_LOGI(TAG, "Network activation aborted");
+    }
+    else if (!connected) {
+        LWLTE_LOGE(TAG, "Network activation timed out");
     }
-    LWLTE_LOGE(TAG, "Network activation timed out");
-    s_lwlte_core_context.network_activate_thread_handle = NULL;
-    lwlte_sys_thread_delete(NULL);
+    core->network_activate_thread_handle = NULL;
+    /* Must be the last access to the context, the deinit and restart wait for the bit to be cleared */
+    lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_INIT_TASK_RUNNING);
 }
 
-lwlte_err_t lwlte_core_network_activate_internal(void)
+
+
+lwlte_err_t lwlte_core_network_activate_internal(lwlte_core_t* core)
 {
     /* Check if the module is initialized */
-    if (s_lwlte_core_context.flags == NULL || s_lwlte_core_context.core_input_queue == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return LWLTE_NOT_INITIALIZED;
     }
+    /* Only one bring-up at a time */
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_INIT_TASK_RUNNING)) {
+        return LWLTE_ALREADY_INITIALIZED;
+    }
     /* Create the network activate task */
-    lwlte_sys_thread_cfg_t network_activate_task_config = {
-        .name = "network_activate_task",
-        .priority = tskIDLE_PRIORITY + 1,
-        .stack_size = 4096,
-        .arg = NULL
-    };
-    lwlte_sys_thread_create(network_activate_task, &network_activate_task_config);
+    lwlte_sys_thread_cfg_t network_activate_task_config;
+    lwlte_sys_thread_cfg_apply(&network_activate_task_config, &core->config.activate_task, "network_activate_task", 
+        LWLTE_CORE_ACTIVATE_TASK_STACK_SIZE, LWLTE_CORE_ACTIVATE_TASK_PRIORITY, core);
+    lwlte_sys_flags_set(core->flags, LWLTE_FLAGS_INIT_TASK_RUNNING);
+    core->network_activate_thread_handle = lwlte_sys_thread_create(network_activate_task, &network_activate_task_config);
+    if (core->network_activate_thread_handle == NULL) {
+        lwlte_sys_flags_clear(core->flags, LWLTE_FLAGS_INIT_TASK_RUNNING);
+        return LWLTE_ERROR;
+    }
     return LWLTE_OK;
 }
 
-bool lwlte_core_get_module_ready_internal(void)
+bool lwlte_core_get_module_ready_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY);
 }
 
-bool lwlte_core_get_module_sim_card_ready_internal(void)
+bool lwlte_core_get_module_sim_card_ready_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_SIM_CARD_READY);
 }
 
-bool lwlte_core_get_module_signal_good_internal(void)
+bool lwlte_core_get_module_signal_good_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_SIGNAL_GOOD);
 }
 
-bool lwlte_core_get_module_pdn_activated_internal(void)
+bool lwlte_core_get_module_pdn_activated_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_PDN_ACTIVATED);
 }
 
-bool lwlte_core_get_module_ip_gprs_activated_internal(void)
+bool lwlte_core_get_module_ip_gprs_activated_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_IP_GPRS_ACTIVATED);
 }
 
-bool lwlte_core_get_network_connected_internal(void)
+bool lwlte_core_get_network_connected_internal(lwlte_core_t* core)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return false;
     }
-    return lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
+    return lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED);
 }
 
-lwlte_err_t lwlte_core_wait_module_ready(lwlte_base_type_t timeout_ms)
+lwlte_err_t lwlte_core_wait_module_ready(lwlte_core_t* core, lwlte_base_type_t timeout_ms)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return LWLTE_NOT_INITIALIZED;
     }
-    lwlte_sys_flags_wait(s_lwlte_core_context.flags, 
+    lwlte_sys_flags_wait(core->flags, 
         LWLTE_FLAGS_MODULE_READY, true, 
         false, timeout_ms);
-    if (lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_READY) == 0) {
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_READY) == 0) {
         return LWLTE_TIMEOUT;
     }
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_core_wait_network_connected(lwlte_base_type_t timeout_ms)
+lwlte_err_t lwlte_core_wait_network_connected(lwlte_core_t* core, lwlte_base_type_t timeout_ms)
 {
-    if (s_lwlte_core_context.flags == NULL) {
+    if (core == NULL || core->flags == NULL) {
         return LWLTE_NOT_INITIALIZED;
     }
-    lwlte_sys_flags_wait(s_lwlte_core_context.flags, 
+    lwlte_sys_flags_wait(core->flags, 
         LWLTE_FLAGS_MODULE_NETWORK_CONNECTED, true, 
         false, timeout_ms);
-    if (lwlte_sys_flags_get_bit(s_lwlte_core_context.flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED) == 0) {
+    if (lwlte_sys_flags_get_bit(core->flags, LWLTE_FLAGS_MODULE_NETWORK_CONNECTED) == 0) {
         return LWLTE_TIMEOUT;
     }
     return LWLTE_OK;
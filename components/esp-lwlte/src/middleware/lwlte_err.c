@@ -3,4 +3,34 @@
     Author: JovisDreams
     Date: 2025-12-30
     Description: Error code definition
-*/
\ No newline at end of file
+*/
+#include "lwlte_err.h"
+#include "esp_err.h"
+
+esp_err_t lwlte_err_2_esp_err(lwlte_err_t err)
+{
+    switch (err)
+    {
+        case LWLTE_OK:
+            return ESP_OK;
+        case LWLTE_ERROR:
+            return ESP_FAIL;
+        case LWLTE_TIMEOUT:
+            return ESP_ERR_TIMEOUT;
+        case LWLTE_INVALID_ARG:
+            return ESP_ERR_INVALID_ARG;
+        case LWLTE_NOT_SUPPORTED:
+            return ESP_ERR_NOT_SUPPORTED;
+        case LWLTE_NOT_INITIALIZED:
+            return ESP_ERR_NOT_ALLOWED;
+        case LWLTE_ALREADY_INITIALIZED:
+            return ESP_ERR_NOT_ALLOWED;
+        case LWLTE_NOT_FOUND:
+            return ESP_ERR_NOT_FOUND;
+        case LWLTE_NO_MEM:
+            return ESP_ERR_NO_MEM;
+        default:
+            return ESP_FAIL;
+    }
+    return ESP_FAIL;
+}
@@ -0,0 +1,580 @@
+/*
+    File: lwlte_http.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte http client source file
+    - HTTP/1.1 on a socket of lwlte_tcp: the module's HTTP commands keep the whole body in the module,
+      a socket streams it and keeps the connection for the next requests.
+*/
+#include "lwlte_http_client.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Defaults, used for the fields left zero in lwlte_http_config_t */
+#define LWLTE_HTTP_PORT 80
+#define LWLTE_HTTP_CHUNK_SIZE 1024
+#define LWLTE_HTTP_TIMEOUT_MS 15000
+#define LWLTE_HTTP_MAX_RESUMES 3
+/* Bytes per socket read */
+#define LWLTE_HTTP_RX_BUF_SIZE 512
+/* Longest status or header line, a longer one fails the response */
+#define LWLTE_HTTP_LINE_MAX 256
+#define LWLTE_HTTP_ETAG_MAX 64
+/* "Range: bytes=<uint32>-\r\n" and "If-Range: <etag>\r\n" */
+#define LWLTE_HTTP_RANGE_MAX (sizeof("Range: bytes=4294967295-\r\n") + sizeof("If-Range: \r\n") + LWLTE_HTTP_ETAG_MAX)
+#define LWLTE_HTTP_USER_AGENT "esp-lwlte"
+
+static const char* TAG = "lwlte_http";
+
+typedef enum {
+    LWLTE_HTTP_BODY_NONE = 0,
+    LWLTE_HTTP_BODY_LENGTH,
+    LWLTE_HTTP_BODY_CHUNKED,
+    LWLTE_HTTP_BODY_CLOSE, // until the server closes the connection
+} lwlte_http_body_mode_t;
+
+/* What the headers of a response say */
+typedef struct {
+    int status;
+    bool http_1_0;
+    int64_t content_length; // -1: not sent
+    bool chunked;
+    bool close;
+    bool keep_alive;
+    int64_t range_start; // Content-Range, -1: not sent
+    uint32_t range_total;
+    char etag[LWLTE_HTTP_ETAG_MAX];
+} lwlte_http_head_t;
+
+struct lwlte_http_client_s {
+    lwlte_tcp_t* tcp;
+    char* host; // host and extra headers, one block
+    const char* headers;
+    uint16_t port;
+    size_t chunk_size;
+    uint32_t timeout_ms;
+    uint32_t max_resumes;
+    int sock; // -1: no connection
+    bool reused; // the connection already carried a response
+    uint8_t* chunk; // body bytes waiting for the callback
+    size_t chunk_len;
+    uint8_t rx[LWLTE_HTTP_RX_BUF_SIZE];
+    size_t rx_pos;
+    size_t rx_len;
+    char line[LWLTE_HTTP_LINE_MAX];
+    char etag[LWLTE_HTTP_ETAG_MAX]; // of the request being received, sent in If-Range when it resumes
+    bool aborted; // the callback stopped the transfer
+    lwlte_http_stats_t stats;
+};
+
+static void lwlte_http_disconnect(lwlte_http_client_t* client)
+{
+    if (client->sock >= 0) {
+        lwlte_tcp_close_internal(client->tcp, client->sock);
+        client->sock = -1;
+    }
+    client->rx_pos = 0;
+    client->rx_len = 0;
+}
+
+/* Open a connection, or keep the current one if it is idle and open */
+static lwlte_err_t lwlte_http_connect(lwlte_http_client_t* client)
+{
+    if (client->sock >= 0) {
+        /* Data or a close on an idle connection: the server dropped it or sent garbage */
+        lwlte_sys_flagbits_t bits = lwlte_sys_flags_get(lwlte_tcp_get_events_internal(client->tcp));
+        if (client->rx_pos == client->rx_len && !(bits & LWLTE_TCP_EVENT_RX(client->sock))) {
+            return LWLTE_OK;
+        }
+        lwlte_http_disconnect(client);
+    }
+    lwlte_err_t err = lwlte_tcp_open_internal(client->tcp, LWLTE_SOCKET_TCP, client->host, client->port,
+        client->timeout_ms, &client->sock);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGW(TAG, "Failed to connect to %s:%u.", client->host, (unsigned)client->port);
+        client->sock = -1;
+        return err;
+    }
+    client->stats.connections++;
+    client->reused = false;
+    return LWLTE_OK;
+}
+
+/* Queue all of data, waiting for room in the send ring */
+static lwlte_err_t lwlte_http_send_all(lwlte_http_client_t* client, const char* data, size_t len)
+{
+    while (len > 0) {
+        size_t sent = 0;
+        lwlte_err_t err = lwlte_tcp_send_internal(client->tcp, client->sock, data, len, &sent);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        data += sent;
+        len -= sent;
+        if (len > 0 && lwlte_sys_flags_wait(lwlte_tcp_get_events_internal(client->tcp),
+            LWLTE_TCP_EVENT_TX(client->sock), false, false, client->timeout_ms) == 0) {
+            return LWLTE_TIMEOUT;
+        }
+    }
+    return LWLTE_OK;
+}
+
+static lwlte_err_t lwlte_http_send_request(lwlte_http_client_t* client, const lwlte_http_request_t* req, bool head)
+{
+    char range[LWLTE_HTTP_RANGE_MAX] = "";
+    uint32_t from = req->offset + req->received;
+    if (from > 0) {
+        /* If-Range: a changed resource is sent whole instead of a part of the new one */
+        int n = snprintf(range, sizeof(range), "Range: bytes=%u-\r\n", (unsigned)from);
+        if (head && client->etag[0] != '\0') {
+            snprintf(range + n, sizeof(range) - n, "If-Range: %s\r\n", client->etag);
+        }
+    }
+    char port[8] = "";
+    if (client->port != LWLTE_HTTP_PORT) {
+        snprintf(port, sizeof(port), ":%u", (unsigned)client->port);
+    }
+    const char* fmt = "GET %s HTTP/1.1\r\nHost: %s%s\r\nUser-Agent: " LWLTE_HTTP_USER_AGENT "\r\n%s%s\r\n";
+    int len = snprintf(NULL, 0, fmt, req->path, client->host, port, range, client->headers);
+    char* buf = lwlte_sys_mem_malloc(len + 1);
+    if (buf == NULL) {
+        return LWLTE_ERROR;
+    }
+    snprintf(buf, len + 1, fmt, req->path, client->host, port, range, client->headers);
+    lwlte_err_t err = lwlte_http_send_all(client, buf, len);
+    lwlte_sys_mem_free(buf);
+    if (err == LWLTE_OK) {
+        client->stats.requests++;
+        client->stats.reused += client->reused ? 1 : 0;
+    }
+    return err;
+}
+
+/* Read from the socket if the buffer is empty, a closed connection is an error */
+static lwlte_err_t lwlte_http_fill(lwlte_http_client_t* client)
+{
+    if (client->rx_pos < client->rx_len) {
+        return LWLTE_OK;
+    }
+    size_t received = 0;
+    lwlte_err_t err = lwlte_tcp_recv_internal(client->tcp, client->sock, client->rx, LWLTE_HTTP_RX_BUF_SIZE,
+        client->timeout_ms, &received);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    if (received == 0) {
+        return LWLTE_ERROR;
+    }
+    client->rx_pos = 0;
+    client->rx_len = received;
+    return LWLTE_OK;
+}
+
+/* Read a line without its "\r\n" into client->line */
+static lwlte_err_t lwlte_http_read_line(lwlte_http_client_t* client)
+{
+    size_t len = 0;
+    while (true) {
+        lwlte_err_t err = lwlte_http_fill(client);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        char c = (char)client->rx[client->rx_pos++];
+        if (c == '\n') {
+            break;
+        }
+        if (len + 1 >= LWLTE_HTTP_LINE_MAX) {
+            LWLTE_LOGE(TAG, "Response line too long.");
+            return LWLTE_NOT_SUPPORTED;
+        }
+        client->line[len++] = c;
+    }
+    if (len > 0 && client->line[len - 1] == '\r') {
+        len--;
+    }
+    client->line[len] = '\0';
+    return LWLTE_OK;
+}
+
+/* Whether a header value holds a token, case-insensitive */
+static bool lwlte_http_has_token(const char* value, const char* token)
+{
+    size_t token_len = strlen(token);
+    for (const char* p = value; *p != '\0'; p++) {
+        if (strncasecmp(p, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The value of a header line if its name is name, NULL otherwise */
+static const char* lwlte_http_header_value(const char* line, const char* name)
+{
+    size_t name_len = strlen(name);
+    if (strncasecmp(line, name, name_len) != 0 || line[name_len] != ':') {
+        return NULL;
+    }
+    const char* value = line + name_len + 1;
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    return value;
+}
+
+static lwlte_err_t lwlte_http_read_head(lwlte_http_client_t* client, lwlte_http_head_t* head)
+{
+    /* The interim 1xx responses are skipped */
+    do {
+        memset(head, 0, sizeof(lwlte_http_head_t));
+        head->content_length = -1;
+        head->range_start = -1;
+        lwlte_err_t err = lwlte_http_read_line(client);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        int minor = 0;
+        if (sscanf(client->line, "HTTP/1.%d %d", &minor, &head->status) != 2 || head->status < 100) {
+            LWLTE_LOGE(TAG, "Malformed status line: %s", client->line);
+            return LWLTE_NOT_SUPPORTED;
+        }
+        head->http_1_0 = minor == 0;
+        while (true) {
+            err = lwlte_http_read_line(client);
+            if (err != LWLTE_OK) {
+                return err;
+            }
+            if (client->line[0] == '\0') {
+                break;
+            }
+            const char* value = NULL;
+            if ((value = lwlte_http_header_value(client->line, "Content-Length")) != NULL) {
+                head->content_length = strtoll(value, NULL, 10);
+            }
+            else if ((value = lwlte_http_header_value(client->line, "Transfer-Encoding")) != NULL) {
+                head->chunked = lwlte_http_has_token(value, "chunked");
+            }
+            else if ((value = lwlte_http_header_value(client->line, "Connection")) != NULL) {
+                head->close = lwlte_http_has_token(value, "close");
+                head->keep_alive = lwlte_http_has_token(value, "keep-alive");
+            }
+            else if ((value = lwlte_http_header_value(client->line, "Content-Range")) != NULL) {
+                unsigned long start = 0;
+                unsigned long end = 0;
+                unsigned long total = 0;
+                if (sscanf(value, "bytes %lu-%lu/%lu", &start, &end, &total) >= 2) {
+                    head->range_start = start;
+                    head->range_total = total;
+                }
+            }
+            else if ((value = lwlte_http_header_value(client->line, "ETag")) != NULL) {
+                snprintf(head->etag, sizeof(head->etag), "%s", value);
+            }
+        }
+    } while (head->status < 200);
+    return LWLTE_OK;
+}
+
+/* Pass the collected body bytes to the callback */
+static bool lwlte_http_flush_chunk(lwlte_http_client_t* client, lwlte_http_request_t* req, size_t index,
+    lwlte_http_body_cb_t cb, void* ctx)
+{
+    if (client->chunk_len == 0) {
+        return true;
+    }
+    size_t len = client->chunk_len;
+    client->chunk_len = 0;
+    req->received += len;
+    client->stats.body_bytes += len;
+    if (!cb(index, client->chunk, len, ctx)) {
+        client->aborted = true;
+        return false;
+    }
+    return true;
+}
+
+/* Collect body bytes into chunks of chunk_size, the first *skip bytes were delivered before */
+static bool lwlte_http_deliver(lwlte_http_client_t* client, lwlte_http_request_t* req, size_t index,
+    lwlte_http_body_cb_t cb, void* ctx, uint32_t* skip, const uint8_t* data, size_t len)
+{
+    size_t skipped = *skip < len ? *skip : len;
+    *skip -= skipped;
+    data += skipped;
+    len -= skipped;
+    while (len > 0) {
+        size_t n = client->chunk_size - client->chunk_len < len ? client->chunk_size - client->chunk_len : len;
+        memcpy(client->chunk + client->chunk_len, data, n);
+        client->chunk_len += n;
+        data += n;
+        len -= n;
+        if (client->chunk_len == client->chunk_size && !lwlte_http_flush_chunk(client, req, index, cb, ctx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Read len body bytes, or up to the close of the connection with len UINT64_MAX */
+static lwlte_err_t lwlte_http_read_data(lwlte_http_client_t* client, lwlte_http_request_t* req, size_t index,
+    lwlte_http_body_cb_t cb, void* ctx, uint32_t* skip, uint64_t len)
+{
+    while (len > 0) {
+        lwlte_err_t err = lwlte_http_fill(client);
+        if (err != LWLTE_OK) {
+            /* The end of the body when it runs to the close */
+            return (err == LWLTE_ERROR && len == UINT64_MAX) ? LWLTE_OK : err;
+        }
+        size_t n = client->rx_len - client->rx_pos;
+        n = n < len ? n : (size_t)len;
+        const uint8_t* data = client->rx + client->rx_pos;
+        client->rx_pos += n;
+        if (len != UINT64_MAX) {
+            len -= n;
+        }
+        if (cb != NULL && !lwlte_http_deliver(client, req, index, cb, ctx, skip, data, n)) {
+            return LWLTE_ERROR;
+        }
+    }
+    return LWLTE_OK;
+}
+
+static lwlte_err_t lwlte_http_read_chunked(lwlte_http_client_t* client, lwlte_http_request_t* req, size_t index,
+    lwlte_http_body_cb_t cb, void* ctx, uint32_t* skip)
+{
+    while (true) {
+        lwlte_err_t err = lwlte_http_read_line(client);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        char* end = NULL;
+        unsigned long size = strtoul(client->line, &end, 16);
+        if (end == client->line) {
+            LWLTE_LOGE(TAG, "Malformed chunk size: %s", client->line);
+            return LWLTE_NOT_SUPPORTED;
+        }
+        if (size == 0) {
+            break;
+        }
+        err = lwlte_http_read_data(client, req, index, cb, ctx, skip, size);
+        if (err == LWLTE_OK) {
+            /* The "\r\n" after the data */
+            err = lwlte_http_read_line(client);
+        }
+        if (err != LWLTE_OK) {
+            return err;
+        }
+    }
+    /* The trailer, up to the empty line */
+    do {
+        lwlte_err_t err = lwlte_http_read_line(client);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+    } while (client->line[0] != '\0');
+    return LWLTE_OK;
+}
+
+/**
+ * Read the response to req. The body of a 2xx goes to the callback, from the first byte not delivered yet.
+ * @param keep_alive Whether the connection can carry the next response
+ * @return LWLTE_ERROR or LWLTE_TIMEOUT if the connection was lost, the request can be resumed
+ */
+static lwlte_err_t lwlte_http_read_response(lwlte_http_client_t* client, lwlte_http_request_t* req, size_t index,
+    lwlte_http_body_cb_t cb, void* ctx, bool* keep_alive)
+{
+    *keep_alive = false;
+    lwlte_http_head_t head;
+    lwlte_err_t err = lwlte_http_read_head(client, &head);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    client->reused = true;
+    uint32_t from = req->offset + req->received;
+    uint32_t skip = 0;
+    bool success = head.status >= 200 && head.status < 300;
+    if (head.status == 206) {
+        if (head.range_start != (int64_t)from) {
+            LWLTE_LOGE(TAG, "%s: range from %ld instead of %u.", req->path, (long)head.range_start, (unsigned)from);
+            return LWLTE_NOT_SUPPORTED;
+        }
+        req->total_length = head.range_total;
+    }
+    else if (success) {
+        /* The whole resource: the server ignored the range, or the resource changed since the bytes delivered */
+        if (req->received > 0 && client->etag[0] != '\0' && strcmp(client->etag, head.etag) != 0) {
+            LWLTE_LOGE(TAG, "%s changed during the download.", req->path);
+            return LWLTE_NOT_SUPPORTED;
+        }
+        skip = from;
+        req->total_length = head.content_length >= 0 ? (uint32_t)head.content_length : 0;
+    }
+    if (success && req->received == 0) {
+        memcpy(client->etag, head.etag, sizeof(client->etag));
+    }
+    req->status = head.status;
+    lwlte_http_body_mode_t mode = LWLTE_HTTP_BODY_CLOSE;
+    if (head.status == 204 || head.status == 304) {
+        mode = LWLTE_HTTP_BODY_NONE;
+    }
+    else if (head.chunked) {
+        mode = LWLTE_HTTP_BODY_CHUNKED;
+    }
+    else if (head.content_length >= 0) {
+        mode = LWLTE_HTTP_BODY_LENGTH;
+    }
+    lwlte_http_body_cb_t body_cb = success ? cb : NULL;
+    if (mode == LWLTE_HTTP_BODY_LENGTH) {
+        err = lwlte_http_read_data(client, req, index, body_cb, ctx, &skip, (uint64_t)head.content_length);
+    }
+    else if (mode == LWLTE_HTTP_BODY_CHUNKED) {
+        err = lwlte_http_read_chunked(client, req, index, body_cb, ctx, &skip);
+    }
+    else if (mode == LWLTE_HTTP_BODY_CLOSE) {
+        err = lwlte_http_read_data(client, req, index, body_cb, ctx, &skip, UINT64_MAX);
+    }
+    /* The bytes received before a loss count for the resume */
+    if (!client->aborted && !lwlte_http_flush_chunk(client, req, index, cb, ctx) && err == LWLTE_OK) {
+        err = LWLTE_ERROR;
+    }
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    *keep_alive = mode != LWLTE_HTTP_BODY_CLOSE && !head.close && (!head.http_1_0 || head.keep_alive);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_http_client_create_internal(lwlte_tcp_t* tcp, const lwlte_http_config_t* config,
+    lwlte_http_client_t** client_out)
+{
+    if (tcp == NULL || config == NULL || client_out == NULL || config->host == NULL || config->host[0] == '\0') {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_http_client_t* client = lwlte_sys_mem_malloc(sizeof(lwlte_http_client_t));
+    if (client == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(client, 0, sizeof(lwlte_http_client_t));
+    client->tcp = tcp;
+    client->sock = -1;
+    /* Fill in the defaults */
+    client->port = config->port > 0 ? config->port : LWLTE_HTTP_PORT;
+    client->chunk_size = config->chunk_size > 0 ? config->chunk_size : LWLTE_HTTP_CHUNK_SIZE;
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : LWLTE_HTTP_TIMEOUT_MS;
+    client->max_resumes = config->max_resumes > 0 ? config->max_resumes : LWLTE_HTTP_MAX_RESUMES;
+    const char* headers = config->headers != NULL ? config->headers : "";
+    size_t host_size = strlen(config->host) + 1;
+    client->host = lwlte_sys_mem_malloc(host_size + strlen(headers) + 1);
+    client->chunk = lwlte_sys_mem_malloc(client->chunk_size);
+    if (client->host == NULL || client->chunk == NULL) {
+        lwlte_http_client_destroy_internal(client);
+        return LWLTE_ERROR;
+    }
+    memcpy(client->host, config->host, host_size);
+    client->headers = client->host + host_size;
+    memcpy(client->host + host_size, headers, strlen(headers) + 1);
+    *client_out = client;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_http_client_destroy_internal(lwlte_http_client_t* client)
+{
+    if (client == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_http_disconnect(client);
+    lwlte_sys_mem_free(client->chunk);
+    lwlte_sys_mem_free(client->host);
+    lwlte_sys_mem_free(client);
+    return LWLTE_OK;
+}
+
+/* The request line cannot carry spaces or line breaks */
+static bool lwlte_http_check_path(const char* path)
+{
+    if (path == NULL || path[0] != '/') {
+        return false;
+    }
+    return strpbrk(path, " \r\n") == NULL;
+}
+
+lwlte_err_t lwlte_http_client_get_internal(lwlte_http_client_t* client, lwlte_http_request_t* requests, size_t count,
+    lwlte_http_body_cb_t cb, void* ctx)
+{
+    if (client == NULL || requests == NULL || count == 0 || cb == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!lwlte_http_check_path(requests[i].path)) {
+            return LWLTE_INVALID_ARG;
+        }
+        requests[i].status = 0;
+        requests[i].total_length = 0;
+        requests[i].received = 0;
+        requests[i].resumes = 0;
+    }
+    client->aborted = false;
+    client->chunk_len = 0;
+    client->etag[0] = '\0';
+    /* The responses come in order: only requests[next] may be partly received when the connection is lost */
+    size_t next = 0;
+    while (next < count) {
+        size_t window = count - next < LWLTE_HTTP_PIPELINE_MAX ? count - next : LWLTE_HTTP_PIPELINE_MAX;
+        bool reused = client->sock >= 0;
+        lwlte_err_t err = lwlte_http_connect(client);
+        reused = reused && client->reused && client->sock >= 0;
+        for (size_t i = 0; i < window && err == LWLTE_OK; i++) {
+            err = lwlte_http_send_request(client, &requests[next + i], i == 0);
+        }
+        size_t done = 0;
+        bool keep_alive = true;
+        while (err == LWLTE_OK && done < window && keep_alive) {
+            err = lwlte_http_read_response(client, &requests[next], next, cb, ctx, &keep_alive);
+            if (err == LWLTE_OK) {
+                next++;
+                done++;
+                client->etag[0] = '\0';
+            }
+        }
+        if (err == LWLTE_OK && keep_alive) {
+            continue;
+        }
+        /* The requests sent after the last response go again on a new connection */
+        lwlte_http_disconnect(client);
+        if (err == LWLTE_OK) {
+            continue;
+        }
+        lwlte_http_request_t* req = &requests[next];
+        if (client->aborted) {
+            return LWLTE_ERROR;
+        }
+        if (err == LWLTE_NOT_SUPPORTED || err == LWLTE_INVALID_ARG) {
+            return err;
+        }
+        /* A kept-alive connection closed by the server before the first response costs no resume */
+        if (reused && done == 0 && req->status == 0) {
+            continue;
+        }
+        if (req->resumes >= client->max_resumes) {
+            LWLTE_LOGE(TAG, "%s failed after %u resumes.", req->path, (unsigned)req->resumes);
+            return err;
+        }
+        req->resumes++;
+        client->stats.resumes++;
+        LWLTE_LOGW(TAG, "Connection lost, resuming %s from %u.", req->path, (unsigned)(req->offset + req->received));
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_http_client_get_stats_internal(lwlte_http_client_t* client, lwlte_http_stats_t* stats)
+{
+    if (client == NULL || stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    *stats = client->stats;
+    return LWLTE_OK;
+}
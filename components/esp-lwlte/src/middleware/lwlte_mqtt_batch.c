@@ -0,0 +1,384 @@
+/*
+    File: lwlte_mqtt_batch.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT publish batching source file
+    - One open batch per topic, in a small table. A batch is framed as it grows, flushing it is one call
+      to the flush function with the buffer.
+    - A batch is taken out of the table under the lock and flushed after it is released, the flush function
+      may block on the pipeline and may publish again.
+*/
+#include "lwlte_mqtt_batch.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Defaults, used for the fields left unset in batch_t */
+#define LWLTE_MQTT_BATCH_MAX_BYTES 512
+#define LWLTE_MQTT_BATCH_MAX_COUNT 32
+#define LWLTE_MQTT_BATCH_FLUSH_QOS 2
+#define LWLTE_MQTT_BATCH_TASK_STACK_SIZE 3072
+#define LWLTE_MQTT_BATCH_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+/* Topics batched at the same time, the oldest batch is flushed to open a new one */
+#define LWLTE_MQTT_BATCH_MAX_TOPICS 8
+/* Wait of the task when no batch is open, opening one wakes it earlier */
+#define LWLTE_MQTT_BATCH_IDLE_WAIT_MS 1000
+/* A flush can wait for the pipeline, the task gets this long to stop */
+#define LWLTE_MQTT_BATCH_STOP_TIMEOUT_MS 15000
+/* Digits of the largest netstring length */
+#define LWLTE_MQTT_BATCH_LEN_DIGITS 10
+
+static const char* TAG = "lwlte_mqtt_batch";
+
+typedef struct {
+    char* topic; // NULL: free slot
+    char* buf; // framed payload, with room for the closing bracket and the terminator
+    size_t len;
+    lwlte_base_type_t count;
+    lwlte_base_type_t qos; // highest QoS asked for in the batch, -1 if only the default
+    lwlte_tick_t deadline_ms; // end of the window, from the first publish
+} lwlte_mqtt_batch_slot_t;
+
+typedef struct {
+    lwlte_base_type_t window_ms;
+    lwlte_base_type_t max_bytes;
+    lwlte_base_type_t max_count;
+    lwlte_base_type_t flush_qos;
+    lwlte_mqtt_batch_format_t format;
+    lwlte_mqtt_batch_flush_fn_t flush;
+    void* flush_ctx;
+    lwlte_mqtt_batch_slot_t slots[LWLTE_MQTT_BATCH_MAX_TOPICS];
+    volatile bool stop;
+    lwlte_sys_mutex_t lock;
+    lwlte_sys_semaphore_t wake; // given when a batch is opened and on stop
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_thread_t thread_handle;
+} lwlte_mqtt_batch_context_t;
+
+/* True if one more publish keeps the framed batch, with its JSON closing bracket, within max_bytes */
+static bool lwlte_mqtt_batch_fits(lwlte_mqtt_batch_context_t* b, const lwlte_mqtt_batch_slot_t* slot, size_t payload_len)
+{
+    size_t size = slot->len + payload_len;
+    if (b->format == LWLTE_MQTT_BATCH_JSON_ARRAY) {
+        size += 2; // '[' or ',' before the payload, ']' at the end
+    }
+    else {
+        char digits[LWLTE_MQTT_BATCH_LEN_DIGITS + 1];
+        size += snprintf(digits, sizeof(digits), "%u", (unsigned)payload_len) + 2; // "<len>:" and ','
+    }
+    return size <= (size_t)b->max_bytes;
+}
+
+static void lwlte_mqtt_batch_slot_free(lwlte_mqtt_batch_slot_t* slot)
+{
+    lwlte_sys_mem_free(slot->topic);
+    lwlte_sys_mem_free(slot->buf);
+    memset(slot, 0, sizeof(lwlte_mqtt_batch_slot_t));
+}
+
+static lwlte_mqtt_batch_slot_t* lwlte_mqtt_batch_find(lwlte_mqtt_batch_context_t* b, const char* topic)
+{
+    for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS; i++) {
+        if (b->slots[i].topic != NULL && strcmp(b->slots[i].topic, topic) == 0) {
+            return &b->slots[i];
+        }
+    }
+    return NULL;
+}
+
+/* Take a batch out of the table to flush it once the lock is released, the lock must be held */
+static void lwlte_mqtt_batch_detach(lwlte_mqtt_batch_slot_t* slot, lwlte_mqtt_batch_slot_t* detached)
+{
+    *detached = *slot;
+    memset(slot, 0, sizeof(lwlte_mqtt_batch_slot_t));
+}
+
+/* Put a batch whose flush failed back for one more window, it is lost if its topic or the table got taken meanwhile */
+static void lwlte_mqtt_batch_reattach(lwlte_mqtt_batch_context_t* b, lwlte_mqtt_batch_slot_t* detached)
+{
+    lwlte_sys_mutex_lock(b->lock);
+    lwlte_mqtt_batch_slot_t* slot = NULL;
+    if (lwlte_mqtt_batch_find(b, detached->topic) == NULL) {
+        for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS && slot == NULL; i++) {
+            if (b->slots[i].topic == NULL) {
+                slot = &b->slots[i];
+            }
+        }
+    }
+    if (slot != NULL) {
+        LWLTE_LOGW(TAG, "Batch of %d publishes to %s not queued, kept for the next window.", 
+            (int)detached->count, detached->topic);
+        *slot = *detached;
+        slot->deadline_ms = lwlte_sys_time_get_ms() + b->window_ms;
+    }
+    else {
+        LWLTE_LOGW(TAG, "Batch of %d publishes to %s not queued and lost.", (int)detached->count, detached->topic);
+        lwlte_mqtt_batch_slot_free(detached);
+    }
+    lwlte_sys_mutex_unlock(b->lock);
+}
+
+/* Hand the detached batches to the flush function in order, called without the lock */
+static lwlte_err_t lwlte_mqtt_batch_flush_detached(lwlte_mqtt_batch_context_t* b, lwlte_mqtt_batch_slot_t* detached, int count)
+{
+    lwlte_err_t first_err = LWLTE_OK;
+    for (int i = 0; i < count; i++) {
+        lwlte_mqtt_batch_slot_t* slot = &detached[i];
+        size_t len = slot->len;
+        if (b->format == LWLTE_MQTT_BATCH_JSON_ARRAY) {
+            slot->buf[len++] = ']';
+        }
+        slot->buf[len] = '\0';
+        lwlte_err_t err = b->flush(slot->topic, slot->buf, len, slot->qos, false, b->flush_ctx);
+        if (err != LWLTE_OK) {
+            slot->buf[slot->len] = '\0';
+            lwlte_mqtt_batch_reattach(b, slot);
+            if (first_err == LWLTE_OK) {
+                first_err = err;
+            }
+            continue;
+        }
+        lwlte_mqtt_batch_slot_free(slot);
+    }
+    return first_err;
+}
+
+/* Open a batch for a topic, the oldest one is detached into evicted if the table is full */
+static lwlte_err_t lwlte_mqtt_batch_open(lwlte_mqtt_batch_context_t* b, const char* topic, lwlte_mqtt_batch_slot_t** opened,
+    lwlte_mqtt_batch_slot_t* evicted)
+{
+    lwlte_mqtt_batch_slot_t* slot = NULL;
+    lwlte_mqtt_batch_slot_t* oldest = NULL;
+    for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS && slot == NULL; i++) {
+        if (b->slots[i].topic == NULL) {
+            slot = &b->slots[i];
+        }
+        else if (oldest == NULL || (int32_t)(b->slots[i].deadline_ms - oldest->deadline_ms) < 0) {
+            oldest = &b->slots[i];
+        }
+    }
+    if (slot == NULL) {
+        lwlte_mqtt_batch_detach(oldest, evicted);
+        slot = oldest;
+    }
+    size_t topic_len = strlen(topic);
+    slot->topic = lwlte_sys_mem_malloc(topic_len + 1);
+    slot->buf = lwlte_sys_mem_malloc(b->max_bytes + 1);
+    if (slot->topic == NULL || slot->buf == NULL) {
+        lwlte_mqtt_batch_slot_free(slot);
+        return LWLTE_ERROR;
+    }
+    memcpy(slot->topic, topic, topic_len + 1);
+    slot->len = 0;
+    slot->count = 0;
+    slot->qos = -1;
+    slot->deadline_ms = lwlte_sys_time_get_ms() + b->window_ms;
+    *opened = slot;
+    return LWLTE_OK;
+}
+
+static void lwlte_mqtt_batch_append(lwlte_mqtt_batch_context_t* b, lwlte_mqtt_batch_slot_t* slot,
+    const char* payload, size_t payload_len, lwlte_base_type_t qos)
+{
+    char* p = slot->buf + slot->len;
+    if (b->format == LWLTE_MQTT_BATCH_JSON_ARRAY) {
+        *p++ = (slot->count == 0) ? '[' : ',';
+    }
+    else {
+        p += snprintf(p, LWLTE_MQTT_BATCH_LEN_DIGITS + 2, "%u:", (unsigned)payload_len);
+    }
+    memcpy(p, payload, payload_len);
+    p += payload_len;
+    if (b->format == LWLTE_MQTT_BATCH_NETSTRING) {
+        *p++ = ',';
+    }
+    slot->len = p - slot->buf;
+    slot->count++;
+    if (qos > slot->qos) {
+        slot->qos = qos;
+    }
+}
+
+static void lwlte_mqtt_batch_task(void *pvParameters)
+{
+    lwlte_mqtt_batch_context_t* b = (lwlte_mqtt_batch_context_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_mqtt_batch_task starts.");
+    lwlte_base_type_t wait_ms = LWLTE_MQTT_BATCH_IDLE_WAIT_MS;
+    while (!b->stop) {
+        lwlte_sys_semaphore_wait(b->wake, wait_ms);
+        if (b->stop) {
+            break;
+        }
+        /* Flush the batches at the end of their window, and wait for the next end */
+        wait_ms = LWLTE_MQTT_BATCH_IDLE_WAIT_MS;
+        lwlte_mqtt_batch_slot_t due[LWLTE_MQTT_BATCH_MAX_TOPICS];
+        int due_count = 0;
+        lwlte_sys_mutex_lock(b->lock);
+        for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS; i++) {
+            lwlte_mqtt_batch_slot_t* slot = &b->slots[i];
+            if (slot->topic == NULL) {
+                continue;
+            }
+            int32_t remaining_ms = (int32_t)(slot->deadline_ms - lwlte_sys_time_get_ms());
+            if (remaining_ms <= 0) {
+                lwlte_mqtt_batch_detach(slot, &due[due_count++]);
+            }
+            else if (remaining_ms < wait_ms) {
+                wait_ms = remaining_ms;
+            }
+        }
+        lwlte_sys_mutex_unlock(b->lock);
+        /* A batch kept after a failed flush runs for one more window */
+        if (lwlte_mqtt_batch_flush_detached(b, due, due_count) != LWLTE_OK && b->window_ms < wait_ms) {
+            wait_ms = b->window_ms;
+        }
+    }
+    LWLTE_LOGI(TAG, "lwlte_mqtt_batch_task exits.");
+    /* Must be the last access to the context, lwlte_mqtt_batch_delete frees it once this is given */
+    lwlte_sys_semaphore_signal(b->exited);
+}
+
+lwlte_mqtt_batch_t lwlte_mqtt_batch_create(const lwlte_mqtt_client_config_t* config, lwlte_mqtt_batch_flush_fn_t flush, void* ctx)
+{
+    if (config == NULL || flush == NULL || config->batch_t.window_ms <= 0) {
+        return NULL;
+    }
+    lwlte_mqtt_batch_context_t* b = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_batch_context_t));
+    if (b == NULL) {
+        return NULL;
+    }
+    memset(b, 0, sizeof(lwlte_mqtt_batch_context_t));
+    /* Fill in the defaults */
+    b->window_ms = config->batch_t.window_ms;
+    b->max_bytes = config->batch_t.max_bytes > 0 ? config->batch_t.max_bytes : LWLTE_MQTT_BATCH_MAX_BYTES;
+    b->max_count = config->batch_t.max_count > 0 ? config->batch_t.max_count : LWLTE_MQTT_BATCH_MAX_COUNT;
+    b->flush_qos = (config->batch_t.flush_qos >= 0 && config->batch_t.flush_qos <= 2) ?
+        config->batch_t.flush_qos : LWLTE_MQTT_BATCH_FLUSH_QOS;
+    b->format = config->batch_t.format;
+    b->flush = flush;
+    b->flush_ctx = ctx;
+    b->lock = lwlte_sys_mutex_create();
+    b->wake = lwlte_sys_semaphore_create();
+    b->exited = lwlte_sys_semaphore_create();
+    if (b->lock == NULL || b->wake == NULL || b->exited == NULL) {
+        lwlte_mqtt_batch_delete(b);
+        return NULL;
+    }
+    /* Create the batch task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->batch_t.task, "lwlte_mqtt_batch_task", LWLTE_MQTT_BATCH_TASK_STACK_SIZE, 
+        LWLTE_MQTT_BATCH_TASK_PRIORITY, b);
+    b->thread_handle = lwlte_sys_thread_create(lwlte_mqtt_batch_task, &thread_config);
+    if (b->thread_handle == NULL) {
+        lwlte_mqtt_batch_delete(b);
+        return NULL;
+    }
+    return b;
+}
+
+void lwlte_mqtt_batch_delete(lwlte_mqtt_batch_t batch)
+{
+    lwlte_mqtt_batch_context_t* b = (lwlte_mqtt_batch_context_t*)batch;
+    if (b == NULL) {
+        return;
+    }
+    if (b->thread_handle != NULL) {
+        b->stop = true;
+        lwlte_sys_semaphore_signal(b->wake);
+        if (!lwlte_sys_semaphore_wait(b->exited, LWLTE_MQTT_BATCH_STOP_TIMEOUT_MS)) {
+            /* The task still uses the context, leak it rather than free it under the task */
+            LWLTE_LOGE(TAG, "lwlte_mqtt_batch_task did not stop in time.");
+            return;
+        }
+        b->thread_handle = NULL;
+    }
+    /* The open batches are sent, a batch that cannot be queued any more is lost */
+    lwlte_mqtt_batch_flush(b);
+    for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS; i++) {
+        lwlte_mqtt_batch_slot_free(&b->slots[i]);
+    }
+    lwlte_sys_mutex_delete(b->lock);
+    lwlte_sys_semaphore_delete(b->wake);
+    lwlte_sys_semaphore_delete(b->exited);
+    lwlte_sys_mem_free(b);
+}
+
+lwlte_err_t lwlte_mqtt_batch_add(lwlte_mqtt_batch_t batch, const char* topic, const char* payload, size_t payload_len,
+    lwlte_base_type_t qos, bool retain)
+{
+    lwlte_mqtt_batch_context_t* b = (lwlte_mqtt_batch_context_t*)batch;
+    if (b == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (topic == NULL || payload == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* The batches taken out of the table, flushed in this order once the lock is released */
+    lwlte_mqtt_batch_slot_t detached[3];
+    int detached_count = 0;
+    lwlte_err_t err = LWLTE_OK;
+    lwlte_sys_mutex_lock(b->lock);
+    lwlte_mqtt_batch_slot_t* slot = lwlte_mqtt_batch_find(b, topic);
+    lwlte_mqtt_batch_slot_t empty = { 0 };
+    /* Priority, retained and oversized publishes go out at once, after what was batched before them */
+    if (qos >= b->flush_qos || retain || !lwlte_mqtt_batch_fits(b, &empty, payload_len)) {
+        if (slot != NULL) {
+            lwlte_mqtt_batch_detach(slot, &detached[detached_count++]);
+        }
+        lwlte_sys_mutex_unlock(b->lock);
+        err = lwlte_mqtt_batch_flush_detached(b, detached, detached_count);
+        if (err == LWLTE_OK) {
+            err = b->flush(topic, payload, payload_len, qos, retain, b->flush_ctx);
+        }
+        return err;
+    }
+    /* A batch that cannot take the publish is flushed first */
+    if (slot != NULL && !lwlte_mqtt_batch_fits(b, slot, payload_len)) {
+        lwlte_mqtt_batch_detach(slot, &detached[detached_count++]);
+        slot = NULL;
+    }
+    bool opened = false;
+    if (slot == NULL) {
+        detached[detached_count].topic = NULL;
+        err = lwlte_mqtt_batch_open(b, topic, &slot, &detached[detached_count]);
+        if (detached[detached_count].topic != NULL) {
+            detached_count++;
+        }
+        opened = (err == LWLTE_OK);
+    }
+    if (err == LWLTE_OK) {
+        lwlte_mqtt_batch_append(b, slot, payload, payload_len, qos);
+        /* A full batch is sent now, if it cannot be queued the task retries at the end of the next window */
+        if (slot->count >= b->max_count) {
+            lwlte_mqtt_batch_detach(slot, &detached[detached_count++]);
+        }
+    }
+    lwlte_sys_mutex_unlock(b->lock);
+    /* A batch that could not be queued is kept for the next window, the publish itself was taken */
+    lwlte_mqtt_batch_flush_detached(b, detached, detached_count);
+    if (opened) {
+        lwlte_sys_semaphore_signal(b->wake);
+    }
+    return err;
+}
+
+lwlte_err_t lwlte_mqtt_batch_flush(lwlte_mqtt_batch_t batch)
+{
+    lwlte_mqtt_batch_context_t* b = (lwlte_mqtt_batch_context_t*)batch;
+    if (b == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    lwlte_mqtt_batch_slot_t detached[LWLTE_MQTT_BATCH_MAX_TOPICS];
+    int detached_count = 0;
+    lwlte_sys_mutex_lock(b->lock);
+    for (int i = 0; i < LWLTE_MQTT_BATCH_MAX_TOPICS; i++) {
+        if (b->slots[i].topic != NULL) {
+            lwlte_mqtt_batch_detach(&b->slots[i], &detached[detached_count++]);
+        }
+    }
+    lwlte_sys_mutex_unlock(b->lock);
+    return lwlte_mqtt_batch_flush_detached(b, detached, detached_count);
+}
@@ -15,74 +15,709 @@
 #include "lwlte_sys_thread.h"
 #include "lwlte_sys_flags.h"
 #include "lwlte_sys_mem.h"
+#include "lwlte_mqtt_pipeline.h"
+#include "lwlte_mqtt_outbox.h"
+#include "lwlte_mqtt_router.h"
+#include "lwlte_mqtt_batch.h"
+#include "lwlte_mqtt_reconnect.h"
+#include "lwlte_at_builder.h"
+#include "lwlte_tls.h"
 #include <stddef.h>
 #include <string.h>
 
-#define AT_CMD_MAX_LENGTH 100
+/* The broker answers through the module, CONNECT OK and CONNACK OK can take a while on a slow link */
+#define LWLTE_MQTT_CLIENT_CONNECT_TIMEOUT_MS 15000
+#define LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS 10000
+/* Payloads from this size go after the '>' prompt of AT+MPUBEX instead of being quoted in AT+MPUB */
+#define LWLTE_MQTT_CLIENT_PROMPT_THRESHOLD 256
+/* Wait of lwlte_mqtt_client_publish_internal for a free pipeline slot */
+#define LWLTE_MQTT_CLIENT_PUBLISH_WAIT_MS 10000
+#define LWLTE_MQTT_CLIENT_DEFAULT_CLEAN_SESSION 1
+/* A client that reconnects by itself resumes a persistent session by default */
+#define LWLTE_MQTT_CLIENT_RECONNECT_CLEAN_SESSION 0
+/* AT+CDNSGIP reports no TTL, the broker address is resolved again after this long */
+#define LWLTE_MQTT_CLIENT_DEFAULT_DNS_TTL_MS 600000
+/* Longest dotted IPv4 address */
+#define LWLTE_MQTT_CLIENT_IP_MAX_LENGTH 15
+#define LWLTE_MQTT_CLIENT_DEFAULT_KEEPALIVE 60
+#define LWLTE_MQTT_CLIENT_DEFAULT_SUB_QOS 0
+/* +MQTTSTATU state of a session authenticated by the broker */
+#define LWLTE_MQTT_STATE_CONNECTED 1
+/* AT+SSLMIPSTART takes no context, the MQTT connection of the module runs on SSL context 0 */
+#define LWLTE_MQTT_CLIENT_SSL_CTX_ID 0
 
 static const char* TAG = "lwlte_mqtt_client";
 
-static struct {
+/* A subscription kept by the client, the topic follows the node in the same block */
+typedef struct lwlte_mqtt_client_sub_s {
+    struct lwlte_mqtt_client_sub_s* next;
+    bool active; // acknowledged on the current session
+    char topic[];
+} lwlte_mqtt_client_sub_t;
+
+/* Broker address resolved by AT+CDNSGIP */
+typedef struct {
+    char ip[LWLTE_MQTT_CLIENT_IP_MAX_LENGTH + 1];
+    lwlte_tick_t expires_ms;
+    bool valid;
+} lwlte_mqtt_client_dns_t;
+
+struct lwlte_mqtt_client_s {
+    lwlte_core_t* core; // the module the client talks through
     lwlte_mqtt_client_config_t config;
     lwlte_sys_flags_t flags;
+    lwlte_mqtt_pipeline_t pipeline; // outbound publishes
+    lwlte_mqtt_outbox_t outbox; // persistent log in front of the pipeline, NULL without storage
+    lwlte_mqtt_router_t router; // incoming messages by topic filter
+    lwlte_mqtt_batch_t batch; // coalesces the small publishes, NULL without a batching window
+    lwlte_at_builder_t pub_cmd; // AT+MPUB with its head written once, used by the pipeline task only
+    lwlte_at_builder_t pubex_cmd; // AT+MPUBEX likewise, its payload follows the prompt
+    char* host_cmd; // AT+CDNSGIP and AT+(SSL)MIPSTART, sized at init for the broker host or its address
+    size_t host_cmd_size;
+    char* mconnect_cmd; // built at init, it only depends on the config
+    char* config_strings; // the strings of the config, copied into one block
+    int32_t clean_session; // with the default filled in
+    lwlte_mqtt_reconnect_t reconnect; // reopens a lost session, NULL unless reconnect_t.enable
+    lwlte_sys_mutex_t session_lock; // serializes the session commands, guards the fields below
+    lwlte_mqtt_client_sub_t* subs; // restored on a new session
+    bool wanted; // between lwlte_mqtt_client_connect_internal and lwlte_mqtt_client_disconnect_internal
+    bool online; // the session was opened and not closed since, it may have been lost meanwhile
+    lwlte_mqtt_client_dns_t dns;
+    lwlte_mqtt_reconnect_stats_t session_stats; // the DNS and subscription counters
+    volatile uint32_t rx_count; // messages delivered, wraps around
+    volatile lwlte_sys_flags_t watcher; // woken on a delivery, see lwlte_mqtt_client_set_watcher_internal
+};
 
-} s_lwlte_mqtt_client_context;
-
-static char* lwlte_string_dup(const char* str)
+/* Copy a string of the config to the string block, which was sized for all of them */
+static const char* lwlte_mqtt_client_pack_string(char** cursor, const char* str)
 {
     if (str == NULL) {
         return NULL;
     }
-    char* new_str = lwlte_sys_mem_malloc(strlen(str) + 1);
-    strcpy(new_str, str);
-    return new_str;
+    size_t size = strlen(str) + 1;
+    char* copy = *cursor;
+    memcpy(copy, str, size);
+    *cursor += size;
+    return copy;
 }
 
-static lwlte_err_t lwlte_mqtt_client_config_copy(const lwlte_mqtt_client_config_t *config)
+/* The quoted AT+M* arguments cannot carry a quote or a line break */
+static bool lwlte_mqtt_client_check_text(const char* text, size_t len)
 {
-    /* Deep copy the client_t */
-    if (config->client_t.client_id != NULL) {
-        s_lwlte_mqtt_client_context.config.client_t.client_id = lwlte_string_dup(config->client_t.client_id);
+    if (text == NULL || len == 0) {
+        return false;
     }
-    if (config->client_t.username != NULL) {
-        s_lwlte_mqtt_client_context.config.client_t.username = lwlte_string_dup(config->client_t.username);
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '"' || text[i] == '\r' || text[i] == '\n' || text[i] == '\0') {
+            return false;
+        }
     }
-    if (config->client_t.password != NULL) {
-        s_lwlte_mqtt_client_context.config.client_t.password = lwlte_string_dup(config->client_t.password);
+    return true;
+}
+
+/* True unless the module reports the session down, a status that cannot be read counts as up */
+static bool lwlte_mqtt_client_session_up(lwlte_mqtt_client_t* client)
+{
+    lwlte_at_field_t fields[1];
+    if (lwlte_core_send_at_cmd_parse_internal(client->core, AT_MQTTSTATU, "OK", "ERROR", 
+        LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, LWLTE_AT_SCHEMA_MQTTSTATU, fields, 1) != LWLTE_OK) {
+        return true;
     }
-    if (config->client_t.will_qos != LWLTE_MQTT_CFG_UNSET_INT) {
-        s_lwlte_mqtt_client_context.config.client_t.will_qos = config->client_t.will_qos;
+    return fields[0].v.i == LWLTE_MQTT_STATE_CONNECTED;
+}
+
+/* Make room for a publish command of this size, the head is written again in a new buffer */
+static lwlte_err_t lwlte_mqtt_client_reserve_cmd(lwlte_at_builder_t* cmd, const char* head, size_t size)
+{
+    if (size <= cmd->size) {
+        return LWLTE_OK;
     }
-    if (config->client_t.will_retain != LWLTE_MQTT_CFG_UNSET_INT) {
-        s_lwlte_mqtt_client_context.config.client_t.will_retain = config->client_t.will_retain;
+    char* buf = lwlte_sys_mem_malloc(size);
+    if (buf == NULL) {
+        return LWLTE_ERROR;
     }
-    if (config->client_t.will_topic != NULL) {
-        s_lwlte_mqtt_client_context.config.client_t.will_topic = lwlte_string_dup(config->client_t.will_topic);
+    lwlte_sys_mem_free(cmd->buf);
+    lwlte_at_builder_init(cmd, buf, size);
+    lwlte_at_builder_str(cmd, head);
+    return LWLTE_OK;
+}
+
+/* Send one publish for the pipeline, called from the pipeline task */
+static lwlte_err_t lwlte_mqtt_client_send_publish(const lwlte_mqtt_pipeline_msg_t* msg, void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    size_t topic_len = strlen(msg->topic);
+    lwlte_err_t err;
+    /* A large or binary payload is streamed as it is after the prompt */
+    if (msg->payload_len >= LWLTE_MQTT_CLIENT_PROMPT_THRESHOLD || 
+        !lwlte_mqtt_client_check_text(msg->payload, msg->payload_len)) {
+        if (lwlte_mqtt_client_reserve_cmd(&client->pubex_cmd, AT_MPUBEX, 
+            lwlte_at_builder_size(AT_MPUBEX, topic_len, 3, 1)) != LWLTE_OK) {
+            return LWLTE_ERROR;
+        }
+        lwlte_at_builder_t* b = &client->pubex_cmd;
+        lwlte_at_builder_rewind(b, strlen(AT_MPUBEX));
+        lwlte_at_builder_quoted(b, msg->topic, topic_len);
+        lwlte_at_builder_char(b, ',');
+        lwlte_at_builder_int(b, msg->qos);
+        lwlte_at_builder_raw(b, msg->retain ? ",1," : ",0,", 3);
+        lwlte_at_builder_int(b, (int32_t)msg->payload_len);
+        if (lwlte_at_builder_end(b) != LWLTE_OK) {
+            return LWLTE_INVALID_ARG;
+        }
+        lwlte_core_iovec_t iov = { .base = msg->payload, .len = msg->payload_len };
+        err = lwlte_core_send_at_cmd_prompt_internal(client->core, b->buf, &iov, 1, "OK", "ERROR", 
+            msg->ack_timeout_ms, NULL, 0);
+    }
+    else {
+        if (lwlte_mqtt_client_reserve_cmd(&client->pub_cmd, AT_MPUB, 
+            lwlte_at_builder_size(AT_MPUB, topic_len + msg->payload_len, 2, 2)) != LWLTE_OK) {
+            return LWLTE_ERROR;
+        }
+        /* Only the fields of the message are written after the head */
+        lwlte_at_builder_t* b = &client->pub_cmd;
+        lwlte_at_builder_rewind(b, strlen(AT_MPUB));
+        lwlte_at_builder_quoted(b, msg->topic, topic_len);
+        lwlte_at_builder_char(b, ',');
+        lwlte_at_builder_int(b, msg->qos);
+        lwlte_at_builder_raw(b, msg->retain ? ",1," : ",0,", 3);
+        lwlte_at_builder_quoted(b, msg->payload, msg->payload_len);
+        if (lwlte_at_builder_end(b) != LWLTE_OK) {
+            return LWLTE_INVALID_ARG;
+        }
+        err = lwlte_core_send_at_cmd_internal(client->core, b->buf, "OK", "ERROR", 
+            msg->ack_timeout_ms, NULL, 0);
+    }
+    /* A lost session holds the pipeline instead of burning the retries */
+    if (err != LWLTE_OK && !lwlte_mqtt_client_session_up(client)) {
+        LWLTE_LOGW(TAG, "MQTT session is down, publishing is on hold.");
+        lwlte_mqtt_pipeline_set_online(client->pipeline, false);
+        lwlte_mqtt_reconnect_notify_lost(client->reconnect);
+    }
+    return err;
+}
+
+/**
+ * Parse the header of +MSUB: "<topic>",<len> byte,<payload>
+ * @return The offset of the payload, 0 if the header is malformed
+ */
+static size_t lwlte_mqtt_client_parse_msub(const char* data, size_t size, const char** topic, size_t* topic_len, 
+    size_t* payload_len)
+{
+    const char* end = data + size;
+    const char* p = data + strlen(URC_MSUB);
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    if (p >= end || *p != '"') {
+        return 0;
+    }
+    *topic = ++p;
+    while (p < end && *p != '"') {
+        p++;
+    }
+    *topic_len = p - *topic;
+    if (p + 1 >= end || p[1] != ',' || *topic_len == 0) {
+        return 0;
+    }
+    p += 2;
+    const char* digits = p;
+    *payload_len = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        *payload_len = *payload_len * 10 + (*p - '0');
+        p++;
+    }
+    size_t suffix_len = strlen(URC_MSUB_LEN_SUFFIX);
+    if (p == digits || (size_t)(end - p) < suffix_len || memcmp(p, URC_MSUB_LEN_SUFFIX, suffix_len) != 0) {
+        return 0;
+    }
+    return p + suffix_len - data;
+}
+
+/* The core URC handler of the client, the payload is delivered in place */
+static size_t lwlte_mqtt_client_msub_urc(const char* data, size_t size, void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    const char* topic = NULL;
+    size_t topic_len = 0;
+    size_t payload_len = 0;
+    size_t header_len = lwlte_mqtt_client_parse_msub(data, size, &topic, &topic_len, &payload_len);
+    if (header_len == 0) {
+        LWLTE_LOGW(TAG, "Malformed MSUB: %.*s", (int)size, data);
+        return 0;
     }
-    if (config->client_t.will_message != NULL) {
-        s_lwlte_mqtt_client_context.config.client_t.will_message = lwlte_string_dup(config->client_t.will_message);
+    /* The payload may hold line breaks, ask the core for the rest of it */
+    if (size < header_len + payload_len) {
+        return header_len + payload_len - size;
     }
-    /* Deep copy the broker_t */
-    if (config->broker_t.uri != NULL) {
-        s_lwlte_mqtt_client_context.config.broker_t.uri = lwlte_string_dup(config->broker_t.uri);
+    lwlte_mqtt_router_dispatch(client->router, topic, topic_len, data + header_len, payload_len);
+    /* Only the core worker writes it */
+    client->rx_count++;
+    lwlte_sys_flags_t watcher = client->watcher;
+    if (watcher != NULL) {
+        lwlte_sys_flags_set(watcher, LWLTE_CORE_WATCHER_WAKE);
+    }
+    return 0;
+}
+
+/* The outbox feeds the pipeline, called from the pipeline task */
+static bool lwlte_mqtt_client_feed_outbox(void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    return lwlte_mqtt_outbox_feed(client->outbox, client->pipeline);
+}
+
+/* Pipeline completions go through the outbox, which reports them with the record IDs */
+static void lwlte_mqtt_client_outbox_publish_cb(lwlte_base_type_t msg_id, lwlte_mqtt_msg_status_t status, void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    lwlte_mqtt_outbox_complete(client->outbox, status);
+}
+
+/* Queue a publish in the outbox or the pipeline */
+static lwlte_err_t lwlte_mqtt_client_enqueue(lwlte_mqtt_client_t* client, const char* topic, const char* payload, 
+    size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    if (client->outbox == NULL) {
+        return lwlte_mqtt_pipeline_submit(client->pipeline, topic, payload, payload_len, qos, retain, wait_ms, msg_id);
+    }
+    lwlte_err_t err = lwlte_mqtt_outbox_append(client->outbox, topic, payload, payload_len, qos, retain, wait_ms, msg_id);
+    if (err == LWLTE_OK) {
+        lwlte_mqtt_pipeline_wake(client->pipeline);
+    }
+    return err;
+}
+
+/* A flushed batch, called by the batching stage after it released its lock, so the enqueue may block */
+static lwlte_err_t lwlte_mqtt_client_flush_batch(const char* topic, const char* payload, size_t payload_len, 
+    lwlte_base_type_t qos, bool retain, void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    return lwlte_mqtt_client_enqueue(client, topic, payload, payload_len, qos, retain, 
+        LWLTE_MQTT_CLIENT_PUBLISH_WAIT_MS, NULL);
+}
+
+/* Create the pipeline, behind the outbox when a storage is configured */
+static lwlte_err_t lwlte_mqtt_client_create_pipeline(lwlte_mqtt_client_t* client)
+{
+    if (client->config.outbox_t.storage == NULL) {
+        client->pipeline = lwlte_mqtt_pipeline_create(&client->config, lwlte_mqtt_client_send_publish, client);
+        return client->pipeline != NULL ? LWLTE_OK : LWLTE_ERROR;
+    }
+    lwlte_mqtt_client_config_t pipeline_config = client->config;
+    pipeline_config.pipeline_t.on_publish = lwlte_mqtt_client_outbox_publish_cb;
+    pipeline_config.pipeline_t.ctx = client;
+    client->pipeline = lwlte_mqtt_pipeline_create(&pipeline_config, lwlte_mqtt_client_send_publish, client);
+    if (client->pipeline == NULL) {
+        return LWLTE_ERROR;
+    }
+    client->outbox = lwlte_mqtt_outbox_create(&client->config, lwlte_mqtt_pipeline_get_capacity(client->pipeline));
+    if (client->outbox == NULL) {
+        lwlte_mqtt_pipeline_delete(client->pipeline);
+        client->pipeline = NULL;
+        return LWLTE_ERROR;
+    }
+    lwlte_mqtt_pipeline_set_source(client->pipeline, lwlte_mqtt_client_feed_outbox, client);
+    return LWLTE_OK;
+}
+
+static void lwlte_mqtt_client_free_config_strings(lwlte_mqtt_client_t* client)
+{
+    lwlte_sys_mem_free(client->config_strings);
+    client->config_strings = NULL;
+    client->config.client_t.client_id = NULL;
+    client->config.client_t.username = NULL;
+    client->config.client_t.password = NULL;
+    client->config.client_t.will_topic = NULL;
+    client->config.client_t.will_message = NULL;
+    client->config.broker_t.uri = NULL;
+}
+
+static lwlte_err_t lwlte_mqtt_client_config_copy(lwlte_mqtt_client_t* client, const lwlte_mqtt_client_config_t *config)
+{
+    /* Deep copy the strings into one block, instead of one allocation each */
+    const char* strings[] = {
+        config->client_t.client_id, config->client_t.username, config->client_t.password, 
+        config->client_t.will_topic, config->client_t.will_message, config->broker_t.uri, 
+    };
+    size_t size = 0;
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        size += (strings[i] != NULL) ? strlen(strings[i]) + 1 : 0;
+    }
+    lwlte_mqtt_client_free_config_strings(client);
+    client->config_strings = lwlte_sys_mem_malloc(size);
+    if (client->config_strings == NULL) {
+        return LWLTE_ERROR;
+    }
+    char* cursor = client->config_strings;
+    client->config.client_t.client_id = lwlte_mqtt_client_pack_string(&cursor, config->client_t.client_id);
+    client->config.client_t.username = lwlte_mqtt_client_pack_string(&cursor, config->client_t.username);
+    client->config.client_t.password = lwlte_mqtt_client_pack_string(&cursor, config->client_t.password);
+    client->config.client_t.will_topic = lwlte_mqtt_client_pack_string(&cursor, config->client_t.will_topic);
+    client->config.client_t.will_message = lwlte_mqtt_client_pack_string(&cursor, config->client_t.will_message);
+    client->config.broker_t.uri = lwlte_mqtt_client_pack_string(&cursor, config->broker_t.uri);
+    /* The integers, the unset ones keep their defaults */
+    if (config->client_t.will_qos != LWLTE_MQTT_CFG_UNSET_INT) {
+        client->config.client_t.will_qos = config->client_t.will_qos;
+    }
+    if (config->client_t.will_retain != LWLTE_MQTT_CFG_UNSET_INT) {
+        client->config.client_t.will_retain = config->client_t.will_retain;
     }
     if (config->broker_t.port != LWLTE_MQTT_CFG_UNSET_INT) {
-        s_lwlte_mqtt_client_context.config.broker_t.port = config->broker_t.port;
+        client->config.broker_t.port = config->broker_t.port;
     }
     if (config->broker_t.clean_session != LWLTE_MQTT_CFG_UNSET_INT) {
-        s_lwlte_mqtt_client_context.config.broker_t.clean_session = config->broker_t.clean_session;
+        client->config.broker_t.clean_session = config->broker_t.clean_session;
     }
     if (config->broker_t.keepalive != LWLTE_MQTT_CFG_UNSET_INT) {
-        s_lwlte_mqtt_client_context.config.broker_t.keepalive = config->broker_t.keepalive;
+        client->config.broker_t.keepalive = config->broker_t.keepalive;
+    }
+    /* The pipeline, pool, outbox and batch configs hold no string */
+    client->config.pipeline_t = config->pipeline_t;
+    client->config.pool_t = config->pool_t;
+    client->config.outbox_t = config->outbox_t;
+    client->config.batch_t = config->batch_t;
+    client->config.reconnect_t = config->reconnect_t;
+    /* The certificates are uploaded by the init, only the context is kept */
+    client->config.tls_t = config->tls_t;
+    memset(&client->config.tls_t.ca_cert, 0, sizeof(lwlte_tls_file_t));
+    memset(&client->config.tls_t.client_cert, 0, sizeof(lwlte_tls_file_t));
+    memset(&client->config.tls_t.client_key, 0, sizeof(lwlte_tls_file_t));
+    /* A broker session cannot be resumed unless it persists */
+    if (client->config.broker_t.clean_session != LWLTE_MQTT_CFG_UNSET_INT) {
+        client->clean_session = client->config.broker_t.clean_session;
+    }
+    else {
+        client->clean_session = client->config.reconnect_t.enable ? 
+            LWLTE_MQTT_CLIENT_RECONNECT_CLEAN_SESSION : LWLTE_MQTT_CLIENT_DEFAULT_CLEAN_SESSION;
+    }
+    return LWLTE_OK;
+}
+
+/* Build AT+MCONFIG in a buffer of its exact size, NULL if a field cannot be quoted */
+static char* lwlte_mqtt_client_build_config_cmd(lwlte_mqtt_client_t* client)
+{
+    const char* username = client->config.client_t.username == NULL ? "" : client->config.client_t.username;
+    const char* password = client->config.client_t.password == NULL ? "" : client->config.client_t.password;
+    bool has_will = client->config.client_t.will_topic != NULL && client->config.client_t.will_topic[0] != '\0' &&
+    client->config.client_t.will_message != NULL && client->config.client_t.will_message[0] != '\0' &&
+    client->config.client_t.will_qos != LWLTE_MQTT_CFG_UNSET_INT &&
+    client->config.client_t.will_retain != LWLTE_MQTT_CFG_UNSET_INT;
+    size_t text_len = strlen(client->config.client_t.client_id) + strlen(username) + strlen(password);
+    if (has_will) {
+        text_len += strlen(client->config.client_t.will_topic) + strlen(client->config.client_t.will_message);
+    }
+    size_t size = lwlte_at_builder_size(AT_MCONFIG, text_len, has_will ? 2 : 0, has_will ? 5 : 3);
+    char* buf = lwlte_sys_mem_malloc(size);
+    if (buf == NULL) {
+        return NULL;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, size);
+    lwlte_at_builder_str(&b, AT_MCONFIG);
+    lwlte_at_builder_quoted(&b, client->config.client_t.client_id, strlen(client->config.client_t.client_id));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_quoted(&b, username, strlen(username));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_quoted(&b, password, strlen(password));
+    if (has_will) {
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_int(&b, client->config.client_t.will_qos);
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_int(&b, client->config.client_t.will_retain);
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_quoted(&b, client->config.client_t.will_topic, strlen(client->config.client_t.will_topic));
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_quoted(&b, client->config.client_t.will_message, strlen(client->config.client_t.will_message));
+    }
+    if (lwlte_at_builder_end(&b) != LWLTE_OK) {
+        lwlte_sys_mem_free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/* Build a command of integer arguments in a new buffer of its exact size */
+static char* lwlte_mqtt_client_build_int_cmd(const char* head, const int32_t* values, size_t count)
+{
+    size_t size = lwlte_at_builder_size(head, 0, count, 0);
+    char* buf = lwlte_sys_mem_malloc(size);
+    if (buf == NULL) {
+        return NULL;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, buf, size);
+    lwlte_at_builder_str(&b, head);
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            lwlte_at_builder_char(&b, ',');
+        }
+        lwlte_at_builder_int(&b, values[i]);
+    }
+    lwlte_at_builder_end(&b);
+    return buf;
+}
+
+static void lwlte_mqtt_client_free_connect_cmds(lwlte_mqtt_client_t* client)
+{
+    lwlte_sys_mem_free(client->host_cmd);
+    lwlte_sys_mem_free(client->mconnect_cmd);
+    client->host_cmd = NULL;
+    client->host_cmd_size = 0;
+    client->mconnect_cmd = NULL;
+}
+
+/* Build AT+MCONNECT, sent as it is on every connect, and size the buffer of AT+CDNSGIP and AT+(SSL)MIPSTART */
+static lwlte_err_t lwlte_mqtt_client_build_connect_cmds(lwlte_mqtt_client_t* client)
+{
+    lwlte_mqtt_client_free_connect_cmds(client);
+    size_t host_len = strlen(client->config.broker_t.uri);
+    if (host_len < LWLTE_MQTT_CLIENT_IP_MAX_LENGTH) {
+        host_len = LWLTE_MQTT_CLIENT_IP_MAX_LENGTH;
+    }
+    size_t mipstart_size = lwlte_at_builder_size(AT_SSLMIPSTART, host_len, 1, 1);
+    size_t cdnsgip_size = lwlte_at_builder_size(AT_CDNSGIP, host_len, 0, 1);
+    client->host_cmd_size = mipstart_size > cdnsgip_size ? mipstart_size : cdnsgip_size;
+    client->host_cmd = lwlte_sys_mem_malloc(client->host_cmd_size);
+    int32_t session[2] = {
+        client->clean_session, 
+        client->config.broker_t.keepalive == LWLTE_MQTT_CFG_UNSET_INT ? 
+            LWLTE_MQTT_CLIENT_DEFAULT_KEEPALIVE : client->config.broker_t.keepalive, 
+    };
+    client->mconnect_cmd = lwlte_mqtt_client_build_int_cmd(AT_MCONNECT, session, 2);
+    if (client->host_cmd == NULL || client->mconnect_cmd == NULL) {
+        lwlte_mqtt_client_free_connect_cmds(client);
+        return LWLTE_ERROR;
     }
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_mqtt_client_init_internal(const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms)
+/* A dotted IPv4 address needs no lookup */
+static bool lwlte_mqtt_client_is_ip(const char* host)
+{
+    size_t dots = 0;
+    for (const char* p = host; *p != '\0'; p++) {
+        if (*p == '.') {
+            dots++;
+        }
+        else if (*p < '0' || *p > '9') {
+            return false;
+        }
+    }
+    return dots == 3;
+}
+
+/**
+ * The host to open the TCP connection to, the cached broker address while it is fresh.
+ * The module resolves the name itself when the lookup fails. Called with the session lock held.
+ */
+static const char* lwlte_mqtt_client_resolve_locked(lwlte_mqtt_client_t* client)
+{
+    const char* uri = client->config.broker_t.uri;
+    if (client->reconnect == NULL || lwlte_mqtt_client_is_ip(uri)) {
+        return uri;
+    }
+    lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+    if (client->dns.valid && (int32_t)(client->dns.expires_ms - now_ms) > 0) {
+        client->session_stats.dns_cache_hits++;
+        return client->dns.ip;
+    }
+    client->dns.valid = false;
+    client->session_stats.dns_lookups++;
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, client->host_cmd, client->host_cmd_size);
+    lwlte_at_builder_str(&b, AT_CDNSGIP);
+    lwlte_at_builder_quoted(&b, uri, strlen(uri));
+    lwlte_at_field_t fields[3];
+    /* The result comes after OK */
+    if (lwlte_at_builder_end(&b) != LWLTE_OK || 
+        lwlte_core_send_at_cmd_parse_internal(client->core, client->host_cmd, "+CDNSGIP:", "ERROR", 
+        LWLTE_MQTT_CLIENT_CONNECT_TIMEOUT_MS, LWLTE_AT_SCHEMA_CDNSGIP, fields, 3) != LWLTE_OK || 
+        fields[0].v.i != 1) {
+        LWLTE_LOGW(TAG, "Failed to resolve %s, the module resolves it on connect.", uri);
+        return uri;
+    }
+    memcpy(client->dns.ip, fields[2].s.ptr, fields[2].s.len);
+    client->dns.ip[fields[2].s.len] = '\0';
+    lwlte_base_type_t ttl_ms = client->config.reconnect_t.dns_ttl_ms > 0 ? 
+        client->config.reconnect_t.dns_ttl_ms : LWLTE_MQTT_CLIENT_DEFAULT_DNS_TTL_MS;
+    client->dns.expires_ms = now_ms + ttl_ms;
+    client->dns.valid = true;
+    return client->dns.ip;
+}
+
+static lwlte_err_t lwlte_mqtt_client_send_subscribe(lwlte_mqtt_client_t* client, const char* topic)
+{
+    size_t size = lwlte_at_builder_size(AT_MSUB, strlen(topic), 1, 1);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return LWLTE_ERROR;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, AT_MSUB);
+    lwlte_at_builder_quoted(&b, topic, strlen(topic));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, LWLTE_MQTT_CLIENT_DEFAULT_SUB_QOS);
+    lwlte_err_t err = LWLTE_INVALID_ARG;
+    if (lwlte_at_builder_end(&b) == LWLTE_OK) {
+        err = lwlte_core_send_at_cmd_internal(client->core, cmd, "SUBACK", "ERROR", 
+            LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+    }
+    lwlte_sys_mem_free(cmd);
+    return err;
+}
+
+static lwlte_err_t lwlte_mqtt_client_send_unsubscribe(lwlte_mqtt_client_t* client, const char* topic)
+{
+    size_t size = lwlte_at_builder_size(AT_MUNSUB, strlen(topic), 0, 1);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return LWLTE_ERROR;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, AT_MUNSUB);
+    lwlte_at_builder_quoted(&b, topic, strlen(topic));
+    lwlte_err_t err = LWLTE_INVALID_ARG;
+    if (lwlte_at_builder_end(&b) == LWLTE_OK) {
+        err = lwlte_core_send_at_cmd_internal(client->core, cmd, "UNSUBACK", "ERROR", 
+            LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+    }
+    lwlte_sys_mem_free(cmd);
+    return err;
+}
+
+static lwlte_mqtt_client_sub_t* lwlte_mqtt_client_find_sub(lwlte_mqtt_client_t* client, const char* topic)
+{
+    for (lwlte_mqtt_client_sub_t* sub = client->subs; sub != NULL; sub = sub->next) {
+        if (strcmp(sub->topic, topic) == 0) {
+            return sub;
+        }
+    }
+    return NULL;
+}
+
+static void lwlte_mqtt_client_remove_sub(lwlte_mqtt_client_t* client, lwlte_mqtt_client_sub_t* sub)
+{
+    for (lwlte_mqtt_client_sub_t** p = &client->subs; *p != NULL; p = &(*p)->next) {
+        if (*p == sub) {
+            *p = sub->next;
+            lwlte_sys_mem_free(sub);
+            return;
+        }
+    }
+}
+
+static void lwlte_mqtt_client_free_subs(lwlte_mqtt_client_t* client)
+{
+    while (client->subs != NULL) {
+        lwlte_mqtt_client_sub_t* next = client->subs->next;
+        lwlte_sys_mem_free(client->subs);
+        client->subs = next;
+    }
+}
+
+/**
+ * Send the subscriptions not acknowledged on this session, all of them when the broker has no session to resume.
+ * One that fails stays inactive, it is sent again by the next probe of the reconnect task. Called with the session lock held.
+ */
+static void lwlte_mqtt_client_restore_subs_locked(lwlte_mqtt_client_t* client, bool resume)
+{
+    if (!resume && client->subs != NULL) {
+        client->session_stats.resubscribes++;
+    }
+    for (lwlte_mqtt_client_sub_t* sub = client->subs; sub != NULL; sub = sub->next) {
+        if (resume && sub->active) {
+            continue;
+        }
+        sub->active = lwlte_mqtt_client_send_subscribe(client, sub->topic) == LWLTE_OK;
+        if (!sub->active) {
+            LWLTE_LOGW(TAG, "Failed to restore the subscription to %s.", sub->topic);
+        }
+    }
+}
+
+/* Open the TCP connection and the session, then restore the subscriptions. Called with the session lock held */
+static lwlte_err_t lwlte_mqtt_client_connect_locked(lwlte_mqtt_client_t* client, bool resume)
+{
+    const char* host = lwlte_mqtt_client_resolve_locked(client);
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, client->host_cmd, client->host_cmd_size);
+    lwlte_at_builder_str(&b, client->config.tls_t.enable ? AT_SSLMIPSTART : AT_MIPSTART);
+    lwlte_at_builder_quoted(&b, host, strlen(host));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, client->config.broker_t.port);
+    if (lwlte_at_builder_end(&b) != LWLTE_OK) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* Open the TCP (or TLS) connection to the broker */
+    lwlte_err_t err = lwlte_core_send_at_cmd_internal(client->core, client->host_cmd, "CONNECT OK", "ERROR", 
+        LWLTE_MQTT_CLIENT_CONNECT_TIMEOUT_MS, NULL, 0);
+    if (err != LWLTE_OK) {
+        /* The broker may have moved, the next attempt resolves it again */
+        if (host == client->dns.ip) {
+            client->dns.valid = false;
+        }
+        LWLTE_LOGE(TAG, "Failed to connect to the MQTT broker!");
+        return err;
+    }
+    /* Open the MQTT session */
+    err = lwlte_core_send_at_cmd_internal(client->core, client->mconnect_cmd, "CONNACK OK", "ERROR", 
+        LWLTE_MQTT_CLIENT_CONNECT_TIMEOUT_MS, NULL, 0);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "MQTT broker refused the session!");
+        lwlte_core_send_at_cmd_internal(client->core, AT_MIPCLOSE, "OK", "ERROR", LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+        return err;
+    }
+    LWLTE_LOGI(TAG, "MQTT session is up.");
+    client->online = true;
+    lwlte_mqtt_client_restore_subs_locked(client, resume);
+    lwlte_mqtt_pipeline_set_online(client->pipeline, true);
+    return LWLTE_OK;
+}
+
+/* Open the lost session again, called from the reconnect task */
+static lwlte_err_t lwlte_mqtt_client_reconnect(lwlte_tick_t down_ms, void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    /* The CONNACK of the module carries no session present flag: a persistent session is only taken as kept
+       by the broker within the session_expiry_ms set by the user, otherwise all the subscriptions are sent again */
+    lwlte_base_type_t expiry_ms = client->config.reconnect_t.session_expiry_ms;
+    bool resume = client->clean_session == 0 && expiry_ms > 0 && down_ms <= (lwlte_tick_t)expiry_ms;
+    lwlte_sys_mutex_lock(client->session_lock);
+    /* Disconnected meanwhile */
+    if (!client->wanted) {
+        lwlte_sys_mutex_unlock(client->session_lock);
+        return LWLTE_ERROR;
+    }
+    /* The module may still hold the broken connection */
+    lwlte_mqtt_pipeline_set_online(client->pipeline, false);
+    client->online = false;
+    lwlte_core_send_at_cmd_internal(client->core, AT_MIPCLOSE, "OK", "ERROR", LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+    lwlte_err_t err = lwlte_mqtt_client_connect_locked(client, resume);
+    lwlte_sys_mutex_unlock(client->session_lock);
+    return err;
+}
+
+/* Probe the session and send the subscriptions that could not be restored, called from the reconnect task */
+static bool lwlte_mqtt_client_probe_session(void* ctx)
+{
+    lwlte_mqtt_client_t* client = (lwlte_mqtt_client_t*)ctx;
+    lwlte_sys_mutex_lock(client->session_lock);
+    bool up = lwlte_mqtt_client_session_up(client);
+    if (up && client->online) {
+        lwlte_mqtt_client_restore_subs_locked(client, true);
+    }
+    lwlte_sys_mutex_unlock(client->session_lock);
+    return up;
+}
+
+lwlte_err_t lwlte_mqtt_client_init_internal(lwlte_mqtt_client_t* client, const lwlte_mqtt_client_config_t *config, lwlte_base_type_t timeout_ms)
 {
     LWLTE_LOGI(TAG, "Checking config and core status...");
     /* Check if the config is valid */
-    if (config == NULL) {
+    if (client == NULL || config == NULL) {
         return LWLTE_INVALID_ARG;
     }
     if (config->client_t.client_id == NULL) {
@@ -98,105 +733,347 @@ lwlte_err_t lwlte_mqtt_client_init_internal(const lwlte_mqtt_client_config_t *co
         return LWLTE_INVALID_ARG;
     }
     /* Wait until the module is ready or timeout */
-    if (lwlte_core_wait_module_ready(timeout_ms) != LWLTE_OK) {
+    if (lwlte_core_wait_module_ready(client->core, timeout_ms) != LWLTE_OK) {
         LWLTE_LOGE(TAG, "Module is not ready!");
         return LWLTE_NOT_INITIALIZED;
     }
     LWLTE_LOGI(TAG, "Config and core status are ok, initializing MQTT client...");
     /* Create the flags */
-    if (s_lwlte_mqtt_client_context.flags == NULL) {
-        s_lwlte_mqtt_client_context.flags = lwlte_sys_flags_create();
-        lwlte_sys_flags_clear(s_lwlte_mqtt_client_context.flags, LWLTE_FLAGS_ALL_BITS);
+    if (client->flags == NULL) {
+        client->flags = lwlte_sys_flags_create();
+        lwlte_sys_flags_clear(client->flags, LWLTE_FLAGS_ALL_BITS);
     }
     /* Deep copy the config */
-    if (lwlte_mqtt_client_config_copy(config) != LWLTE_OK) {
+    if (lwlte_mqtt_client_config_copy(client, config) != LWLTE_OK) {
         return LWLTE_ERROR;
     }
+    /* Build the commands of the config, no field is truncated */
+    if (lwlte_mqtt_client_build_connect_cmds(client) != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "MQTT broker URI is invalid!");
+        return LWLTE_INVALID_ARG;
+    }
+    /* The certificates stay on the module, a restart only checks them */
+    if (config->tls_t.enable) {
+        lwlte_err_t tls_err = lwlte_tls_setup_internal(client->core, &config->tls_t, LWLTE_MQTT_CLIENT_SSL_CTX_ID);
+        if (tls_err != LWLTE_OK) {
+            LWLTE_LOGE(TAG, "Failed to set up TLS!");
+            return tls_err;
+        }
+    }
+    char* config_cmd = lwlte_mqtt_client_build_config_cmd(client);
+    if (config_cmd == NULL) {
+        LWLTE_LOGE(TAG, "MQTT client ID, credentials or will cannot be sent!");
+        return LWLTE_INVALID_ARG;
+    }
     /* Send the AT+MCONFIG command */
-    char at_cmd_buf[AT_CMD_MAX_LENGTH];
-    char response_buf[AT_CMD_MAX_LENGTH];
-    response_buf[0] = '\0';
-    bool has_will = s_lwlte_mqtt_client_context.config.client_t.will_topic != NULL && s_lwlte_mqtt_client_context.config.client_t.will_topic[0] != '\0' &&
-    s_lwlte_mqtt_client_context.config.client_t.will_message != NULL && s_lwlte_mqtt_client_context.config.client_t.will_message[0] != '\0' &&
-    s_lwlte_mqtt_client_context.config.client_t.will_qos != LWLTE_MQTT_CFG_UNSET_INT &&
-    s_lwlte_mqtt_client_context.config.client_t.will_retain != LWLTE_MQTT_CFG_UNSET_INT;
-    if (has_will) {
-        snprintf(at_cmd_buf, AT_CMD_MAX_LENGTH, 
-            "AT+MCONFIG=\"%s\",\"%s\",\"%s\",%d,%d,\"%s\",\"%s\"\r\n", 
-            s_lwlte_mqtt_client_context.config.client_t.client_id, 
-            s_lwlte_mqtt_client_context.config.client_t.username == NULL ? "" : s_lwlte_mqtt_client_context.config.client_t.username, 
-            s_lwlte_mqtt_client_context.config.client_t.password == NULL ? "" : s_lwlte_mqtt_client_context.config.client_t.password, 
-            s_lwlte_mqtt_client_context.config.client_t.will_qos, 
-            s_lwlte_mqtt_client_context.config.client_t.will_retain, s_lwlte_mqtt_client_context.config.client_t.will_topic, 
-            s_lwlte_mqtt_client_context.config.client_t.will_message);
-    } else {
-        snprintf(at_cmd_buf, AT_CMD_MAX_LENGTH, 
-            "AT+MCONFIG=\"%s\",\"%s\",\"%s\"\r\n", 
-            s_lwlte_mqtt_client_context.config.client_t.client_id, 
-            s_lwlte_mqtt_client_context.config.client_t.username == NULL ? "" : s_lwlte_mqtt_client_context.config.client_t.username, 
-            s_lwlte_mqtt_client_context.config.client_t.password == NULL ? "" : s_lwlte_mqtt_client_context.config.client_t.password
-        );
-    }
-    lwlte_core_send_at_cmd_internal(at_cmd_buf, "OK", "ERROR", 10000, response_buf, AT_CMD_MAX_LENGTH);
-    if (strstr(response_buf, "OK") == NULL) {
+    lwlte_err_t err = lwlte_core_send_at_cmd_internal(client->core, config_cmd, "OK", "ERROR", 10000, NULL, 0);
+    lwlte_sys_mem_free(config_cmd);
+    if (err != LWLTE_OK) {
         LWLTE_LOGE(TAG, "Failed to set MQTT client config!");
         return LWLTE_ERROR;
     }
+    /* Publishes can be queued from now on, they are sent once the session is up */
+    if (client->pipeline == NULL && lwlte_mqtt_client_create_pipeline(client) != LWLTE_OK) {
+        return LWLTE_ERROR;
+    }
+    if (client->batch == NULL && client->config.batch_t.window_ms > 0) {
+        client->batch = lwlte_mqtt_batch_create(&client->config, lwlte_mqtt_client_flush_batch, client);
+        if (client->batch == NULL) {
+            return LWLTE_ERROR;
+        }
+    }
+    if (client->reconnect == NULL && client->config.reconnect_t.enable) {
+        client->reconnect = lwlte_mqtt_reconnect_create(&client->config, lwlte_mqtt_client_reconnect, 
+            lwlte_mqtt_client_probe_session, client);
+        if (client->reconnect == NULL) {
+            return LWLTE_ERROR;
+        }
+    }
+    /* The incoming messages go to the router */
+    if (lwlte_core_add_urc_handler_internal(client->core, URC_MSUB, lwlte_mqtt_client_msub_urc, client) != LWLTE_OK) {
+        return LWLTE_ERROR;
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_mqtt_client_deinit_internal(lwlte_mqtt_client_t* client)
+{
+    if (client == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* The reconnect task goes first, it sends the session commands */
+    lwlte_mqtt_reconnect_delete(client->reconnect);
+    client->reconnect = NULL;
+    /* Stop the deliveries, the handler uses the client */
+    lwlte_core_remove_urc_handler_internal(client->core, URC_MSUB);
+    /* The open batches are queued before the pipeline goes */
+    lwlte_mqtt_batch_delete(client->batch);
+    client->batch = NULL;
+    /* The pending publishes are reported dropped, those from the outbox stay logged for the next run */
+    lwlte_mqtt_pipeline_delete(client->pipeline);
+    client->pipeline = NULL;
+    lwlte_mqtt_outbox_delete(client->outbox);
+    client->outbox = NULL;
+    lwlte_sys_mem_free(client->pub_cmd.buf);
+    memset(&client->pub_cmd, 0, sizeof(lwlte_at_builder_t));
+    lwlte_sys_mem_free(client->pubex_cmd.buf);
+    memset(&client->pubex_cmd, 0, sizeof(lwlte_at_builder_t));
+    lwlte_mqtt_client_free_connect_cmds(client);
+    lwlte_mqtt_client_free_config_strings(client);
+    lwlte_mqtt_client_free_subs(client);
+    client->wanted = false;
+    client->online = false;
+    client->dns.valid = false;
+    client->config.client_t.will_qos = LWLTE_MQTT_CFG_UNSET_INT;
+    client->config.client_t.will_retain = LWLTE_MQTT_CFG_UNSET_INT;
+    client->config.broker_t.port = LWLTE_MQTT_CFG_UNSET_INT;
+    client->config.broker_t.clean_session = LWLTE_MQTT_CFG_UNSET_INT;
+    client->config.broker_t.keepalive = LWLTE_MQTT_CFG_UNSET_INT;
+    lwlte_sys_flags_delete(client->flags);
+    client->flags = NULL;
+
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_mqtt_client_deinit_internal(void)
+lwlte_err_t lwlte_mqtt_client_connect_internal(lwlte_mqtt_client_t* client)
+{
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    lwlte_sys_mutex_lock(client->session_lock);
+    client->wanted = true;
+    /* Nothing is known of a session left on the broker, all the subscriptions are sent */
+    lwlte_err_t err = lwlte_mqtt_client_connect_locked(client, false);
+    lwlte_sys_mutex_unlock(client->session_lock);
+    /* A failed connect is retried by the reconnect task */
+    lwlte_mqtt_reconnect_set_wanted(client->reconnect, true, err == LWLTE_OK);
+    return err;
+}
+
+lwlte_err_t lwlte_mqtt_client_disconnect_internal(lwlte_mqtt_client_t* client)
+{
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    lwlte_mqtt_reconnect_set_wanted(client->reconnect, false, false);
+    lwlte_sys_mutex_lock(client->session_lock);
+    client->wanted = false;
+    client->online = false;
+    /* Hold the publishes, they are kept for the next session */
+    lwlte_mqtt_pipeline_set_online(client->pipeline, false);
+    lwlte_err_t err = lwlte_core_send_at_cmd_internal(client->core, AT_MDISCONNECT, "OK", "ERROR", 
+        LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+    lwlte_err_t close_err = lwlte_core_send_at_cmd_internal(client->core, AT_MIPCLOSE, "OK", "ERROR", 
+        LWLTE_MQTT_CLIENT_ACK_TIMEOUT_MS, NULL, 0);
+    lwlte_sys_mutex_unlock(client->session_lock);
+    return err != LWLTE_OK ? err : close_err;
+}
+
+lwlte_err_t lwlte_mqtt_client_subscribe_internal(lwlte_mqtt_client_t* client, const char* topic)
 {
-    if (s_lwlte_mqtt_client_context.config.client_t.client_id != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.client_t.client_id);
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    size_t topic_len = topic != NULL ? strlen(topic) : 0;
+    if (!lwlte_mqtt_client_check_text(topic, topic_len)) {
+        return LWLTE_INVALID_ARG;
     }
-    if (s_lwlte_mqtt_client_context.config.client_t.username != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.client_t.username);
+    lwlte_sys_mutex_lock(client->session_lock);
+    lwlte_mqtt_client_sub_t* sub = lwlte_mqtt_client_find_sub(client, topic);
+    bool added = false;
+    if (sub == NULL) {
+        sub = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_client_sub_t) + topic_len + 1);
+        if (sub == NULL) {
+            lwlte_sys_mutex_unlock(client->session_lock);
+            return LWLTE_ERROR;
+        }
+        memcpy(sub->topic, topic, topic_len + 1);
+        sub->active = false;
+        sub->next = client->subs;
+        client->subs = sub;
+        added = true;
     }
-    if (s_lwlte_mqtt_client_context.config.client_t.password != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.client_t.password);
+    /* Without a session the subscription is sent on the next connect */
+    lwlte_err_t err = LWLTE_OK;
+    if (client->online) {
+        err = lwlte_mqtt_client_send_subscribe(client, topic);
+        sub->active = (err == LWLTE_OK);
+        /* A refused subscription is not kept */
+        if (err != LWLTE_OK && added) {
+            lwlte_mqtt_client_remove_sub(client, sub);
+        }
     }
-    s_lwlte_mqtt_client_context.config.client_t.will_qos = LWLTE_MQTT_CFG_UNSET_INT;
-    s_lwlte_mqtt_client_context.config.client_t.will_retain = LWLTE_MQTT_CFG_UNSET_INT;
-    if (s_lwlte_mqtt_client_context.config.client_t.will_topic != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.client_t.will_topic);
+    lwlte_sys_mutex_unlock(client->session_lock);
+    return err;
+}
+
+lwlte_err_t lwlte_mqtt_client_unsubscribe_internal(lwlte_mqtt_client_t* client, const char* topic)
+{
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
     }
-    if (s_lwlte_mqtt_client_context.config.client_t.will_message != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.client_t.will_message);
+    if (!lwlte_mqtt_client_check_text(topic, topic != NULL ? strlen(topic) : 0)) {
+        return LWLTE_INVALID_ARG;
     }
-    if (s_lwlte_mqtt_client_context.config.broker_t.uri != NULL) {
-        free((void*)s_lwlte_mqtt_client_context.config.broker_t.uri);
+    lwlte_sys_mutex_lock(client->session_lock);
+    /* Without a session the subscription is only forgotten */
+    lwlte_err_t err = LWLTE_OK;
+    if (client->online) {
+        err = lwlte_mqtt_client_send_unsubscribe(client, topic);
     }
-    s_lwlte_mqtt_client_context.config.broker_t.port = LWLTE_MQTT_CFG_UNSET_INT;
-    s_lwlte_mqtt_client_context.config.broker_t.clean_session = LWLTE_MQTT_CFG_UNSET_INT;
-    s_lwlte_mqtt_client_context.config.broker_t.keepalive = LWLTE_MQTT_CFG_UNSET_INT;
-    lwlte_sys_flags_delete(s_lwlte_mqtt_client_context.flags);
-    s_lwlte_mqtt_client_context.flags = NULL;
+    lwlte_mqtt_client_sub_t* sub = lwlte_mqtt_client_find_sub(client, topic);
+    if (err == LWLTE_OK && sub != NULL) {
+        lwlte_mqtt_client_remove_sub(client, sub);
+    }
+    lwlte_sys_mutex_unlock(client->session_lock);
+    return err;
+}
 
-    return LWLTE_OK;
+lwlte_err_t lwlte_mqtt_client_publish_binary_internal(lwlte_mqtt_client_t* client, const char* topic, 
+    const void* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, 
+    lwlte_base_type_t* msg_id)
+{
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (!lwlte_mqtt_client_check_text(topic, topic != NULL ? strlen(topic) : 0) || 
+        payload == NULL || payload_len == 0 || qos > 2) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (client->batch == NULL) {
+        return lwlte_mqtt_client_enqueue(client, topic, payload, payload_len, qos, retain, wait_ms, msg_id);
+    }
+    /* The batch gets its ID when it is flushed */
+    if (msg_id != NULL) {
+        *msg_id = 0;
+    }
+    return lwlte_mqtt_batch_add(client->batch, topic, payload, payload_len, qos, retain);
 }
 
-lwlte_err_t lwlte_mqtt_client_connect_internal()
+lwlte_err_t lwlte_mqtt_client_publish_qos_internal(lwlte_mqtt_client_t* client, const char* topic, const char* payload, 
+    lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
 {
-    return LWLTE_OK;
+    if (payload == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    return lwlte_mqtt_client_publish_binary_internal(client, topic, payload, strlen(payload), qos, retain, 
+        wait_ms, msg_id);
 }
 
-lwlte_err_t lwlte_mqtt_client_disconnect_internal()
+lwlte_err_t lwlte_mqtt_client_flush_internal(lwlte_mqtt_client_t* client)
 {
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    return (client->batch != NULL) ? lwlte_mqtt_batch_flush(client->batch) : LWLTE_OK;
+}
+
+lwlte_err_t lwlte_mqtt_client_publish_internal(lwlte_mqtt_client_t* client, const char* topic, const char* payload)
+{
+    return lwlte_mqtt_client_publish_qos_internal(client, topic, payload, -1, false, 
+        LWLTE_MQTT_CLIENT_PUBLISH_WAIT_MS, NULL);
+}
+
+lwlte_err_t lwlte_mqtt_client_get_reconnect_stats_internal(lwlte_mqtt_client_t* client, 
+    lwlte_mqtt_reconnect_stats_t* stats)
+{
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_mqtt_reconnect_get_stats(client->reconnect, stats);
+    lwlte_sys_mutex_lock(client->session_lock);
+    stats->dns_lookups = client->session_stats.dns_lookups;
+    stats->dns_cache_hits = client->session_stats.dns_cache_hits;
+    stats->resubscribes = client->session_stats.resubscribes;
+    lwlte_sys_mutex_unlock(client->session_lock);
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_mqtt_client_subscribe_internal(const char* topic)
+static void lwlte_mqtt_client_pool_stats(const lwlte_slab_stats_t* slab, lwlte_mqtt_pool_stats_t* stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->block_size = slab->block_size;
+    stats->block_count = slab->block_count;
+    stats->in_use = slab->in_use;
+    stats->peak = slab->peak;
+    stats->exhausted = slab->exhausted;
+    stats->oversize = slab->oversize;
+}
+
+lwlte_err_t lwlte_mqtt_client_get_pool_stats_internal(lwlte_mqtt_client_t* client, 
+    lwlte_mqtt_pool_stats_t* topic_stats, lwlte_mqtt_pool_stats_t* payload_stats)
 {
+    if (client->pipeline == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    lwlte_slab_stats_t topic_slab;
+    lwlte_slab_stats_t payload_slab;
+    lwlte_mqtt_pipeline_get_pool_stats(client->pipeline, &topic_slab, &payload_slab);
+    lwlte_mqtt_client_pool_stats(&topic_slab, topic_stats);
+    lwlte_mqtt_client_pool_stats(&payload_slab, payload_stats);
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_mqtt_client_unsubscribe_internal(const char* topic)
+lwlte_err_t lwlte_mqtt_client_add_handler_internal(lwlte_mqtt_client_t* client, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    return lwlte_mqtt_router_add(client->router, filter, cb, ctx);
+}
+
+lwlte_err_t lwlte_mqtt_client_remove_handler_internal(lwlte_mqtt_client_t* client, const char* filter, 
+    lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    return lwlte_mqtt_router_remove(client->router, filter, cb, ctx);
+}
+
+uint32_t lwlte_mqtt_client_get_rx_count_internal(lwlte_mqtt_client_t* client)
 {
+    return client->rx_count;
+}
+
+void lwlte_mqtt_client_set_watcher_internal(lwlte_mqtt_client_t* client, lwlte_sys_flags_t watcher)
+{
+    client->watcher = watcher;
+}
+
+lwlte_err_t lwlte_mqtt_client_create_internal(lwlte_core_t* core, lwlte_mqtt_client_t** client)
+{
+    if (core == NULL || client == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_mqtt_client_t* new_client = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_client_t));
+    if (new_client == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(new_client, 0, sizeof(lwlte_mqtt_client_t));
+    new_client->core = core;
+    new_client->config = LWLTE_MQTT_CLIENT_CONFIG_DEFAULT();
+    /* The handlers can be added before the client is initialized */
+    new_client->router = lwlte_mqtt_router_create();
+    new_client->session_lock = lwlte_sys_mutex_create();
+    if (new_client->router == NULL || new_client->session_lock == NULL) {
+        lwlte_mqtt_router_delete(new_client->router);
+        lwlte_sys_mutex_delete(new_client->session_lock);
+        lwlte_sys_mem_free(new_client);
+        return LWLTE_ERROR;
+    }
+    *client = new_client;
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_mqtt_client_publish_internal(const char* topic, const char* payload)
+lwlte_err_t lwlte_mqtt_client_destroy_internal(lwlte_mqtt_client_t* client)
 {
+    if (client == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_mqtt_client_deinit_internal(client);
+    lwlte_mqtt_router_delete(client->router);
+    lwlte_sys_mutex_delete(client->session_lock);
+    lwlte_sys_mem_free(client);
     return LWLTE_OK;
-}
\ No newline at end of file
+}
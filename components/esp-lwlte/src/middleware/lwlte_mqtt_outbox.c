@@ -0,0 +1,486 @@
+/*
+    File: lwlte_mqtt_outbox.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT store-and-forward outbox source file
+    - The storage is a ring of sectors written append-only. A record is a header, the topic and the payload,
+      4-byte aligned and never across two sectors.
+    - A record is written with its commit and done bytes erased, the commit byte is programmed last and the
+      done byte once the publish is delivered, so a power cut leaves at most one torn record behind.
+    - A sector is only erased when the head enters it again, every sector takes the same share of the erases.
+*/
+#include "lwlte_mqtt_outbox.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+#define LWLTE_MQTT_OUTBOX_MAGIC 0x4F42
+/* Value of a programmed commit or done byte */
+#define LWLTE_MQTT_OUTBOX_MARK 0x00
+#define LWLTE_MQTT_OUTBOX_ERASED 0xFF
+/* QoS of a record appended with the default QoS, resolved by the pipeline when it is sent */
+#define LWLTE_MQTT_OUTBOX_QOS_DEFAULT 0xFF
+#define LWLTE_MQTT_OUTBOX_ALIGN(n) (((n) + 3u) & ~3u)
+/* Sector of an in-flight record whose sector was erased */
+#define LWLTE_MQTT_OUTBOX_NO_SECTOR UINT32_MAX
+
+static const char* TAG = "lwlte_mqtt_outbox";
+
+typedef struct {
+    uint16_t magic;
+    uint16_t topic_len;
+    uint16_t payload_len;
+    uint8_t qos;
+    uint8_t retain;
+    uint32_t seq; // increases by one per record, the head is after the highest one
+    uint32_t crc; // CRC-32 of the fields above, the topic and the payload
+    uint8_t commit; // programmed once the topic and the payload are written
+    uint8_t done; // programmed once the publish is delivered
+    uint16_t reserved;
+} lwlte_mqtt_outbox_record_t;
+
+typedef enum {
+    LWLTE_MQTT_OUTBOX_SLOT_RECORD, // a committed record
+    LWLTE_MQTT_OUTBOX_SLOT_FREE, // erased, the next record goes here
+    LWLTE_MQTT_OUTBOX_SLOT_END, // end of the sector, or a torn or foreign record that closes it
+} lwlte_mqtt_outbox_slot_t;
+
+typedef struct {
+    uint32_t sector;
+    uint32_t offset; // from the start of the sector
+} lwlte_mqtt_outbox_pos_t;
+
+/* A record handed to the pipeline and not completed yet */
+typedef struct {
+    lwlte_mqtt_outbox_pos_t pos;
+    uint32_t seq;
+} lwlte_mqtt_outbox_ref_t;
+
+typedef struct {
+    const lwlte_sys_storage_t* storage;
+    lwlte_mqtt_outbox_overflow_t overflow;
+    lwlte_mqtt_publish_cb_t on_publish;
+    void* cb_ctx;
+    uint32_t sector_count;
+    uint16_t* pending; // undelivered records per sector
+    lwlte_mqtt_outbox_pos_t head; // where the next record is written
+    bool head_closed; // the next record goes to the next sector
+    lwlte_mqtt_outbox_pos_t cursor; // next record to feed
+    uint32_t next_seq;
+    lwlte_mqtt_outbox_ref_t* inflight; // ring, in the order the pipeline completes them
+    uint32_t inflight_cap;
+    uint32_t inflight_head;
+    uint32_t inflight_count;
+    char* buf; // topic and payload of the record being fed
+    lwlte_sys_mutex_t lock;
+    lwlte_sys_semaphore_t space; // given when a record is done
+} lwlte_mqtt_outbox_context_t;
+
+static uint32_t lwlte_mqtt_outbox_crc32(uint32_t crc, const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (size-- > 0) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t lwlte_mqtt_outbox_record_crc(const lwlte_mqtt_outbox_record_t* hdr, const char* topic, const char* payload)
+{
+    uint32_t crc = lwlte_mqtt_outbox_crc32(0, hdr, offsetof(lwlte_mqtt_outbox_record_t, crc));
+    crc = lwlte_mqtt_outbox_crc32(crc, topic, hdr->topic_len);
+    return lwlte_mqtt_outbox_crc32(crc, payload, hdr->payload_len);
+}
+
+static uint32_t lwlte_mqtt_outbox_record_size(const lwlte_mqtt_outbox_record_t* hdr)
+{
+    return LWLTE_MQTT_OUTBOX_ALIGN(sizeof(lwlte_mqtt_outbox_record_t) + hdr->topic_len + hdr->payload_len);
+}
+
+static uint32_t lwlte_mqtt_outbox_addr(lwlte_mqtt_outbox_context_t* o, lwlte_mqtt_outbox_pos_t pos)
+{
+    return pos.sector * o->storage->sector_size + pos.offset;
+}
+
+/* IDs reported to on_publish, the sequence number kept positive */
+static lwlte_base_type_t lwlte_mqtt_outbox_id(uint32_t seq)
+{
+    return (lwlte_base_type_t)(seq & 0x7FFFFFFF);
+}
+
+static lwlte_mqtt_outbox_slot_t lwlte_mqtt_outbox_probe(lwlte_mqtt_outbox_context_t* o, lwlte_mqtt_outbox_pos_t pos,
+    lwlte_mqtt_outbox_record_t* hdr)
+{
+    if (pos.offset + sizeof(lwlte_mqtt_outbox_record_t) > o->storage->sector_size) {
+        return LWLTE_MQTT_OUTBOX_SLOT_END;
+    }
+    if (o->storage->read(o->storage->ctx, lwlte_mqtt_outbox_addr(o, pos), hdr, sizeof(*hdr)) != LWLTE_OK) {
+        return LWLTE_MQTT_OUTBOX_SLOT_END;
+    }
+    const uint8_t* bytes = (const uint8_t*)hdr;
+    size_t erased = 0;
+    while (erased < sizeof(*hdr) && bytes[erased] == LWLTE_MQTT_OUTBOX_ERASED) {
+        erased++;
+    }
+    if (erased == sizeof(*hdr)) {
+        return LWLTE_MQTT_OUTBOX_SLOT_FREE;
+    }
+    if (hdr->magic != LWLTE_MQTT_OUTBOX_MAGIC || hdr->commit != LWLTE_MQTT_OUTBOX_MARK ||
+        pos.offset + lwlte_mqtt_outbox_record_size(hdr) > o->storage->sector_size) {
+        return LWLTE_MQTT_OUTBOX_SLOT_END;
+    }
+    return LWLTE_MQTT_OUTBOX_SLOT_RECORD;
+}
+
+/* Walk the records of a sector, count the undelivered ones and find the highest sequence number */
+static void lwlte_mqtt_outbox_scan_sector(lwlte_mqtt_outbox_context_t* o, uint32_t sector,
+    lwlte_mqtt_outbox_pos_t* end, bool* closed, uint32_t* last_seq, bool* found)
+{
+    lwlte_mqtt_outbox_pos_t pos = { .sector = sector, .offset = 0 };
+    lwlte_mqtt_outbox_record_t hdr;
+    lwlte_mqtt_outbox_slot_t slot;
+    o->pending[sector] = 0;
+    while ((slot = lwlte_mqtt_outbox_probe(o, pos, &hdr)) == LWLTE_MQTT_OUTBOX_SLOT_RECORD) {
+        if (hdr.done != LWLTE_MQTT_OUTBOX_MARK) {
+            o->pending[sector]++;
+        }
+        if (!*found || hdr.seq > *last_seq) {
+            *last_seq = hdr.seq;
+            *found = true;
+        }
+        pos.offset += lwlte_mqtt_outbox_record_size(&hdr);
+    }
+    *end = pos;
+    *closed = (slot == LWLTE_MQTT_OUTBOX_SLOT_END);
+}
+
+/* Program the done byte, the lock must be held */
+static void lwlte_mqtt_outbox_mark_done(lwlte_mqtt_outbox_context_t* o, lwlte_mqtt_outbox_pos_t pos)
+{
+    uint8_t mark = LWLTE_MQTT_OUTBOX_MARK;
+    uint32_t addr = lwlte_mqtt_outbox_addr(o, pos) + offsetof(lwlte_mqtt_outbox_record_t, done);
+    if (o->storage->write(o->storage->ctx, addr, &mark, 1) != LWLTE_OK) {
+        /* Sent again after a reboot, a duplicate rather than a loss */
+        LWLTE_LOGW(TAG, "Failed to mark a record done.");
+    }
+    if (o->pending[pos.sector] > 0) {
+        o->pending[pos.sector]--;
+    }
+    lwlte_sys_semaphore_signal(o->space);
+}
+
+static bool lwlte_mqtt_outbox_is_inflight(lwlte_mqtt_outbox_context_t* o, uint32_t seq)
+{
+    for (uint32_t i = 0; i < o->inflight_count; i++) {
+        if (o->inflight[(o->inflight_head + i) % o->inflight_cap].seq == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Erase a sector and move the head to its start, the lock must be held.
+ * The undelivered records it still holds are reported dropped, except those already in the pipeline.
+ * on_publish is called with the lock held here, it must not publish from a DROPPED report.
+ */
+static lwlte_err_t lwlte_mqtt_outbox_take_sector(lwlte_mqtt_outbox_context_t* o, uint32_t sector)
+{
+    if (o->pending[sector] > 0) {
+        lwlte_mqtt_outbox_pos_t pos = { .sector = sector, .offset = 0 };
+        lwlte_mqtt_outbox_record_t hdr;
+        lwlte_base_type_t dropped = 0;
+        while (lwlte_mqtt_outbox_probe(o, pos, &hdr) == LWLTE_MQTT_OUTBOX_SLOT_RECORD) {
+            if (hdr.done != LWLTE_MQTT_OUTBOX_MARK && !lwlte_mqtt_outbox_is_inflight(o, hdr.seq)) {
+                dropped++;
+                if (o->on_publish != NULL) {
+                    o->on_publish(lwlte_mqtt_outbox_id(hdr.seq), LWLTE_MQTT_MSG_DROPPED, o->cb_ctx);
+                }
+            }
+            pos.offset += lwlte_mqtt_outbox_record_size(&hdr);
+        }
+        LWLTE_LOGW(TAG, "Outbox full, %d oldest publishes dropped.", (int)dropped);
+    }
+    /* The records in the pipeline are still sent, there is just no done byte left to program */
+    for (uint32_t i = 0; i < o->inflight_count; i++) {
+        lwlte_mqtt_outbox_ref_t* ref = &o->inflight[(o->inflight_head + i) % o->inflight_cap];
+        if (ref->pos.sector == sector) {
+            ref->pos.sector = LWLTE_MQTT_OUTBOX_NO_SECTOR;
+        }
+    }
+    /* The cursor can only be here if the newer sectors were not fed yet, the next one is the oldest left */
+    if (o->cursor.sector == sector) {
+        o->cursor.sector = (sector + 1) % o->sector_count;
+        o->cursor.offset = 0;
+    }
+    o->pending[sector] = 0;
+    o->head.sector = sector;
+    o->head.offset = 0;
+    o->head_closed = true;
+    if (o->storage->erase(o->storage->ctx, sector * o->storage->sector_size, o->storage->sector_size) != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to erase sector %d.", (int)sector);
+        return LWLTE_ERROR;
+    }
+    o->head_closed = false;
+    return LWLTE_OK;
+}
+
+lwlte_mqtt_outbox_t lwlte_mqtt_outbox_create(const lwlte_mqtt_client_config_t* config, lwlte_base_type_t capacity)
+{
+    if (config == NULL || config->outbox_t.storage == NULL || capacity <= 0) {
+        return NULL;
+    }
+    const lwlte_sys_storage_t* storage = config->outbox_t.storage;
+    if (storage->read == NULL || storage->write == NULL || storage->erase == NULL ||
+        storage->sector_size <= sizeof(lwlte_mqtt_outbox_record_t) || storage->size / storage->sector_size < 2) {
+        LWLTE_LOGE(TAG, "Outbox storage needs at least 2 sectors.");
+        return NULL;
+    }
+    lwlte_mqtt_outbox_context_t* o = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_outbox_context_t));
+    if (o == NULL) {
+        return NULL;
+    }
+    memset(o, 0, sizeof(lwlte_mqtt_outbox_context_t));
+    o->storage = storage;
+    o->overflow = config->outbox_t.overflow;
+    o->on_publish = config->pipeline_t.on_publish;
+    o->cb_ctx = config->pipeline_t.ctx;
+    o->sector_count = storage->size / storage->sector_size;
+    o->inflight_cap = capacity;
+    o->pending = lwlte_sys_mem_malloc(sizeof(uint16_t) * o->sector_count);
+    o->inflight = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_outbox_ref_t) * o->inflight_cap);
+    o->buf = lwlte_sys_mem_malloc(storage->sector_size);
+    o->lock = lwlte_sys_mutex_create();
+    o->space = lwlte_sys_semaphore_create();
+    if (o->pending == NULL || o->inflight == NULL || o->buf == NULL || o->lock == NULL || o->space == NULL) {
+        lwlte_mqtt_outbox_delete(o);
+        return NULL;
+    }
+    /* Recover the head after the highest sequence number, and the oldest sector left undelivered */
+    uint32_t last_seq = 0;
+    bool found = false;
+    uint32_t head_sector = 0;
+    for (uint32_t s = 0; s < o->sector_count; s++) {
+        lwlte_mqtt_outbox_pos_t end;
+        bool closed;
+        uint32_t seq = 0;
+        bool any = false;
+        lwlte_mqtt_outbox_scan_sector(o, s, &end, &closed, &seq, &any);
+        if (any && (!found || seq > last_seq)) {
+            last_seq = seq;
+            found = true;
+            head_sector = s;
+            o->head = end;
+            o->head_closed = closed;
+        }
+    }
+    if (!found) {
+        /* Empty or foreign content, the first record erases sector 0 */
+        o->head.sector = o->sector_count - 1;
+        o->head_closed = true;
+        o->next_seq = 1;
+        o->cursor.sector = 0;
+        LWLTE_LOGI(TAG, "Outbox is empty, %d sectors.", (int)o->sector_count);
+        return o;
+    }
+    o->next_seq = last_seq + 1;
+    o->cursor.sector = head_sector;
+    for (uint32_t i = 1; i <= o->sector_count; i++) {
+        uint32_t s = (head_sector + i) % o->sector_count;
+        if (o->pending[s] > 0) {
+            o->cursor.sector = s;
+            break;
+        }
+    }
+    lwlte_base_type_t pending = 0;
+    for (uint32_t s = 0; s < o->sector_count; s++) {
+        pending += o->pending[s];
+    }
+    LWLTE_LOGI(TAG, "Outbox recovered, %d publishes pending.", (int)pending);
+    return o;
+}
+
+void lwlte_mqtt_outbox_delete(lwlte_mqtt_outbox_t outbox)
+{
+    lwlte_mqtt_outbox_context_t* o = (lwlte_mqtt_outbox_context_t*)outbox;
+    if (o == NULL) {
+        return;
+    }
+    lwlte_sys_mem_free(o->pending);
+    lwlte_sys_mem_free(o->inflight);
+    lwlte_sys_mem_free(o->buf);
+    lwlte_sys_mutex_delete(o->lock);
+    lwlte_sys_semaphore_delete(o->space);
+    lwlte_sys_mem_free(o);
+}
+
+lwlte_err_t lwlte_mqtt_outbox_append(lwlte_mqtt_outbox_t outbox, const char* topic, const char* payload,
+    size_t payload_len, lwlte_base_type_t qos, bool retain, lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    lwlte_mqtt_outbox_context_t* o = (lwlte_mqtt_outbox_context_t*)outbox;
+    if (o == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (topic == NULL || payload == NULL || qos > 2) {
+        return LWLTE_INVALID_ARG;
+    }
+    size_t topic_len = strlen(topic);
+    if (topic_len > UINT16_MAX || payload_len > UINT16_MAX ||
+        LWLTE_MQTT_OUTBOX_ALIGN(sizeof(lwlte_mqtt_outbox_record_t) + topic_len + payload_len) > o->storage->sector_size) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_mqtt_outbox_record_t hdr = {
+        .magic = LWLTE_MQTT_OUTBOX_MAGIC,
+        .topic_len = topic_len,
+        .payload_len = payload_len,
+        .qos = qos < 0 ? LWLTE_MQTT_OUTBOX_QOS_DEFAULT : qos,
+        .retain = retain ? 1 : 0,
+        .commit = LWLTE_MQTT_OUTBOX_ERASED,
+        .done = LWLTE_MQTT_OUTBOX_ERASED,
+        .reserved = UINT16_MAX,
+    };
+    uint32_t size = lwlte_mqtt_outbox_record_size(&hdr);
+    /* Make room in the head sector, or move the head to the next one */
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_sys_mutex_lock(o->lock);
+    while (o->head_closed || o->head.offset + size > o->storage->sector_size) {
+        uint32_t next = (o->head.sector + 1) % o->sector_count;
+        if (o->pending[next] > 0 && o->overflow == LWLTE_MQTT_OUTBOX_DROP_NEWEST) {
+            lwlte_sys_mutex_unlock(o->lock);
+            LWLTE_LOGW(TAG, "Outbox full, publish rejected.");
+            return LWLTE_ERROR;
+        }
+        if (o->pending[next] > 0 && o->overflow == LWLTE_MQTT_OUTBOX_BLOCK) {
+            lwlte_sys_mutex_unlock(o->lock);
+            lwlte_tick_t elapsed_ms = lwlte_sys_time_get_ms() - start_ms;
+            if (elapsed_ms >= (lwlte_tick_t)wait_ms) {
+                return LWLTE_TIMEOUT;
+            }
+            lwlte_sys_semaphore_wait(o->space, wait_ms - elapsed_ms);
+            lwlte_sys_mutex_lock(o->lock);
+            continue;
+        }
+        lwlte_err_t err = lwlte_mqtt_outbox_take_sector(o, next);
+        if (err != LWLTE_OK) {
+            lwlte_sys_mutex_unlock(o->lock);
+            return err;
+        }
+    }
+    hdr.seq = o->next_seq;
+    hdr.crc = lwlte_mqtt_outbox_record_crc(&hdr, topic, payload);
+    /* Header, topic and payload, then the commit byte that makes the record valid */
+    uint32_t addr = lwlte_mqtt_outbox_addr(o, o->head);
+    uint8_t mark = LWLTE_MQTT_OUTBOX_MARK;
+    lwlte_err_t err = o->storage->write(o->storage->ctx, addr, &hdr, sizeof(hdr));
+    if (err == LWLTE_OK) {
+        err = o->storage->write(o->storage->ctx, addr + sizeof(hdr), topic, topic_len);
+    }
+    if (err == LWLTE_OK && payload_len > 0) {
+        err = o->storage->write(o->storage->ctx, addr + sizeof(hdr) + topic_len, payload, payload_len);
+    }
+    if (err == LWLTE_OK) {
+        err = o->storage->write(o->storage->ctx, addr + offsetof(lwlte_mqtt_outbox_record_t, commit), &mark, 1);
+    }
+    if (err != LWLTE_OK) {
+        /* The torn record closes the sector, the next append starts a new one */
+        o->head_closed = true;
+        lwlte_sys_mutex_unlock(o->lock);
+        LWLTE_LOGE(TAG, "Failed to write a record.");
+        return LWLTE_ERROR;
+    }
+    o->head.offset += size;
+    o->pending[o->head.sector]++;
+    o->next_seq++;
+    if (msg_id != NULL) {
+        *msg_id = lwlte_mqtt_outbox_id(hdr.seq);
+    }
+    lwlte_sys_mutex_unlock(o->lock);
+    return LWLTE_OK;
+}
+
+bool lwlte_mqtt_outbox_feed(lwlte_mqtt_outbox_t outbox, lwlte_mqtt_pipeline_t pipeline)
+{
+    lwlte_mqtt_outbox_context_t* o = (lwlte_mqtt_outbox_context_t*)outbox;
+    if (o == NULL) {
+        return false;
+    }
+    bool fed = false;
+    uint32_t hops = 0;
+    lwlte_sys_mutex_lock(o->lock);
+    while (!fed && o->inflight_count < o->inflight_cap) {
+        lwlte_mqtt_outbox_record_t hdr;
+        if (lwlte_mqtt_outbox_probe(o, o->cursor, &hdr) != LWLTE_MQTT_OUTBOX_SLOT_RECORD) {
+            /* End of the sector, new records show up in the head sector */
+            if (o->cursor.sector == o->head.sector || ++hops > o->sector_count) {
+                break;
+            }
+            o->cursor.sector = (o->cursor.sector + 1) % o->sector_count;
+            o->cursor.offset = 0;
+            continue;
+        }
+        lwlte_mqtt_outbox_pos_t pos = o->cursor;
+        if (hdr.done == LWLTE_MQTT_OUTBOX_MARK) {
+            o->cursor.offset += lwlte_mqtt_outbox_record_size(&hdr);
+            continue;
+        }
+        /* The topic and the payload, each null-terminated for the pipeline */
+        char* topic = o->buf;
+        char* payload = o->buf + hdr.topic_len + 1;
+        uint32_t addr = lwlte_mqtt_outbox_addr(o, pos) + sizeof(hdr);
+        if (o->storage->read(o->storage->ctx, addr, topic, hdr.topic_len) != LWLTE_OK ||
+            o->storage->read(o->storage->ctx, addr + hdr.topic_len, payload, hdr.payload_len) != LWLTE_OK) {
+            break;
+        }
+        topic[hdr.topic_len] = '\0';
+        payload[hdr.payload_len] = '\0';
+        if (lwlte_mqtt_outbox_record_crc(&hdr, topic, payload) != hdr.crc) {
+            LWLTE_LOGW(TAG, "Record %d is corrupt, skipped.", (int)hdr.seq);
+            lwlte_mqtt_outbox_mark_done(o, pos);
+            o->cursor.offset += lwlte_mqtt_outbox_record_size(&hdr);
+            continue;
+        }
+        lwlte_base_type_t qos = (hdr.qos == LWLTE_MQTT_OUTBOX_QOS_DEFAULT) ? -1 : hdr.qos;
+        if (lwlte_mqtt_pipeline_submit(pipeline, topic, payload, hdr.payload_len, qos, hdr.retain != 0, 0, NULL) != LWLTE_OK) {
+            break;
+        }
+        o->inflight[(o->inflight_head + o->inflight_count) % o->inflight_cap] = (lwlte_mqtt_outbox_ref_t){
+            .pos = pos,
+            .seq = hdr.seq,
+        };
+        o->inflight_count++;
+        o->cursor.offset += lwlte_mqtt_outbox_record_size(&hdr);
+        fed = true;
+    }
+    lwlte_sys_mutex_unlock(o->lock);
+    return fed;
+}
+
+void lwlte_mqtt_outbox_complete(lwlte_mqtt_outbox_t outbox, lwlte_mqtt_msg_status_t status)
+{
+    lwlte_mqtt_outbox_context_t* o = (lwlte_mqtt_outbox_context_t*)outbox;
+    if (o == NULL) {
+        return;
+    }
+    lwlte_sys_mutex_lock(o->lock);
+    if (o->inflight_count == 0) {
+        lwlte_sys_mutex_unlock(o->lock);
+        return;
+    }
+    lwlte_mqtt_outbox_ref_t ref = o->inflight[o->inflight_head];
+    o->inflight_head = (o->inflight_head + 1) % o->inflight_cap;
+    o->inflight_count--;
+    /* A dropped publish was never sent, it stays in the log for the next run */
+    if (ref.pos.sector != LWLTE_MQTT_OUTBOX_NO_SECTOR && status != LWLTE_MQTT_MSG_DROPPED) {
+        lwlte_mqtt_outbox_mark_done(o, ref.pos);
+    }
+    lwlte_sys_mutex_unlock(o->lock);
+    if (o->on_publish != NULL) {
+        o->on_publish(lwlte_mqtt_outbox_id(ref.seq), status, o->cb_ctx);
+    }
+}
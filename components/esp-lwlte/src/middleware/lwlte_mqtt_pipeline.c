@@ -0,0 +1,376 @@
+/*
+    File: lwlte_mqtt_pipeline.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT outbound pipeline source file
+    - The pending publishes sit in a ring in submission order. The task sends the oldest one,
+      a publish being retried holds the later ones back so that the broker sees them in order.
+    - Every send is a new packet ID for the broker, so a QoS 2 publish that may have left is never sent again.
+*/
+#include "lwlte_mqtt_pipeline.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include "lwlte_slab.h"
+#include <string.h>
+
+/* Defaults, used for the fields left unset in pipeline_t */
+#define LWLTE_MQTT_PIPELINE_MAX_INFLIGHT 8
+#define LWLTE_MQTT_PIPELINE_ACK_TIMEOUT_MS 5000
+#define LWLTE_MQTT_PIPELINE_MAX_RETRIES 3
+#define LWLTE_MQTT_PIPELINE_DEFAULT_QOS 1
+#define LWLTE_MQTT_PIPELINE_TOPIC_BLOCK_SIZE 64
+#define LWLTE_MQTT_PIPELINE_PAYLOAD_BLOCK_SIZE 256
+#define LWLTE_MQTT_PIPELINE_TASK_STACK_SIZE 4096
+#define LWLTE_MQTT_PIPELINE_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+/* Wait of the task when it has nothing to do, the submissions wake it earlier */
+#define LWLTE_MQTT_PIPELINE_IDLE_WAIT_MS 1000
+/* Pause before a failed publish is sent again */
+#define LWLTE_MQTT_PIPELINE_RETRY_DELAY_MS 500
+/* A publish in flight can last up to the ack timeout */
+#define LWLTE_MQTT_PIPELINE_STOP_MARGIN_MS 1000
+
+static const char* TAG = "lwlte_mqtt_pipeline";
+
+typedef struct {
+    lwlte_mqtt_pipeline_msg_t msg;
+    char* topic; // from the topic pool, or the heap if the pool could not serve it
+    char* payload; // from the payload pool, or the heap
+    lwlte_base_type_t attempts;
+    lwlte_tick_t retry_at_ms;
+} lwlte_mqtt_pipeline_slot_t;
+
+typedef struct {
+    lwlte_base_type_t max_inflight;
+    lwlte_base_type_t ack_timeout_ms;
+    lwlte_base_type_t max_retries;
+    lwlte_base_type_t default_qos;
+    lwlte_mqtt_publish_cb_t on_publish;
+    void* cb_ctx;
+    lwlte_mqtt_pipeline_send_fn_t send;
+    void* send_ctx;
+    lwlte_mqtt_pipeline_source_fn_t source; // refills the free slots, optional
+    void* source_ctx;
+    lwlte_mqtt_pipeline_slot_t* slots; // ring of max_inflight slots
+    lwlte_slab_t topic_pool;
+    lwlte_slab_t payload_pool;
+    lwlte_base_type_t head; // oldest pending publish
+    lwlte_base_type_t count;
+    lwlte_base_type_t next_id;
+    volatile bool online;
+    volatile bool stop;
+    lwlte_sys_mutex_t lock;
+    lwlte_sys_semaphore_t wake; // given on a submission, when going online and on stop
+    lwlte_sys_semaphore_t space; // given when a slot gets free
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_thread_t thread_handle;
+} lwlte_mqtt_pipeline_context_t;
+
+static void lwlte_mqtt_pipeline_complete(lwlte_mqtt_pipeline_context_t* p, lwlte_base_type_t id, lwlte_mqtt_msg_status_t status)
+{
+    if (p->on_publish != NULL) {
+        p->on_publish(id, status, p->cb_ctx);
+    }
+}
+
+/* Drop the head slot, the lock must be held */
+static void lwlte_mqtt_pipeline_pop(lwlte_mqtt_pipeline_context_t* p)
+{
+    lwlte_mqtt_pipeline_slot_t* slot = &p->slots[p->head];
+    lwlte_slab_release(p->topic_pool, slot->topic);
+    lwlte_slab_release(p->payload_pool, slot->payload);
+    memset(slot, 0, sizeof(lwlte_mqtt_pipeline_slot_t));
+    p->head = (p->head + 1) % p->max_inflight;
+    p->count--;
+    lwlte_sys_semaphore_signal(p->space);
+}
+
+/* Let the source queue publishes while slots are free, called from the task without the lock */
+static void lwlte_mqtt_pipeline_refill(lwlte_mqtt_pipeline_context_t* p)
+{
+    while (p->source != NULL && p->online) {
+        lwlte_sys_mutex_lock(p->lock);
+        bool full = p->count >= p->max_inflight;
+        lwlte_sys_mutex_unlock(p->lock);
+        if (full || !p->source(p->source_ctx)) {
+            return;
+        }
+    }
+}
+
+static void lwlte_mqtt_pipeline_task(void *pvParameters)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_mqtt_pipeline_task starts.");
+    lwlte_base_type_t wait_ms = 0;
+    while (!p->stop) {
+        if (wait_ms > 0) {
+            lwlte_sys_semaphore_wait(p->wake, wait_ms);
+            if (p->stop) {
+                break;
+            }
+        }
+        wait_ms = LWLTE_MQTT_PIPELINE_IDLE_WAIT_MS;
+        lwlte_mqtt_pipeline_refill(p);
+        /* The head slot is only removed by this task, it stays valid after the lock is released */
+        lwlte_sys_mutex_lock(p->lock);
+        if (!p->online || p->count == 0) {
+            lwlte_sys_mutex_unlock(p->lock);
+            continue;
+        }
+        lwlte_mqtt_pipeline_slot_t* slot = &p->slots[p->head];
+        lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+        if ((int32_t)(slot->retry_at_ms - now_ms) > 0) {
+            wait_ms = slot->retry_at_ms - now_ms;
+            lwlte_sys_mutex_unlock(p->lock);
+            continue;
+        }
+        lwlte_mqtt_pipeline_msg_t msg = slot->msg;
+        lwlte_sys_mutex_unlock(p->lock);
+        lwlte_err_t err = p->send(&msg, p->send_ctx);
+        lwlte_sys_mutex_lock(p->lock);
+        if (err == LWLTE_OK) {
+            lwlte_mqtt_pipeline_pop(p);
+            lwlte_sys_mutex_unlock(p->lock);
+            lwlte_mqtt_pipeline_complete(p, msg.id, LWLTE_MQTT_MSG_DELIVERED);
+            wait_ms = 0;
+            continue;
+        }
+        /* Sending it again would be a second QoS 2 message, the module may have sent the first one */
+        if (err == LWLTE_TIMEOUT && msg.qos == 2) {
+            LWLTE_LOGW(TAG, "Publish %d not answered, its delivery is unknown.", (int)msg.id);
+            lwlte_mqtt_pipeline_pop(p);
+            lwlte_sys_mutex_unlock(p->lock);
+            lwlte_mqtt_pipeline_complete(p, msg.id, LWLTE_MQTT_MSG_UNKNOWN);
+            wait_ms = 0;
+            continue;
+        }
+        /* The session is gone, keep the publish for the next one without counting a retry */
+        if (!p->online) {
+            lwlte_sys_mutex_unlock(p->lock);
+            continue;
+        }
+        /* At most once for QoS 0, the QoS 1/2 publishes that were not sent go again up to max_retries,
+           a QoS 1 one that may have left too since the broker takes it at least once */
+        slot->attempts++;
+        if (msg.qos == 0 || slot->attempts > p->max_retries) {
+            LWLTE_LOGW(TAG, "Publish %d failed.", (int)msg.id);
+            lwlte_mqtt_pipeline_pop(p);
+            lwlte_sys_mutex_unlock(p->lock);
+            lwlte_mqtt_pipeline_complete(p, msg.id, LWLTE_MQTT_MSG_FAILED);
+            wait_ms = 0;
+            continue;
+        }
+        LWLTE_LOGW(TAG, "Publish %d not confirmed, retry %d.", (int)msg.id, (int)slot->attempts);
+        slot->retry_at_ms = lwlte_sys_time_get_ms() + LWLTE_MQTT_PIPELINE_RETRY_DELAY_MS;
+        wait_ms = LWLTE_MQTT_PIPELINE_RETRY_DELAY_MS;
+        lwlte_sys_mutex_unlock(p->lock);
+    }
+    LWLTE_LOGI(TAG, "lwlte_mqtt_pipeline_task exits.");
+    /* Must be the last access to the context, lwlte_mqtt_pipeline_delete frees it once this is given */
+    lwlte_sys_semaphore_signal(p->exited);
+}
+
+lwlte_mqtt_pipeline_t lwlte_mqtt_pipeline_create(const lwlte_mqtt_client_config_t* config, 
+    lwlte_mqtt_pipeline_send_fn_t send, void* ctx)
+{
+    if (config == NULL || send == NULL) {
+        return NULL;
+    }
+    lwlte_mqtt_pipeline_context_t* p = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_pipeline_context_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    memset(p, 0, sizeof(lwlte_mqtt_pipeline_context_t));
+    /* Fill in the defaults */
+    p->max_inflight = config->pipeline_t.max_inflight > 0 ? 
+        config->pipeline_t.max_inflight : LWLTE_MQTT_PIPELINE_MAX_INFLIGHT;
+    p->ack_timeout_ms = config->pipeline_t.ack_timeout_ms > 0 ? 
+        config->pipeline_t.ack_timeout_ms : LWLTE_MQTT_PIPELINE_ACK_TIMEOUT_MS;
+    p->max_retries = config->pipeline_t.max_retries >= 0 ? 
+        config->pipeline_t.max_retries : LWLTE_MQTT_PIPELINE_MAX_RETRIES;
+    p->default_qos = (config->pipeline_t.default_qos >= 0 && config->pipeline_t.default_qos <= 2) ? 
+        config->pipeline_t.default_qos : LWLTE_MQTT_PIPELINE_DEFAULT_QOS;
+    p->on_publish = config->pipeline_t.on_publish;
+    p->cb_ctx = config->pipeline_t.ctx;
+    p->send = send;
+    p->send_ctx = ctx;
+    p->next_id = 1;
+    p->slots = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_pipeline_slot_t) * p->max_inflight);
+    /* A slot holds one block of each pool, the submissions waiting for a slot may take a few more */
+    lwlte_base_type_t block_count = config->pool_t.block_count > 0 ? config->pool_t.block_count : p->max_inflight;
+    p->topic_pool = lwlte_slab_create(config->pool_t.topic_size > 0 ? 
+        config->pool_t.topic_size : LWLTE_MQTT_PIPELINE_TOPIC_BLOCK_SIZE, block_count);
+    p->payload_pool = lwlte_slab_create(config->pool_t.payload_size > 0 ? 
+        config->pool_t.payload_size : LWLTE_MQTT_PIPELINE_PAYLOAD_BLOCK_SIZE, block_count);
+    p->lock = lwlte_sys_mutex_create();
+    p->wake = lwlte_sys_semaphore_create();
+    p->space = lwlte_sys_semaphore_create();
+    p->exited = lwlte_sys_semaphore_create();
+    if (p->slots == NULL || p->topic_pool == NULL || p->payload_pool == NULL || 
+        p->lock == NULL || p->wake == NULL || p->space == NULL || p->exited == NULL) {
+        lwlte_mqtt_pipeline_delete(p);
+        return NULL;
+    }
+    memset(p->slots, 0, sizeof(lwlte_mqtt_pipeline_slot_t) * p->max_inflight);
+    /* Create the pipeline task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->pipeline_t.task, "lwlte_mqtt_pipeline_task", LWLTE_MQTT_PIPELINE_TASK_STACK_SIZE, 
+        LWLTE_MQTT_PIPELINE_TASK_PRIORITY, p);
+    p->thread_handle = lwlte_sys_thread_create(lwlte_mqtt_pipeline_task, &thread_config);
+    if (p->thread_handle == NULL) {
+        lwlte_mqtt_pipeline_delete(p);
+        return NULL;
+    }
+    return p;
+}
+
+void lwlte_mqtt_pipeline_delete(lwlte_mqtt_pipeline_t pipeline)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    if (p == NULL) {
+        return;
+    }
+    if (p->thread_handle != NULL) {
+        p->stop = true;
+        lwlte_sys_semaphore_signal(p->wake);
+        if (!lwlte_sys_semaphore_wait(p->exited, p->ack_timeout_ms + LWLTE_MQTT_PIPELINE_STOP_MARGIN_MS)) {
+            /* The task still uses the context, leak it rather than free it under the task */
+            LWLTE_LOGE(TAG, "lwlte_mqtt_pipeline_task did not stop in time.");
+            return;
+        }
+        p->thread_handle = NULL;
+    }
+    /* Report what was never sent */
+    while (p->slots != NULL && p->count > 0) {
+        lwlte_base_type_t id = p->slots[p->head].msg.id;
+        lwlte_mqtt_pipeline_pop(p);
+        lwlte_mqtt_pipeline_complete(p, id, LWLTE_MQTT_MSG_DROPPED);
+    }
+    lwlte_sys_mem_free(p->slots);
+    lwlte_slab_delete(p->topic_pool);
+    lwlte_slab_delete(p->payload_pool);
+    lwlte_sys_mutex_delete(p->lock);
+    lwlte_sys_semaphore_delete(p->wake);
+    lwlte_sys_semaphore_delete(p->space);
+    lwlte_sys_semaphore_delete(p->exited);
+    lwlte_sys_mem_free(p);
+}
+
+lwlte_err_t lwlte_mqtt_pipeline_submit(lwlte_mqtt_pipeline_t pipeline, const char* topic, 
+    const char* payload, size_t payload_len, lwlte_base_type_t qos, bool retain, 
+    lwlte_base_type_t wait_ms, lwlte_base_type_t* msg_id)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    if (p == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (topic == NULL || payload == NULL || qos > 2) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (qos < 0) {
+        qos = p->default_qos;
+    }
+    /* Copy the topic and the payload before taking a slot, into pool blocks unless they are too large */
+    size_t topic_len = strlen(topic);
+    char* topic_copy = lwlte_slab_acquire(p->topic_pool, topic_len + 1);
+    char* payload_copy = lwlte_slab_acquire(p->payload_pool, payload_len + 1);
+    if (topic_copy == NULL || payload_copy == NULL) {
+        lwlte_slab_release(p->topic_pool, topic_copy);
+        lwlte_slab_release(p->payload_pool, payload_copy);
+        return LWLTE_ERROR;
+    }
+    memcpy(topic_copy, topic, topic_len + 1);
+    memcpy(payload_copy, payload, payload_len);
+    payload_copy[payload_len] = '\0';
+    /* Wait for a free slot */
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_sys_mutex_lock(p->lock);
+    while (p->count >= p->max_inflight) {
+        lwlte_sys_mutex_unlock(p->lock);
+        lwlte_tick_t elapsed_ms = lwlte_sys_time_get_ms() - start_ms;
+        if (elapsed_ms >= (lwlte_tick_t)wait_ms) {
+            lwlte_slab_release(p->topic_pool, topic_copy);
+            lwlte_slab_release(p->payload_pool, payload_copy);
+            return LWLTE_TIMEOUT;
+        }
+        lwlte_sys_semaphore_wait(p->space, wait_ms - elapsed_ms);
+        lwlte_sys_mutex_lock(p->lock);
+    }
+    lwlte_mqtt_pipeline_slot_t* slot = &p->slots[(p->head + p->count) % p->max_inflight];
+    *slot = (lwlte_mqtt_pipeline_slot_t){
+        .msg = {
+            .id = p->next_id,
+            .topic = topic_copy,
+            .payload = payload_copy,
+            .payload_len = payload_len,
+            .qos = qos,
+            .retain = retain,
+            .ack_timeout_ms = p->ack_timeout_ms,
+        },
+        .topic = topic_copy,
+        .payload = payload_copy,
+    };
+    p->count++;
+    /* MQTT style IDs: 1 to 65535, 0 is never used */
+    p->next_id = (p->next_id >= 0xFFFF) ? 1 : p->next_id + 1;
+    if (msg_id != NULL) {
+        *msg_id = slot->msg.id;
+    }
+    lwlte_sys_mutex_unlock(p->lock);
+    lwlte_sys_semaphore_signal(p->wake);
+    return LWLTE_OK;
+}
+
+void lwlte_mqtt_pipeline_set_online(lwlte_mqtt_pipeline_t pipeline, bool online)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    if (p == NULL) {
+        return;
+    }
+    p->online = online;
+    if (online) {
+        lwlte_sys_semaphore_signal(p->wake);
+    }
+}
+
+bool lwlte_mqtt_pipeline_get_online(lwlte_mqtt_pipeline_t pipeline)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    return (p != NULL) && p->online;
+}
+
+void lwlte_mqtt_pipeline_set_source(lwlte_mqtt_pipeline_t pipeline, lwlte_mqtt_pipeline_source_fn_t source, void* ctx)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    if (p == NULL) {
+        return;
+    }
+    lwlte_sys_mutex_lock(p->lock);
+    p->source = source;
+    p->source_ctx = ctx;
+    lwlte_sys_mutex_unlock(p->lock);
+}
+
+void lwlte_mqtt_pipeline_wake(lwlte_mqtt_pipeline_t pipeline)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    if (p != NULL) {
+        lwlte_sys_semaphore_signal(p->wake);
+    }
+}
+
+lwlte_base_type_t lwlte_mqtt_pipeline_get_capacity(lwlte_mqtt_pipeline_t pipeline)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    return (p != NULL) ? p->max_inflight : 0;
+}
+
+void lwlte_mqtt_pipeline_get_pool_stats(lwlte_mqtt_pipeline_t pipeline, lwlte_slab_stats_t* topic_stats, 
+    lwlte_slab_stats_t* payload_stats)
+{
+    lwlte_mqtt_pipeline_context_t* p = (lwlte_mqtt_pipeline_context_t*)pipeline;
+    lwlte_slab_get_stats(p != NULL ? p->topic_pool : NULL, topic_stats);
+    lwlte_slab_get_stats(p != NULL ? p->payload_pool : NULL, payload_stats);
+}
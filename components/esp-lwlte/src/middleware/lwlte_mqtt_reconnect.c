@@ -0,0 +1,214 @@
+/*
+    File: lwlte_mqtt_reconnect.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT reconnect engine source file
+*/
+#include "lwlte_mqtt_reconnect.h"
+#include "lwlte_backoff.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+/* Defaults, used for the fields left unset in reconnect_t */
+#define LWLTE_MQTT_RECONNECT_CHECK_INTERVAL_MS 5000
+#define LWLTE_MQTT_RECONNECT_BACKOFF_BASE_MS 1000
+#define LWLTE_MQTT_RECONNECT_BACKOFF_MAX_MS 60000
+#define LWLTE_MQTT_RECONNECT_TASK_STACK_SIZE 4096
+#define LWLTE_MQTT_RECONNECT_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+/* Wait of the task while the session is not wanted */
+#define LWLTE_MQTT_RECONNECT_IDLE_WAIT_MS 1000
+/* An attempt sends several AT commands with long timeouts, the task gets this long to stop */
+#define LWLTE_MQTT_RECONNECT_STOP_TIMEOUT_MS 60000
+
+static const char* TAG = "lwlte_mqtt_reconnect";
+
+typedef struct {
+    lwlte_base_type_t check_interval_ms;
+    lwlte_base_type_t backoff_base_ms;
+    lwlte_base_type_t backoff_max_ms;
+    lwlte_mqtt_reconnect_fn_t reconnect;
+    lwlte_mqtt_reconnect_probe_fn_t probe;
+    void* ctx;
+    volatile bool wanted; // the application wants the session up
+    volatile bool up; // as far as the engine knows
+    volatile bool lost_reported; // set by lwlte_mqtt_reconnect_notify_lost, taken by the task
+    volatile bool stop;
+    lwlte_mqtt_reconnect_stats_t stats;
+    lwlte_sys_mutex_t stats_lock;
+    lwlte_sys_semaphore_t wake;
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_thread_t thread_handle;
+} lwlte_mqtt_reconnect_context_t;
+
+static void lwlte_mqtt_reconnect_task(void *pvParameters)
+{
+    lwlte_mqtt_reconnect_context_t* r = (lwlte_mqtt_reconnect_context_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_mqtt_reconnect_task starts.");
+    lwlte_base_type_t wait_ms = LWLTE_MQTT_RECONNECT_IDLE_WAIT_MS;
+    lwlte_tick_t lost_since_ms = 0;
+    lwlte_tick_t next_attempt_ms = 0;
+    uint32_t attempt = 0;
+    bool lost = false;
+    while (!r->stop) {
+        lwlte_sys_semaphore_wait(r->wake, wait_ms);
+        if (r->stop) {
+            break;
+        }
+        if (!r->wanted) {
+            lost = false;
+            r->lost_reported = false;
+            wait_ms = LWLTE_MQTT_RECONNECT_IDLE_WAIT_MS;
+            continue;
+        }
+        lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+        /* Detect the loss: reported by the client, a failed first connect, or the periodic probe */
+        if (!lost && (r->lost_reported || !r->up || !r->probe(r->ctx))) {
+            LWLTE_LOGW(TAG, "MQTT session lost, reconnecting.");
+            lost = true;
+            lost_since_ms = now_ms;
+            next_attempt_ms = now_ms;
+            attempt = 0;
+            r->up = false;
+            lwlte_sys_mutex_lock(r->stats_lock);
+            r->stats.sessions_lost++;
+            lwlte_sys_mutex_unlock(r->stats_lock);
+        }
+        r->lost_reported = false;
+        if (!lost) {
+            wait_ms = r->check_interval_ms;
+            continue;
+        }
+        if ((int32_t)(next_attempt_ms - now_ms) > 0) {
+            wait_ms = next_attempt_ms - now_ms;
+            continue;
+        }
+        attempt++;
+        lwlte_err_t err = r->reconnect(now_ms - lost_since_ms, r->ctx);
+        now_ms = lwlte_sys_time_get_ms();
+        lwlte_sys_mutex_lock(r->stats_lock);
+        if (err == LWLTE_OK && r->wanted) {
+            uint32_t resume_ms = now_ms - lost_since_ms;
+            r->stats.reconnects++;
+            r->stats.last_reconnect_ms = resume_ms;
+            r->stats.total_reconnect_ms += resume_ms;
+            if (resume_ms > r->stats.max_reconnect_ms) {
+                r->stats.max_reconnect_ms = resume_ms;
+            }
+            lwlte_sys_mutex_unlock(r->stats_lock);
+            LWLTE_LOGI(TAG, "MQTT session resumed in %u ms after %u attempts.", (unsigned)resume_ms, (unsigned)attempt);
+            lost = false;
+            r->up = true;
+            wait_ms = r->check_interval_ms;
+            continue;
+        }
+        r->stats.failed_attempts++;
+        lwlte_sys_mutex_unlock(r->stats_lock);
+        wait_ms = lwlte_backoff_ms(r->backoff_base_ms, r->backoff_max_ms, attempt);
+        next_attempt_ms = now_ms + wait_ms;
+        LWLTE_LOGW(TAG, "Reconnect attempt %u failed, next one in %u ms.", (unsigned)attempt, (unsigned)wait_ms);
+    }
+    LWLTE_LOGI(TAG, "lwlte_mqtt_reconnect_task exits.");
+    /* Must be the last access to the context, lwlte_mqtt_reconnect_delete frees it once this is given */
+    lwlte_sys_semaphore_signal(r->exited);
+}
+
+lwlte_mqtt_reconnect_t lwlte_mqtt_reconnect_create(const lwlte_mqtt_client_config_t* config, 
+    lwlte_mqtt_reconnect_fn_t reconnect, lwlte_mqtt_reconnect_probe_fn_t probe, void* ctx)
+{
+    if (config == NULL || reconnect == NULL || probe == NULL) {
+        return NULL;
+    }
+    lwlte_mqtt_reconnect_context_t* r = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_reconnect_context_t));
+    if (r == NULL) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(lwlte_mqtt_reconnect_context_t));
+    /* Fill in the defaults */
+    r->check_interval_ms = config->reconnect_t.check_interval_ms > 0 ? 
+        config->reconnect_t.check_interval_ms : LWLTE_MQTT_RECONNECT_CHECK_INTERVAL_MS;
+    r->backoff_base_ms = config->reconnect_t.backoff_base_ms > 0 ? 
+        config->reconnect_t.backoff_base_ms : LWLTE_MQTT_RECONNECT_BACKOFF_BASE_MS;
+    r->backoff_max_ms = config->reconnect_t.backoff_max_ms >= r->backoff_base_ms ? 
+        config->reconnect_t.backoff_max_ms : LWLTE_MQTT_RECONNECT_BACKOFF_MAX_MS;
+    if (r->backoff_max_ms < r->backoff_base_ms) {
+        r->backoff_max_ms = r->backoff_base_ms;
+    }
+    r->reconnect = reconnect;
+    r->probe = probe;
+    r->ctx = ctx;
+    r->stats_lock = lwlte_sys_mutex_create();
+    r->wake = lwlte_sys_semaphore_create();
+    r->exited = lwlte_sys_semaphore_create();
+    if (r->stats_lock == NULL || r->wake == NULL || r->exited == NULL) {
+        lwlte_mqtt_reconnect_delete(r);
+        return NULL;
+    }
+    /* Create the reconnect task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->reconnect_t.task, "lwlte_mqtt_reconnect_task", LWLTE_MQTT_RECONNECT_TASK_STACK_SIZE, 
+        LWLTE_MQTT_RECONNECT_TASK_PRIORITY, r);
+    r->thread_handle = lwlte_sys_thread_create(lwlte_mqtt_reconnect_task, &thread_config);
+    if (r->thread_handle == NULL) {
+        lwlte_mqtt_reconnect_delete(r);
+        return NULL;
+    }
+    return r;
+}
+
+void lwlte_mqtt_reconnect_delete(lwlte_mqtt_reconnect_t reconnect)
+{
+    lwlte_mqtt_reconnect_context_t* r = (lwlte_mqtt_reconnect_context_t*)reconnect;
+    if (r == NULL) {
+        return;
+    }
+    if (r->thread_handle != NULL) {
+        r->stop = true;
+        lwlte_sys_semaphore_signal(r->wake);
+        if (!lwlte_sys_semaphore_wait(r->exited, LWLTE_MQTT_RECONNECT_STOP_TIMEOUT_MS)) {
+            /* The task still uses the context, leak it rather than free it under the task */
+            LWLTE_LOGE(TAG, "lwlte_mqtt_reconnect_task did not stop in time.");
+            return;
+        }
+        r->thread_handle = NULL;
+    }
+    lwlte_sys_mutex_delete(r->stats_lock);
+    lwlte_sys_semaphore_delete(r->wake);
+    lwlte_sys_semaphore_delete(r->exited);
+    lwlte_sys_mem_free(r);
+}
+
+void lwlte_mqtt_reconnect_set_wanted(lwlte_mqtt_reconnect_t reconnect, bool wanted, bool up)
+{
+    lwlte_mqtt_reconnect_context_t* r = (lwlte_mqtt_reconnect_context_t*)reconnect;
+    if (r == NULL) {
+        return;
+    }
+    r->up = up;
+    r->wanted = wanted;
+    lwlte_sys_semaphore_signal(r->wake);
+}
+
+void lwlte_mqtt_reconnect_notify_lost(lwlte_mqtt_reconnect_t reconnect)
+{
+    lwlte_mqtt_reconnect_context_t* r = (lwlte_mqtt_reconnect_context_t*)reconnect;
+    if (r == NULL) {
+        return;
+    }
+    r->lost_reported = true;
+    lwlte_sys_semaphore_signal(r->wake);
+}
+
+void lwlte_mqtt_reconnect_get_stats(lwlte_mqtt_reconnect_t reconnect, lwlte_mqtt_reconnect_stats_t* stats)
+{
+    lwlte_mqtt_reconnect_context_t* r = (lwlte_mqtt_reconnect_context_t*)reconnect;
+    if (r == NULL) {
+        memset(stats, 0, sizeof(lwlte_mqtt_reconnect_stats_t));
+        return;
+    }
+    lwlte_sys_mutex_lock(r->stats_lock);
+    *stats = r->stats;
+    lwlte_sys_mutex_unlock(r->stats_lock);
+}
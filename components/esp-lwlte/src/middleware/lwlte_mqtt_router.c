@@ -0,0 +1,430 @@
+/*
+    File: lwlte_mqtt_router.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte MQTT subscription router source file
+*/
+#include "lwlte_mqtt_router.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+/* Initial room for the exact children of a node, doubled when full */
+#define LWLTE_MQTT_ROUTER_CHILDREN_MIN 4
+
+/* Handlers of a dispatch collected on the stack, more are moved to the heap */
+#define LWLTE_MQTT_ROUTER_HANDLERS_STACK 8
+
+static const char* TAG = "lwlte_mqtt_router";
+
+typedef struct lwlte_mqtt_router_entry_s {
+    lwlte_mqtt_message_cb_t cb;
+    void* ctx;
+    struct lwlte_mqtt_router_entry_s* next;
+} lwlte_mqtt_router_entry_t;
+
+typedef struct lwlte_mqtt_router_node_s {
+    char* level; // not null-terminated, NULL for the root and the wildcards
+    size_t level_len;
+    struct lwlte_mqtt_router_node_s** children; // exact levels, sorted by length then bytes
+    size_t child_count;
+    size_t child_size;
+    struct lwlte_mqtt_router_node_s* plus; // '+' branch
+    struct lwlte_mqtt_router_node_s* hash; // '#' branch, a leaf
+    lwlte_mqtt_router_entry_t* entries; // handlers of the filter ending here
+} lwlte_mqtt_router_node_t;
+
+typedef struct {
+    lwlte_mqtt_router_node_t root;
+    lwlte_sys_mutex_t lock;
+} lwlte_mqtt_router_context_t;
+
+typedef struct {
+    lwlte_mqtt_message_cb_t cb;
+    void* ctx;
+} lwlte_mqtt_router_handler_t;
+
+/* The message being dispatched and its matched handlers, called once the lock is released */
+typedef struct {
+    const char* topic;
+    size_t topic_len;
+    lwlte_mqtt_router_handler_t* handlers;
+    size_t count;
+    size_t size;
+    bool heap; // handlers is on the heap
+    bool truncated; // a handler was left out, no memory
+} lwlte_mqtt_router_msg_t;
+
+static int lwlte_mqtt_router_compare(const lwlte_mqtt_router_node_t* node, const char* level, size_t level_len)
+{
+    if (node->level_len != level_len) {
+        return node->level_len < level_len ? -1 : 1;
+    }
+    return memcmp(node->level, level, level_len);
+}
+
+/* Bisect the exact children, returns the index of the match or of the insertion point */
+static size_t lwlte_mqtt_router_search(const lwlte_mqtt_router_node_t* node, const char* level, size_t level_len, bool* found)
+{
+    size_t low = 0;
+    size_t high = node->child_count;
+    *found = false;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = lwlte_mqtt_router_compare(node->children[mid], level, level_len);
+        if (cmp == 0) {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static lwlte_mqtt_router_node_t* lwlte_mqtt_router_node_create(const char* level, size_t level_len)
+{
+    lwlte_mqtt_router_node_t* node = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_router_node_t));
+    if (node == NULL) {
+        return NULL;
+    }
+    memset(node, 0, sizeof(lwlte_mqtt_router_node_t));
+    if (level != NULL) {
+        node->level = lwlte_sys_mem_malloc(level_len > 0 ? level_len : 1);
+        if (node->level == NULL) {
+            lwlte_sys_mem_free(node);
+            return NULL;
+        }
+        memcpy(node->level, level, level_len);
+        node->level_len = level_len;
+    }
+    return node;
+}
+
+/* Free the content of a node and of its subtree, the node itself is left to the caller */
+static void lwlte_mqtt_router_node_clear(lwlte_mqtt_router_node_t* node)
+{
+    for (size_t i = 0; i < node->child_count; i++) {
+        lwlte_mqtt_router_node_clear(node->children[i]);
+        lwlte_sys_mem_free(node->children[i]);
+    }
+    lwlte_sys_mem_free(node->children);
+    if (node->plus != NULL) {
+        lwlte_mqtt_router_node_clear(node->plus);
+        lwlte_sys_mem_free(node->plus);
+    }
+    if (node->hash != NULL) {
+        lwlte_mqtt_router_node_clear(node->hash);
+        lwlte_sys_mem_free(node->hash);
+    }
+    while (node->entries != NULL) {
+        lwlte_mqtt_router_entry_t* entry = node->entries;
+        node->entries = entry->next;
+        lwlte_sys_mem_free(entry);
+    }
+    lwlte_sys_mem_free(node->level);
+    memset(node, 0, sizeof(lwlte_mqtt_router_node_t));
+}
+
+static bool lwlte_mqtt_router_node_empty(const lwlte_mqtt_router_node_t* node)
+{
+    return node->child_count == 0 && node->plus == NULL && node->hash == NULL && node->entries == NULL;
+}
+
+/* Child of a node for one filter level, created if needed */
+static lwlte_mqtt_router_node_t* lwlte_mqtt_router_child(lwlte_mqtt_router_node_t* node, const char* level, size_t level_len)
+{
+    lwlte_mqtt_router_node_t** wildcard = NULL;
+    if (level_len == 1 && level[0] == '+') {
+        wildcard = &node->plus;
+    }
+    else if (level_len == 1 && level[0] == '#') {
+        wildcard = &node->hash;
+    }
+    if (wildcard != NULL) {
+        if (*wildcard == NULL) {
+            *wildcard = lwlte_mqtt_router_node_create(NULL, 0);
+        }
+        return *wildcard;
+    }
+    bool found;
+    size_t index = lwlte_mqtt_router_search(node, level, level_len, &found);
+    if (found) {
+        return node->children[index];
+    }
+    if (node->child_count == node->child_size) {
+        size_t size = node->child_size > 0 ? node->child_size * 2 : LWLTE_MQTT_ROUTER_CHILDREN_MIN;
+        lwlte_mqtt_router_node_t** children = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_router_node_t*) * size);
+        if (children == NULL) {
+            return NULL;
+        }
+        if (node->child_count > 0) {
+            memcpy(children, node->children, sizeof(lwlte_mqtt_router_node_t*) * node->child_count);
+        }
+        lwlte_sys_mem_free(node->children);
+        node->children = children;
+        node->child_size = size;
+    }
+    lwlte_mqtt_router_node_t* child = lwlte_mqtt_router_node_create(level, level_len);
+    if (child == NULL) {
+        return NULL;
+    }
+    memmove(&node->children[index + 1], &node->children[index],
+        sizeof(lwlte_mqtt_router_node_t*) * (node->child_count - index));
+    node->children[index] = child;
+    node->child_count++;
+    return child;
+}
+
+/* '+' and '#' must fill a whole level, '#' must be the last one */
+static bool lwlte_mqtt_router_check_filter(const char* filter)
+{
+    size_t len = strlen(filter);
+    if (len == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (filter[i] != '+' && filter[i] != '#') {
+            continue;
+        }
+        bool level_start = (i == 0 || filter[i - 1] == '/');
+        bool level_end = (i + 1 == len || filter[i + 1] == '/');
+        if (!level_start || !level_end || (filter[i] == '#' && i + 1 != len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Collect the handlers of a matched node, the lock must be held */
+static void lwlte_mqtt_router_collect(const lwlte_mqtt_router_node_t* node, lwlte_mqtt_router_msg_t* msg)
+{
+    for (lwlte_mqtt_router_entry_t* entry = node->entries; entry != NULL; entry = entry->next) {
+        if (msg->count == msg->size) {
+            size_t size = msg->size * 2;
+            lwlte_mqtt_router_handler_t* handlers = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_router_handler_t) * size);
+            if (handlers == NULL) {
+                msg->truncated = true;
+                return;
+            }
+            memcpy(handlers, msg->handlers, sizeof(lwlte_mqtt_router_handler_t) * msg->count);
+            if (msg->heap) {
+                lwlte_sys_mem_free(msg->handlers);
+            }
+            msg->handlers = handlers;
+            msg->size = size;
+            msg->heap = true;
+        }
+        msg->handlers[msg->count++] = (lwlte_mqtt_router_handler_t){ .cb = entry->cb, .ctx = entry->ctx };
+    }
+}
+
+/**
+ * Match the levels from pos on against the subtree of a node.
+ * @param done All the levels are consumed, pos is not used
+ */
+static void lwlte_mqtt_router_match(const lwlte_mqtt_router_node_t* node, const char* pos, bool done,
+    bool root, lwlte_mqtt_router_msg_t* msg)
+{
+    /* A leading wildcard does not match the $SYS style topics */
+    bool wildcards = !(root && msg->topic_len > 0 && msg->topic[0] == '$');
+    /* '#' also matches the parent level: "a/#" matches "a" */
+    if (node->hash != NULL && wildcards) {
+        lwlte_mqtt_router_collect(node->hash, msg);
+    }
+    if (done) {
+        lwlte_mqtt_router_collect(node, msg);
+        return;
+    }
+    const char* end = msg->topic + msg->topic_len;
+    const char* level_end = memchr(pos, '/', end - pos);
+    if (level_end == NULL) {
+        level_end = end;
+    }
+    bool last = (level_end == end);
+    bool found;
+    size_t index = lwlte_mqtt_router_search(node, pos, level_end - pos, &found);
+    if (found) {
+        lwlte_mqtt_router_match(node->children[index], level_end + 1, last, false, msg);
+    }
+    if (node->plus != NULL && wildcards) {
+        lwlte_mqtt_router_match(node->plus, level_end + 1, last, false, msg);
+    }
+}
+
+/* Remove a handler under a node and prune the nodes left empty, the lock must be held */
+static lwlte_err_t lwlte_mqtt_router_remove_from(lwlte_mqtt_router_node_t* node, const char* pos,
+    lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    if (pos == NULL) {
+        for (lwlte_mqtt_router_entry_t** link = &node->entries; *link != NULL; link = &(*link)->next) {
+            if ((*link)->cb == cb && (*link)->ctx == ctx) {
+                lwlte_mqtt_router_entry_t* entry = *link;
+                *link = entry->next;
+                lwlte_sys_mem_free(entry);
+                return LWLTE_OK;
+            }
+        }
+        return LWLTE_NOT_FOUND;
+    }
+    const char* level_end = strchr(pos, '/');
+    size_t level_len = (level_end != NULL) ? (size_t)(level_end - pos) : strlen(pos);
+    const char* next = (level_end != NULL) ? level_end + 1 : NULL;
+    lwlte_mqtt_router_node_t** wildcard = NULL;
+    size_t index = 0;
+    if (level_len == 1 && pos[0] == '+') {
+        wildcard = &node->plus;
+    }
+    else if (level_len == 1 && pos[0] == '#') {
+        wildcard = &node->hash;
+    }
+    else {
+        bool found;
+        index = lwlte_mqtt_router_search(node, pos, level_len, &found);
+        if (!found) {
+            return LWLTE_NOT_FOUND;
+        }
+    }
+    lwlte_mqtt_router_node_t* child = (wildcard != NULL) ? *wildcard : node->children[index];
+    if (child == NULL) {
+        return LWLTE_NOT_FOUND;
+    }
+    lwlte_err_t err = lwlte_mqtt_router_remove_from(child, next, cb, ctx);
+    if (err != LWLTE_OK || !lwlte_mqtt_router_node_empty(child)) {
+        return err;
+    }
+    lwlte_mqtt_router_node_clear(child);
+    lwlte_sys_mem_free(child);
+    if (wildcard != NULL) {
+        *wildcard = NULL;
+    }
+    else {
+        memmove(&node->children[index], &node->children[index + 1],
+            sizeof(lwlte_mqtt_router_node_t*) * (node->child_count - index - 1));
+        node->child_count--;
+    }
+    return LWLTE_OK;
+}
+
+lwlte_mqtt_router_t lwlte_mqtt_router_create(void)
+{
+    lwlte_mqtt_router_context_t* r = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_router_context_t));
+    if (r == NULL) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(lwlte_mqtt_router_context_t));
+    r->lock = lwlte_sys_mutex_create();
+    if (r->lock == NULL) {
+        lwlte_sys_mem_free(r);
+        return NULL;
+    }
+    return r;
+}
+
+void lwlte_mqtt_router_delete(lwlte_mqtt_router_t router)
+{
+    lwlte_mqtt_router_context_t* r = (lwlte_mqtt_router_context_t*)router;
+    if (r == NULL) {
+        return;
+    }
+    lwlte_mqtt_router_node_clear(&r->root);
+    lwlte_sys_mutex_delete(r->lock);
+    lwlte_sys_mem_free(r);
+}
+
+lwlte_err_t lwlte_mqtt_router_add(lwlte_mqtt_router_t router, const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    lwlte_mqtt_router_context_t* r = (lwlte_mqtt_router_context_t*)router;
+    if (r == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (filter == NULL || cb == NULL || !lwlte_mqtt_router_check_filter(filter)) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(r->lock);
+    /* Walk down the levels, creating the missing nodes */
+    lwlte_mqtt_router_node_t* node = &r->root;
+    const char* pos = filter;
+    while (node != NULL && pos != NULL) {
+        const char* level_end = strchr(pos, '/');
+        size_t level_len = (level_end != NULL) ? (size_t)(level_end - pos) : strlen(pos);
+        node = lwlte_mqtt_router_child(node, pos, level_len);
+        pos = (level_end != NULL) ? level_end + 1 : NULL;
+    }
+    if (node == NULL) {
+        /* The nodes created on the way stay empty, they are harmless and reused by the next add */
+        lwlte_sys_mutex_unlock(r->lock);
+        return LWLTE_ERROR;
+    }
+    for (lwlte_mqtt_router_entry_t* entry = node->entries; entry != NULL; entry = entry->next) {
+        if (entry->cb == cb && entry->ctx == ctx) {
+            lwlte_sys_mutex_unlock(r->lock);
+            return LWLTE_OK;
+        }
+    }
+    lwlte_mqtt_router_entry_t* entry = lwlte_sys_mem_malloc(sizeof(lwlte_mqtt_router_entry_t));
+    if (entry == NULL) {
+        lwlte_sys_mutex_unlock(r->lock);
+        return LWLTE_ERROR;
+    }
+    *entry = (lwlte_mqtt_router_entry_t){ .cb = cb, .ctx = ctx, .next = node->entries };
+    node->entries = entry;
+    lwlte_sys_mutex_unlock(r->lock);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_mqtt_router_remove(lwlte_mqtt_router_t router, const char* filter, lwlte_mqtt_message_cb_t cb, void* ctx)
+{
+    lwlte_mqtt_router_context_t* r = (lwlte_mqtt_router_context_t*)router;
+    if (r == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (filter == NULL || cb == NULL || !lwlte_mqtt_router_check_filter(filter)) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(r->lock);
+    lwlte_err_t err = lwlte_mqtt_router_remove_from(&r->root, filter, cb, ctx);
+    lwlte_sys_mutex_unlock(r->lock);
+    return err;
+}
+
+lwlte_base_type_t lwlte_mqtt_router_dispatch(lwlte_mqtt_router_t router, const char* topic, size_t topic_len,
+    const char* payload, size_t payload_len)
+{
+    lwlte_mqtt_router_context_t* r = (lwlte_mqtt_router_context_t*)router;
+    if (r == NULL || topic == NULL || topic_len == 0) {
+        return 0;
+    }
+    lwlte_mqtt_router_handler_t handlers[LWLTE_MQTT_ROUTER_HANDLERS_STACK];
+    lwlte_mqtt_router_msg_t msg = {
+        .topic = topic,
+        .topic_len = topic_len,
+        .handlers = handlers,
+        .count = 0,
+        .size = LWLTE_MQTT_ROUTER_HANDLERS_STACK,
+        .heap = false,
+        .truncated = false,
+    };
+    lwlte_sys_mutex_lock(r->lock);
+    lwlte_mqtt_router_match(&r->root, topic, false, true, &msg);
+    lwlte_sys_mutex_unlock(r->lock);
+    if (msg.truncated) {
+        LWLTE_LOGW(TAG, "No memory, only %u handlers called for topic %.*s.", (unsigned)msg.count, (int)topic_len, topic);
+    }
+    /* Called without the lock, a handler may add or remove handlers */
+    for (size_t i = 0; i < msg.count; i++) {
+        msg.handlers[i].cb(topic, topic_len, payload, payload_len, msg.handlers[i].ctx);
+    }
+    if (msg.heap) {
+        lwlte_sys_mem_free(msg.handlers);
+    }
+    if (msg.count == 0) {
+        LWLTE_LOGW(TAG, "No handler for topic %.*s.", (int)topic_len, topic);
+    }
+    return (lwlte_base_type_t)msg.count;
+}
@@ -0,0 +1,348 @@
+/*
+    File: lwlte_ota_update.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte ota update source file
+    - The HTTP callback (the task of lwlte_ota_run_internal) fills the buffers in turn and hands each full one to
+      the writer task, it only waits when both are still being written.
+*/
+#include "lwlte_ota_update.h"
+#include "lwlte_http_client.h"
+#include "lwlte_sys_hash.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+#define LWLTE_OTA_TASK_STACK_SIZE 4096
+#define LWLTE_OTA_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+/* A flash write may be in progress when the task is stopped */
+#define LWLTE_OTA_STOP_TIMEOUT_MS 10000
+
+/* Flags of the buffers */
+#define LWLTE_OTA_FLAG_FULL(i) (BIT0 << (i)) // handed to the writer
+#define LWLTE_OTA_FLAG_FREE(i) (BIT2 << (i)) // can be filled
+#define LWLTE_OTA_FLAG_STOP BIT4
+
+static const char* TAG = "lwlte_ota";
+
+struct lwlte_ota_s {
+    lwlte_http_client_t* http;
+    char* path;
+    lwlte_sys_storage_t* storage;
+    uint8_t expected[LWLTE_SYS_SHA256_SIZE];
+    bool check_digest;
+    lwlte_sys_sha256_t sha;
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    bool complete;
+    uint8_t* buf[2]; // one block
+    size_t buffer_size;
+    size_t len[2]; // bytes of a full buffer
+    uint32_t offset[2]; // storage offset of a full buffer
+    size_t cur; // the buffer being filled
+    size_t fill;
+    uint32_t queued; // download position: bytes written or in a buffer
+    uint32_t written; // updated by the writer
+    uint32_t erased_end; // the storage is erased up to here, used by the writer
+    volatile lwlte_err_t write_err; // the first write error, the writer skips the buffers after it
+    bool too_large;
+    lwlte_sys_flags_t flags;
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_thread_t thread_handle;
+    lwlte_ota_stats_t stats;
+    uint32_t downloaded; // body bytes received by all the runs
+};
+
+/* Hash and write a buffer, erasing the sectors ahead, called from the writer task */
+static lwlte_err_t lwlte_ota_write(lwlte_ota_t* ota, const uint8_t* data, uint32_t offset, size_t len)
+{
+    lwlte_sys_storage_t* storage = ota->storage;
+    while (ota->erased_end < offset + len) {
+        lwlte_err_t err = storage->erase(storage->ctx, ota->erased_end, storage->sector_size);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        ota->erased_end += storage->sector_size;
+    }
+    lwlte_err_t err = storage->write(storage->ctx, offset, data, len);
+    if (err == LWLTE_OK) {
+        lwlte_sys_sha256_update(ota->sha, data, len);
+    }
+    return err;
+}
+
+static void lwlte_ota_task(void *pvParameters)
+{
+    lwlte_ota_t* ota = (lwlte_ota_t*)pvParameters;
+    size_t next = 0;
+    while (true) {
+        /* The buffers are written in the order they were filled */
+        lwlte_sys_flagbits_t bits = lwlte_sys_flags_wait(ota->flags, LWLTE_OTA_FLAG_FULL(next) | LWLTE_OTA_FLAG_STOP,
+            false, false, LWLTE_SYS_WAIT_FOREVER);
+        if (!(bits & LWLTE_OTA_FLAG_FULL(next))) {
+            break;
+        }
+        if (ota->write_err == LWLTE_OK) {
+            lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+            lwlte_err_t err = lwlte_ota_write(ota, ota->buf[next], ota->offset[next], ota->len[next]);
+            ota->stats.write_ms += lwlte_sys_time_get_ms() - start_ms;
+            if (err == LWLTE_OK) {
+                ota->written += ota->len[next];
+            }
+            else {
+                LWLTE_LOGE(TAG, "Failed to write %u bytes at %u!", (unsigned)ota->len[next], (unsigned)ota->offset[next]);
+                ota->write_err = err;
+            }
+        }
+        lwlte_sys_flags_clear(ota->flags, LWLTE_OTA_FLAG_FULL(next));
+        lwlte_sys_flags_set(ota->flags, LWLTE_OTA_FLAG_FREE(next));
+        next ^= 1;
+    }
+    /* Must be the last access to the context, lwlte_ota_end_internal frees it once this is given */
+    lwlte_sys_semaphore_signal(ota->exited);
+}
+
+/* Hand the buffer being filled to the writer */
+static void lwlte_ota_submit(lwlte_ota_t* ota)
+{
+    if (ota->fill == 0) {
+        return;
+    }
+    ota->len[ota->cur] = ota->fill;
+    ota->offset[ota->cur] = ota->queued;
+    ota->queued += ota->fill;
+    ota->fill = 0;
+    lwlte_sys_flags_set(ota->flags, LWLTE_OTA_FLAG_FULL(ota->cur));
+    ota->cur ^= 1;
+}
+
+/* The body of the image, called from the task of lwlte_ota_run_internal */
+static bool lwlte_ota_body_cb(size_t index, const void* data, size_t len, void* ctx)
+{
+    lwlte_ota_t* ota = (lwlte_ota_t*)ctx;
+    const uint8_t* src = (const uint8_t*)data;
+    ota->downloaded += len;
+    if (ota->queued + ota->fill + len > ota->storage->size) {
+        LWLTE_LOGE(TAG, "The image does not fit in the storage (%u bytes).", (unsigned)ota->storage->size);
+        ota->too_large = true;
+        return false;
+    }
+    while (len > 0) {
+        if (ota->write_err != LWLTE_OK) {
+            return false;
+        }
+        if (ota->fill == 0) {
+            /* Both buffers are being written: the flash is slower than the link */
+            lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+            lwlte_sys_flags_wait(ota->flags, LWLTE_OTA_FLAG_FREE(ota->cur), false, true, LWLTE_SYS_WAIT_FOREVER);
+            ota->stats.stall_ms += lwlte_sys_time_get_ms() - start_ms;
+        }
+        size_t n = ota->buffer_size - ota->fill < len ? ota->buffer_size - ota->fill : len;
+        memcpy(ota->buf[ota->cur] + ota->fill, src, n);
+        ota->fill += n;
+        src += n;
+        len -= n;
+        if (ota->fill == ota->buffer_size) {
+            lwlte_ota_submit(ota);
+        }
+    }
+    return true;
+}
+
+/* Start over from the first byte */
+static void lwlte_ota_reset(lwlte_ota_t* ota)
+{
+    uint8_t discard[LWLTE_SYS_SHA256_SIZE];
+    lwlte_sys_sha256_finish(ota->sha, discard);
+    ota->queued = 0;
+    ota->written = 0;
+    ota->erased_end = 0;
+    ota->complete = false;
+}
+
+/* Hash the bytes already in the storage, the buffers are free */
+static lwlte_err_t lwlte_ota_rehash(lwlte_ota_t* ota, uint32_t size)
+{
+    uint32_t offset = 0;
+    while (offset < size) {
+        size_t n = size - offset < ota->buffer_size ? size - offset : ota->buffer_size;
+        lwlte_err_t err = ota->storage->read(ota->storage->ctx, offset, ota->buf[0], n);
+        if (err != LWLTE_OK) {
+            return err;
+        }
+        lwlte_sys_sha256_update(ota->sha, ota->buf[0], n);
+        offset += n;
+    }
+    ota->queued = size;
+    ota->written = size;
+    /* The sector holding the last byte was erased before it was written */
+    uint32_t sector = ota->storage->sector_size;
+    ota->erased_end = (size + sector - 1) / sector * sector;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ota_begin_internal(const lwlte_ota_config_t* config, lwlte_ota_t** ota_out)
+{
+    if (config == NULL || ota_out == NULL || config->http == NULL || config->path == NULL ||
+        config->storage == NULL || config->storage->sector_size == 0 || config->resume_offset > config->storage->size) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_ota_t* ota = lwlte_sys_mem_malloc(sizeof(lwlte_ota_t));
+    if (ota == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(ota, 0, sizeof(lwlte_ota_t));
+    ota->http = config->http;
+    ota->storage = config->storage;
+    ota->check_digest = config->sha256 != NULL;
+    if (ota->check_digest) {
+        memcpy(ota->expected, config->sha256, LWLTE_SYS_SHA256_SIZE);
+    }
+    /* Fill in the defaults */
+    ota->buffer_size = config->buffer_size > 0 ? config->buffer_size : config->storage->sector_size;
+    ota->path = lwlte_sys_mem_malloc(strlen(config->path) + 1);
+    ota->buf[0] = lwlte_sys_mem_malloc(2 * ota->buffer_size);
+    ota->sha = lwlte_sys_sha256_create();
+    ota->flags = lwlte_sys_flags_create();
+    ota->exited = lwlte_sys_semaphore_create();
+    if (ota->path == NULL || ota->buf[0] == NULL || ota->sha == NULL || ota->flags == NULL || ota->exited == NULL) {
+        lwlte_ota_end_internal(ota);
+        return LWLTE_ERROR;
+    }
+    strcpy(ota->path, config->path);
+    ota->buf[1] = ota->buf[0] + ota->buffer_size;
+    lwlte_sys_flags_clear(ota->flags, LWLTE_FLAGS_ALL_BITS);
+    lwlte_sys_flags_set(ota->flags, LWLTE_OTA_FLAG_FREE(0) | LWLTE_OTA_FLAG_FREE(1));
+    lwlte_err_t err = lwlte_ota_rehash(ota, config->resume_offset);
+    if (err != LWLTE_OK) {
+        lwlte_ota_end_internal(ota);
+        return err;
+    }
+    /* Create the writer task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->task, "lwlte_ota_task", LWLTE_OTA_TASK_STACK_SIZE, 
+        LWLTE_OTA_TASK_PRIORITY, ota);
+    ota->thread_handle = lwlte_sys_thread_create(lwlte_ota_task, &thread_config);
+    if (ota->thread_handle == NULL) {
+        lwlte_ota_end_internal(ota);
+        return LWLTE_ERROR;
+    }
+    *ota_out = ota;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ota_run_internal(lwlte_ota_t* ota)
+{
+    if (ota == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (ota->complete) {
+        return LWLTE_OK;
+    }
+    if (ota->written > 0) {
+        ota->stats.resumes++;
+        LWLTE_LOGI(TAG, "Resuming %s from %u.", ota->path, (unsigned)ota->written);
+    }
+    /* The buffers that failed are downloaded again */
+    ota->queued = ota->written;
+    ota->write_err = LWLTE_OK;
+    ota->too_large = false;
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_http_request_t req = { .path = ota->path, .offset = ota->written };
+    lwlte_err_t err = lwlte_http_client_get_internal(ota->http, &req, 1, lwlte_ota_body_cb, ota);
+    /* Let the writer finish */
+    lwlte_ota_submit(ota);
+    lwlte_sys_flags_wait(ota->flags, LWLTE_OTA_FLAG_FREE(0) | LWLTE_OTA_FLAG_FREE(1), true, false,
+        LWLTE_SYS_WAIT_FOREVER);
+    ota->stats.elapsed_ms += lwlte_sys_time_get_ms() - start_ms;
+    ota->stats.resumes += req.resumes;
+    if (req.total_length > 0) {
+        ota->stats.image_size = req.total_length;
+    }
+    if (ota->too_large || ota->stats.image_size > ota->storage->size) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (ota->write_err != LWLTE_OK) {
+        /* The failed write may have programmed a part of its sector, the next run erases it and writes it again
+           from its start, the hash goes back to the bytes before it */
+        uint32_t sector_start = ota->written / ota->storage->sector_size * ota->storage->sector_size;
+        uint8_t discard[LWLTE_SYS_SHA256_SIZE];
+        lwlte_sys_sha256_finish(ota->sha, discard);
+        lwlte_err_t rehash_err = lwlte_ota_rehash(ota, sector_start);
+        if (rehash_err != LWLTE_OK) {
+            lwlte_ota_reset(ota);
+            return rehash_err;
+        }
+        return ota->write_err;
+    }
+    if (err != LWLTE_OK) {
+        /* A malformed or changed answer is worth another try as well */
+        return err == LWLTE_NOT_SUPPORTED ? LWLTE_ERROR : err;
+    }
+    if (req.status < 200 || req.status >= 300) {
+        LWLTE_LOGE(TAG, "%s: HTTP status %d.", ota->path, req.status);
+        return LWLTE_NOT_FOUND;
+    }
+    if (ota->stats.image_size > 0 && ota->written != ota->stats.image_size) {
+        return LWLTE_ERROR;
+    }
+    lwlte_sys_sha256_finish(ota->sha, ota->digest);
+    if (ota->check_digest && memcmp(ota->digest, ota->expected, LWLTE_SYS_SHA256_SIZE) != 0) {
+        LWLTE_LOGE(TAG, "%s: SHA-256 mismatch, the image is discarded.", ota->path);
+        lwlte_ota_reset(ota);
+        return LWLTE_NOT_SUPPORTED;
+    }
+    ota->complete = true;
+    ota->stats.image_size = ota->written;
+    LWLTE_LOGI(TAG, "%s: %u bytes written.", ota->path, (unsigned)ota->written);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ota_get_stats_internal(lwlte_ota_t* ota, lwlte_ota_stats_t* stats)
+{
+    if (ota == NULL || stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    *stats = ota->stats;
+    stats->written = ota->written;
+    stats->bytes_per_second = ota->stats.elapsed_ms > 0 ?
+        (uint32_t)((uint64_t)ota->downloaded * 1000 / ota->stats.elapsed_ms) : 0;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ota_get_sha256_internal(lwlte_ota_t* ota, uint8_t* digest)
+{
+    if (ota == NULL || digest == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (!ota->complete) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    memcpy(digest, ota->digest, LWLTE_SYS_SHA256_SIZE);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ota_end_internal(lwlte_ota_t* ota)
+{
+    if (ota == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (ota->thread_handle != NULL) {
+        lwlte_sys_flags_set(ota->flags, LWLTE_OTA_FLAG_STOP);
+        /* The task still uses the context, leak it rather than free it under the task */
+        if (!lwlte_sys_semaphore_wait(ota->exited, LWLTE_OTA_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_ota_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        ota->thread_handle = NULL;
+    }
+    lwlte_sys_flags_delete(ota->flags);
+    lwlte_sys_semaphore_delete(ota->exited);
+    lwlte_sys_sha256_delete(ota->sha);
+    lwlte_sys_mem_free(ota->buf[0]);
+    lwlte_sys_mem_free(ota->path);
+    lwlte_sys_mem_free(ota);
+    return LWLTE_OK;
+}
@@ -0,0 +1,295 @@
+/*
+    File: lwlte_ping.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte link probe source file
+    - Every probe is its own AT+CIPPING with one echo request, so the AT channel is only held for one RTT
+      and the other commands go between the probes of a round.
+    - A probe is a 16-bit RTT in a ring, the summary is computed from the ring when it is asked for.
+*/
+#include "lwlte_ping_probe.h"
+#include "lwlte_core.h"
+#include "lwlte_at_builder.h"
+#include "lwlte_at_parser.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+/* Defaults, used for the fields left zero in lwlte_ping_config_t */
+#define LWLTE_PING_SIZE 32
+#define LWLTE_PING_TIMEOUT_MS 5000
+#define LWLTE_PING_TASK_STACK_SIZE 4096
+#define LWLTE_PING_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+/* AT+CIPPING takes its timeout in units of 100 ms, up to 60 s */
+#define LWLTE_PING_TIMEOUT_UNIT_MS 100
+#define LWLTE_PING_TIMEOUT_MAX_UNITS 600
+/* Time for the module to take the command and answer on top of the probe timeout */
+#define LWLTE_PING_CMD_MARGIN_MS 2000
+/* How long the task sleeps without periodic rounds before it looks at the stop request again */
+#define LWLTE_PING_IDLE_WAIT_MS 1000
+/* A probe may be waiting for its answer when the task is stopped */
+#define LWLTE_PING_STOP_TIMEOUT_MS (LWLTE_PING_TIMEOUT_MAX_UNITS * LWLTE_PING_TIMEOUT_UNIT_MS + LWLTE_PING_CMD_MARGIN_MS)
+/* A ring entry of a lost probe, the RTTs are clamped below it */
+#define LWLTE_PING_SAMPLE_LOST UINT16_MAX
+
+static const char* TAG = "lwlte_ping";
+
+struct lwlte_ping_s {
+    lwlte_core_t* core;
+    char* cmd; // the AT+CIPPING of a probe, built once
+    lwlte_base_type_t timeout_ms;
+    lwlte_base_type_t burst;
+    lwlte_base_type_t interval_ms;
+    lwlte_sys_mutex_t lock; // the ring and the counters
+    uint16_t samples[LWLTE_PING_WINDOW]; // RTT in ms or LWLTE_PING_SAMPLE_LOST, oldest first from head - count
+    size_t head; // the next entry
+    size_t count;
+    uint32_t jitter_x16; // RFC 3550 estimate in 1/16 ms
+    uint32_t rtt_last_ms;
+    bool has_rtt; // the jitter has a previous RTT to compare with
+    uint32_t total_sent;
+    uint32_t total_lost;
+    lwlte_tick_t last_probe_ms;
+    lwlte_sys_thread_t thread_handle;
+    volatile bool stop;
+    lwlte_sys_semaphore_t wake;
+    lwlte_sys_semaphore_t exited;
+};
+
+/* Send one echo request, LWLTE_OK with its RTT if it was answered in time */
+static lwlte_err_t lwlte_ping_probe(lwlte_ping_t* ping, uint32_t* rtt_ms)
+{
+    lwlte_at_field_t fields[4];
+    lwlte_err_t err = lwlte_core_send_at_cmd_parse_internal(ping->core, ping->cmd, "OK", "ERROR",
+        ping->timeout_ms + LWLTE_PING_CMD_MARGIN_MS, LWLTE_AT_SCHEMA_CIPPING, fields, 4);
+    if (err != LWLTE_OK) {
+        return err;
+    }
+    /* The module reports a timed out request with a reply time past the timeout */
+    if (fields[2].v.i < 0 || (lwlte_base_type_t)fields[2].v.i >= ping->timeout_ms) {
+        return LWLTE_TIMEOUT;
+    }
+    *rtt_ms = (uint32_t)fields[2].v.i;
+    return LWLTE_OK;
+}
+
+/* Put a probe in the ring, called with the lock held */
+static void lwlte_ping_record(lwlte_ping_t* ping, bool answered, uint32_t rtt_ms)
+{
+    uint16_t sample = LWLTE_PING_SAMPLE_LOST;
+    if (answered) {
+        sample = rtt_ms < LWLTE_PING_SAMPLE_LOST ? (uint16_t)rtt_ms : LWLTE_PING_SAMPLE_LOST - 1;
+        if (ping->has_rtt) {
+            uint32_t d = rtt_ms > ping->rtt_last_ms ? rtt_ms - ping->rtt_last_ms : ping->rtt_last_ms - rtt_ms;
+            /* J += (|D| - J) / 16, kept in 1/16 ms */
+            ping->jitter_x16 = ping->jitter_x16 + d - ((ping->jitter_x16 + 8) >> 4);
+        }
+        ping->rtt_last_ms = rtt_ms;
+        ping->has_rtt = true;
+    }
+    else {
+        ping->total_lost++;
+    }
+    ping->total_sent++;
+    ping->samples[ping->head] = sample;
+    ping->head = (ping->head + 1) % LWLTE_PING_WINDOW;
+    if (ping->count < LWLTE_PING_WINDOW) {
+        ping->count++;
+    }
+    ping->last_probe_ms = lwlte_sys_time_get_ms();
+}
+
+static void lwlte_ping_round(lwlte_ping_t* ping)
+{
+    for (lwlte_base_type_t i = 0; i < ping->burst && !ping->stop; i++) {
+        uint32_t rtt_ms = 0;
+        lwlte_err_t err = lwlte_ping_probe(ping, &rtt_ms);
+        /* The link went down during the round, the probes say nothing about its quality */
+        if (err != LWLTE_OK && !lwlte_core_get_network_connected_internal(ping->core)) {
+            break;
+        }
+        lwlte_sys_mutex_lock(ping->lock);
+        lwlte_ping_record(ping, err == LWLTE_OK, rtt_ms);
+        lwlte_sys_mutex_unlock(ping->lock);
+    }
+}
+
+static void lwlte_ping_task(void *pvParameters)
+{
+    lwlte_ping_t* ping = (lwlte_ping_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_ping_task starts.");
+    lwlte_tick_t next_round_ms = lwlte_sys_time_get_ms();
+    while (!ping->stop) {
+        lwlte_base_type_t wait_ms = LWLTE_PING_IDLE_WAIT_MS;
+        if (ping->interval_ms > 0) {
+            int32_t left = (int32_t)(next_round_ms - lwlte_sys_time_get_ms());
+            wait_ms = left > 0 ? left : 0;
+        }
+        bool triggered = wait_ms > 0 ? lwlte_sys_semaphore_wait(ping->wake, wait_ms) : false;
+        if (ping->stop) {
+            break;
+        }
+        lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+        if (!triggered && (ping->interval_ms == 0 || (int32_t)(now_ms - next_round_ms) < 0)) {
+            continue;
+        }
+        /* A trigger restarts the period, the periods missed by a long round are skipped */
+        next_round_ms = now_ms + ping->interval_ms;
+        if (lwlte_core_get_network_connected_internal(ping->core)) {
+            lwlte_ping_round(ping);
+        }
+    }
+    LWLTE_LOGI(TAG, "lwlte_ping_task exits.");
+    /* Must be the last access to the context, lwlte_ping_destroy_internal frees it once this is given */
+    lwlte_sys_semaphore_signal(ping->exited);
+}
+
+lwlte_err_t lwlte_ping_create_internal(lwlte_core_t* core, const lwlte_ping_config_t* config, lwlte_ping_t** ping_out)
+{
+    if (core == NULL || config == NULL || ping_out == NULL || config->host == NULL || config->host[0] == '\0') {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_ping_t* ping = lwlte_sys_mem_malloc(sizeof(lwlte_ping_t));
+    if (ping == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(ping, 0, sizeof(lwlte_ping_t));
+    ping->core = core;
+    /* Fill in the defaults */
+    lwlte_base_type_t size = config->size > 0 ? config->size : LWLTE_PING_SIZE;
+    ping->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : LWLTE_PING_TIMEOUT_MS;
+    ping->burst = config->burst > 0 ? config->burst : 1;
+    ping->interval_ms = config->interval_ms;
+    int32_t timeout_units = (ping->timeout_ms + LWLTE_PING_TIMEOUT_UNIT_MS - 1) / LWLTE_PING_TIMEOUT_UNIT_MS;
+    if (timeout_units > LWLTE_PING_TIMEOUT_MAX_UNITS) {
+        timeout_units = LWLTE_PING_TIMEOUT_MAX_UNITS;
+        ping->timeout_ms = LWLTE_PING_TIMEOUT_MAX_UNITS * LWLTE_PING_TIMEOUT_UNIT_MS;
+    }
+    size_t host_len = strlen(config->host);
+    size_t cmd_size = lwlte_at_builder_size(AT_CIPPING, host_len, 3, 1);
+    ping->cmd = lwlte_sys_mem_malloc(cmd_size);
+    ping->lock = lwlte_sys_mutex_create();
+    ping->wake = lwlte_sys_semaphore_create();
+    ping->exited = lwlte_sys_semaphore_create();
+    if (ping->cmd == NULL || ping->lock == NULL || ping->wake == NULL || ping->exited == NULL) {
+        lwlte_ping_destroy_internal(ping);
+        return LWLTE_ERROR;
+    }
+    /* "<host>",<count>,<size>,<timeout> */
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, ping->cmd, cmd_size);
+    lwlte_at_builder_str(&b, AT_CIPPING);
+    lwlte_at_builder_quoted(&b, config->host, host_len);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, 1);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, (int32_t)size);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, timeout_units);
+    if (lwlte_at_builder_end(&b) != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Host %s can not be sent to the module.", config->host);
+        lwlte_ping_destroy_internal(ping);
+        return LWLTE_INVALID_ARG;
+    }
+    /* Create the probe task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->task, "lwlte_ping_task", LWLTE_PING_TASK_STACK_SIZE, 
+        LWLTE_PING_TASK_PRIORITY, ping);
+    ping->thread_handle = lwlte_sys_thread_create(lwlte_ping_task, &thread_config);
+    if (ping->thread_handle == NULL) {
+        lwlte_ping_destroy_internal(ping);
+        return LWLTE_ERROR;
+    }
+    *ping_out = ping;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ping_destroy_internal(lwlte_ping_t* ping)
+{
+    if (ping == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (ping->thread_handle != NULL) {
+        ping->stop = true;
+        lwlte_sys_semaphore_signal(ping->wake);
+        /* The task still uses the context, leak it rather than free it under the task */
+        if (!lwlte_sys_semaphore_wait(ping->exited, LWLTE_PING_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_ping_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        ping->thread_handle = NULL;
+    }
+    lwlte_sys_semaphore_delete(ping->wake);
+    lwlte_sys_semaphore_delete(ping->exited);
+    lwlte_sys_mutex_delete(ping->lock);
+    lwlte_sys_mem_free(ping->cmd);
+    lwlte_sys_mem_free(ping);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ping_trigger_internal(lwlte_ping_t* ping)
+{
+    if (ping == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_semaphore_signal(ping->wake);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ping_reset_internal(lwlte_ping_t* ping)
+{
+    if (ping == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(ping->lock);
+    ping->head = 0;
+    ping->count = 0;
+    ping->jitter_x16 = 0;
+    ping->rtt_last_ms = 0;
+    ping->has_rtt = false;
+    lwlte_sys_mutex_unlock(ping->lock);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ping_get_summary_internal(lwlte_ping_t* ping, lwlte_ping_summary_t* summary)
+{
+    if (ping == NULL || summary == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    memset(summary, 0, sizeof(lwlte_ping_summary_t));
+    uint64_t rtt_sum_ms = 0;
+    lwlte_sys_mutex_lock(ping->lock);
+    for (size_t i = 0; i < ping->count; i++) {
+        uint16_t sample = ping->samples[(ping->head + LWLTE_PING_WINDOW - 1 - i) % LWLTE_PING_WINDOW];
+        summary->sent++;
+        if (sample == LWLTE_PING_SAMPLE_LOST) {
+            summary->lost++;
+            continue;
+        }
+        if (summary->sent - summary->lost == 1 || sample < summary->rtt_min_ms) {
+            summary->rtt_min_ms = sample;
+        }
+        if (sample > summary->rtt_max_ms) {
+            summary->rtt_max_ms = sample;
+        }
+        rtt_sum_ms += sample;
+        /* Bucket b ends at LWLTE_PING_BUCKET_FIRST_MS << b */
+        size_t bucket = 0;
+        while (bucket < LWLTE_PING_BUCKETS - 1 && sample >= (LWLTE_PING_BUCKET_FIRST_MS << bucket)) {
+            bucket++;
+        }
+        summary->histogram[bucket]++;
+    }
+    uint32_t answered = summary->sent - summary->lost;
+    summary->rtt_avg_ms = answered > 0 ? (uint32_t)(rtt_sum_ms / answered) : 0;
+    summary->loss_permille = summary->sent > 0 ? summary->lost * 1000 / summary->sent : 0;
+    summary->rtt_last_ms = ping->rtt_last_ms;
+    summary->jitter_ms = (ping->jitter_x16 + 8) >> 4;
+    summary->total_sent = ping->total_sent;
+    summary->total_lost = ping->total_lost;
+    summary->age_ms = ping->total_sent > 0 ? (uint32_t)(lwlte_sys_time_get_ms() - ping->last_probe_ms) : UINT32_MAX;
+    lwlte_sys_mutex_unlock(ping->lock);
+    return LWLTE_OK;
+}
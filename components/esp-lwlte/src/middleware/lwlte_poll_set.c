@@ -0,0 +1,185 @@
+/*
+    File: lwlte_poll_set.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte poll set source file
+*/
+#include "lwlte_poll_set.h"
+#include "lwlte_core.h"
+#include "lwlte_tcp.h"
+#include "lwlte_mqtt_client.h"
+#include "lwlte_sys_flags.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_thread.h"
+
+/* Set by lwlte_poll_set_wakeup_internal, next to LWLTE_CORE_WATCHER_WAKE */
+#define LWLTE_POLL_SET_FLAG_USER_WAKE BIT1
+
+struct lwlte_poll_s {
+    lwlte_sys_flags_t flags;
+};
+
+/* Make the set the watcher of the sources of the items, or stop with NULL */
+static void lwlte_poll_set_watch(lwlte_poll_item_t* items, size_t count, lwlte_sys_flags_t watcher)
+{
+    for (size_t i = 0; i < count; i++) {
+        lwlte_poll_item_t* item = &items[i];
+        if (item->type == LWLTE_POLL_SOCKET && item->source.socket.handle != NULL) {
+            lwlte_tcp_set_watcher_internal(item->source.socket.handle, watcher);
+        }
+        else if (item->type == LWLTE_POLL_MQTT && item->source.mqtt != NULL) {
+            lwlte_mqtt_client_set_watcher_internal(item->source.mqtt, watcher);
+        }
+        else if (item->type == LWLTE_POLL_LINK && item->source.link != NULL) {
+            lwlte_core_set_watcher_internal(item->source.link, watcher);
+        }
+    }
+}
+
+/* Set the ready bits of an item, and shorten *wait_ms to its next timer expiry */
+static uint32_t lwlte_poll_set_check(lwlte_poll_item_t* item, lwlte_tick_t now_ms, uint32_t* wait_ms)
+{
+    uint32_t ready = 0;
+    switch (item->type) {
+        case LWLTE_POLL_SOCKET: {
+            if (item->source.socket.handle == NULL || item->source.socket.sock < 0 ||
+                item->source.socket.sock >= LWLTE_SOCKET_MAX) {
+                return LWLTE_POLL_ERR;
+            }
+            lwlte_sys_flagbits_t bits = lwlte_sys_flags_get(lwlte_tcp_get_events_internal(item->source.socket.handle));
+            if (bits & LWLTE_TCP_EVENT_RX(item->source.socket.sock)) {
+                ready |= LWLTE_POLL_IN;
+            }
+            if (bits & LWLTE_TCP_EVENT_TX(item->source.socket.sock)) {
+                ready |= LWLTE_POLL_OUT;
+            }
+            break;
+        }
+        case LWLTE_POLL_MQTT: {
+            if (item->source.mqtt == NULL) {
+                return LWLTE_POLL_ERR;
+            }
+            uint32_t rx_count = lwlte_mqtt_client_get_rx_count_internal(item->source.mqtt);
+            /* The messages delivered before the first wait are not reported */
+            if (!item->started) {
+                item->mark = rx_count;
+                item->started = true;
+            }
+            if (rx_count != item->mark && (item->events & LWLTE_POLL_IN)) {
+                ready |= LWLTE_POLL_IN;
+                item->mark = rx_count;
+            }
+            break;
+        }
+        case LWLTE_POLL_LINK: {
+            if (item->source.link == NULL) {
+                return LWLTE_POLL_ERR;
+            }
+            ready |= lwlte_core_get_network_connected_internal(item->source.link) ? LWLTE_POLL_UP : LWLTE_POLL_DOWN;
+            break;
+        }
+        case LWLTE_POLL_TIMER: {
+            if (item->source.period_ms == 0) {
+                return LWLTE_POLL_ERR;
+            }
+            if (!item->started) {
+                item->mark = now_ms + item->source.period_ms;
+                item->started = true;
+            }
+            if ((int32_t)(now_ms - item->mark) >= 0 && (item->events & LWLTE_POLL_EXPIRED)) {
+                ready |= LWLTE_POLL_EXPIRED;
+                item->mark += item->source.period_ms;
+                /* The periods missed by a late wait are skipped */
+                if ((int32_t)(now_ms - item->mark) >= 0) {
+                    item->mark = now_ms + item->source.period_ms;
+                }
+            }
+            if (item->events & LWLTE_POLL_EXPIRED) {
+                uint32_t left = (int32_t)(item->mark - now_ms) > 0 ? item->mark - now_ms : 0;
+                *wait_ms = left < *wait_ms ? left : *wait_ms;
+            }
+            break;
+        }
+        default:
+            return LWLTE_POLL_ERR;
+    }
+    return ready & item->events;
+}
+
+lwlte_err_t lwlte_poll_set_create_internal(lwlte_poll_set_t** set)
+{
+    if (set == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_poll_set_t* s = lwlte_sys_mem_malloc(sizeof(lwlte_poll_set_t));
+    if (s == NULL) {
+        return LWLTE_ERROR;
+    }
+    s->flags = lwlte_sys_flags_create();
+    if (s->flags == NULL) {
+        lwlte_sys_mem_free(s);
+        return LWLTE_ERROR;
+    }
+    lwlte_sys_flags_clear(s->flags, LWLTE_FLAGS_ALL_BITS);
+    *set = s;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_poll_set_destroy_internal(lwlte_poll_set_t* set)
+{
+    if (set == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_flags_delete(set->flags);
+    lwlte_sys_mem_free(set);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_poll_set_wait_internal(lwlte_poll_set_t* set, lwlte_poll_item_t* items, size_t count,
+    uint32_t timeout_ms, size_t* ready)
+{
+    if (set == NULL || (items == NULL && count > 0) || ready == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    *ready = 0;
+    lwlte_poll_set_watch(items, count, set->flags);
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_err_t err = LWLTE_TIMEOUT;
+    while (true) {
+        /* Cleared before the check, a change during the check wakes the wait below at once */
+        lwlte_sys_flagbits_t woken = lwlte_sys_flags_wait(set->flags, 
+            LWLTE_CORE_WATCHER_WAKE | LWLTE_POLL_SET_FLAG_USER_WAKE, false, true, 0);
+        lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+        uint32_t elapsed_ms = now_ms - start_ms;
+        uint32_t wait_ms = LWLTE_SYS_WAIT_FOREVER;
+        if (timeout_ms != LWLTE_SYS_WAIT_FOREVER) {
+            wait_ms = elapsed_ms < timeout_ms ? timeout_ms - elapsed_ms : 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            items[i].revents = lwlte_poll_set_check(&items[i], now_ms, &wait_ms);
+            if (items[i].revents != 0) {
+                (*ready)++;
+            }
+        }
+        if (*ready > 0 || (woken & LWLTE_POLL_SET_FLAG_USER_WAKE)) {
+            err = LWLTE_OK;
+            break;
+        }
+        if (timeout_ms != LWLTE_SYS_WAIT_FOREVER && elapsed_ms >= timeout_ms) {
+            break;
+        }
+        lwlte_sys_flags_wait(set->flags, LWLTE_CORE_WATCHER_WAKE | LWLTE_POLL_SET_FLAG_USER_WAKE, false, false,
+            wait_ms);
+    }
+    lwlte_poll_set_watch(items, count, NULL);
+    return err;
+}
+
+lwlte_err_t lwlte_poll_set_wakeup_internal(lwlte_poll_set_t* set)
+{
+    if (set == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_flags_set(set->flags, LWLTE_POLL_SET_FLAG_USER_WAKE);
+    return LWLTE_OK;
+}
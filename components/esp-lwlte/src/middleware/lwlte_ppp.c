@@ -0,0 +1,183 @@
+/*
+    File: lwlte_ppp.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte PPP link source file
+*/
+#include "lwlte_ppp.h"
+#include "lwlte_core.h"
+#include "lwlte_sys_log.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_mutex.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+#if CONFIG_LWIP_PPP_SUPPORT
+
+#include "lwip/netif.h"
+#include "netif/ppp/pppapi.h"
+#include "netif/ppp/pppos.h"
+
+/* Time for the module to answer the dial command */
+#define LWLTE_PPP_DIAL_TIMEOUT_MS 10000
+/* Time for the LCP terminate handshake */
+#define LWLTE_PPP_CLOSE_TIMEOUT_MS 5000
+
+static const char* TAG = "lwlte_ppp";
+
+typedef struct {
+    lwlte_core_t* core;
+    ppp_pcb* pcb;
+    struct netif netif;
+    volatile bool link_up;
+    volatile bool closing;
+    lwlte_sys_semaphore_t dead; // given by the status callback once the link is down after a close
+} lwlte_ppp_context_t;
+
+/* lwIP hands the encoded PPP frames to the data channel, called from the TCP/IP thread */
+static u32_t lwlte_ppp_output_cb(ppp_pcb* pcb, u8_t* data, u32_t len, void* ctx)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ctx;
+    if (lwlte_core_data_write_internal(p->core, data, len) != LWLTE_OK) {
+        return 0;
+    }
+    return len;
+}
+
+/* Data channel input, called from the UART RX task */
+static void lwlte_ppp_data_sink(const uint8_t* data, size_t size, void* ctx)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ctx;
+    if (p->pcb != NULL) {
+        pppos_input_tcpip(p->pcb, (u8_t*)data, size);
+    }
+}
+
+static void lwlte_ppp_status_cb(ppp_pcb* pcb, int err_code, void* ctx)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ctx;
+    if (err_code == PPPERR_NONE) {
+        LWLTE_LOGI(TAG, "PPP link is up, IP address: %s", ip4addr_ntoa(netif_ip4_addr(&p->netif)));
+        p->link_up = true;
+        lwlte_core_set_link_up_internal(p->core, true);
+        return;
+    }
+    LWLTE_LOGW(TAG, "PPP link is down, error %d.", err_code);
+    p->link_up = false;
+    lwlte_core_set_link_up_internal(p->core, false);
+    /* Only a requested close waits for the end of the link, a link lost otherwise is left to the watchdog */
+    if (p->closing) {
+        lwlte_sys_semaphore_signal(p->dead);
+    }
+}
+
+lwlte_ppp_t lwlte_ppp_create(lwlte_core_t* core)
+{
+    lwlte_ppp_context_t* p = lwlte_sys_mem_malloc(sizeof(lwlte_ppp_context_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    memset(p, 0, sizeof(lwlte_ppp_context_t));
+    p->core = core;
+    p->dead = lwlte_sys_semaphore_create();
+    if (p->dead == NULL) {
+        lwlte_sys_mem_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void lwlte_ppp_delete(lwlte_ppp_t ppp)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ppp;
+    if (p == NULL) {
+        return;
+    }
+    lwlte_sys_semaphore_delete(p->dead);
+    lwlte_sys_mem_free(p);
+}
+
+lwlte_err_t lwlte_ppp_start_internal(lwlte_ppp_t ppp)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ppp;
+    if (p == NULL) {
+        return LWLTE_NOT_SUPPORTED;
+    }
+    /* A previous attempt is torn down before dialing again */
+    lwlte_ppp_stop_internal(p);
+    lwlte_err_t err = lwlte_core_enter_data_mode_internal(p->core, AT_DIAL, LWLTE_PPP_DIAL_TIMEOUT_MS);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Dial failed.");
+        return err;
+    }
+    p->pcb = pppapi_pppos_create(&p->netif, lwlte_ppp_output_cb, lwlte_ppp_status_cb, p);
+    if (p->pcb == NULL) {
+        lwlte_core_exit_data_mode_internal(p->core);
+        return LWLTE_ERROR;
+    }
+    lwlte_core_set_data_sink_internal(p->core, lwlte_ppp_data_sink, p);
+    pppapi_set_default(p->pcb);
+    ppp_set_usepeerdns(p->pcb, 1);
+    if (pppapi_connect(p->pcb, 0) != ERR_OK) {
+        lwlte_ppp_stop_internal(p);
+        return LWLTE_ERROR;
+    }
+    LWLTE_LOGI(TAG, "PPP started.");
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ppp_stop_internal(lwlte_ppp_t ppp)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ppp;
+    if (p == NULL || p->pcb == NULL) {
+        return LWLTE_OK;
+    }
+    p->closing = true;
+    lwlte_sys_semaphore_wait(p->dead, 0);
+    /* Terminate the link, the status callback reports it dead even if the peer does not answer */
+    if (pppapi_close(p->pcb, 0) == ERR_OK) {
+        lwlte_sys_semaphore_wait(p->dead, LWLTE_PPP_CLOSE_TIMEOUT_MS);
+    }
+    lwlte_core_set_data_sink_internal(p->core, NULL, NULL);
+    pppapi_free(p->pcb);
+    p->pcb = NULL;
+    p->closing = false;
+    p->link_up = false;
+    lwlte_core_set_link_up_internal(p->core, false);
+    LWLTE_LOGI(TAG, "PPP stopped.");
+    return lwlte_core_exit_data_mode_internal(p->core);
+}
+
+bool lwlte_ppp_get_link_up_internal(lwlte_ppp_t ppp)
+{
+    lwlte_ppp_context_t* p = (lwlte_ppp_context_t*)ppp;
+    return (p != NULL) && p->link_up;
+}
+
+#else
+
+lwlte_ppp_t lwlte_ppp_create(lwlte_core_t* core)
+{
+    return NULL;
+}
+
+void lwlte_ppp_delete(lwlte_ppp_t ppp)
+{
+}
+
+lwlte_err_t lwlte_ppp_start_internal(lwlte_ppp_t ppp)
+{
+    return LWLTE_NOT_SUPPORTED;
+}
+
+lwlte_err_t lwlte_ppp_stop_internal(lwlte_ppp_t ppp)
+{
+    return LWLTE_OK;
+}
+
+bool lwlte_ppp_get_link_up_internal(lwlte_ppp_t ppp)
+{
+    return false;
+}
+
+#endif
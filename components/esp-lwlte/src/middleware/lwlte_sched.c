@@ -0,0 +1,310 @@
+/*
+    File: lwlte_sched.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte multi-modem link scheduler source file
+    - Each link is weighted by its AT round-trip time, the commands queued on it and its CSQ,
+      the picks follow the weights with a smooth weighted round-robin.
+    - A link is left out as soon as it loses the network or its watchdog starts a recovery,
+      the scheduler task reports the transitions and refreshes the CSQ readings.
+*/
+#include "lwlte_sched.h"
+#include "lwlte_core.h"
+#include "lwlte_watchdog.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+/* Defaults, used for the fields left zero in lwlte_sched_config_t */
+#define LWLTE_SCHED_REFRESH_INTERVAL_MS 5000
+#define LWLTE_SCHED_TASK_STACK_SIZE 3072
+#define LWLTE_SCHED_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+/* A refresh may be waiting on an AT+CSQ of every link */
+#define LWLTE_SCHED_STOP_TIMEOUT_MS 10000
+/* Added to the measured latency so that an idle link with no sample yet is not infinitely better */
+#define LWLTE_SCHED_LATENCY_FLOOR_MS 20
+/* Best CSQ value, and the value assumed for a link that has no reading yet */
+#define LWLTE_SCHED_CSQ_MAX 31
+#define LWLTE_SCHED_CSQ_ASSUMED 15
+#define LWLTE_SCHED_WEIGHT_SCALE 1000000
+
+static const char* TAG = "lwlte_sched";
+
+typedef struct {
+    lwlte_core_t* core; // NULL: free slot
+    bool usable; // last state reported through on_link_event
+    uint32_t weight;
+    int64_t current_weight; // smooth weighted round-robin state
+    uint32_t picks;
+    uint32_t failovers;
+} lwlte_sched_link_t;
+
+struct lwlte_sched_s {
+    lwlte_sched_config_t config; // with the defaults filled in
+    lwlte_sched_link_t links[LWLTE_SCHED_MAX_LINKS];
+    lwlte_sys_mutex_t lock; // guards the links, held only for short computations
+    lwlte_sys_mutex_t refresh_lock; // held by the task while it talks to the links, a link is not removed under it
+    lwlte_sys_thread_t thread_handle;
+    volatile bool stop;
+    lwlte_sys_semaphore_t wake;
+    lwlte_sys_semaphore_t exited;
+};
+
+/* Network connected and not being recovered */
+static bool lwlte_sched_check_link(lwlte_core_t* core)
+{
+    if (!lwlte_core_get_network_connected_internal(core)) {
+        return false;
+    }
+    lwlte_watchdog_stats_t stats;
+    lwlte_watchdog_t watchdog = lwlte_core_get_watchdog_internal(core);
+    if (watchdog != NULL && lwlte_watchdog_get_stats(watchdog, &stats) == LWLTE_OK && 
+        stats.stage != LWLTE_WATCHDOG_STAGE_NONE) {
+        return false;
+    }
+    return true;
+}
+
+/* Weight of a usable link, inversely proportional to its cost */
+static uint32_t lwlte_sched_weight(lwlte_core_t* core)
+{
+    lwlte_core_health_t health;
+    if (lwlte_core_get_health_internal(core, &health) != LWLTE_OK) {
+        return 1;
+    }
+    lwlte_base_type_t csq = (health.csq >= 0 && health.csq <= LWLTE_SCHED_CSQ_MAX) ? health.csq : LWLTE_SCHED_CSQ_ASSUMED;
+    lwlte_base_type_t pending = health.pending_cmds > 0 ? health.pending_cmds : 0;
+    uint64_t cost = (uint64_t)(health.at_latency_ms + LWLTE_SCHED_LATENCY_FLOOR_MS) * (1 + pending);
+    /* The weakest signal doubles the cost: CSQ 31 counts once, CSQ 0 twice */
+    cost = cost * (2 * LWLTE_SCHED_CSQ_MAX - csq) / LWLTE_SCHED_CSQ_MAX;
+    uint32_t weight = (uint32_t)(LWLTE_SCHED_WEIGHT_SCALE / (cost > 0 ? cost : 1));
+    return weight > 0 ? weight : 1;
+}
+
+static lwlte_sched_link_t* lwlte_sched_find(lwlte_sched_t* sched, lwlte_core_t* core)
+{
+    for (int i = 0; i < LWLTE_SCHED_MAX_LINKS; i++) {
+        if (sched->links[i].core == core) {
+            return &sched->links[i];
+        }
+    }
+    return NULL;
+}
+
+/* Refresh the CSQ readings and report the links that went up or down */
+static void lwlte_sched_refresh(lwlte_sched_t* sched)
+{
+    lwlte_sys_mutex_lock(sched->refresh_lock);
+    for (int i = 0; i < LWLTE_SCHED_MAX_LINKS; i++) {
+        lwlte_core_t* core = sched->links[i].core;
+        if (core == NULL) {
+            continue;
+        }
+        /* AT+CSQ also keeps the latency average of an idle link up to date, a link not ready is skipped */
+        lwlte_base_type_t csq;
+        lwlte_core_refresh_signal_internal(core, &csq);
+        bool usable = lwlte_sched_check_link(core);
+        lwlte_sys_mutex_lock(sched->lock);
+        bool changed = usable != sched->links[i].usable;
+        sched->links[i].usable = usable;
+        if (changed && !usable) {
+            sched->links[i].failovers++;
+        }
+        lwlte_sys_mutex_unlock(sched->lock);
+        if (changed) {
+            LWLTE_LOGW(TAG, "Link %d is %s.", i, usable ? "up" : "down, failing its traffic over");
+            if (sched->config.on_link_event != NULL) {
+                sched->config.on_link_event(core, usable, sched->config.ctx);
+            }
+        }
+    }
+    lwlte_sys_mutex_unlock(sched->refresh_lock);
+}
+
+static void lwlte_sched_task(void *pvParameters)
+{
+    lwlte_sched_t* sched = (lwlte_sched_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_sched_task starts.");
+    while (!sched->stop) {
+        lwlte_sched_refresh(sched);
+        lwlte_sys_semaphore_wait(sched->wake, sched->config.refresh_interval_ms);
+    }
+    LWLTE_LOGI(TAG, "lwlte_sched_task exits.");
+    /* Must be the last access to the scheduler, lwlte_sched_destroy_internal frees it once this is given */
+    lwlte_sys_semaphore_signal(sched->exited);
+}
+
+lwlte_err_t lwlte_sched_create_internal(const lwlte_sched_config_t* config, lwlte_sched_t** sched)
+{
+    if (config == NULL || sched == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sched_t* s = lwlte_sys_mem_malloc(sizeof(lwlte_sched_t));
+    if (s == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(s, 0, sizeof(lwlte_sched_t));
+    s->config = *config;
+    if (s->config.refresh_interval_ms <= 0) {
+        s->config.refresh_interval_ms = LWLTE_SCHED_REFRESH_INTERVAL_MS;
+    }
+    s->lock = lwlte_sys_mutex_create();
+    s->refresh_lock = lwlte_sys_mutex_create();
+    s->wake = lwlte_sys_semaphore_create();
+    s->exited = lwlte_sys_semaphore_create();
+    if (s->lock == NULL || s->refresh_lock == NULL || s->wake == NULL || s->exited == NULL) {
+        lwlte_sched_destroy_internal(s);
+        return LWLTE_ERROR;
+    }
+    /* Create the scheduler task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->task, "lwlte_sched_task", LWLTE_SCHED_TASK_STACK_SIZE, 
+        LWLTE_SCHED_TASK_PRIORITY, s);
+    s->thread_handle = lwlte_sys_thread_create(lwlte_sched_task, &thread_config);
+    if (s->thread_handle == NULL) {
+        lwlte_sched_destroy_internal(s);
+        return LWLTE_ERROR;
+    }
+    *sched = s;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_sched_destroy_internal(lwlte_sched_t* sched)
+{
+    if (sched == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (sched->thread_handle != NULL) {
+        sched->stop = true;
+        lwlte_sys_semaphore_signal(sched->wake);
+        if (!lwlte_sys_semaphore_wait(sched->exited, LWLTE_SCHED_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_sched_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        sched->thread_handle = NULL;
+    }
+    lwlte_sys_semaphore_delete(sched->wake);
+    lwlte_sys_semaphore_delete(sched->exited);
+    lwlte_sys_mutex_delete(sched->refresh_lock);
+    lwlte_sys_mutex_delete(sched->lock);
+    lwlte_sys_mem_free(sched);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_sched_add_link_internal(lwlte_sched_t* sched, lwlte_core_t* core)
+{
+    if (sched == NULL || core == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_err_t err = LWLTE_ERROR;
+    lwlte_sys_mutex_lock(sched->lock);
+    if (lwlte_sched_find(sched, core) != NULL) {
+        err = LWLTE_ALREADY_INITIALIZED;
+    }
+    else {
+        lwlte_sched_link_t* link = lwlte_sched_find(sched, NULL);
+        if (link != NULL) {
+            *link = (lwlte_sched_link_t){ .core = core };
+            err = LWLTE_OK;
+        }
+    }
+    lwlte_sys_mutex_unlock(sched->lock);
+    /* Report the new link at once */
+    if (err == LWLTE_OK) {
+        lwlte_sys_semaphore_signal(sched->wake);
+    }
+    return err;
+}
+
+lwlte_err_t lwlte_sched_remove_link_internal(lwlte_sched_t* sched, lwlte_core_t* core)
+{
+    if (sched == NULL || core == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* Wait for a refresh in progress, the instance may be destroyed right after this returns */
+    lwlte_sys_mutex_lock(sched->refresh_lock);
+    lwlte_sys_mutex_lock(sched->lock);
+    lwlte_sched_link_t* link = lwlte_sched_find(sched, core);
+    if (link != NULL) {
+        memset(link, 0, sizeof(lwlte_sched_link_t));
+    }
+    lwlte_sys_mutex_unlock(sched->lock);
+    lwlte_sys_mutex_unlock(sched->refresh_lock);
+    return link != NULL ? LWLTE_OK : LWLTE_NOT_FOUND;
+}
+
+lwlte_err_t lwlte_sched_pick_internal(lwlte_sched_t* sched, lwlte_core_t** core)
+{
+    if (sched == NULL || core == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(sched->lock);
+    lwlte_sched_link_t* best = NULL;
+    int64_t total_weight = 0;
+    for (int i = 0; i < LWLTE_SCHED_MAX_LINKS; i++) {
+        lwlte_sched_link_t* link = &sched->links[i];
+        if (link->core == NULL) {
+            continue;
+        }
+        /* Checked on every pick, the traffic leaves a failing link without waiting for the task */
+        if (!lwlte_sched_check_link(link->core)) {
+            link->weight = 0;
+            link->current_weight = 0;
+            continue;
+        }
+        link->weight = lwlte_sched_weight(link->core);
+        link->current_weight += link->weight;
+        total_weight += link->weight;
+        if (best == NULL || link->current_weight > best->current_weight) {
+            best = link;
+        }
+    }
+    if (best != NULL) {
+        best->current_weight -= total_weight;
+        best->picks++;
+        *core = best->core;
+    }
+    lwlte_sys_mutex_unlock(sched->lock);
+    return best != NULL ? LWLTE_OK : LWLTE_NOT_FOUND;
+}
+
+bool lwlte_sched_link_usable_internal(lwlte_sched_t* sched, lwlte_core_t* core)
+{
+    if (sched == NULL || core == NULL) {
+        return false;
+    }
+    lwlte_sys_mutex_lock(sched->lock);
+    bool usable = lwlte_sched_find(sched, core) != NULL && lwlte_sched_check_link(core);
+    lwlte_sys_mutex_unlock(sched->lock);
+    return usable;
+}
+
+lwlte_err_t lwlte_sched_get_link_stats_internal(lwlte_sched_t* sched, lwlte_core_t* core, lwlte_sched_link_stats_t* stats)
+{
+    if (sched == NULL || core == NULL || stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(sched->lock);
+    lwlte_sched_link_t* link = lwlte_sched_find(sched, core);
+    if (link == NULL) {
+        lwlte_sys_mutex_unlock(sched->lock);
+        return LWLTE_NOT_FOUND;
+    }
+    lwlte_core_health_t health = { .csq = LWLTE_CORE_CSQ_UNKNOWN };
+    lwlte_core_get_health_internal(core, &health);
+    *stats = (lwlte_sched_link_stats_t){
+        .usable = lwlte_sched_check_link(core),
+        .latency_ms = health.at_latency_ms,
+        .pending_cmds = health.pending_cmds,
+        .csq = health.csq,
+        .weight = link->weight,
+        .picks = link->picks,
+        .failovers = link->failovers,
+    };
+    lwlte_sys_mutex_unlock(sched->lock);
+    return LWLTE_OK;
+}
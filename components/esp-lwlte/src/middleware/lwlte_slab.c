@@ -0,0 +1,135 @@
+/*
+    File: lwlte_slab.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte fixed-size block pool source file
+*/
+#include "lwlte_slab.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include <string.h>
+
+#define LWLTE_SLAB_ALIGN(n) (((n) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+typedef struct lwlte_slab_block_s {
+    struct lwlte_slab_block_s* next;
+} lwlte_slab_block_t;
+
+typedef struct {
+    char* blocks; // block_count blocks of block_size bytes
+    lwlte_slab_block_t* free_list;
+    lwlte_slab_stats_t stats;
+    lwlte_sys_mutex_t lock;
+} lwlte_slab_context_t;
+
+lwlte_slab_t lwlte_slab_create(size_t block_size, size_t block_count)
+{
+    if (block_size == 0 || block_count == 0) {
+        return NULL;
+    }
+    lwlte_slab_context_t* s = lwlte_sys_mem_malloc(sizeof(lwlte_slab_context_t));
+    if (s == NULL) {
+        return NULL;
+    }
+    memset(s, 0, sizeof(lwlte_slab_context_t));
+    s->stats.block_size = LWLTE_SLAB_ALIGN(block_size < sizeof(lwlte_slab_block_t) ? 
+        sizeof(lwlte_slab_block_t) : block_size);
+    s->stats.block_count = block_count;
+    s->blocks = lwlte_sys_mem_malloc(s->stats.block_size * block_count);
+    s->lock = lwlte_sys_mutex_create();
+    if (s->blocks == NULL || s->lock == NULL) {
+        lwlte_slab_delete(s);
+        return NULL;
+    }
+    /* Chain the blocks in address order */
+    for (size_t i = block_count; i > 0; i--) {
+        lwlte_slab_block_t* block = (lwlte_slab_block_t*)(s->blocks + (i - 1) * s->stats.block_size);
+        block->next = s->free_list;
+        s->free_list = block;
+    }
+    return s;
+}
+
+void lwlte_slab_delete(lwlte_slab_t slab)
+{
+    lwlte_slab_context_t* s = (lwlte_slab_context_t*)slab;
+    if (s == NULL) {
+        return;
+    }
+    lwlte_sys_mem_free(s->blocks);
+    lwlte_sys_mutex_delete(s->lock);
+    lwlte_sys_mem_free(s);
+}
+
+void* lwlte_slab_alloc(lwlte_slab_t slab, size_t size)
+{
+    lwlte_slab_context_t* s = (lwlte_slab_context_t*)slab;
+    if (s == NULL) {
+        return NULL;
+    }
+    lwlte_sys_mutex_lock(s->lock);
+    lwlte_slab_block_t* block = NULL;
+    if (size > s->stats.block_size) {
+        s->stats.oversize++;
+    }
+    else if (s->free_list == NULL) {
+        s->stats.exhausted++;
+    }
+    else {
+        block = s->free_list;
+        s->free_list = block->next;
+        s->stats.in_use++;
+        if (s->stats.in_use > s->stats.peak) {
+            s->stats.peak = s->stats.in_use;
+        }
+    }
+    lwlte_sys_mutex_unlock(s->lock);
+    return block;
+}
+
+static bool lwlte_slab_owns(lwlte_slab_context_t* s, const void* ptr)
+{
+    return s != NULL && (const char*)ptr >= s->blocks && 
+        (const char*)ptr < s->blocks + s->stats.block_size * s->stats.block_count;
+}
+
+void lwlte_slab_free(lwlte_slab_t slab, void* block)
+{
+    lwlte_slab_context_t* s = (lwlte_slab_context_t*)slab;
+    if (block == NULL || !lwlte_slab_owns(s, block)) {
+        return;
+    }
+    lwlte_sys_mutex_lock(s->lock);
+    ((lwlte_slab_block_t*)block)->next = s->free_list;
+    s->free_list = (lwlte_slab_block_t*)block;
+    s->stats.in_use--;
+    lwlte_sys_mutex_unlock(s->lock);
+}
+
+void* lwlte_slab_acquire(lwlte_slab_t slab, size_t size)
+{
+    void* ptr = lwlte_slab_alloc(slab, size);
+    return ptr != NULL ? ptr : lwlte_sys_mem_malloc(size);
+}
+
+void lwlte_slab_release(lwlte_slab_t slab, void* ptr)
+{
+    if (lwlte_slab_owns((lwlte_slab_context_t*)slab, ptr)) {
+        lwlte_slab_free(slab, ptr);
+    }
+    else {
+        lwlte_sys_mem_free(ptr);
+    }
+}
+
+void lwlte_slab_get_stats(lwlte_slab_t slab, lwlte_slab_stats_t* stats)
+{
+    lwlte_slab_context_t* s = (lwlte_slab_context_t*)slab;
+    if (s == NULL) {
+        memset(stats, 0, sizeof(lwlte_slab_stats_t));
+        return;
+    }
+    lwlte_sys_mutex_lock(s->lock);
+    *stats = s->stats;
+    lwlte_sys_mutex_unlock(s->lock);
+}
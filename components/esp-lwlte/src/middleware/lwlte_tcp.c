@@ -0,0 +1,817 @@
+/*
+    File: lwlte_tcp.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte multiplexed socket layer source file
+*/
+#include "lwlte_tcp.h"
+#include "lwlte_at_builder.h"
+#include "lwlte_at_parser.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_log.h"
+#include <string.h>
+
+/* Defaults, used for the fields left zero in lwlte_socket_config_t */
+#define LWLTE_TCP_RX_RING_SIZE 2048
+#define LWLTE_TCP_TX_RING_SIZE 2048
+#define LWLTE_TCP_TASK_STACK_SIZE 4096
+#define LWLTE_TCP_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+#define AT_CMD_MAX_LENGTH 100
+/* Bytes per AT+CIPSEND, also the largest datagram */
+#define LWLTE_TCP_SEND_CHUNK 1024
+/* Bytes per AT+CIPRXGET=2, less if the line buffer of the core is smaller */
+#define LWLTE_TCP_RXGET_MAX 1024
+/* Largest segment or datagram the module pushes with +RECEIVE */
+#define LWLTE_TCP_SEGMENT_MAX 1472
+/* Longest head of a +RECEIVE or +CIPRXGET: 2 URC before its data, with the line break */
+#define LWLTE_TCP_URC_HEADER_MAX 32
+#define LWLTE_TCP_CMD_TIMEOUT_MS 5000
+#define LWLTE_TCP_SEND_TIMEOUT_MS 10000
+/* Wait of the send task when it is not woken, a failed chunk is retried after it */
+#define LWLTE_TCP_IDLE_WAIT_MS 1000
+/* lwlte_tcp_close_internal lets the queued data go out for this long */
+#define LWLTE_TCP_CLOSE_FLUSH_MS 5000
+#define LWLTE_TCP_CLOSE_POLL_MS 50
+/* A chunk may be in flight when the task is stopped */
+#define LWLTE_TCP_STOP_TIMEOUT_MS 30000
+/* Length before each datagram in the rings of a UDP socket */
+#define LWLTE_TCP_DATAGRAM_HEADER 2
+
+static const char* TAG = "lwlte_tcp";
+
+typedef enum {
+    LWLTE_TCP_FREE = 0,
+    LWLTE_TCP_CONNECTING,
+    LWLTE_TCP_CONNECTED,
+    LWLTE_TCP_CLOSED, // by the peer or a failed connect, the socket waits for lwlte_tcp_close_internal
+} lwlte_tcp_state_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t size;
+    size_t head; // next byte to read
+    size_t used;
+} lwlte_tcp_ring_t;
+
+typedef struct {
+    lwlte_tcp_t* tcp; // for the URC handler of the socket
+    int id;
+    char prefix[4]; // "<id>, " starts the lines of the module about this connection
+    lwlte_tcp_state_t state;
+    lwlte_socket_type_t type;
+    uint32_t generation; // changed by every open and close, a chunk taken before is not consumed after
+    lwlte_tcp_ring_t rx;
+    lwlte_tcp_ring_t tx;
+    bool rx_held; // buffered mode: the module holds data for the socket
+    lwlte_socket_stats_t stats;
+} lwlte_tcp_socket_t;
+
+struct lwlte_tcp_s {
+    lwlte_core_t* core;
+    lwlte_socket_rx_mode_t rx_mode;
+    size_t rxget_max; // bytes per AT+CIPRXGET=2 that fit in the line buffer with their URC head
+    lwlte_tcp_socket_t sockets[LWLTE_SOCKET_MAX];
+    uint8_t* ring_block; // the rings of all the sockets, allocated once
+    uint8_t* chunk; // the chunk the send task is sending
+    lwlte_sys_mutex_t lock; // guards the sockets, taken by the URC handlers as well
+    lwlte_sys_flags_t events; // LWLTE_TCP_EVENT_* bits
+    volatile lwlte_sys_flags_t watcher; // woken on a change of the events, see lwlte_tcp_set_watcher_internal
+    volatile bool stop;
+    lwlte_sys_semaphore_t wake;
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_thread_t thread_handle;
+    bool urc_added;
+};
+
+static size_t lwlte_tcp_ring_free(const lwlte_tcp_ring_t* r)
+{
+    return r->size - r->used;
+}
+
+/* Copy out without consuming, from offset bytes after the head */
+static void lwlte_tcp_ring_peek(const lwlte_tcp_ring_t* r, size_t offset, void* out, size_t len)
+{
+    size_t start = (r->head + offset) % r->size;
+    size_t first = r->size - start < len ? r->size - start : len;
+    memcpy(out, r->buf + start, first);
+    memcpy((uint8_t*)out + first, r->buf, len - first);
+}
+
+static void lwlte_tcp_ring_consume(lwlte_tcp_ring_t* r, size_t len)
+{
+    r->head = (r->head + len) % r->size;
+    r->used -= len;
+}
+
+/* Append what fits, returns the bytes written */
+static size_t lwlte_tcp_ring_write(lwlte_tcp_ring_t* r, const void* data, size_t len)
+{
+    if (len > lwlte_tcp_ring_free(r)) {
+        len = lwlte_tcp_ring_free(r);
+    }
+    size_t tail = (r->head + r->used) % r->size;
+    size_t first = r->size - tail < len ? r->size - tail : len;
+    memcpy(r->buf + tail, data, first);
+    memcpy(r->buf, (const uint8_t*)data + first, len - first);
+    r->used += len;
+    return len;
+}
+
+/* Append a datagram with its length, whole or not at all */
+static bool lwlte_tcp_ring_write_datagram(lwlte_tcp_ring_t* r, const void* data, size_t len)
+{
+    if (len + LWLTE_TCP_DATAGRAM_HEADER > lwlte_tcp_ring_free(r)) {
+        return false;
+    }
+    uint8_t header[LWLTE_TCP_DATAGRAM_HEADER] = { (uint8_t)(len >> 8), (uint8_t)len };
+    lwlte_tcp_ring_write(r, header, LWLTE_TCP_DATAGRAM_HEADER);
+    lwlte_tcp_ring_write(r, data, len);
+    return true;
+}
+
+static size_t lwlte_tcp_ring_datagram_len(const lwlte_tcp_ring_t* r)
+{
+    uint8_t header[LWLTE_TCP_DATAGRAM_HEADER];
+    lwlte_tcp_ring_peek(r, 0, header, LWLTE_TCP_DATAGRAM_HEADER);
+    return ((size_t)header[0] << 8) | header[1];
+}
+
+static void lwlte_tcp_reset_socket(lwlte_tcp_socket_t* sock)
+{
+    sock->rx.head = 0;
+    sock->rx.used = 0;
+    sock->tx.head = 0;
+    sock->tx.used = 0;
+    sock->rx_held = false;
+    sock->generation++;
+}
+
+/* Set the event bits of a socket from its state, called with the lock held */
+static void lwlte_tcp_update_events(lwlte_tcp_t* tcp, lwlte_tcp_socket_t* sock)
+{
+    lwlte_sys_flagbits_t set = 0;
+    lwlte_sys_flagbits_t clear = 0;
+    if (sock->state != LWLTE_TCP_FREE && (sock->rx.used > 0 || sock->rx_held || sock->state == LWLTE_TCP_CLOSED)) {
+        set |= LWLTE_TCP_EVENT_RX(sock->id);
+    }
+    else {
+        clear |= LWLTE_TCP_EVENT_RX(sock->id);
+    }
+    size_t room = sock->type == LWLTE_SOCKET_UDP ? LWLTE_TCP_DATAGRAM_HEADER + 1 : 1;
+    if (sock->state == LWLTE_TCP_CONNECTED && lwlte_tcp_ring_free(&sock->tx) >= room) {
+        set |= LWLTE_TCP_EVENT_TX(sock->id);
+    }
+    else {
+        clear |= LWLTE_TCP_EVENT_TX(sock->id);
+    }
+    lwlte_sys_flagbits_t before = lwlte_sys_flags_get(tcp->events);
+    if (clear != 0) {
+        lwlte_sys_flags_clear(tcp->events, clear);
+    }
+    if (set != 0) {
+        lwlte_sys_flags_set(tcp->events, set);
+    }
+    lwlte_sys_flags_t watcher = tcp->watcher;
+    if (watcher != NULL && lwlte_sys_flags_get(tcp->events) != before) {
+        lwlte_sys_flags_set(watcher, LWLTE_CORE_WATCHER_WAKE);
+    }
+}
+
+/* Put received data in the ring of a socket, called from the core worker with the lock held */
+static void lwlte_tcp_deliver_locked(lwlte_tcp_t* tcp, lwlte_tcp_socket_t* sock, const char* data, size_t len)
+{
+    if (sock->state == LWLTE_TCP_FREE) {
+        return;
+    }
+    size_t written = 0;
+    /* A datagram read in buffered mode may be split, its bytes are kept as a stream */
+    if (sock->type == LWLTE_SOCKET_UDP && tcp->rx_mode == LWLTE_SOCKET_RX_PUSH) {
+        written = lwlte_tcp_ring_write_datagram(&sock->rx, data, len) ? len : 0;
+    }
+    else {
+        written = lwlte_tcp_ring_write(&sock->rx, data, len);
+    }
+    sock->stats.rx_bytes += written;
+    if (written < len) {
+        sock->stats.rx_dropped += len - written;
+        LWLTE_LOGW(TAG, "Receive ring of socket %d is full, %u bytes dropped.", sock->id, (unsigned)(len - written));
+    }
+    lwlte_tcp_update_events(tcp, sock);
+}
+
+/* Parse a decimal number, false if there is none */
+static bool lwlte_tcp_parse_uint(const char** p, const char* end, size_t* value)
+{
+    const char* digits = *p;
+    *value = 0;
+    while (*p < end && **p >= '0' && **p <= '9') {
+        *value = *value * 10 + (**p - '0');
+        (*p)++;
+    }
+    return *p != digits;
+}
+
+static lwlte_tcp_socket_t* lwlte_tcp_find_socket(lwlte_tcp_t* tcp, size_t id)
+{
+    return id < LWLTE_SOCKET_MAX ? &tcp->sockets[id] : NULL;
+}
+
+/* "<id>, CONNECT OK" and the other lines about a connection, called from the core worker */
+static size_t lwlte_tcp_state_urc(const char* data, size_t size, void* ctx)
+{
+    lwlte_tcp_socket_t* sock = (lwlte_tcp_socket_t*)ctx;
+    lwlte_tcp_t* tcp = sock->tcp;
+    const char* text = data + strlen(sock->prefix);
+    size_t text_len = size - strlen(sock->prefix);
+    size_t result = 0;
+    lwlte_sys_mutex_lock(tcp->lock);
+    if (text_len >= strlen("CONNECT OK") && memcmp(text, "CONNECT OK", strlen("CONNECT OK")) == 0) {
+        if (sock->state == LWLTE_TCP_CONNECTING) {
+            sock->state = LWLTE_TCP_CONNECTED;
+            lwlte_sys_flags_set(tcp->events, LWLTE_TCP_EVENT_STATE(sock->id));
+        }
+    }
+    else if ((text_len >= strlen("CONNECT FAIL") && memcmp(text, "CONNECT FAIL", strlen("CONNECT FAIL")) == 0) ||
+        (text_len >= strlen("CLOSED") && memcmp(text, "CLOSED", strlen("CLOSED")) == 0)) {
+        if (sock->state == LWLTE_TCP_CONNECTING || sock->state == LWLTE_TCP_CONNECTED) {
+            LWLTE_LOGI(TAG, "Socket %d: %.*s", sock->id, (int)text_len, text);
+            sock->state = LWLTE_TCP_CLOSED;
+            lwlte_sys_flags_set(tcp->events, LWLTE_TCP_EVENT_STATE(sock->id));
+        }
+    }
+    else {
+        /* "CLOSE OK", "SEND OK"... answer a command */
+        result = LWLTE_CORE_URC_PASS;
+    }
+    lwlte_tcp_update_events(tcp, sock);
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return result;
+}
+
+/* +RECEIVE,<id>,<len>:\r\n<data>, the data of push mode, called from the core worker */
+static size_t lwlte_tcp_receive_urc(const char* data, size_t size, void* ctx)
+{
+    lwlte_tcp_t* tcp = (lwlte_tcp_t*)ctx;
+    const char* end = data + size;
+    const char* p = data + strlen(URC_RECEIVE);
+    size_t id = 0;
+    size_t len = 0;
+    const char* nl = memchr(data, '\n', size);
+    if (nl == NULL || !lwlte_tcp_parse_uint(&p, end, &id) || p >= end || *p++ != ',' ||
+        !lwlte_tcp_parse_uint(&p, end, &len) || lwlte_tcp_find_socket(tcp, id) == NULL) {
+        LWLTE_LOGW(TAG, "Malformed RECEIVE: %.*s", (int)size, data);
+        return 0;
+    }
+    size_t header_len = nl + 1 - data;
+    if (size < header_len + len) {
+        return header_len + len - size;
+    }
+    lwlte_sys_mutex_lock(tcp->lock);
+    lwlte_tcp_deliver_locked(tcp, lwlte_tcp_find_socket(tcp, id), nl + 1, len);
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return 0;
+}
+
+/**
+ * +CIPRXGET: 1,<id> announces data held by the module, +CIPRXGET: 2,<id>,<len>,<remain>\r\n<data> is the answer
+ * of a read, called from the core worker
+ */
+static size_t lwlte_tcp_rxget_urc(const char* data, size_t size, void* ctx)
+{
+    lwlte_tcp_t* tcp = (lwlte_tcp_t*)ctx;
+    const char* nl = memchr(data, '\n', size);
+    lwlte_at_tokenizer_t tok;
+    int32_t mode = 0;
+    int32_t id = 0;
+    if (nl == NULL || !lwlte_at_tokenizer_init(&tok, data, nl + 1 - data, URC_CIPRXGET) ||
+        lwlte_at_next_int(&tok, &mode) != LWLTE_OK || lwlte_at_next_int(&tok, &id) != LWLTE_OK ||
+        id < 0 || lwlte_tcp_find_socket(tcp, id) == NULL) {
+        return LWLTE_CORE_URC_PASS;
+    }
+    lwlte_tcp_socket_t* sock = lwlte_tcp_find_socket(tcp, id);
+    if (mode == 1) {
+        lwlte_sys_mutex_lock(tcp->lock);
+        sock->rx_held = sock->state != LWLTE_TCP_FREE;
+        lwlte_tcp_update_events(tcp, sock);
+        lwlte_sys_mutex_unlock(tcp->lock);
+        return 0;
+    }
+    int32_t len = 0;
+    int32_t remain = 0;
+    if (mode != 2 || lwlte_at_next_int(&tok, &len) != LWLTE_OK || lwlte_at_next_int(&tok, &remain) != LWLTE_OK ||
+        len < 0) {
+        return LWLTE_CORE_URC_PASS;
+    }
+    size_t header_len = nl + 1 - data;
+    if (size < header_len + len) {
+        return header_len + len - size;
+    }
+    lwlte_sys_mutex_lock(tcp->lock);
+    sock->rx_held = remain > 0;
+    lwlte_tcp_deliver_locked(tcp, sock, nl + 1, len);
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return 0;
+}
+
+/* Copy the next chunk of a socket to tcp->chunk, returns its length, 0 if there is nothing to send */
+static size_t lwlte_tcp_take_chunk(lwlte_tcp_t* tcp, lwlte_tcp_socket_t* sock, size_t* consumed, uint32_t* generation)
+{
+    size_t len = 0;
+    lwlte_sys_mutex_lock(tcp->lock);
+    if (sock->state == LWLTE_TCP_CONNECTED && sock->tx.used > 0) {
+        if (sock->type == LWLTE_SOCKET_UDP) {
+            len = lwlte_tcp_ring_datagram_len(&sock->tx);
+            lwlte_tcp_ring_peek(&sock->tx, LWLTE_TCP_DATAGRAM_HEADER, tcp->chunk, len);
+            *consumed = LWLTE_TCP_DATAGRAM_HEADER + len;
+        }
+        else {
+            len = sock->tx.used < LWLTE_TCP_SEND_CHUNK ? sock->tx.used : LWLTE_TCP_SEND_CHUNK;
+            lwlte_tcp_ring_peek(&sock->tx, 0, tcp->chunk, len);
+            *consumed = len;
+        }
+        *generation = sock->generation;
+    }
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return len;
+}
+
+/* Send a chunk, the module takes it at once in quick send mode */
+static lwlte_err_t lwlte_tcp_send_chunk(lwlte_tcp_t* tcp, lwlte_tcp_socket_t* sock, size_t len)
+{
+    char at_cmd_buf[AT_CMD_MAX_LENGTH];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, at_cmd_buf, AT_CMD_MAX_LENGTH);
+    lwlte_at_builder_str(&b, AT_CIPSEND);
+    lwlte_at_builder_int(&b, sock->id);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, (int32_t)len);
+    lwlte_at_builder_end(&b);
+    lwlte_core_iovec_t iov = { .base = tcp->chunk, .len = len };
+    return lwlte_core_send_at_cmd_prompt_internal(tcp->core, at_cmd_buf, &iov, 1, "DATA ACCEPT", "ERROR",
+        LWLTE_TCP_SEND_TIMEOUT_MS, NULL, 0);
+}
+
+static void lwlte_tcp_task(void *pvParameters)
+{
+    lwlte_tcp_t* tcp = (lwlte_tcp_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_tcp_task starts.");
+    int first = 0;
+    while (!tcp->stop) {
+        lwlte_sys_semaphore_wait(tcp->wake, LWLTE_TCP_IDLE_WAIT_MS);
+        /* One chunk per socket and turn, a large send does not hold the others back.
+           A socket whose chunk failed waits for the next wake-up */
+        bool failed[LWLTE_SOCKET_MAX] = { 0 };
+        bool sent = true;
+        while (sent && !tcp->stop) {
+            sent = false;
+            for (int i = 0; i < LWLTE_SOCKET_MAX && !tcp->stop; i++) {
+                lwlte_tcp_socket_t* sock = &tcp->sockets[(first + i) % LWLTE_SOCKET_MAX];
+                size_t consumed = 0;
+                uint32_t generation = 0;
+                size_t len = failed[sock->id] ? 0 : lwlte_tcp_take_chunk(tcp, sock, &consumed, &generation);
+                if (len == 0) {
+                    continue;
+                }
+                lwlte_err_t err = lwlte_tcp_send_chunk(tcp, sock, len);
+                lwlte_sys_mutex_lock(tcp->lock);
+                if (err == LWLTE_OK && sock->generation == generation) {
+                    lwlte_tcp_ring_consume(&sock->tx, consumed);
+                    sock->stats.tx_bytes += len;
+                    lwlte_tcp_update_events(tcp, sock);
+                    sent = true;
+                }
+                else if (err != LWLTE_OK) {
+                    sock->stats.send_failures++;
+                    failed[sock->id] = true;
+                }
+                lwlte_sys_mutex_unlock(tcp->lock);
+                if (err != LWLTE_OK) {
+                    LWLTE_LOGW(TAG, "Failed to send on socket %d, retrying later.", sock->id);
+                }
+            }
+            first = (first + 1) % LWLTE_SOCKET_MAX;
+        }
+    }
+    LWLTE_LOGI(TAG, "lwlte_tcp_task exits.");
+    /* Must be the last access to the context, lwlte_tcp_destroy_internal frees it once this is given */
+    lwlte_sys_semaphore_signal(tcp->exited);
+}
+
+static lwlte_err_t lwlte_tcp_add_urc_handlers(lwlte_tcp_t* tcp)
+{
+    tcp->urc_added = true;
+    lwlte_err_t err = lwlte_core_add_urc_handler_internal(tcp->core, URC_RECEIVE, lwlte_tcp_receive_urc, tcp);
+    if (err == LWLTE_OK) {
+        err = lwlte_core_add_urc_handler_internal(tcp->core, URC_CIPRXGET, lwlte_tcp_rxget_urc, tcp);
+    }
+    for (int i = 0; i < LWLTE_SOCKET_MAX && err == LWLTE_OK; i++) {
+        err = lwlte_core_add_urc_handler_internal(tcp->core, tcp->sockets[i].prefix, lwlte_tcp_state_urc,
+            &tcp->sockets[i]);
+    }
+    return err;
+}
+
+static void lwlte_tcp_remove_urc_handlers(lwlte_tcp_t* tcp)
+{
+    if (!tcp->urc_added) {
+        return;
+    }
+    lwlte_core_remove_urc_handler_internal(tcp->core, URC_RECEIVE);
+    lwlte_core_remove_urc_handler_internal(tcp->core, URC_CIPRXGET);
+    for (int i = 0; i < LWLTE_SOCKET_MAX; i++) {
+        lwlte_core_remove_urc_handler_internal(tcp->core, tcp->sockets[i].prefix);
+    }
+    tcp->urc_added = false;
+}
+
+/* Switch the module to quick send and to the receive mode */
+static lwlte_err_t lwlte_tcp_setup_module(lwlte_tcp_t* tcp)
+{
+    lwlte_err_t err = lwlte_core_send_at_cmd_internal(tcp->core, AT_CIPQSEND_ON, "OK", "ERROR",
+        LWLTE_TCP_CMD_TIMEOUT_MS, NULL, 0);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to enable the quick send mode!");
+        return err;
+    }
+    int32_t mode = tcp->rx_mode == LWLTE_SOCKET_RX_BUFFERED ? 1 : 0;
+    char at_cmd_buf[AT_CMD_MAX_LENGTH];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, at_cmd_buf, AT_CMD_MAX_LENGTH);
+    lwlte_at_builder_str(&b, AT_CIPRXGET);
+    lwlte_at_builder_int(&b, mode);
+    lwlte_at_builder_end(&b);
+    err = lwlte_core_send_at_cmd_internal(tcp->core, at_cmd_buf, "OK", "ERROR", LWLTE_TCP_CMD_TIMEOUT_MS, NULL, 0);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to set the receive mode!");
+        return tcp->rx_mode == LWLTE_SOCKET_RX_BUFFERED ? LWLTE_NOT_SUPPORTED : err;
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_tcp_create_internal(lwlte_core_t* core, const lwlte_socket_config_t* config, lwlte_tcp_t** tcp_out)
+{
+    if (core == NULL || config == NULL || tcp_out == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_tcp_t* tcp = lwlte_sys_mem_malloc(sizeof(lwlte_tcp_t));
+    if (tcp == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(tcp, 0, sizeof(lwlte_tcp_t));
+    tcp->core = core;
+    tcp->rx_mode = config->rx_mode;
+    /* A URC larger than the line buffer is dropped by the core, the pushed segments must fit in it */
+    size_t line_size = lwlte_core_get_line_size_internal(core);
+    if (line_size <= LWLTE_TCP_URC_HEADER_MAX) {
+        lwlte_sys_mem_free(tcp);
+        return LWLTE_INVALID_ARG;
+    }
+    if (tcp->rx_mode == LWLTE_SOCKET_RX_PUSH && line_size <= LWLTE_TCP_SEGMENT_MAX + LWLTE_TCP_URC_HEADER_MAX) {
+        LWLTE_LOGW(TAG, "uart_buf_size %u can not hold a pushed segment, the sockets use the buffered mode.",
+            (unsigned)line_size);
+        tcp->rx_mode = LWLTE_SOCKET_RX_BUFFERED;
+    }
+    tcp->rxget_max = line_size - 1 - LWLTE_TCP_URC_HEADER_MAX;
+    if (tcp->rxget_max > LWLTE_TCP_RXGET_MAX) {
+        tcp->rxget_max = LWLTE_TCP_RXGET_MAX;
+    }
+    /* Fill in the defaults */
+    size_t rx_size = config->rx_ring_size > 0 ? config->rx_ring_size : LWLTE_TCP_RX_RING_SIZE;
+    size_t tx_size = config->tx_ring_size > 0 ? config->tx_ring_size : LWLTE_TCP_TX_RING_SIZE;
+    tcp->ring_block = lwlte_sys_mem_malloc(LWLTE_SOCKET_MAX * (rx_size + tx_size));
+    tcp->chunk = lwlte_sys_mem_malloc(LWLTE_TCP_SEND_CHUNK);
+    tcp->lock = lwlte_sys_mutex_create();
+    tcp->events = lwlte_sys_flags_create();
+    tcp->wake = lwlte_sys_semaphore_create();
+    tcp->exited = lwlte_sys_semaphore_create();
+    if (tcp->ring_block == NULL || tcp->chunk == NULL || tcp->lock == NULL || tcp->events == NULL ||
+        tcp->wake == NULL || tcp->exited == NULL) {
+        lwlte_tcp_destroy_internal(tcp);
+        return LWLTE_ERROR;
+    }
+    lwlte_sys_flags_clear(tcp->events, LWLTE_FLAGS_ALL_BITS);
+    for (int i = 0; i < LWLTE_SOCKET_MAX; i++) {
+        lwlte_tcp_socket_t* sock = &tcp->sockets[i];
+        sock->tcp = tcp;
+        sock->id = i;
+        sock->prefix[0] = (char)('0' + i);
+        sock->prefix[1] = ',';
+        sock->prefix[2] = ' ';
+        sock->prefix[3] = '\0';
+        sock->rx.buf = tcp->ring_block + i * (rx_size + tx_size);
+        sock->rx.size = rx_size;
+        sock->tx.buf = sock->rx.buf + rx_size;
+        sock->tx.size = tx_size;
+    }
+    lwlte_err_t err = lwlte_tcp_setup_module(tcp);
+    if (err == LWLTE_OK) {
+        err = lwlte_tcp_add_urc_handlers(tcp);
+    }
+    if (err != LWLTE_OK) {
+        lwlte_tcp_destroy_internal(tcp);
+        return err;
+    }
+    /* Create the send task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->task, "lwlte_tcp_task", LWLTE_TCP_TASK_STACK_SIZE, 
+        LWLTE_TCP_TASK_PRIORITY, tcp);
+    tcp->thread_handle = lwlte_sys_thread_create(lwlte_tcp_task, &thread_config);
+    if (tcp->thread_handle == NULL) {
+        lwlte_tcp_destroy_internal(tcp);
+        return LWLTE_ERROR;
+    }
+    *tcp_out = tcp;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_tcp_destroy_internal(lwlte_tcp_t* tcp)
+{
+    if (tcp == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (tcp->thread_handle != NULL) {
+        tcp->stop = true;
+        lwlte_sys_semaphore_signal(tcp->wake);
+        /* The task still uses the context, leak it rather than free it under the task */
+        if (!lwlte_sys_semaphore_wait(tcp->exited, LWLTE_TCP_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_tcp_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        tcp->thread_handle = NULL;
+    }
+    /* The queued data is dropped, nothing sends it any more */
+    for (int i = 0; i < LWLTE_SOCKET_MAX && tcp->lock != NULL; i++) {
+        if (tcp->sockets[i].state != LWLTE_TCP_FREE) {
+            lwlte_sys_mutex_lock(tcp->lock);
+            tcp->sockets[i].tx.used = 0;
+            lwlte_sys_mutex_unlock(tcp->lock);
+            lwlte_tcp_close_internal(tcp, i);
+        }
+    }
+    lwlte_tcp_remove_urc_handlers(tcp);
+    lwlte_sys_mutex_delete(tcp->lock);
+    lwlte_sys_flags_delete(tcp->events);
+    lwlte_sys_semaphore_delete(tcp->wake);
+    lwlte_sys_semaphore_delete(tcp->exited);
+    lwlte_sys_mem_free(tcp->chunk);
+    lwlte_sys_mem_free(tcp->ring_block);
+    lwlte_sys_mem_free(tcp);
+    return LWLTE_OK;
+}
+
+/* The host and port of AT+CIPSTART, the host is quoted */
+static bool lwlte_tcp_check_host(const char* host)
+{
+    if (host == NULL || host[0] == '\0') {
+        return false;
+    }
+    for (const char* p = host; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\r' || *p == '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+lwlte_err_t lwlte_tcp_open_internal(lwlte_tcp_t* tcp, lwlte_socket_type_t type, const char* host, uint16_t port,
+    lwlte_base_type_t timeout_ms, int* id)
+{
+    if (tcp == NULL || id == NULL || !lwlte_tcp_check_host(host) || port == 0 ||
+        (type != LWLTE_SOCKET_TCP && type != LWLTE_SOCKET_UDP)) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* Take a free socket */
+    lwlte_tcp_socket_t* sock = NULL;
+    lwlte_sys_mutex_lock(tcp->lock);
+    for (int i = 0; i < LWLTE_SOCKET_MAX && sock == NULL; i++) {
+        if (tcp->sockets[i].state == LWLTE_TCP_FREE) {
+            sock = &tcp->sockets[i];
+            lwlte_tcp_reset_socket(sock);
+            memset(&sock->stats, 0, sizeof(lwlte_socket_stats_t));
+            sock->type = type;
+            sock->state = LWLTE_TCP_CONNECTING;
+            lwlte_sys_flags_clear(tcp->events, LWLTE_TCP_EVENT_STATE(sock->id));
+            lwlte_tcp_update_events(tcp, sock);
+        }
+    }
+    lwlte_sys_mutex_unlock(tcp->lock);
+    if (sock == NULL) {
+        return LWLTE_NOT_FOUND;
+    }
+    /* The module answers OK at once and reports the connection later */
+    size_t size = lwlte_at_builder_size(AT_CIPSTART, strlen(host) + strlen("TCP"), 2, 2);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    lwlte_err_t err = LWLTE_ERROR;
+    if (cmd != NULL) {
+        lwlte_at_builder_t b;
+        lwlte_at_builder_init(&b, cmd, size);
+        lwlte_at_builder_str(&b, AT_CIPSTART);
+        lwlte_at_builder_int(&b, sock->id);
+        lwlte_at_builder_raw(&b, type == LWLTE_SOCKET_TCP ? ",\"TCP\"," : ",\"UDP\",", strlen(",\"TCP\","));
+        lwlte_at_builder_quoted(&b, host, strlen(host));
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_int(&b, port);
+        err = lwlte_at_builder_end(&b);
+        if (err == LWLTE_OK) {
+            err = lwlte_core_send_at_cmd_internal(tcp->core, cmd, "OK", "ERROR", LWLTE_TCP_CMD_TIMEOUT_MS, NULL, 0);
+        }
+        lwlte_sys_mem_free(cmd);
+    }
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to open socket %d to %s:%u!", sock->id, host, (unsigned)port);
+        lwlte_sys_mutex_lock(tcp->lock);
+        sock->state = LWLTE_TCP_FREE;
+        lwlte_tcp_update_events(tcp, sock);
+        lwlte_sys_mutex_unlock(tcp->lock);
+        return err;
+    }
+    *id = sock->id;
+    if (timeout_ms == 0) {
+        return LWLTE_OK;
+    }
+    lwlte_sys_flags_wait(tcp->events, LWLTE_TCP_EVENT_STATE(sock->id), false, false, timeout_ms);
+    lwlte_sys_mutex_lock(tcp->lock);
+    lwlte_tcp_state_t state = sock->state;
+    lwlte_sys_mutex_unlock(tcp->lock);
+    if (state == LWLTE_TCP_CONNECTED) {
+        return LWLTE_OK;
+    }
+    lwlte_tcp_close_internal(tcp, sock->id);
+    return state == LWLTE_TCP_CONNECTING ? LWLTE_TIMEOUT : LWLTE_ERROR;
+}
+
+lwlte_err_t lwlte_tcp_send_internal(lwlte_tcp_t* tcp, int id, const void* data, size_t len, size_t* sent)
+{
+    lwlte_tcp_socket_t* sock = tcp != NULL && id >= 0 ? lwlte_tcp_find_socket(tcp, id) : NULL;
+    if (sock == NULL || data == NULL || sent == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    *sent = 0;
+    lwlte_sys_mutex_lock(tcp->lock);
+    if (sock->state != LWLTE_TCP_CONNECTED) {
+        lwlte_sys_mutex_unlock(tcp->lock);
+        return sock->state == LWLTE_TCP_FREE ? LWLTE_INVALID_ARG : LWLTE_ERROR;
+    }
+    if (sock->type == LWLTE_SOCKET_UDP) {
+        if (len == 0 || len > LWLTE_TCP_SEND_CHUNK) {
+            lwlte_sys_mutex_unlock(tcp->lock);
+            return LWLTE_INVALID_ARG;
+        }
+        *sent = lwlte_tcp_ring_write_datagram(&sock->tx, data, len) ? len : 0;
+    }
+    else {
+        *sent = lwlte_tcp_ring_write(&sock->tx, data, len);
+    }
+    lwlte_tcp_update_events(tcp, sock);
+    lwlte_sys_mutex_unlock(tcp->lock);
+    if (*sent > 0) {
+        lwlte_sys_semaphore_signal(tcp->wake);
+    }
+    return LWLTE_OK;
+}
+
+/* Ask the module for the data it holds, the URC handler puts it in the ring */
+static lwlte_err_t lwlte_tcp_pull(lwlte_tcp_t* tcp, lwlte_tcp_socket_t* sock, size_t room)
+{
+    char at_cmd_buf[AT_CMD_MAX_LENGTH];
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, at_cmd_buf, AT_CMD_MAX_LENGTH);
+    lwlte_at_builder_str(&b, AT_CIPRXGET);
+    lwlte_at_builder_raw(&b, "2,", 2);
+    lwlte_at_builder_int(&b, sock->id);
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, (int32_t)(room < tcp->rxget_max ? room : tcp->rxget_max));
+    lwlte_at_builder_end(&b);
+    lwlte_err_t err = lwlte_core_send_at_cmd_internal(tcp->core, at_cmd_buf, "OK", "ERROR",
+        LWLTE_TCP_CMD_TIMEOUT_MS, NULL, 0);
+    if (err != LWLTE_OK) {
+        /* The module has nothing for the socket (e.g. the connection is gone) */
+        lwlte_sys_mutex_lock(tcp->lock);
+        sock->rx_held = false;
+        lwlte_tcp_update_events(tcp, sock);
+        lwlte_sys_mutex_unlock(tcp->lock);
+    }
+    return err;
+}
+
+lwlte_err_t lwlte_tcp_recv_internal(lwlte_tcp_t* tcp, int id, void* buf, size_t size, lwlte_base_type_t wait_ms,
+    size_t* received)
+{
+    lwlte_tcp_socket_t* sock = tcp != NULL && id >= 0 ? lwlte_tcp_find_socket(tcp, id) : NULL;
+    if (sock == NULL || buf == NULL || size == 0 || received == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    *received = 0;
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    while (true) {
+        lwlte_sys_mutex_lock(tcp->lock);
+        if (sock->state == LWLTE_TCP_FREE) {
+            lwlte_sys_mutex_unlock(tcp->lock);
+            return LWLTE_INVALID_ARG;
+        }
+        if (sock->rx.used > 0) {
+            if (sock->type == LWLTE_SOCKET_UDP && tcp->rx_mode == LWLTE_SOCKET_RX_PUSH) {
+                /* One datagram, the part that does not fit in buf is lost as with a datagram socket */
+                size_t len = lwlte_tcp_ring_datagram_len(&sock->rx);
+                *received = len < size ? len : size;
+                lwlte_tcp_ring_peek(&sock->rx, LWLTE_TCP_DATAGRAM_HEADER, buf, *received);
+                lwlte_tcp_ring_consume(&sock->rx, LWLTE_TCP_DATAGRAM_HEADER + len);
+            }
+            else {
+                *received = sock->rx.used < size ? sock->rx.used : size;
+                lwlte_tcp_ring_peek(&sock->rx, 0, buf, *received);
+                lwlte_tcp_ring_consume(&sock->rx, *received);
+            }
+            lwlte_tcp_update_events(tcp, sock);
+            lwlte_sys_mutex_unlock(tcp->lock);
+            return LWLTE_OK;
+        }
+        bool pull = sock->rx_held;
+        bool closed = sock->state == LWLTE_TCP_CLOSED;
+        size_t room = lwlte_tcp_ring_free(&sock->rx);
+        lwlte_sys_mutex_unlock(tcp->lock);
+        if (pull) {
+            lwlte_err_t err = lwlte_tcp_pull(tcp, sock, room);
+            if (err != LWLTE_OK) {
+                return err;
+            }
+            continue;
+        }
+        /* The end of the stream */
+        if (closed) {
+            return LWLTE_OK;
+        }
+        lwlte_tick_t elapsed_ms = lwlte_sys_time_get_ms() - start_ms;
+        if (elapsed_ms >= (lwlte_tick_t)wait_ms) {
+            return LWLTE_TIMEOUT;
+        }
+        lwlte_sys_flags_wait(tcp->events, LWLTE_TCP_EVENT_RX(sock->id), false, false, wait_ms - elapsed_ms);
+    }
+}
+
+lwlte_err_t lwlte_tcp_close_internal(lwlte_tcp_t* tcp, int id)
+{
+    lwlte_tcp_socket_t* sock = tcp != NULL && id >= 0 ? lwlte_tcp_find_socket(tcp, id) : NULL;
+    if (sock == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    /* Let the queued data go out first */
+    lwlte_tick_t start_ms = lwlte_sys_time_get_ms();
+    lwlte_sys_mutex_lock(tcp->lock);
+    while (sock->state == LWLTE_TCP_CONNECTED && sock->tx.used > 0 && tcp->thread_handle != NULL &&
+        lwlte_sys_time_get_ms() - start_ms < LWLTE_TCP_CLOSE_FLUSH_MS) {
+        lwlte_sys_mutex_unlock(tcp->lock);
+        lwlte_sys_thread_sleep(LWLTE_TCP_CLOSE_POLL_MS);
+        lwlte_sys_mutex_lock(tcp->lock);
+    }
+    lwlte_tcp_state_t state = sock->state;
+    lwlte_sys_mutex_unlock(tcp->lock);
+    if (state == LWLTE_TCP_FREE) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_err_t err = LWLTE_OK;
+    if (state != LWLTE_TCP_CLOSED) {
+        char at_cmd_buf[AT_CMD_MAX_LENGTH];
+        lwlte_at_builder_t b;
+        lwlte_at_builder_init(&b, at_cmd_buf, AT_CMD_MAX_LENGTH);
+        lwlte_at_builder_str(&b, AT_CIPCLOSE);
+        lwlte_at_builder_int(&b, sock->id);
+        lwlte_at_builder_raw(&b, ",1", 2);
+        lwlte_at_builder_end(&b);
+        err = lwlte_core_send_at_cmd_internal(tcp->core, at_cmd_buf, "CLOSE OK", "ERROR",
+            LWLTE_TCP_CMD_TIMEOUT_MS, NULL, 0);
+    }
+    /* The socket is free whatever the module answered, it may have closed the connection meanwhile */
+    lwlte_sys_mutex_lock(tcp->lock);
+    lwlte_tcp_reset_socket(sock);
+    sock->state = LWLTE_TCP_FREE;
+    lwlte_tcp_update_events(tcp, sock);
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return err;
+}
+
+lwlte_err_t lwlte_tcp_get_stats_internal(lwlte_tcp_t* tcp, int id, lwlte_socket_stats_t* stats)
+{
+    lwlte_tcp_socket_t* sock = tcp != NULL && id >= 0 ? lwlte_tcp_find_socket(tcp, id) : NULL;
+    if (sock == NULL || stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_sys_mutex_lock(tcp->lock);
+    *stats = sock->stats;
+    lwlte_sys_mutex_unlock(tcp->lock);
+    return LWLTE_OK;
+}
+
+lwlte_sys_flags_t lwlte_tcp_get_events_internal(lwlte_tcp_t* tcp)
+{
+    return tcp != NULL ? tcp->events : NULL;
+}
+
+void lwlte_tcp_set_watcher_internal(lwlte_tcp_t* tcp, lwlte_sys_flags_t watcher)
+{
+    if (tcp != NULL) {
+        tcp->watcher = watcher;
+    }
+}
@@ -0,0 +1,302 @@
+/*
+    File: lwlte_tls.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte module-side TLS source file
+*/
+#include "lwlte_tls.h"
+#include "lwlte_at_builder.h"
+#include "lwlte_at_parser.h"
+#include "lwlte_sys_log.h"
+#include "lwlte_sys_mem.h"
+#include "lwlte_sys_hash.h"
+#include <string.h>
+
+/* Bytes per AT+FSWRITE, also the read buffer of a certificate in storage */
+#define LWLTE_TLS_CHUNK_SIZE 512
+#define LWLTE_TLS_CMD_TIMEOUT_MS 5000
+/* Timeout of AT+FSWRITE for the data to arrive after the prompt, seconds */
+#define LWLTE_TLS_FSWRITE_TIMEOUT_S 10
+#define LWLTE_TLS_FSWRITE_TRUNCATE 0
+#define LWLTE_TLS_FSWRITE_APPEND 1
+#define LWLTE_TLS_FSREAD_FROM_START 0
+/* Next to every certificate the module keeps "<name>.sha" with the SHA-256 of its content in hex */
+#define LWLTE_TLS_DIGEST_SUFFIX ".sha"
+#define LWLTE_TLS_DIGEST_HEX_SIZE (LWLTE_SYS_SHA256_SIZE * 2)
+/* The digest and the framing of the AT+FSREAD response */
+#define LWLTE_TLS_DIGEST_RESPONSE_SIZE (LWLTE_TLS_DIGEST_HEX_SIZE + 64)
+
+static const char* TAG = "lwlte_tls";
+
+static bool lwlte_tls_file_set(const lwlte_tls_file_t* file)
+{
+    return file->name != NULL && file->size > 0 && (file->data != NULL || file->storage != NULL);
+}
+
+/* Send a command made of a head, a quoted name and integers, the response is copied if response_buf is set */
+static lwlte_err_t lwlte_tls_send_cmd(lwlte_core_t* core, const char* head, const char* name, 
+    const int32_t* values, size_t count, char* response_buf, lwlte_base_type_t response_buf_size)
+{
+    size_t size = lwlte_at_builder_size(head, strlen(name), count, 1);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return LWLTE_ERROR;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, head);
+    lwlte_at_builder_quoted(&b, name, strlen(name));
+    for (size_t i = 0; i < count; i++) {
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_int(&b, values[i]);
+    }
+    lwlte_err_t err = lwlte_at_builder_end(&b);
+    if (err == LWLTE_OK) {
+        err = lwlte_core_send_at_cmd_internal(core, cmd, "OK", "ERROR", LWLTE_TLS_CMD_TIMEOUT_MS, 
+            response_buf, response_buf_size);
+    }
+    lwlte_sys_mem_free(cmd);
+    return err;
+}
+
+/* AT+SSLCFG="<type>",<ctx>,<value>, the value is a quoted file name or an integer */
+static lwlte_err_t lwlte_tls_send_sslcfg(lwlte_core_t* core, const char* type, lwlte_base_type_t ctx_id, 
+    const char* file_name, int32_t value)
+{
+    size_t size = lwlte_at_builder_size(AT_SSLCFG, strlen(type) + (file_name != NULL ? strlen(file_name) : 0), 2, 2);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return LWLTE_ERROR;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, AT_SSLCFG);
+    lwlte_at_builder_quoted(&b, type, strlen(type));
+    lwlte_at_builder_char(&b, ',');
+    lwlte_at_builder_int(&b, ctx_id);
+    lwlte_at_builder_char(&b, ',');
+    if (file_name != NULL) {
+        lwlte_at_builder_quoted(&b, file_name, strlen(file_name));
+    }
+    else {
+        lwlte_at_builder_int(&b, value);
+    }
+    lwlte_err_t err = lwlte_at_builder_end(&b);
+    if (err == LWLTE_OK) {
+        err = lwlte_core_send_at_cmd_internal(core, cmd, "OK", "ERROR", LWLTE_TLS_CMD_TIMEOUT_MS, NULL, 0);
+    }
+    lwlte_sys_mem_free(cmd);
+    return err;
+}
+
+/* Size of a file on the module, -1 if it does not exist */
+static int32_t lwlte_tls_file_size(lwlte_core_t* core, const char* name)
+{
+    size_t size = lwlte_at_builder_size(AT_FSFLSIZE, strlen(name), 0, 1);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return -1;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, AT_FSFLSIZE);
+    lwlte_at_builder_quoted(&b, name, strlen(name));
+    lwlte_at_field_t fields[1];
+    int32_t file_size = -1;
+    if (lwlte_at_builder_end(&b) == LWLTE_OK && 
+        lwlte_core_send_at_cmd_parse_internal(core, cmd, "OK", "ERROR", LWLTE_TLS_CMD_TIMEOUT_MS, 
+        LWLTE_AT_SCHEMA_FSFLSIZE, fields, 1) == LWLTE_OK) {
+        file_size = fields[0].v.i;
+    }
+    lwlte_sys_mem_free(cmd);
+    return file_size;
+}
+
+/* One AT+FSWRITE, the data goes after the prompt */
+static lwlte_err_t lwlte_tls_write_chunk(lwlte_core_t* core, const char* name, uint32_t offset, 
+    const void* data, uint32_t len)
+{
+    int32_t values[] = { offset == 0 ? LWLTE_TLS_FSWRITE_TRUNCATE : LWLTE_TLS_FSWRITE_APPEND, (int32_t)len, 
+        LWLTE_TLS_FSWRITE_TIMEOUT_S };
+    size_t size = lwlte_at_builder_size(AT_FSWRITE, strlen(name), 3, 1);
+    char* cmd = lwlte_sys_mem_malloc(size);
+    if (cmd == NULL) {
+        return LWLTE_ERROR;
+    }
+    lwlte_at_builder_t b;
+    lwlte_at_builder_init(&b, cmd, size);
+    lwlte_at_builder_str(&b, AT_FSWRITE);
+    lwlte_at_builder_quoted(&b, name, strlen(name));
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        lwlte_at_builder_char(&b, ',');
+        lwlte_at_builder_int(&b, values[i]);
+    }
+    lwlte_err_t err = lwlte_at_builder_end(&b);
+    if (err == LWLTE_OK) {
+        lwlte_core_iovec_t iov = { .base = data, .len = len };
+        err = lwlte_core_send_at_cmd_prompt_internal(core, cmd, &iov, 1, "OK", "ERROR", 
+            LWLTE_TLS_CMD_TIMEOUT_MS, NULL, 0);
+    }
+    lwlte_sys_mem_free(cmd);
+    return err;
+}
+
+/* Bytes of the file at offset, from its data or through the chunk buffer from storage */
+static const void* lwlte_tls_file_chunk(const lwlte_tls_file_t* file, uint32_t offset, uint32_t len, char* chunk_buf)
+{
+    if (file->data != NULL) {
+        return (const char*)file->data + offset;
+    }
+    if (file->storage->read(file->storage->ctx, file->offset + offset, chunk_buf, len) != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to read %s from storage!", file->name);
+        return NULL;
+    }
+    return chunk_buf;
+}
+
+/* SHA-256 of the file content in lower-case hex */
+static lwlte_err_t lwlte_tls_file_digest(const lwlte_tls_file_t* file, char* chunk_buf, 
+    char hex[LWLTE_TLS_DIGEST_HEX_SIZE + 1])
+{
+    lwlte_sys_sha256_t sha = lwlte_sys_sha256_create();
+    if (sha == NULL) {
+        return LWLTE_ERROR;
+    }
+    for (uint32_t offset = 0; offset < file->size; offset += LWLTE_TLS_CHUNK_SIZE) {
+        uint32_t len = file->size - offset;
+        if (len > LWLTE_TLS_CHUNK_SIZE) {
+            len = LWLTE_TLS_CHUNK_SIZE;
+        }
+        const void* data = lwlte_tls_file_chunk(file, offset, len, chunk_buf);
+        if (data == NULL) {
+            lwlte_sys_sha256_delete(sha);
+            return LWLTE_ERROR;
+        }
+        lwlte_sys_sha256_update(sha, data, len);
+    }
+    uint8_t digest[LWLTE_SYS_SHA256_SIZE];
+    lwlte_sys_sha256_finish(sha, digest);
+    lwlte_sys_sha256_delete(sha);
+    static const char hex_digits[] = "0123456789abcdef";
+    for (int i = 0; i < LWLTE_SYS_SHA256_SIZE; i++) {
+        hex[i * 2] = hex_digits[digest[i] >> 4];
+        hex[i * 2 + 1] = hex_digits[digest[i] & 0x0F];
+    }
+    hex[LWLTE_TLS_DIGEST_HEX_SIZE] = '\0';
+    return LWLTE_OK;
+}
+
+/* True if the digest file on the module holds this digest */
+static bool lwlte_tls_digest_matches(lwlte_core_t* core, const char* digest_name, const char* hex)
+{
+    char response[LWLTE_TLS_DIGEST_RESPONSE_SIZE];
+    int32_t values[] = { LWLTE_TLS_FSREAD_FROM_START, LWLTE_TLS_DIGEST_HEX_SIZE, 0 };
+    if (lwlte_tls_file_size(core, digest_name) != LWLTE_TLS_DIGEST_HEX_SIZE || 
+        lwlte_tls_send_cmd(core, AT_FSREAD, digest_name, values, 3, response, sizeof(response)) != LWLTE_OK) {
+        return false;
+    }
+    return strstr(response, hex) != NULL;
+}
+
+/* Write the file in chunks after the prompts of AT+FSWRITE, a chunk from storage goes through the chunk buffer */
+static lwlte_err_t lwlte_tls_upload(lwlte_core_t* core, const lwlte_tls_file_t* file, char* chunk_buf)
+{
+    /* Fails if the file exists, AT+FSWRITE truncates it then */
+    lwlte_tls_send_cmd(core, AT_FSCREATE, file->name, NULL, 0, NULL, 0);
+    for (uint32_t offset = 0; offset < file->size; offset += LWLTE_TLS_CHUNK_SIZE) {
+        uint32_t len = file->size - offset;
+        if (len > LWLTE_TLS_CHUNK_SIZE) {
+            len = LWLTE_TLS_CHUNK_SIZE;
+        }
+        const void* data = lwlte_tls_file_chunk(file, offset, len, chunk_buf);
+        if (data == NULL || lwlte_tls_write_chunk(core, file->name, offset, data, len) != LWLTE_OK) {
+            LWLTE_LOGE(TAG, "Failed to upload %s!", file->name);
+            return LWLTE_ERROR;
+        }
+    }
+    return LWLTE_OK;
+}
+
+/**
+ * Upload a file unless the module already has it with the same digest. The digest file is removed
+ * before the upload and written after it, an interrupted upload is done again on the next setup
+ */
+static lwlte_err_t lwlte_tls_ensure_file(lwlte_core_t* core, const lwlte_tls_file_t* file)
+{
+    size_t name_len = strlen(file->name);
+    char* digest_name = lwlte_sys_mem_malloc(name_len + sizeof(LWLTE_TLS_DIGEST_SUFFIX));
+    char* chunk_buf = (file->data == NULL) ? lwlte_sys_mem_malloc(LWLTE_TLS_CHUNK_SIZE) : NULL;
+    if (digest_name == NULL || (file->data == NULL && chunk_buf == NULL)) {
+        lwlte_sys_mem_free(digest_name);
+        lwlte_sys_mem_free(chunk_buf);
+        return LWLTE_ERROR;
+    }
+    memcpy(digest_name, file->name, name_len);
+    memcpy(digest_name + name_len, LWLTE_TLS_DIGEST_SUFFIX, sizeof(LWLTE_TLS_DIGEST_SUFFIX));
+    char hex[LWLTE_TLS_DIGEST_HEX_SIZE + 1];
+    lwlte_err_t err = lwlte_tls_file_digest(file, chunk_buf, hex);
+    if (err == LWLTE_OK) {
+        if (lwlte_tls_file_size(core, file->name) == (int32_t)file->size && 
+            lwlte_tls_digest_matches(core, digest_name, hex)) {
+            LWLTE_LOGD(TAG, "%s is already on the module.", file->name);
+        }
+        else {
+            LWLTE_LOGI(TAG, "Uploading %s (%u bytes)...", file->name, (unsigned)file->size);
+            lwlte_tls_send_cmd(core, AT_FSDEL, digest_name, NULL, 0, NULL, 0);
+            err = lwlte_tls_upload(core, file, chunk_buf);
+            if (err == LWLTE_OK) {
+                lwlte_tls_send_cmd(core, AT_FSCREATE, digest_name, NULL, 0, NULL, 0);
+                err = lwlte_tls_write_chunk(core, digest_name, 0, hex, LWLTE_TLS_DIGEST_HEX_SIZE);
+            }
+        }
+    }
+    lwlte_sys_mem_free(digest_name);
+    lwlte_sys_mem_free(chunk_buf);
+    return err;
+}
+
+lwlte_err_t lwlte_tls_setup_internal(lwlte_core_t* core, const lwlte_tls_config_t* config, lwlte_base_type_t ctx_id)
+{
+    if (core == NULL || config == NULL || config->verify > LWLTE_TLS_VERIFY_MUTUAL) {
+        return LWLTE_INVALID_ARG;
+    }
+    bool need_ca = config->verify != LWLTE_TLS_VERIFY_NONE;
+    bool need_client = config->verify == LWLTE_TLS_VERIFY_MUTUAL;
+    if ((need_ca && !lwlte_tls_file_set(&config->ca_cert)) || 
+        (need_client && (!lwlte_tls_file_set(&config->client_cert) || !lwlte_tls_file_set(&config->client_key)))) {
+        LWLTE_LOGE(TAG, "A certificate required by the TLS verify mode is not set!");
+        return LWLTE_INVALID_ARG;
+    }
+    const struct {
+        const char* type;
+        const lwlte_tls_file_t* file;
+        bool needed;
+    } files[] = {
+        { "cacert", &config->ca_cert, need_ca },
+        { "clientcert", &config->client_cert, need_client },
+        { "clientkey", &config->client_key, need_client },
+    };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        if (!files[i].needed) {
+            continue;
+        }
+        lwlte_err_t err = lwlte_tls_ensure_file(core, files[i].file);
+        if (err == LWLTE_OK) {
+            err = lwlte_tls_send_sslcfg(core, files[i].type, ctx_id, files[i].file->name, 0);
+        }
+        if (err != LWLTE_OK) {
+            return err;
+        }
+    }
+    lwlte_err_t err = lwlte_tls_send_sslcfg(core, "seclevel", ctx_id, NULL, config->verify);
+    if (err != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Failed to configure the SSL context %d!", (int)ctx_id);
+        return err;
+    }
+    /* Without it every reconnect runs the full handshake, which still works */
+    if (config->session_resume && 
+        lwlte_tls_send_sslcfg(core, "session", ctx_id, NULL, 1) != LWLTE_OK) {
+        LWLTE_LOGW(TAG, "The module refused TLS session resumption, reconnects use a full handshake.");
+    }
+    return LWLTE_OK;
+}
@@ -0,0 +1,310 @@
+/*
+    File: lwlte_watchdog.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: esp-lwlte modem health watchdog source file
+    - Watches the liveness signals of the core and escalates through soft recovery,
+      EN power-cycle and full re-init until the module is healthy again.
+*/
+#include "lwlte_watchdog.h"
+#include "lwlte_backoff.h"
+#include "lwlte_core.h"
+#include "lwlte_err.h"
+#include "lwlte_sys_types.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_log.h"
+#include "lwlte_sys_mem.h"
+#include <string.h>
+
+/* Defaults, used for the fields left zero in lwlte_watchdog_config_t */
+#define LWLTE_WATCHDOG_CHECK_INTERVAL_MS 1000
+#define LWLTE_WATCHDOG_RX_SILENCE_MS 30000
+#define LWLTE_WATCHDOG_MAX_CONSECUTIVE_TIMEOUTS 3
+#define LWLTE_WATCHDOG_BACKOFF_BASE_MS 2000
+#define LWLTE_WATCHDOG_BACKOFF_MAX_MS 60000
+#define LWLTE_WATCHDOG_TASK_STACK_SIZE 4096
+#define LWLTE_WATCHDOG_TASK_PRIORITY (tskIDLE_PRIORITY + 2)
+/* The soft recovery gives up on the module after this many unanswered "AT" */
+#define LWLTE_WATCHDOG_PROBE_RETRIES 3
+#define LWLTE_WATCHDOG_PROBE_TIMEOUT_MS 1000
+/* A recovery action (e.g. a full re-init) may be running when the watchdog is stopped */
+#define LWLTE_WATCHDOG_STOP_TIMEOUT_MS 30000
+
+typedef enum {
+    LWLTE_WATCHDOG_HEALTHY = 0,
+    LWLTE_WATCHDOG_PENDING, // the bring-up is running, neither healthy nor failed yet
+    LWLTE_WATCHDOG_FAILED_TIMEOUTS,
+    LWLTE_WATCHDOG_FAILED_RX_SILENCE,
+    LWLTE_WATCHDOG_FAILED_UNEXPECTED_RDY,
+    LWLTE_WATCHDOG_FAILED_ACTIVATION,
+    LWLTE_WATCHDOG_FAILED_CORE_DOWN, // a previous re-init failed
+} lwlte_watchdog_health_t;
+
+static const char* TAG = "lwlte_watchdog";
+
+typedef struct {
+    lwlte_core_t* core; // the supervised instance
+    lwlte_config_t config; // kept for the full re-init stage
+    lwlte_watchdog_config_t wd_config; // with the defaults filled in
+    lwlte_sys_thread_t thread_handle;
+    volatile bool stop;
+    lwlte_sys_semaphore_t wake;
+    lwlte_sys_semaphore_t exited;
+    lwlte_sys_mutex_t stats_lock;
+    lwlte_watchdog_stats_t stats;
+    lwlte_base_type_t seen_unexpected_rdy_count;
+} lwlte_watchdog_context_t;
+
+static lwlte_err_t lwlte_watchdog_probe(lwlte_watchdog_context_t* wd)
+{
+    lwlte_err_t err = LWLTE_TIMEOUT;
+    for (int i = 0; i < LWLTE_WATCHDOG_PROBE_RETRIES && err == LWLTE_TIMEOUT; i++) {
+        err = lwlte_core_send_at_cmd_internal(wd->core, AT_PROBE, "OK", "ERROR", LWLTE_WATCHDOG_PROBE_TIMEOUT_MS, NULL, 0);
+    }
+    return err;
+}
+
+static lwlte_watchdog_health_t lwlte_watchdog_check(lwlte_watchdog_context_t* wd)
+{
+    lwlte_core_health_t health;
+    if (lwlte_core_get_health_internal(wd->core, &health) != LWLTE_OK) {
+        return LWLTE_WATCHDOG_FAILED_CORE_DOWN;
+    }
+    if (health.unexpected_rdy_count != wd->seen_unexpected_rdy_count) {
+        wd->seen_unexpected_rdy_count = health.unexpected_rdy_count;
+        return LWLTE_WATCHDOG_FAILED_UNEXPECTED_RDY;
+    }
+    if (health.consecutive_timeouts >= wd->wd_config.max_consecutive_timeouts) {
+        return LWLTE_WATCHDOG_FAILED_TIMEOUTS;
+    }
+    if (lwlte_core_get_network_activating_internal(wd->core)) {
+        return LWLTE_WATCHDOG_PENDING;
+    }
+    if (!lwlte_core_get_network_connected_internal(wd->core)) {
+        return LWLTE_WATCHDOG_FAILED_ACTIVATION;
+    }
+    /* A quiet UART is normal when idle, only a probe that gets no answer counts */
+    if (lwlte_sys_time_get_ms() - health.last_rx_ms >= (lwlte_tick_t)wd->wd_config.rx_silence_ms) {
+        if (lwlte_watchdog_probe(wd) == LWLTE_TIMEOUT) {
+            return LWLTE_WATCHDOG_FAILED_RX_SILENCE;
+        }
+    }
+    return LWLTE_WATCHDOG_HEALTHY;
+}
+
+static void lwlte_watchdog_count_failure(lwlte_watchdog_context_t* wd, lwlte_watchdog_health_t health)
+{
+    switch (health)
+    {
+        case LWLTE_WATCHDOG_FAILED_TIMEOUTS:
+            wd->stats.timeout_events++;
+            LWLTE_LOGE(TAG, "Module stuck: too many AT command timeouts.");
+            break;
+        case LWLTE_WATCHDOG_FAILED_RX_SILENCE:
+            wd->stats.rx_silence_events++;
+            LWLTE_LOGE(TAG, "Module stuck: no answer to the probe after a silence.");
+            break;
+        case LWLTE_WATCHDOG_FAILED_UNEXPECTED_RDY:
+            wd->stats.unexpected_rdy_events++;
+            LWLTE_LOGE(TAG, "Module rebooted by itself.");
+            break;
+        case LWLTE_WATCHDOG_FAILED_ACTIVATION:
+            wd->stats.activation_failures++;
+            LWLTE_LOGE(TAG, "Module is not connected to the network.");
+            break;
+        default:
+            LWLTE_LOGE(TAG, "Core is down.");
+            break;
+    }
+}
+
+static void lwlte_watchdog_count(lwlte_watchdog_context_t* wd, uint32_t* counter)
+{
+    lwlte_sys_mutex_lock(wd->stats_lock);
+    (*counter)++;
+    lwlte_sys_mutex_unlock(wd->stats_lock);
+}
+
+/* Run the recovery action of a stage, return the stage actually run. Called without the stats lock */
+static lwlte_watchdog_stage_t lwlte_watchdog_recover(lwlte_watchdog_context_t* wd, lwlte_watchdog_stage_t stage)
+{
+    if (stage == LWLTE_WATCHDOG_STAGE_SOFT) {
+        LWLTE_LOGW(TAG, "Recovery: soft.");
+        lwlte_watchdog_count(wd, &wd->stats.soft_recoveries);
+        /* Escalate at once if the module does not even answer "AT" */
+        if (lwlte_watchdog_probe(wd) != LWLTE_TIMEOUT && lwlte_core_reactivate_internal(wd->core) == LWLTE_OK) {
+            return stage;
+        }
+        stage = LWLTE_WATCHDOG_STAGE_POWER_CYCLE;
+    }
+    if (stage == LWLTE_WATCHDOG_STAGE_POWER_CYCLE) {
+        LWLTE_LOGW(TAG, "Recovery: power-cycle.");
+        lwlte_watchdog_count(wd, &wd->stats.power_cycles);
+        if (lwlte_core_restart_internal(wd->core) == LWLTE_OK) {
+            return stage;
+        }
+        stage = LWLTE_WATCHDOG_STAGE_FULL_REINIT;
+    }
+    LWLTE_LOGW(TAG, "Recovery: full re-init.");
+    lwlte_watchdog_count(wd, &wd->stats.full_reinits);
+    /* The instance is re-initialized in place, so the handle held by the application and the locks the other
+       tasks wait on stay valid, their AT commands fail until the init is done */
+    lwlte_core_deinit_internal(wd->core);
+    if (lwlte_core_init_internal(wd->core, &wd->config) != LWLTE_OK) {
+        LWLTE_LOGE(TAG, "Full re-init failed.");
+    }
+    return LWLTE_WATCHDOG_STAGE_FULL_REINIT;
+}
+
+static void lwlte_watchdog_task(void *pvParameters)
+{
+    lwlte_watchdog_context_t* wd = (lwlte_watchdog_context_t*)pvParameters;
+    LWLTE_LOGI(TAG, "lwlte_watchdog_task starts.");
+    lwlte_watchdog_stage_t stage = LWLTE_WATCHDOG_STAGE_NONE;
+    bool failing = false;
+    lwlte_tick_t failing_since_ms = 0;
+    lwlte_tick_t next_action_ms = 0;
+    uint32_t attempt = 0;
+    while (!wd->stop) {
+        lwlte_sys_semaphore_wait(wd->wake, wd->wd_config.check_interval_ms);
+        if (wd->stop) {
+            break;
+        }
+        lwlte_watchdog_health_t health = lwlte_watchdog_check(wd);
+        lwlte_tick_t now_ms = lwlte_sys_time_get_ms();
+        lwlte_sys_mutex_lock(wd->stats_lock);
+        if (health == LWLTE_WATCHDOG_HEALTHY) {
+            if (failing) {
+                uint32_t recovery_ms = now_ms - failing_since_ms;
+                wd->stats.recoveries++;
+                wd->stats.last_recovery_ms = recovery_ms;
+                wd->stats.total_recovery_ms += recovery_ms;
+                if (recovery_ms > wd->stats.max_recovery_ms) {
+                    wd->stats.max_recovery_ms = recovery_ms;
+                }
+                LWLTE_LOGI(TAG, "Module recovered in %u ms.", (unsigned)recovery_ms);
+            }
+            failing = false;
+            attempt = 0;
+            stage = LWLTE_WATCHDOG_STAGE_NONE;
+            wd->stats.stage = stage;
+        }
+        else if (health != LWLTE_WATCHDOG_PENDING) {
+            if (!failing) {
+                failing = true;
+                failing_since_ms = now_ms;
+                next_action_ms = now_ms;
+                lwlte_watchdog_count_failure(wd, health);
+            }
+            /* Escalate once the previous action has had its backoff time */
+            if ((int32_t)(now_ms - next_action_ms) >= 0) {
+                lwlte_sys_mutex_unlock(wd->stats_lock);
+                stage = lwlte_watchdog_recover(wd, stage < LWLTE_WATCHDOG_STAGE_FULL_REINIT ? stage + 1 : stage);
+                lwlte_sys_mutex_lock(wd->stats_lock);
+                wd->stats.stage = stage;
+                attempt++;
+                next_action_ms = lwlte_sys_time_get_ms() + 
+                    lwlte_backoff_ms(wd->wd_config.backoff_base_ms, wd->wd_config.backoff_max_ms, attempt);
+                lwlte_core_reset_health_internal(wd->core);
+            }
+        }
+        lwlte_sys_mutex_unlock(wd->stats_lock);
+    }
+    LWLTE_LOGI(TAG, "lwlte_watchdog_task exits.");
+    /* Must be the last access to the context, lwlte_watchdog_stop frees it once this is given */
+    lwlte_sys_semaphore_signal(wd->exited);
+}
+
+lwlte_err_t lwlte_watchdog_start(lwlte_core_t* core, const lwlte_config_t* config, lwlte_watchdog_t* watchdog)
+{
+    if (core == NULL || config == NULL || watchdog == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    lwlte_watchdog_context_t* wd = lwlte_sys_mem_malloc(sizeof(lwlte_watchdog_context_t));
+    if (wd == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(wd, 0, sizeof(lwlte_watchdog_context_t));
+    wd->core = core;
+    wd->config = *config;
+    /* Fill in the defaults */
+    lwlte_watchdog_config_t* wd_config = &wd->wd_config;
+    *wd_config = config->watchdog;
+    if (wd_config->check_interval_ms <= 0) {
+        wd_config->check_interval_ms = LWLTE_WATCHDOG_CHECK_INTERVAL_MS;
+    }
+    if (wd_config->rx_silence_ms <= 0) {
+        wd_config->rx_silence_ms = LWLTE_WATCHDOG_RX_SILENCE_MS;
+    }
+    if (wd_config->max_consecutive_timeouts <= 0) {
+        wd_config->max_consecutive_timeouts = LWLTE_WATCHDOG_MAX_CONSECUTIVE_TIMEOUTS;
+    }
+    if (wd_config->backoff_base_ms <= 0) {
+        wd_config->backoff_base_ms = LWLTE_WATCHDOG_BACKOFF_BASE_MS;
+    }
+    if (wd_config->backoff_max_ms < wd_config->backoff_base_ms) {
+        wd_config->backoff_max_ms = wd_config->backoff_base_ms > LWLTE_WATCHDOG_BACKOFF_MAX_MS ?
+            wd_config->backoff_base_ms : LWLTE_WATCHDOG_BACKOFF_MAX_MS;
+    }
+    lwlte_core_health_t health = { 0 };
+    lwlte_core_get_health_internal(core, &health);
+    wd->seen_unexpected_rdy_count = health.unexpected_rdy_count;
+    wd->stop = false;
+    wd->wake = lwlte_sys_semaphore_create();
+    wd->exited = lwlte_sys_semaphore_create();
+    wd->stats_lock = lwlte_sys_mutex_create();
+    /* Create the watchdog task */
+    lwlte_sys_thread_cfg_t thread_config;
+    lwlte_sys_thread_cfg_apply(&thread_config, &config->watchdog_task, "lwlte_watchdog_task", LWLTE_WATCHDOG_TASK_STACK_SIZE, 
+        LWLTE_WATCHDOG_TASK_PRIORITY, wd);
+    if (wd->wake == NULL || wd->exited == NULL || wd->stats_lock == NULL) {
+        lwlte_watchdog_stop(wd);
+        return LWLTE_ERROR;
+    }
+    wd->thread_handle = lwlte_sys_thread_create(lwlte_watchdog_task, &thread_config);
+    if (wd->thread_handle == NULL) {
+        lwlte_watchdog_stop(wd);
+        return LWLTE_ERROR;
+    }
+    *watchdog = wd;
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_watchdog_stop(lwlte_watchdog_t watchdog)
+{
+    lwlte_watchdog_context_t* wd = (lwlte_watchdog_context_t*)watchdog;
+    if (wd == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    if (wd->thread_handle != NULL) {
+        wd->stop = true;
+        lwlte_sys_semaphore_signal(wd->wake);
+        /* A task still running a recovery keeps using the context, leak it rather than free it under the task */
+        if (!lwlte_sys_semaphore_wait(wd->exited, LWLTE_WATCHDOG_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_watchdog_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        wd->thread_handle = NULL;
+    }
+    lwlte_sys_semaphore_delete(wd->wake);
+    lwlte_sys_semaphore_delete(wd->exited);
+    lwlte_sys_mutex_delete(wd->stats_lock);
+    lwlte_sys_mem_free(wd);
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_watchdog_get_stats(lwlte_watchdog_t watchdog, lwlte_watchdog_stats_t* stats)
+{
+    lwlte_watchdog_context_t* wd = (lwlte_watchdog_context_t*)watchdog;
+    if (stats == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (wd == NULL) {
+        return LWLTE_NOT_INITIALIZED;
+    }
+    lwlte_sys_mutex_lock(wd->stats_lock);
+    *stats = wd->stats;
+    lwlte_sys_mutex_unlock(wd->stats_lock);
+    return LWLTE_OK;
+}
@@ -11,26 +11,50 @@
 #include "driver/uart.h"
 #include "lwlte_sys_types.h"
 #include "lwlte_err.h"
+#include "lwlte_sys_thread.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* opaque handle */
+typedef void* lwlte_ll_uart_t;
+
+/* Receives the data read from the UART, called from the UART RX task */
+typedef lwlte_err_t (*lwlte_ll_uart_rx_fn_t)(void* ctx, char* data, lwlte_base_type_t size);
+
 typedef struct {
     lwlte_base_type_t uart_num;
     lwlte_base_type_t uart_tx_io_num;
     lwlte_base_type_t uart_rx_io_num;
     lwlte_base_type_t uart_buf_size;
     lwlte_uart_config_t uart_config;
+    lwlte_sys_thread_cfg_t rx_task_config; // name, stack, priority and core of the UART RX task
+    lwlte_ll_uart_rx_fn_t rx_fn; // receiver of the data, the chunks are null-terminated
+    void* rx_ctx;
 } lwlte_ll_uart_config_t;
 
-lwlte_err_t lwlte_ll_uart_write(const char* data, size_t size);
+lwlte_err_t lwlte_ll_uart_write(lwlte_ll_uart_t uart, const char* data, size_t size);
+
+/**
+ * Install the UART driver and start its RX task, one instance per UART.
+ */
+lwlte_err_t lwlte_ll_uart_init(const lwlte_ll_uart_config_t *config, lwlte_ll_uart_t* uart);
+
+/**
+ * Stop the RX task and remove the driver.
+ * @return LWLTE_TIMEOUT if the RX task did not stop, the driver and the context are then left in place
+ */
+lwlte_err_t lwlte_ll_uart_deinit(lwlte_ll_uart_t uart);
 
-lwlte_err_t lwlte_ll_uart_init(lwlte_ll_uart_config_t *config);
+/**
+ * Configure the EN pin as an output driven at the given level, without toggling it.
+ */
+lwlte_err_t lwlte_ll_gpio_init(lwlte_base_type_t gpio_num, lwlte_base_type_t level);
 
-lwlte_err_t lwlte_ll_uart_deinit(lwlte_base_type_t uart_num);
+lwlte_err_t lwlte_ll_gpio_set_level(lwlte_base_type_t gpio_num, lwlte_base_type_t level);
 
-lwlte_err_t lwlte_ll_gpio_init(lwlte_base_type_t gpio_num);
+lwlte_err_t lwlte_ll_gpio_deinit(lwlte_base_type_t gpio_num);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,38 @@
+/*
+    File: lwlte_sys_hash.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Hash encapsulation header file
+    - Encapsulate the SHA-256 APIs of mbedTLS (hardware accelerated on the ESP32 targets).
+    Platform: ESP-IDF
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LWLTE_SYS_SHA256_SIZE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* lwlte_sys_sha256_t; // opaque handle
+
+/**
+ * Create a SHA-256 context, started. Returns NULL on failure.
+ */
+lwlte_sys_sha256_t lwlte_sys_sha256_create(void);
+
+void lwlte_sys_sha256_delete(lwlte_sys_sha256_t h);
+
+void lwlte_sys_sha256_update(lwlte_sys_sha256_t h, const void* data, size_t len);
+
+/**
+ * Write the digest, the context starts over.
+ */
+void lwlte_sys_sha256_finish(lwlte_sys_sha256_t h, uint8_t digest[LWLTE_SYS_SHA256_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
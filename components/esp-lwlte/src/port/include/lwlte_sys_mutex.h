@@ -7,6 +7,7 @@
 */
 #pragma once
 
+#include <stdbool.h>
 #include "freertos/FreeRTOS.h"
 
 #ifdef __cplusplus
@@ -24,11 +25,17 @@ void lwlte_sys_mutex_unlock(lwlte_sys_mutex_t m);
 
 void lwlte_sys_mutex_delete(lwlte_sys_mutex_t m);
 
+/* Lock of the state shared by all the instances, created statically on first use and never deleted */
+void lwlte_sys_global_lock(void);
+
+void lwlte_sys_global_unlock(void);
+
 lwlte_sys_semaphore_t lwlte_sys_semaphore_create(void);
 
 void lwlte_sys_semaphore_signal(lwlte_sys_semaphore_t s);
 
-void lwlte_sys_semaphore_wait(lwlte_sys_semaphore_t s, BaseType_t timeout_ms);
+/* @return false if the semaphore was not given within timeout_ms */
+bool lwlte_sys_semaphore_wait(lwlte_sys_semaphore_t s, BaseType_t timeout_ms);
 
 void lwlte_sys_semaphore_delete(lwlte_sys_semaphore_t s);
 
@@ -0,0 +1,44 @@
+/*
+    File: lwlte_sys_storage.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Storage encapsulation header file
+    - Backends of lwlte_sys_storage_t: a raw flash partition (data or OTA update) on the target, a file on the host.
+    Platform: ESP-IDF
+*/
+#pragma once
+
+#include "lwlte_sys_types.h"
+#include "lwlte_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Use a data partition of the partition table, found by its label.
+ */
+lwlte_err_t lwlte_sys_storage_partition_open(const char* label, lwlte_sys_storage_t* storage);
+
+/**
+ * Use the app partition the next OTA update goes to.
+ */
+lwlte_err_t lwlte_sys_storage_update_partition_open(lwlte_sys_storage_t* storage);
+
+/**
+ * Boot from the update partition opened with lwlte_sys_storage_update_partition_open on the next restart,
+ * the image in it is checked first.
+ */
+lwlte_err_t lwlte_sys_storage_update_partition_activate(const lwlte_sys_storage_t* storage);
+
+/**
+ * Use a file, created and filled with 0xFF if it does not exist yet.
+ * @param size Bytes, rounded down to a multiple of sector_size
+ */
+lwlte_err_t lwlte_sys_storage_file_open(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage);
+
+void lwlte_sys_storage_file_close(lwlte_sys_storage_t* storage);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,11 +9,14 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "lwlte_sys_types.h"
+#include "lwlte.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define LWLTE_SYS_THREAD_NO_AFFINITY (-1)
+
 /* opaque handle */
 typedef void* lwlte_sys_thread_t;
 
@@ -25,9 +28,16 @@ typedef struct {
     const char* name;        /* thread name (optional) */
     uint32_t    stack_size;  /* bytes */
     uint32_t    priority;    /* abstract priority */
+    int32_t     core_id;     /* core to pin the thread to, LWLTE_SYS_THREAD_NO_AFFINITY for none */
     void*       arg;         /* argument passed to entry */
 } lwlte_sys_thread_cfg_t;
 
+/**
+ * Fill a thread config from a user's task config, the unset stack size and priority take the defaults.
+ */
+void lwlte_sys_thread_cfg_apply(lwlte_sys_thread_cfg_t* cfg, const lwlte_task_config_t* task_config, const char* name, 
+    uint32_t default_stack_size, uint32_t default_priority, void* arg);
+
 /**
  * Create and start a thread.
  *
@@ -56,6 +66,11 @@ lwlte_tick_t lwlte_sys_time_get_ticks(void);
  */
 lwlte_tick_t lwlte_sys_time_get_ms(void);
 
+/**
+ * Get a random number, e.g. to jitter retry delays.
+ */
+uint32_t lwlte_sys_random(void);
+
 #ifdef __cplusplus
 }
 #endif
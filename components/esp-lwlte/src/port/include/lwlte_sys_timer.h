@@ -0,0 +1,53 @@
+/*
+    File: lwlte_sys_timer.h
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Timer encapsulation header file
+    - Encapsulate the software timer APIs of FreeRTOS.
+    Platform: ESP-IDF
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* opaque handle */
+typedef void* lwlte_sys_timer_t;
+
+/* timer callback, runs in the timer service task and must not block */
+typedef void (*lwlte_sys_timer_fn_t)(void* arg);
+
+/**
+ * Create a timer, it does not run until started.
+ *
+ * @param period_ms   period (or delay of a one-shot timer) in ms
+ * @param auto_reload true: periodic; false: one-shot
+ *
+ * @return timer handle or NULL on failure
+ */
+lwlte_sys_timer_t lwlte_sys_timer_create(const char* name, uint32_t period_ms, bool auto_reload,
+    lwlte_sys_timer_fn_t fn, void* arg);
+
+/**
+ * Delete a timer, the callback is not called any more once this returns, unless it is running already.
+ * The memory is freed later by the timer service task.
+ */
+void lwlte_sys_timer_delete(lwlte_sys_timer_t t);
+
+/**
+ * Start (or restart) a timer with the given period.
+ */
+bool lwlte_sys_timer_start(lwlte_sys_timer_t t, uint32_t period_ms);
+
+/**
+ * Stop a timer, a pending one-shot callback will not run.
+ */
+bool lwlte_sys_timer_stop(lwlte_sys_timer_t t);
+
+#ifdef __cplusplus
+}
+#endif
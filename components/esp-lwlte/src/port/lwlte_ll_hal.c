@@ -8,94 +8,166 @@
 
 #include "lwlte_ll_hal.h"
 #include "lwlte_sys_types.h"
-#include "lwlte_core.h"
 #include "lwlte_err.h"
 #include "lwlte_sys_log.h"
+#include "lwlte_sys_thread.h"
+#include "lwlte_sys_mutex.h"
+#include "lwlte_sys_mem.h"
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
+#include <string.h>
+
+/* The RX task checks for a stop request at this interval */
+#define LWLTE_LL_UART_RX_POLL_MS 100
+#define LWLTE_LL_UART_STOP_TIMEOUT_MS 1000
 
 static const char* TAG = "lwlte_ll_hal";
 
-static struct {
+typedef struct {
     lwlte_ll_uart_config_t config;
     QueueHandle_t uart_rx_queue;
-    TaskHandle_t uart_rx_task_handle;
-} s_lwlte_ll_uart_context;
+    lwlte_sys_thread_t uart_rx_task_handle;
+    volatile bool uart_rx_task_stop;
+    lwlte_sys_semaphore_t uart_rx_task_exited;
+} lwlte_ll_uart_ctx_t;
 
 static void lwlte_ll_uart_rx_task(void *pvParameters)
 {
+    lwlte_ll_uart_ctx_t* u = (lwlte_ll_uart_ctx_t*)pvParameters;
     LWLTE_LOGI(TAG, "lwlte_ll_uart_rx_task starts.");
     uart_event_t event;
-    char buf[s_lwlte_ll_uart_context.config.uart_buf_size];
-    while (1) {
-        if(xQueueReceive(s_lwlte_ll_uart_context.uart_rx_queue, 
-            &event, portMAX_DELAY) == pdPASS) {
+    char buf[u->config.uart_buf_size];
+    while (!u->uart_rx_task_stop) {
+        if(xQueueReceive(u->uart_rx_queue, 
+            &event, pdMS_TO_TICKS(LWLTE_LL_UART_RX_POLL_MS)) == pdPASS) {
             if (event.type == UART_DATA){
-                /* Read the data from the UART */
-                int len = uart_read_bytes(s_lwlte_ll_uart_context.config.uart_num, 
-                    &buf, event.size, pdMS_TO_TICKS(100));
-                if (len > 0) {
+                /* Read the data from the UART in chunks, leaving room for the terminator */
+                size_t remaining = event.size;
+                while (remaining > 0) {
+                    size_t read_size = remaining < sizeof(buf) - 1 ? remaining : sizeof(buf) - 1;
+                    int len = uart_read_bytes(u->config.uart_num, 
+                        &buf, read_size, pdMS_TO_TICKS(100));
+                    if (len <= 0) {
+                        break;
+                    }
                     buf[len] = '\0';
-                    lwlte_core_input(buf, len);
+                    u->config.rx_fn(u->config.rx_ctx, buf, len);
+                    remaining -= len;
                 }
             }
         }
     }
+    LWLTE_LOGI(TAG, "lwlte_ll_uart_rx_task exits.");
+    lwlte_sys_semaphore_signal(u->uart_rx_task_exited);
 }
 
-lwlte_err_t lwlte_ll_uart_write(const char* data, size_t size)
+lwlte_err_t lwlte_ll_uart_write(lwlte_ll_uart_t uart, const char* data, size_t size)
 {
-    if (uart_write_bytes(s_lwlte_ll_uart_context.config.uart_num, data, size) < 0) {
+    lwlte_ll_uart_ctx_t* u = (lwlte_ll_uart_ctx_t*)uart;
+    if (u == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    if (uart_write_bytes(u->config.uart_num, data, size) < 0) {
         return LWLTE_ERROR;
     }
     return LWLTE_OK;
 }
 
-lwlte_err_t lwlte_ll_uart_init(lwlte_ll_uart_config_t *config)
+lwlte_err_t lwlte_ll_uart_init(const lwlte_ll_uart_config_t *config, lwlte_ll_uart_t* uart)
 {
+    if (config == NULL || config->rx_fn == NULL || uart == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
     /* Initialize the context */
-    s_lwlte_ll_uart_context.config = *config;
+    lwlte_ll_uart_ctx_t* u = lwlte_sys_mem_malloc(sizeof(lwlte_ll_uart_ctx_t));
+    if (u == NULL) {
+        return LWLTE_ERROR;
+    }
+    memset(u, 0, sizeof(lwlte_ll_uart_ctx_t));
+    u->config = *config;
     /* Install the UART driver */
-    ESP_ERROR_CHECK(uart_driver_install(s_lwlte_ll_uart_context.config.uart_num,
-                                  s_lwlte_ll_uart_context.config.uart_buf_size,
-                                  s_lwlte_ll_uart_context.config.uart_buf_size,
+    ESP_ERROR_CHECK(uart_driver_install(u->config.uart_num,
+                                  u->config.uart_buf_size,
+                                  u->config.uart_buf_size,
                                       10, 
-                                      &s_lwlte_ll_uart_context.uart_rx_queue,
+                                      &u->uart_rx_queue,
                                 0));
     /* Configure the UART parameters */
-    ESP_ERROR_CHECK(uart_param_config(s_lwlte_ll_uart_context.config.uart_num, 
-        &s_lwlte_ll_uart_context.config.uart_config));
+    ESP_ERROR_CHECK(uart_param_config(u->config.uart_num, 
+        &u->config.uart_config));
     /* Set the UART pins */
-    ESP_ERROR_CHECK(uart_set_pin(s_lwlte_ll_uart_context.config.uart_num, 
-        s_lwlte_ll_uart_context.config.uart_tx_io_num, 
-        s_lwlte_ll_uart_context.config.uart_rx_io_num, 
+    ESP_ERROR_CHECK(uart_set_pin(u->config.uart_num, 
+        u->config.uart_tx_io_num, 
+        u->config.uart_rx_io_num, 
         UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
     /* Create the UART RX task */
-    xTaskCreate(lwlte_ll_uart_rx_task, "lwlte_ll_uart_rx_task", 4096,
-        NULL, tskIDLE_PRIORITY + 10, &s_lwlte_ll_uart_context.uart_rx_task_handle);
+    u->uart_rx_task_stop = false;
+    u->uart_rx_task_exited = lwlte_sys_semaphore_create();
+    u->config.rx_task_config.arg = u;
+    u->uart_rx_task_handle = lwlte_sys_thread_create(lwlte_ll_uart_rx_task, 
+        &u->config.rx_task_config);
+    /* The handle is returned even on failure, lwlte_ll_uart_deinit releases what was set up */
+    *uart = u;
+    if (u->uart_rx_task_handle == NULL) {
+        LWLTE_LOGE(TAG, "Failed to create the UART RX task.");
+        return LWLTE_ERROR;
+    }
     LWLTE_LOGI(TAG, "lwlte_ll_uart_init completed.");
     return ESP_OK;
 }
 
-lwlte_err_t lwlte_ll_uart_deinit(lwlte_base_type_t uart_num)
+lwlte_err_t lwlte_ll_uart_deinit(lwlte_ll_uart_t uart)
 {
-    ESP_ERROR_CHECK(uart_driver_delete(uart_num));
+    lwlte_ll_uart_ctx_t* u = (lwlte_ll_uart_ctx_t*)uart;
+    if (u == NULL) {
+        return LWLTE_OK;
+    }
+    /* Stop the RX task before the driver (and its event queue) goes away */
+    if (u->uart_rx_task_handle != NULL) {
+        u->uart_rx_task_stop = true;
+        /* The task still uses the context and the driver, leak them rather than delete them under the task */
+        if (!lwlte_sys_semaphore_wait(u->uart_rx_task_exited, LWLTE_LL_UART_STOP_TIMEOUT_MS)) {
+            LWLTE_LOGE(TAG, "lwlte_ll_uart_rx_task did not stop in time.");
+            return LWLTE_TIMEOUT;
+        }
+        u->uart_rx_task_handle = NULL;
+    }
+    lwlte_sys_semaphore_delete(u->uart_rx_task_exited);
+    if (u->uart_rx_queue != NULL) {
+        ESP_ERROR_CHECK(uart_driver_delete(u->config.uart_num));
+    }
+    lwlte_sys_mem_free(u);
     LWLTE_LOGI(TAG, "lwlte_ll_uart_deinit completed.");
     return ESP_OK;
 }
 
-lwlte_err_t lwlte_ll_gpio_init(lwlte_base_type_t gpio_num)
+lwlte_err_t lwlte_ll_gpio_init(lwlte_base_type_t gpio_num, lwlte_base_type_t level)
 {
     gpio_reset_pin(gpio_num);
+    /* Set the level before enabling the output so that a powered module does not see a glitch */
+    gpio_set_level(gpio_num, level);
     gpio_set_direction(gpio_num, GPIO_MODE_OUTPUT);
-    gpio_set_level(gpio_num, 0);
-    vTaskDelay(pdMS_TO_TICKS(1000));
-    gpio_set_level(gpio_num, 1);
     LWLTE_LOGI(TAG, "lwlte_ll_gpio_init completed.");
     return LWLTE_OK;
 }
 
+lwlte_err_t lwlte_ll_gpio_set_level(lwlte_base_type_t gpio_num, lwlte_base_type_t level)
+{
+    if (gpio_set_level(gpio_num, level) != ESP_OK) {
+        return LWLTE_ERROR;
+    }
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_ll_gpio_deinit(lwlte_base_type_t gpio_num)
+{
+    /* Hold the module powered off */
+    gpio_set_level(gpio_num, 0);
+    LWLTE_LOGI(TAG, "lwlte_ll_gpio_deinit completed.");
+    return LWLTE_OK;
+}
+
@@ -0,0 +1,45 @@
+/*
+    File: lwlte_sys_hash.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Hash encapsulation source file
+    Platform: ESP-IDF
+*/
+#include "lwlte_sys_hash.h"
+#include "lwlte_sys_mem.h"
+#include "mbedtls/sha256.h"
+
+lwlte_sys_sha256_t lwlte_sys_sha256_create(void)
+{
+    mbedtls_sha256_context* ctx = lwlte_sys_mem_malloc(sizeof(mbedtls_sha256_context));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    mbedtls_sha256_init(ctx);
+    if (mbedtls_sha256_starts(ctx, 0) != 0) {
+        mbedtls_sha256_free(ctx);
+        lwlte_sys_mem_free(ctx);
+        return NULL;
+    }
+    return (lwlte_sys_sha256_t)ctx;
+}
+
+void lwlte_sys_sha256_delete(lwlte_sys_sha256_t h)
+{
+    if (!h) return;
+    mbedtls_sha256_free((mbedtls_sha256_context*)h);
+    lwlte_sys_mem_free(h);
+}
+
+void lwlte_sys_sha256_update(lwlte_sys_sha256_t h, const void* data, size_t len)
+{
+    if (!h) return;
+    mbedtls_sha256_update((mbedtls_sha256_context*)h, (const unsigned char*)data, len);
+}
+
+void lwlte_sys_sha256_finish(lwlte_sys_sha256_t h, uint8_t digest[LWLTE_SYS_SHA256_SIZE])
+{
+    if (!h) return;
+    mbedtls_sha256_finish((mbedtls_sha256_context*)h, digest);
+    mbedtls_sha256_starts((mbedtls_sha256_context*)h, 0);
+}
@@ -36,6 +36,24 @@ void lwlte_sys_mutex_delete(lwlte_sys_mutex_t m) {
     vSemaphoreDelete((SemaphoreHandle_t)m);
 }
 
+static StaticSemaphore_t s_lwlte_sys_global_lock_buf;
+static SemaphoreHandle_t s_lwlte_sys_global_lock;
+static portMUX_TYPE s_lwlte_sys_global_lock_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void lwlte_sys_global_lock(void) {
+    /* The static creation neither blocks nor allocates, so it may run in the critical section */
+    portENTER_CRITICAL(&s_lwlte_sys_global_lock_mux);
+    if (s_lwlte_sys_global_lock == NULL) {
+        s_lwlte_sys_global_lock = xSemaphoreCreateMutexStatic(&s_lwlte_sys_global_lock_buf);
+    }
+    portEXIT_CRITICAL(&s_lwlte_sys_global_lock_mux);
+    xSemaphoreTake(s_lwlte_sys_global_lock, portMAX_DELAY);
+}
+
+void lwlte_sys_global_unlock(void) {
+    xSemaphoreGive(s_lwlte_sys_global_lock);
+}
+
 lwlte_sys_mutex_t lwlte_sys_semaphore_create(void)
 {
     SemaphoreHandle_t s = xSemaphoreCreateBinary();
@@ -49,11 +67,11 @@ void lwlte_sys_semaphore_signal(lwlte_sys_semaphore_t s) {
     xSemaphoreGive((SemaphoreHandle_t)s);
 }
 
-void lwlte_sys_semaphore_wait(lwlte_sys_semaphore_t s, BaseType_t timeout_ms) {
+bool lwlte_sys_semaphore_wait(lwlte_sys_semaphore_t s, BaseType_t timeout_ms) {
     if (s == NULL) {
-        return;
+        return false;
     }
-    xSemaphoreTake((SemaphoreHandle_t)s, pdMS_TO_TICKS(timeout_ms));
+    return xSemaphoreTake((SemaphoreHandle_t)s, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
 }
 
 void lwlte_sys_semaphore_delete(lwlte_sys_semaphore_t s) {
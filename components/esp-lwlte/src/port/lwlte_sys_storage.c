@@ -0,0 +1,176 @@
+/*
+    File: lwlte_sys_storage.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Storage encapsulation source file
+    Platform: ESP-IDF
+*/
+#include "lwlte_sys_storage.h"
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Bytes written at a time when a file is filled or erased */
+#define LWLTE_SYS_STORAGE_FILL_CHUNK 256
+
+static lwlte_err_t lwlte_sys_partition_read(void* ctx, uint32_t offset, void* data, size_t size)
+{
+    return esp_partition_read((const esp_partition_t*)ctx, offset, data, size) == ESP_OK ? LWLTE_OK : LWLTE_ERROR;
+}
+
+static lwlte_err_t lwlte_sys_partition_write(void* ctx, uint32_t offset, const void* data, size_t size)
+{
+    return esp_partition_write((const esp_partition_t*)ctx, offset, data, size) == ESP_OK ? LWLTE_OK : LWLTE_ERROR;
+}
+
+static lwlte_err_t lwlte_sys_partition_erase(void* ctx, uint32_t offset, size_t size)
+{
+    return esp_partition_erase_range((const esp_partition_t*)ctx, offset, size) == ESP_OK ? LWLTE_OK : LWLTE_ERROR;
+}
+
+lwlte_err_t lwlte_sys_storage_partition_open(const char* label, lwlte_sys_storage_t* storage)
+{
+    if (label == NULL || storage == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL) {
+        return LWLTE_NOT_FOUND;
+    }
+    *storage = (lwlte_sys_storage_t){
+        .read = lwlte_sys_partition_read,
+        .write = lwlte_sys_partition_write,
+        .erase = lwlte_sys_partition_erase,
+        .size = partition->size - partition->size % partition->erase_size,
+        .sector_size = partition->erase_size,
+        .ctx = (void*)partition,
+    };
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_sys_storage_update_partition_open(lwlte_sys_storage_t* storage)
+{
+    if (storage == NULL) {
+        return LWLTE_INVALID_ARG;
+    }
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+    if (partition == NULL) {
+        return LWLTE_NOT_FOUND;
+    }
+    *storage = (lwlte_sys_storage_t){
+        .read = lwlte_sys_partition_read,
+        .write = lwlte_sys_partition_write,
+        .erase = lwlte_sys_partition_erase,
+        .size = partition->size - partition->size % partition->erase_size,
+        .sector_size = partition->erase_size,
+        .ctx = (void*)partition,
+    };
+    return LWLTE_OK;
+}
+
+lwlte_err_t lwlte_sys_storage_update_partition_activate(const lwlte_sys_storage_t* storage)
+{
+    if (storage == NULL || storage->read != lwlte_sys_partition_read) {
+        return LWLTE_INVALID_ARG;
+    }
+    return esp_ota_set_boot_partition((const esp_partition_t*)storage->ctx) == ESP_OK ? LWLTE_OK : LWLTE_ERROR;
+}
+
+static lwlte_err_t lwlte_sys_file_read(void* ctx, uint32_t offset, void* data, size_t size)
+{
+    FILE* f = (FILE*)ctx;
+    if (fseek(f, offset, SEEK_SET) != 0 || fread(data, 1, size, f) != size) {
+        return LWLTE_ERROR;
+    }
+    return LWLTE_OK;
+}
+
+/* Clear bits only, as flash does, so that the file behaves like the partition */
+static lwlte_err_t lwlte_sys_file_write(void* ctx, uint32_t offset, const void* data, size_t size)
+{
+    FILE* f = (FILE*)ctx;
+    uint8_t chunk[LWLTE_SYS_STORAGE_FILL_CHUNK];
+    const uint8_t* src = (const uint8_t*)data;
+    while (size > 0) {
+        size_t n = size < sizeof(chunk) ? size : sizeof(chunk);
+        if (lwlte_sys_file_read(ctx, offset, chunk, n) != LWLTE_OK) {
+            return LWLTE_ERROR;
+        }
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] &= src[i];
+        }
+        if (fseek(f, offset, SEEK_SET) != 0 || fwrite(chunk, 1, n, f) != n) {
+            return LWLTE_ERROR;
+        }
+        offset += n;
+        src += n;
+        size -= n;
+    }
+    return fflush(f) == 0 ? LWLTE_OK : LWLTE_ERROR;
+}
+
+static lwlte_err_t lwlte_sys_file_fill(FILE* f, uint32_t offset, size_t size)
+{
+    uint8_t chunk[LWLTE_SYS_STORAGE_FILL_CHUNK];
+    memset(chunk, 0xFF, sizeof(chunk));
+    if (fseek(f, offset, SEEK_SET) != 0) {
+        return LWLTE_ERROR;
+    }
+    while (size > 0) {
+        size_t n = size < sizeof(chunk) ? size : sizeof(chunk);
+        if (fwrite(chunk, 1, n, f) != n) {
+            return LWLTE_ERROR;
+        }
+        size -= n;
+    }
+    return fflush(f) == 0 ? LWLTE_OK : LWLTE_ERROR;
+}
+
+static lwlte_err_t lwlte_sys_file_erase(void* ctx, uint32_t offset, size_t size)
+{
+    return lwlte_sys_file_fill((FILE*)ctx, offset, size);
+}
+
+lwlte_err_t lwlte_sys_storage_file_open(const char* path, uint32_t size, uint32_t sector_size, lwlte_sys_storage_t* storage)
+{
+    if (path == NULL || storage == NULL || sector_size == 0 || size < sector_size) {
+        return LWLTE_INVALID_ARG;
+    }
+    size -= size % sector_size;
+    FILE* f = fopen(path, "r+b");
+    if (f == NULL) {
+        f = fopen(path, "w+b");
+        if (f == NULL) {
+            return LWLTE_ERROR;
+        }
+    }
+    /* A new or shorter file is extended with erased bytes */
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return LWLTE_ERROR;
+    }
+    long length = ftell(f);
+    if (length >= 0 && (uint32_t)length < size && lwlte_sys_file_fill(f, length, size - length) != LWLTE_OK) {
+        fclose(f);
+        return LWLTE_ERROR;
+    }
+    *storage = (lwlte_sys_storage_t){
+        .read = lwlte_sys_file_read,
+        .write = lwlte_sys_file_write,
+        .erase = lwlte_sys_file_erase,
+        .size = size,
+        .sector_size = sector_size,
+        .ctx = f,
+    };
+    return LWLTE_OK;
+}
+
+void lwlte_sys_storage_file_close(lwlte_sys_storage_t* storage)
+{
+    if (storage == NULL || storage->ctx == NULL) {
+        return;
+    }
+    fclose((FILE*)storage->ctx);
+    storage->ctx = NULL;
+}
@@ -9,6 +9,7 @@
 #include "lwlte_sys_types.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_random.h"
 
 /* 用一个 trampoline 包一层，避免直接暴露 FreeRTOS 语义 */
 typedef struct {
@@ -28,6 +29,16 @@ static void lwlte_thread_trampoline(void* p)
     vTaskDelete(NULL);
 }
 
+void lwlte_sys_thread_cfg_apply(lwlte_sys_thread_cfg_t* cfg, const lwlte_task_config_t* task_config, const char* name, 
+    uint32_t default_stack_size, uint32_t default_priority, void* arg)
+{
+    cfg->name = name;
+    cfg->stack_size = task_config->stack_size > 0 ? task_config->stack_size : default_stack_size;
+    cfg->priority = task_config->priority > 0 ? task_config->priority : default_priority;
+    cfg->core_id = task_config->pin_to_core ? task_config->core_id : LWLTE_SYS_THREAD_NO_AFFINITY;
+    cfg->arg = arg;
+}
+
 lwlte_sys_thread_t lwlte_sys_thread_create(lwlte_sys_thread_fn_t fn, const lwlte_sys_thread_cfg_t* cfg)
 {
     if (!fn || !cfg) {
@@ -44,13 +55,14 @@ lwlte_sys_thread_t lwlte_sys_thread_create(lwlte_sys_thread_fn_t fn, const lwlte
     w->arg = cfg->arg;
 
     TaskHandle_t th = NULL;
-    BaseType_t ok = xTaskCreate(
+    BaseType_t ok = xTaskCreatePinnedToCore(
         lwlte_thread_trampoline,
         cfg->name ? cfg->name : "lwlte",
         cfg->stack_size / sizeof(StackType_t),
         (void*)w,
         (UBaseType_t)cfg->priority,
-        &th
+        &th,
+        cfg->core_id == LWLTE_SYS_THREAD_NO_AFFINITY ? tskNO_AFFINITY : (BaseType_t)cfg->core_id
     );
 
     if (ok != pdPASS) {
@@ -80,3 +92,8 @@ lwlte_tick_t lwlte_sys_time_get_ms(void)
 {
     return xTaskGetTickCount() * portTICK_PERIOD_MS;
 }
+
+uint32_t lwlte_sys_random(void)
+{
+    return esp_random();
+}
@@ -0,0 +1,93 @@
+/*
+    File: lwlte_sys_timer.c
+    Author: JovisDreams
+    Date: 2026-10-19
+    Description: System Timer encapsulation source file
+    Platform: ESP-IDF
+*/
+#include "lwlte_sys_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+
+/* Commands to the timer service task are not expected to block for long */
+#define LWLTE_SYS_TIMER_CMD_TIMEOUT_MS 100
+
+typedef struct {
+    TimerHandle_t handle;
+    lwlte_sys_timer_fn_t fn;
+    void* arg;
+    volatile bool dead; // deleted, a callback that was already due does nothing
+} lwlte_timer_wrap_t;
+
+static TickType_t ms_to_ticks(uint32_t ms)
+{
+    TickType_t t = pdMS_TO_TICKS(ms);
+    return (t == 0) ? 1 : t;
+}
+
+static void lwlte_timer_trampoline(TimerHandle_t handle)
+{
+    lwlte_timer_wrap_t* w = (lwlte_timer_wrap_t*)pvTimerGetTimerID(handle);
+    if (w->dead) {
+        return;
+    }
+    w->fn(w->arg);
+}
+
+/* Runs in the timer service task after the delete command, no callback of the timer can run any more */
+static void lwlte_timer_free(void* param1, uint32_t param2)
+{
+    (void)param2;
+    vPortFree(param1);
+}
+
+lwlte_sys_timer_t lwlte_sys_timer_create(const char* name, uint32_t period_ms, bool auto_reload,
+    lwlte_sys_timer_fn_t fn, void* arg)
+{
+    if (!fn) {
+        return NULL;
+    }
+    lwlte_timer_wrap_t* w = (lwlte_timer_wrap_t*)pvPortMalloc(sizeof(lwlte_timer_wrap_t));
+    if (!w) {
+        return NULL;
+    }
+    w->fn = fn;
+    w->arg = arg;
+    w->dead = false;
+    w->handle = xTimerCreate(name ? name : "lwlte", ms_to_ticks(period_ms),
+        auto_reload ? pdTRUE : pdFALSE, (void*)w, lwlte_timer_trampoline);
+    if (!w->handle) {
+        vPortFree(w);
+        return NULL;
+    }
+    return (lwlte_sys_timer_t)w;
+}
+
+void lwlte_sys_timer_delete(lwlte_sys_timer_t t)
+{
+    if (!t) return;
+    lwlte_timer_wrap_t* w = (lwlte_timer_wrap_t*)t;
+    w->dead = true;
+    /* The timer task may be in the callback or have the delete queued, the wrapper is freed by the timer task
+       once it has processed the delete. If a command cannot be queued the wrapper is leaked */
+    if (xTimerDelete(w->handle, pdMS_TO_TICKS(LWLTE_SYS_TIMER_CMD_TIMEOUT_MS)) != pdPASS) {
+        return;
+    }
+    xTimerPendFunctionCall(lwlte_timer_free, w, 0, pdMS_TO_TICKS(LWLTE_SYS_TIMER_CMD_TIMEOUT_MS));
+}
+
+bool lwlte_sys_timer_start(lwlte_sys_timer_t t, uint32_t period_ms)
+{
+    if (!t) return false;
+    lwlte_timer_wrap_t* w = (lwlte_timer_wrap_t*)t;
+    /* Changing the period also starts the timer */
+    return xTimerChangePeriod(w->handle, ms_to_ticks(period_ms),
+        pdMS_TO_TICKS(LWLTE_SYS_TIMER_CMD_TIMEOUT_MS)) == pdPASS;
+}
+
+bool lwlte_sys_timer_stop(lwlte_sys_timer_t t)
+{
+    if (!t) return false;
+    lwlte_timer_wrap_t* w = (lwlte_timer_wrap_t*)t;
+    return xTimerStop(w->handle, pdMS_TO_TICKS(LWLTE_SYS_TIMER_CMD_TIMEOUT_MS)) == pdPASS;
+}